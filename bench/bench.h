@@ -0,0 +1,89 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <chrono>
+
+#define BENCH_WARMUP 3
+#define BENCH_ITERATIONS 20
+#define BENCH_MAX_ITERATIONS 1000
+#define BENCH_MAX_RESULTS 512
+
+static inline f64 bench_now_ms() {
+    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+    return std::chrono::duration<f64, std::milli>(now).count();
+}
+
+// Set from the command line, see main.cpp
+struct BenchOptions {
+    u32 warmup;
+    u32 iterations;
+    const char *suite; // running suite, recorded with each result
+    u32 max_ulps;      // trace tolerance of the equivalence suite
+    f32 epsilon;
+    const char *csv; // output of the sweep suite, null for its default
+};
+
+extern BenchOptions bench_options;
+
+// Per-iteration wall time over the timed iterations
+struct BenchStats {
+    u32 iterations;
+    f64 min_ms;
+    f64 median_ms;
+    f64 p90_ms;
+    f64 p99_ms;
+    f64 max_ms;
+    f64 mean_ms;
+};
+
+// Sorts samples in place
+BenchStats bench_stats(f64 *samples, u32 count);
+
+// Runs fn bench_options.warmup times untimed, then times each of bench_options.iterations calls
+template <typename Fn> BenchStats bench_measure(Fn fn) {
+    for (u32 i = 0; i < bench_options.warmup; i++) fn();
+
+    f64 samples[BENCH_MAX_ITERATIONS];
+    u32 count = bench_options.iterations < BENCH_MAX_ITERATIONS ? bench_options.iterations : BENCH_MAX_ITERATIONS;
+    for (u32 i = 0; i < count; i++) {
+        f64 start = bench_now_ms();
+        fn();
+        samples[i] = bench_now_ms() - start;
+    }
+    return bench_stats(samples, count);
+}
+
+// Prints one line and keeps the result for bench_write_json. items is how many of unit (neurons, synapses, bytes)
+// one iteration processes, reported per second at the median.
+void bench_report(const char *name, const BenchStats &stats, f64 items, const char *unit);
+bool bench_write_json(const char *path);
+
+// Offscreen GL 4.3 context with a width x height framebuffer bound, for the GPU suites. Prefers a surfaceless EGL
+// display (Mesa llvmpipe on a headless box), falls back to a hidden GLFW window. False when neither is available.
+// Also sets up the shader library and streaming buffer, which deinit tears down again.
+bool bench_gl_init(u32 width, u32 height);
+void bench_gl_deinit();
+
+void bench_reorder(usize neuron_count);
+void bench_plasticity(usize neuron_count);
+void bench_models(usize neuron_count);
+void bench_variants(usize neuron_count);
+void bench_storage(usize neuron_count);
+void bench_spatial(usize neuron_count);
+void bench_memory(usize neuron_count);
+void bench_numa(usize neuron_count);
+void bench_distributed(usize neuron_count);
+void bench_kernels(usize neuron_count);
+void bench_serialize(usize neuron_count);
+void bench_generate(usize neuron_count);
+void bench_render(usize neuron_count);
+void bench_equivalence(usize neuron_count);
+void bench_sell(usize neuron_count);
+void bench_inference(usize neuron_count);
+void bench_delays(usize neuron_count);
+void bench_ensemble(usize neuron_count);
+void bench_sweep(usize neuron_count);
+void bench_edits(usize neuron_count);
+void bench_input(usize neuron_count);
+void bench_stats(usize neuron_count);
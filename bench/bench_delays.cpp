@@ -0,0 +1,53 @@
+#include "bench.h"
+#include "cpu_sim.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#define DELAYS_SEED_STRIDE 97 // every n-th neuron starts active
+
+// Threshold ticks with every synapse delayed by 1 to D ticks, for growing D, next to the same rows without delays.
+// The ring grows with D, the time per tick should not.
+void bench_delays(usize neuron_count) {
+    bool gl = bench_gl_init(64, 64);
+    if (!gl) printf("no GL context, skipping the compute shader\n");
+
+    srand(1);
+    Network net;
+    network_init_host(net, neuron_count);
+    for (usize i = 0; i < net.neuron_count; i += DELAYS_SEED_STRIDE) net.neuron_data[i * 4 + 2] = 1.0f;
+    usize synapses = 0;
+    for (usize i = 0; i < net.neuron_count * MAX_SYNAPSES; i++) synapses += net.synapse_data[i] >= 0;
+
+    u8 *delays = (u8 *)malloc(net.neuron_count * MAX_SYNAPSES);
+    u32 ranges[] = {0, 1, 8, NETWORK_MAX_DELAY};
+    char name[64];
+    for (u32 range : ranges) {
+        for (usize i = 0; i < net.neuron_count * MAX_SYNAPSES; i++) delays[i] = range ? 1 + rand() % range : 0;
+        network_set_delays(net, delays);
+        printf("delays %s%u: ring %zu KB\n", range ? "1.." : "", range, net.neuron_count * range * sizeof(f32) >> 10);
+
+        CpuSim sim;
+        cpu_sim_init(sim, net);
+        BenchStats stats = bench_measure([&] { cpu_sim_tick(sim, net); });
+        cpu_sim_deinit(sim);
+        snprintf(name, sizeof(name), "cpu delays %u", range);
+        bench_report(name, stats, (f64)synapses, "synapses");
+
+        if (gl) {
+            network_upload(net);
+            shader_library_finish(global_shader_library);
+            stats = bench_measure([&] {
+                network_tick(net);
+                glFinish();
+            });
+            snprintf(name, sizeof(name), "gpu delays %u", range);
+            bench_report(name, stats, (f64)synapses, "synapses");
+            network_release_remote_resources(net);
+        }
+    }
+    free(delays);
+    network_deinit(net);
+
+    if (gl) bench_gl_deinit();
+}
@@ -0,0 +1,127 @@
+#include "bench.h"
+#include "cpu_sim.hpp"
+#include "distributed.hpp"
+#include "partition.hpp"
+#include "reorder.hpp"
+#include "topology.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define DISTRIBUTED_TICKS 50
+#define DISTRIBUTED_SEED_STRIDE 97 // every n-th neuron starts active
+#define DISTRIBUTED_TCP_PORT 41000
+
+// One rank in a forked child. Checks its neurons against the single-process run, exits non-zero on any difference.
+static void bench_distributed_rank(const Network &net, const usize *bounds, const f32 *expected, TransportKind kind,
+                                   u32 rank, u32 rank_count, const char *shm_name, u16 port) {
+    Transport transport;
+    bool ok = kind == TransportShm ? transport_init_shm(transport, shm_name, rank, rank_count)
+                                   : transport_init_tcp(transport, "127.0.0.1", port, rank, rank_count);
+    DistributedSim dist;
+    if (!ok || !distributed_init(dist, net, bounds, transport)) _exit(2);
+
+    for (int t = 0; t < DISTRIBUTED_TICKS; t++) {
+        if (!distributed_tick(dist)) _exit(3);
+    }
+
+    usize mismatches = 0;
+    for (usize i = dist.begin; i < dist.end; i++) {
+        mismatches += distributed_activation(dist, i) != expected[i];
+    }
+
+    if (rank == 0) {
+        printf("  %-4s rank 0 %9.3f ms/tick (%.3f exchange)  halo %zu  %8.1f spikes/tick  %8.1f KB/tick  "
+               "%.2fx vs u32 lists  %zu bitset %zu delta\n",
+               kind == TransportShm ? "shm" : "tcp", dist.tick_ms / dist.ticks, transport.exchange_ms / dist.ticks,
+               dist.halo_count, (f64)dist.spikes_sent / dist.ticks, dist.bytes_sent / 1024.0 / dist.ticks,
+               dist.bytes_sent ? (f64)dist.raw_bytes / dist.bytes_sent : 0.0, dist.bitset_messages,
+               dist.delta_messages);
+        fflush(stdout);
+    }
+
+    distributed_deinit(dist);
+    transport_deinit(transport);
+    _exit(mismatches ? 1 : 0);
+}
+
+static void bench_distributed_run(const Network &net, const usize *bounds, const f32 *expected, TransportKind kind,
+                                  u32 rank_count) {
+    char shm_name[64];
+    snprintf(shm_name, sizeof(shm_name), "/bench-distributed-%d", (int)getpid());
+    u16 port = (u16)(DISTRIBUTED_TCP_PORT + getpid() % 300 * TRANSPORT_MAX_RANKS);
+
+    fflush(stdout);
+    pid_t children[TRANSPORT_MAX_RANKS];
+    for (u32 rank = 0; rank < rank_count; rank++) {
+        children[rank] = fork();
+        if (children[rank] == 0) bench_distributed_rank(net, bounds, expected, kind, rank, rank_count, shm_name, port);
+    }
+
+    u32 failed = 0;
+    for (u32 rank = 0; rank < rank_count; rank++) {
+        int status = 0;
+        waitpid(children[rank], &status, 0);
+        failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    printf("  %-4s %s\n", kind == TransportShm ? "shm" : "tcp",
+           failed ? "FAILED, ranks differ from the single-process run" : "matches the single-process run");
+}
+
+// Spatial wiring in Hilbert order, split into ranks by contiguous ranges and by the partitioner
+void bench_distributed(usize neuron_count) {
+    for (u32 rank_count = 2; rank_count <= 4; rank_count *= 2) {
+        TopologyParams params = {};
+        params.kind = TopologyParams::Spatial;
+        params.neuron_count = neuron_count;
+        params.degree = MAX_SYNAPSES;
+        params.decay_length = 0.05f;
+        params.seed = 1;
+
+        Topology topo;
+        topology_generate(topo, params);
+        Network net;
+        network_init_host(net, topo);
+        topology_deinit(topo);
+        network_reorder(net, ReorderHilbert);
+        for (usize i = 0; i < net.neuron_count; i += DISTRIBUTED_SEED_STRIDE) {
+            net.neuron_data[i * 4 + 2] = 1.0f;
+        }
+
+        u32 *part = (u32 *)malloc(net.neuron_count * sizeof(u32));
+        usize synapses = 0;
+        for (usize i = 0; i < net.neuron_count * MAX_SYNAPSES; i++) synapses += net.synapse_data[i] >= 0;
+        partition_ranges(net.neuron_count, rank_count, part);
+        usize range_cut = partition_cut(net, part);
+
+        f64 start = bench_now_ms();
+        partition_compute(net, rank_count, part);
+        f64 partition_ms = bench_now_ms() - start;
+        usize cut = partition_cut(net, part);
+        printf("%u ranks: cut %.2f%% of synapses as ranges, %.2f%% partitioned (%.1f ms)\n", rank_count,
+               100.0 * range_cut / synapses, 100.0 * cut / synapses, partition_ms);
+
+        u32 *order = (u32 *)malloc(net.neuron_count * sizeof(u32));
+        usize bounds[TRANSPORT_MAX_RANKS + 1];
+        partition_order(net, part, rank_count, order, bounds);
+        network_permute(net, order);
+        free(order);
+        free(part);
+
+        CpuSim sim;
+        cpu_sim_init(sim, net);
+        start = bench_now_ms();
+        for (int t = 0; t < DISTRIBUTED_TICKS; t++) cpu_sim_tick(sim, net);
+        printf("  single process %9.3f ms/tick\n", (bench_now_ms() - start) / DISTRIBUTED_TICKS);
+
+        bench_distributed_run(net, bounds, sim.activation, TransportShm, rank_count);
+        bench_distributed_run(net, bounds, sim.activation, TransportTcp, rank_count);
+
+        cpu_sim_deinit(sim);
+        network_deinit(net);
+    }
+}
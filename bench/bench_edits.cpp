@@ -0,0 +1,119 @@
+#include "bench.h"
+#include "network_edit.hpp"
+#include "streaming.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define EDITS_SPARE_NEURONS 16 // free slots per 1024 neurons, for the neuron churn runs
+
+// Prunes the synapse in a random slot of a random row, if there is one, and grows one from a random source
+static void bench_edits_synapses(NetworkEditor &editor, Network &net, usize count) {
+    for (usize e = 0; e < count; e++) {
+        u32 neuron = (u32)(rand() % net.neuron_count);
+        network_editor_remove_synapse(editor, net, neuron * MAX_SYNAPSES + rand() % MAX_SYNAPSES);
+        u32 source = (u32)(rand() % net.neuron_count);
+        network_editor_add_synapse(editor, net, (u32)(rand() % net.neuron_count), source, (f32)rand() / RAND_MAX);
+    }
+}
+
+// Removes random neurons and brings as many free ones to life with a few synapses each
+static void bench_edits_neurons(NetworkEditor &editor, Network &net, usize count) {
+    for (usize e = 0; e < count; e++) network_editor_remove_neuron(editor, net, (u32)(rand() % net.neuron_count));
+    for (usize e = 0; e < count; e++) {
+        u32 neuron = network_editor_add_neuron(editor, net, 0.0f, 0.0f, 0.5f);
+        if (neuron == NETWORK_EDIT_NONE) break;
+        for (int j = 0; j < 4; j++) {
+            network_editor_add_synapse(editor, net, neuron, (u32)(rand() % net.neuron_count), 0.25f);
+        }
+    }
+}
+
+static bool bench_edits_match(const Network &net) {
+    usize slots = net.neuron_count * MAX_SYNAPSES;
+    i32 *targets = (i32 *)malloc(slots * sizeof(i32));
+    f32 *weights = (f32 *)malloc(slots * sizeof(f32));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.synapse_buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, slots * sizeof(i32), targets);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.weight_buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, slots * sizeof(f32), weights);
+    bool match = memcmp(targets, net.synapse_data, slots * sizeof(i32)) == 0 &&
+                 memcmp(weights, net.weight_data, slots * sizeof(f32)) == 0;
+    free(targets);
+    free(weights);
+    return match;
+}
+
+// Synapses whose presynaptic neuron is dead, which every flush should have cleared
+static usize bench_edits_dangling(const NetworkEditor &editor, const Network &net) {
+    usize dangling = 0;
+    for (usize slot = 0; slot < net.neuron_count * MAX_SYNAPSES; slot++) {
+        i32 source = net.synapse_data[slot];
+        dangling += source >= 0 && !(editor.alive[source / 64] >> (source % 64) & 1);
+    }
+    return dangling;
+}
+
+// A frame of random topology edits flushed as coalesced partial uploads, for growing edit counts, against the full
+// re-upload the edits would otherwise need. Synapse edits prune and grow one synapse each; neuron churn removes and
+// adds neurons, so its flushes also clear the synapses onto the removed ones.
+void bench_edits(usize neuron_count) {
+    if (!bench_gl_init(64, 64)) {
+        printf("no GL context, skipping\n");
+        return;
+    }
+
+    srand(1);
+    Network net;
+    network_init_host(net, neuron_count);
+    network_upload(net);
+    NetworkEditor editor;
+    network_editor_init(editor, net);
+    network_editor_reserve(editor, net, neuron_count + neuron_count / 1024 * EDITS_SPARE_NEURONS);
+    shader_library_finish(global_shader_library);
+
+    BenchStats stats = bench_measure([&] {
+        network_upload(net);
+        glFinish();
+    });
+    bench_report("full upload", stats, (f64)net.neuron_count, "neurons");
+
+    usize counts[] = {16, 256, 4096};
+    char name[64];
+    for (usize count : counts) {
+        stats = bench_measure([&] {
+            bench_edits_synapses(editor, net, count);
+            network_editor_flush(editor, net);
+            stream_buffer_frame(global_stream_buffer);
+            glFinish();
+        });
+        snprintf(name, sizeof(name), "synapse edits %zu", count);
+        bench_report(name, stats, (f64)count, "edits");
+        printf("  last flush: %zu runs, %zu KB\n", editor.flush_runs, editor.flush_bytes >> 10);
+        assert(editor.flush_runs <= count);
+    }
+
+    for (usize count : counts) {
+        if (count > editor.capacity / 1024 * EDITS_SPARE_NEURONS) break;
+        stats = bench_measure([&] {
+            bench_edits_neurons(editor, net, count);
+            network_editor_flush(editor, net);
+            stream_buffer_frame(global_stream_buffer);
+            glFinish();
+        });
+        snprintf(name, sizeof(name), "neuron churn %zu", count);
+        bench_report(name, stats, (f64)count, "neurons");
+        printf("  last flush: %zu runs, %zu KB, %zu synapses swept\n", editor.flush_runs, editor.flush_bytes >> 10,
+               editor.flush_swept);
+        assert(editor.flush_runs <= count);
+    }
+
+    printf("gpu rows %s\n", bench_edits_match(net) ? "match the host" : "DIFFER from the host");
+    printf("%zu synapses read a removed neuron\n", bench_edits_dangling(editor, net));
+
+    network_editor_deinit(editor);
+    network_deinit(net);
+    bench_gl_deinit();
+}
@@ -0,0 +1,173 @@
+#include "bench.h"
+#include "ensemble.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#define ENSEMBLE_MEMBER_NEURONS (MAX_NEURONS / 32) // the size of the app's demo network
+#define ENSEMBLE_SEED_STRIDE 7                     // every n-th neuron starts active
+#define SWEEP_GAINS 16
+#define SWEEP_TAUS 16
+#define SWEEP_TICKS 1000
+#define SWEEP_STIMULUS_PERIOD 120 // ticks between stimuli of each member's first neuron, as in network_update
+#define SWEEP_DEFAULT_CSV "sweep.csv"
+
+// LIF members on a grid of input gains and membrane time constants, member m at gain m % SWEEP_GAINS
+static void bench_ensemble_members(Network *members, NeuronModelParams *params, usize count, usize member_neurons) {
+    srand(1);
+    for (usize m = 0; m < count; m++) {
+        params[m] = neuron_model_default_params(NeuronModelLif);
+        params[m].input_gain = 0.25f + 0.125f * (m % SWEEP_GAINS);
+        params[m].tau = 2.0f + 2.0f * (m / SWEEP_GAINS % SWEEP_TAUS);
+        network_init_host(members[m], member_neurons, params[m]);
+    }
+}
+
+// The same small networks ticked one at a time, each through its own sim or dispatch, and packed into one ensemble
+// ticked in a single parallel loop or dispatch
+void bench_ensemble(usize neuron_count) {
+    bool gl = bench_gl_init(64, 64);
+    if (!gl) printf("no GL context, skipping the compute shader\n");
+
+    usize count = neuron_count / ENSEMBLE_MEMBER_NEURONS;
+    if (count == 0) count = 1;
+    Network *members = (Network *)malloc(count * sizeof(Network));
+    NeuronModelParams *params = (NeuronModelParams *)malloc(count * sizeof(NeuronModelParams));
+    bench_ensemble_members(members, params, count, ENSEMBLE_MEMBER_NEURONS);
+    for (usize m = 0; m < count; m++) {
+        for (usize i = 0; i < ENSEMBLE_MEMBER_NEURONS; i += ENSEMBLE_SEED_STRIDE) {
+            members[m].neuron_data[i * 4 + 2] = 1.0f;
+        }
+    }
+    usize total = count * ENSEMBLE_MEMBER_NEURONS;
+    printf("%zu networks of %d neurons\n", count, ENSEMBLE_MEMBER_NEURONS);
+
+    CpuSim *sims = (CpuSim *)malloc(count * sizeof(CpuSim));
+    for (usize m = 0; m < count; m++) cpu_sim_init(sims[m], members[m]);
+    BenchStats stats = bench_measure([&] {
+        for (usize m = 0; m < count; m++) cpu_sim_tick(sims[m], members[m]);
+    });
+    bench_report("cpu per network", stats, (f64)total, "neurons");
+    for (usize m = 0; m < count; m++) cpu_sim_deinit(sims[m]);
+    free(sims);
+
+    Ensemble ens;
+    ensemble_init(ens, members, params, count);
+    CpuSim sim;
+    ensemble_sim_init(ens, sim);
+    stats = bench_measure([&] { ensemble_tick_cpu(ens, sim); });
+    bench_report("cpu ensemble", stats, (f64)total, "neurons");
+    cpu_sim_deinit(sim);
+
+    if (gl) {
+        for (usize m = 0; m < count; m++) network_upload(members[m]);
+        shader_library_finish(global_shader_library);
+        stats = bench_measure([&] {
+            for (usize m = 0; m < count; m++) network_tick(members[m]);
+            glFinish();
+        });
+        bench_report("gpu per network", stats, (f64)total, "neurons");
+        for (usize m = 0; m < count; m++) network_release_remote_resources(members[m]);
+
+        ensemble_upload(ens);
+        shader_library_finish(global_shader_library);
+        stats = bench_measure([&] {
+            ensemble_tick(ens);
+            glFinish();
+        });
+        bench_report("gpu ensemble", stats, (f64)total, "neurons");
+    }
+
+    ensemble_deinit(ens);
+    for (usize m = 0; m < count; m++) network_deinit(members[m]);
+    free(members);
+    free(params);
+
+    if (gl) bench_gl_deinit();
+}
+
+// Stimulates the first neuron of every member, as network_update does for the app's single network
+static void bench_sweep_stimulate(const Ensemble &ens, CpuSim *sim, u32 *indices) {
+    for (usize m = 0; m < ens.member_count; m++) {
+        indices[m] = (u32)ens.offsets[m];
+        if (sim) sim->activation[indices[m]] = 1.0f;
+    }
+}
+
+static usize bench_sweep_mismatches(const EnsembleStats &a, const EnsembleStats &b, usize count) {
+    usize mismatches = 0;
+    for (usize m = 0; m < count; m++) {
+        mismatches += a.spikes[m] != b.spikes[m] || a.peak_spikes[m] != b.peak_spikes[m] ||
+                      a.active_ticks[m] != b.active_ticks[m] || a.activation_sum[m] != b.activation_sum[m];
+    }
+    return mismatches;
+}
+
+// Headless parameter sweep: a grid of SWEEP_GAINS x SWEEP_TAUS LIF networks sharing neuron_count neurons, run for
+// SWEEP_TICKS as one ensemble on the CPU and, with a GL context, on the GPU. Strict precision, so both engines
+// produce the same rows. Per-network stats go to --csv, or sweep.csv.
+void bench_sweep(usize neuron_count) {
+    bool gl = bench_gl_init(64, 64);
+    if (!gl) printf("no GL context, sweeping on the CPU only\n");
+
+    usize count = SWEEP_GAINS * SWEEP_TAUS;
+    usize member_neurons = neuron_count / count ? neuron_count / count : 1;
+    Network *members = (Network *)malloc(count * sizeof(Network));
+    NeuronModelParams *params = (NeuronModelParams *)malloc(count * sizeof(NeuronModelParams));
+    bench_ensemble_members(members, params, count, member_neurons);
+
+    Ensemble ens;
+    ensemble_init(ens, members, params, count, KernelPrecisionStrict);
+    for (usize m = 0; m < count; m++) network_deinit(members[m]);
+    free(members);
+    free(params);
+    printf("%zu networks of %zu neurons, %d ticks\n", count, member_neurons, SWEEP_TICKS);
+
+    u32 *indices = (u32 *)malloc(count * sizeof(u32));
+    const char *path = bench_options.csv ? bench_options.csv : SWEEP_DEFAULT_CSV;
+
+    EnsembleStats cpu_stats;
+    ensemble_stats_init(cpu_stats, ens);
+    CpuSim sim;
+    ensemble_sim_init(ens, sim);
+    f64 start = bench_now_ms();
+    for (int t = 0; t < SWEEP_TICKS; t++) {
+        if (t % SWEEP_STIMULUS_PERIOD == 0) bench_sweep_stimulate(ens, &sim, indices);
+        ensemble_tick_cpu(ens, sim);
+        ensemble_record(cpu_stats, ens, sim);
+    }
+    printf("cpu: %.1f ms\n", bench_now_ms() - start);
+    cpu_sim_deinit(sim);
+    bool written = ensemble_write_csv(ens, cpu_stats, path, "cpu");
+
+    if (gl) {
+        EnsembleStats gpu_stats;
+        ensemble_stats_init(gpu_stats, ens);
+        ensemble_upload(ens);
+        shader_library_finish(global_shader_library);
+        start = bench_now_ms();
+        for (int t = 0; t < SWEEP_TICKS; t++) {
+            if (t % SWEEP_STIMULUS_PERIOD == 0) {
+                bench_sweep_stimulate(ens, nullptr, indices);
+                network_stimulate(ens.net, indices, count);
+            }
+            ensemble_tick(ens);
+            ensemble_record_gpu(gpu_stats, ens);
+        }
+        printf("gpu: %.1f ms with a readback per tick, %zu of %zu networks differ from the cpu\n",
+               bench_now_ms() - start, bench_sweep_mismatches(cpu_stats, gpu_stats, count), count);
+        written = written && ensemble_write_csv(ens, gpu_stats, path, "gpu", true);
+        ensemble_stats_deinit(gpu_stats);
+    }
+    if (written) printf("wrote %s\n", path);
+
+    usize silent = 0;
+    for (usize m = 0; m < count; m++) silent += cpu_stats.spikes[m] == 0;
+    printf("%zu networks never fired\n", silent);
+
+    ensemble_stats_deinit(cpu_stats);
+    free(indices);
+    ensemble_deinit(ens);
+
+    if (gl) bench_gl_deinit();
+}
@@ -0,0 +1,204 @@
+#include "bench.h"
+#include "activation_trace.hpp"
+#include "cpu_sim.hpp"
+#include "sell.hpp"
+#include "storage_format.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define EQUIVALENCE_TICKS 100
+#define EQUIVALENCE_SEED 7
+#define EQUIVALENCE_SEED_STRIDE 97 // every n-th neuron starts active
+#define EQUIVALENCE_FAKE_NODES 4
+#define EQUIVALENCE_MAX_DELAY 8
+
+static void bench_equivalence_print(const char *engine, const ActivationDiff &diff) {
+    if (diff.equal) {
+        printf("  %-22s matches over %zu ticks, max error %g (%u ulps)\n", engine, diff.ticks_compared,
+               diff.max_error, diff.max_ulps);
+        return;
+    }
+    printf("  %-22s diverges at tick %zu neuron %zu: %.9g expected, %.9g actual (%u ulps), %zu mismatches, max "
+           "error %g\n",
+           engine, diff.tick, diff.neuron, diff.expected, diff.actual, f32_ulp_distance(diff.expected, diff.actual),
+           diff.mismatches, diff.max_error);
+}
+
+static void bench_equivalence_cpu(ActivationTrace &trace, const Network &net, KernelPrecision precision, bool binary,
+                                  const NumaTopology *numa) {
+    CpuSim sim;
+    numa ? cpu_sim_init_numa(sim, net, *numa) : cpu_sim_init(sim, net);
+    KernelVariant variant = sim.variant;
+    variant.precision = precision;
+    variant.binary = binary;
+
+    trace.tick_count = 0;
+    while (f32 *row = activation_trace_push(trace)) {
+        cpu_sim_tick_variant(sim, net, variant);
+        for (usize i = 0; i < net.neuron_count; i++) row[i] = cpu_sim_activation(sim, i);
+    }
+    cpu_sim_deinit(sim);
+}
+
+static void bench_equivalence_sell(ActivationTrace &trace, const Network &net) {
+    SellSynapses sell;
+    sell_init(sell, net);
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+
+    trace.tick_count = 0;
+    while (f32 *row = activation_trace_push(trace)) {
+        cpu_sim_tick_sell(sim, sell);
+        memcpy(row, sim.activation, net.neuron_count * sizeof(f32));
+    }
+    cpu_sim_deinit(sim);
+    sell_deinit(sell);
+}
+
+static void bench_equivalence_compact(ActivationTrace &trace, const Network &net, WeightFormat weights) {
+    StorageFormat format = {weights, TargetFormatI32, ActivationFormatF32};
+    CompactSynapses compact;
+    compact_init(compact, net, format);
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+
+    trace.tick_count = 0;
+    while (f32 *row = activation_trace_push(trace)) {
+        cpu_sim_tick_compact(sim, compact);
+        memcpy(row, sim.activation, net.neuron_count * sizeof(f32));
+    }
+    cpu_sim_deinit(sim);
+    compact_deinit(compact);
+}
+
+// Uploads a fresh copy of the host state, ticks without the periodic stimulus of network_update, and reads the whole
+// neuron buffer back after every tick
+static void bench_equivalence_gpu(ActivationTrace &trace, Network &net, KernelPrecision precision, bool binary,
+                                  bool sell_rows = false) {
+    network_upload(net);
+    network_set_precision(net, precision);
+    network_set_binary(net, binary);
+    SellSynapses sell;
+    if (sell_rows) {
+        sell_init(sell, net);
+        network_set_sell(net, &sell);
+        sell_deinit(sell);
+    }
+    shader_library_finish(global_shader_library);
+
+    f32 *neurons = (f32 *)malloc(net.neuron_count * 4 * sizeof(f32));
+    trace.tick_count = 0;
+    while (f32 *row = activation_trace_push(trace)) {
+        network_tick(net);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.neuron_buffer);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_count * 4 * sizeof(f32), neurons);
+        for (usize i = 0; i < net.neuron_count; i++) row[i] = neurons[i * 4 + 2];
+    }
+    free(neurons);
+    network_release_remote_resources(net);
+}
+
+// Every engine runs the same seeded network for EQUIVALENCE_TICKS and is diffed against the strict CPU kernel, with
+// the tolerance from --ulps and --epsilon. Strict engines and reruns should match exactly, the others show where
+// their rounding first flips a spike. Binary spike engines and delayed synapses follow different dynamics and get
+// their own references.
+void bench_equivalence(usize neuron_count) {
+    const char *models[] = {"threshold", "lif", "izhikevich"};
+    ActivationTolerance tolerance = {bench_options.max_ulps, bench_options.epsilon};
+
+    NumaTopology numa;
+    numa_detect(numa);
+    if (numa.node_count == 1) {
+        // One real node still gets split, so the partition boundaries are exercised
+        for (u32 n = 1; n < EQUIVALENCE_FAKE_NODES; n++) {
+            numa.cpu_count[n] = numa.cpu_count[0];
+            memcpy(numa.cpus[n], numa.cpus[0], sizeof(numa.cpus[0]));
+        }
+        numa.node_count = EQUIVALENCE_FAKE_NODES;
+        numa.pinning = false;
+    }
+
+    bool gl = bench_gl_init(64, 64);
+    if (!gl) printf("no GL context, skipping the compute shader\n");
+
+    for (int m = 0; m < 3; m++) {
+        srand(EQUIVALENCE_SEED);
+        Network net;
+        network_init_host(net, neuron_count, neuron_model_default_params((NeuronModel)m));
+        for (usize i = 0; i < net.neuron_count; i += EQUIVALENCE_SEED_STRIDE) {
+            net.neuron_data[i * 4 + 2] = 1.0f;
+        }
+        printf("%s, %zu neurons, %d ticks, tolerance %u ulps / %g\n", models[m], net.neuron_count, EQUIVALENCE_TICKS,
+               tolerance.max_ulps, tolerance.epsilon);
+
+        ActivationTrace reference, trace;
+        activation_trace_init(reference, net.neuron_count, EQUIVALENCE_TICKS);
+        activation_trace_init(trace, net.neuron_count, EQUIVALENCE_TICKS);
+        bench_equivalence_cpu(reference, net, KernelPrecisionStrict, false, nullptr);
+
+        bench_equivalence_cpu(trace, net, KernelPrecisionStrict, false, nullptr);
+        bench_equivalence_print("cpu strict rerun", activation_trace_diff(reference, trace, tolerance));
+        bench_equivalence_cpu(trace, net, KernelPrecisionStrict, false, &numa);
+        bench_equivalence_print("cpu strict numa split", activation_trace_diff(reference, trace, tolerance));
+        bench_equivalence_cpu(trace, net, KernelPrecisionF32, false, nullptr);
+        bench_equivalence_print("cpu f32", activation_trace_diff(reference, trace, tolerance));
+        bench_equivalence_cpu(trace, net, KernelPrecisionF64, false, nullptr);
+        bench_equivalence_print("cpu f64", activation_trace_diff(reference, trace, tolerance));
+        bench_equivalence_sell(trace, net);
+        bench_equivalence_print("cpu sell", activation_trace_diff(reference, trace, tolerance));
+        bench_equivalence_compact(trace, net, WeightFormatF16);
+        bench_equivalence_print("cpu f16 weights", activation_trace_diff(reference, trace, tolerance));
+        bench_equivalence_compact(trace, net, WeightFormatQ8);
+        bench_equivalence_print("cpu q8 weights", activation_trace_diff(reference, trace, tolerance));
+
+        if (gl) {
+            bench_equivalence_gpu(trace, net, KernelPrecisionF32, false);
+            bench_equivalence_print("gpu f32", activation_trace_diff(reference, trace, tolerance));
+            bench_equivalence_gpu(trace, net, KernelPrecisionF32, false, true);
+            bench_equivalence_print("gpu sell", activation_trace_diff(reference, trace, tolerance));
+            bench_equivalence_gpu(trace, net, KernelPrecisionStrict, false);
+            bench_equivalence_print("gpu strict", activation_trace_diff(reference, trace, tolerance));
+            bench_equivalence_gpu(trace, net, KernelPrecisionStrict, false, true);
+            bench_equivalence_print("gpu strict sell", activation_trace_diff(reference, trace, tolerance));
+        }
+
+        bench_equivalence_cpu(reference, net, KernelPrecisionStrict, true, nullptr);
+
+        bench_equivalence_cpu(trace, net, KernelPrecisionStrict, true, &numa);
+        bench_equivalence_print("cpu binary numa split", activation_trace_diff(reference, trace, tolerance));
+        bench_equivalence_cpu(trace, net, KernelPrecisionF32, true, nullptr);
+        bench_equivalence_print("cpu binary f32", activation_trace_diff(reference, trace, tolerance));
+        if (gl) {
+            bench_equivalence_gpu(trace, net, KernelPrecisionF32, true);
+            bench_equivalence_print("gpu binary f32", activation_trace_diff(reference, trace, tolerance));
+            bench_equivalence_gpu(trace, net, KernelPrecisionStrict, true);
+            bench_equivalence_print("gpu binary strict", activation_trace_diff(reference, trace, tolerance));
+        }
+
+        u8 *delays = (u8 *)malloc(net.neuron_count * MAX_SYNAPSES);
+        for (usize i = 0; i < net.neuron_count * MAX_SYNAPSES; i++) delays[i] = rand() % (EQUIVALENCE_MAX_DELAY + 1);
+        network_set_delays(net, delays);
+        free(delays);
+        bench_equivalence_cpu(reference, net, KernelPrecisionStrict, false, nullptr);
+
+        bench_equivalence_cpu(trace, net, KernelPrecisionStrict, false, &numa);
+        bench_equivalence_print("cpu delayed numa split", activation_trace_diff(reference, trace, tolerance));
+        bench_equivalence_cpu(trace, net, KernelPrecisionF32, false, nullptr);
+        bench_equivalence_print("cpu delayed f32", activation_trace_diff(reference, trace, tolerance));
+        if (gl) {
+            bench_equivalence_gpu(trace, net, KernelPrecisionF32, false);
+            bench_equivalence_print("gpu delayed f32", activation_trace_diff(reference, trace, tolerance));
+            bench_equivalence_gpu(trace, net, KernelPrecisionStrict, false);
+            bench_equivalence_print("gpu delayed strict", activation_trace_diff(reference, trace, tolerance));
+        }
+        network_set_delays(net, nullptr);
+
+        activation_trace_deinit(trace);
+        activation_trace_deinit(reference);
+        network_deinit(net);
+    }
+
+    if (gl) bench_gl_deinit();
+}
@@ -0,0 +1,32 @@
+#include "bench.h"
+#include "neural_net.hpp"
+#include "topology.hpp"
+
+// Building a network from scratch: the random wiring of network_init_host and each topology generator
+void bench_generate(usize neuron_count) {
+    BenchStats stats = bench_measure([&] {
+        Network net;
+        network_init_host(net, neuron_count);
+        network_deinit(net);
+    });
+    bench_report("random", stats, (f64)neuron_count, "neurons");
+
+    const char *names[] = {"small world", "scale free", "spatial", "layered"};
+    for (int kind = 0; kind < 4; kind++) {
+        TopologyParams params = {};
+        params.kind = (TopologyParams::Kind)kind;
+        params.neuron_count = neuron_count;
+        params.degree = kind == TopologyParams::ScaleFree ? 4 : MAX_SYNAPSES;
+        params.rewire_probability = 0.1f;
+        params.decay_length = 0.05f;
+        params.layer_count = 4;
+        params.seed = 1;
+
+        stats = bench_measure([&] {
+            Topology topo;
+            topology_generate(topo, params);
+            topology_deinit(topo);
+        });
+        bench_report(names[kind], stats, (f64)neuron_count, "neurons");
+    }
+}
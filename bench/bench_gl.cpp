@@ -0,0 +1,120 @@
+#include "bench.h"
+#include "kernel_variant.hpp"
+#include "shader.hpp"
+#include "streaming.hpp"
+
+#include <GLFW/glfw3.h>
+#include <cstdio>
+
+#ifdef BENCH_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+static GLFWwindow *bench_window;
+static GLuint bench_framebuffer;
+static GLuint bench_color;
+
+#ifdef BENCH_EGL
+static EGLDisplay bench_display = EGL_NO_DISPLAY;
+static EGLContext bench_context = EGL_NO_CONTEXT;
+
+// No window system at all, Mesa renders into our framebuffer object only
+static bool bench_gl_init_egl() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!get_platform_display) return false;
+
+    bench_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (bench_display == EGL_NO_DISPLAY || !eglInitialize(bench_display, nullptr, nullptr)) return false;
+    if (!eglBindAPI(EGL_OPENGL_API)) return false;
+
+    EGLint config_attributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint config_count = 0;
+    eglChooseConfig(bench_display, config_attributes, &config, 1, &config_count);
+
+    EGLint context_attributes[] = {EGL_CONTEXT_MAJOR_VERSION,       4,
+                                   EGL_CONTEXT_MINOR_VERSION,       3,
+                                   EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                   EGL_NONE};
+    bench_context = eglCreateContext(bench_display, config_count ? config : nullptr, EGL_NO_CONTEXT,
+                                     context_attributes);
+    if (bench_context == EGL_NO_CONTEXT) return false;
+    if (!eglMakeCurrent(bench_display, EGL_NO_SURFACE, EGL_NO_SURFACE, bench_context)) return false;
+
+    return gladLoadGLLoader((GLADloadproc)eglGetProcAddress);
+}
+#endif
+
+static bool bench_gl_init_glfw() {
+    if (!glfwInit()) return false;
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    bench_window = glfwCreateWindow(64, 64, "bench", nullptr, nullptr);
+    if (!bench_window) {
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(bench_window);
+    glfwSwapInterval(0);
+    return gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+}
+
+bool bench_gl_init(u32 width, u32 height) {
+    bool ok = false;
+    const char *backend = "glfw";
+    GLADloadproc load = (GLADloadproc)glfwGetProcAddress;
+#ifdef BENCH_EGL
+    ok = bench_gl_init_egl();
+    if (ok) {
+        backend = "egl";
+        load = (GLADloadproc)eglGetProcAddress;
+    }
+#endif
+    if (!ok) ok = bench_gl_init_glfw();
+    if (!ok) return false;
+
+    printf("GL %s, %s (%s)\n", (const char *)glGetString(GL_VERSION), (const char *)glGetString(GL_RENDERER),
+           backend);
+
+    glGenFramebuffers(1, &bench_framebuffer);
+    glGenRenderbuffers(1, &bench_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, bench_color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, (GLsizei)width, (GLsizei)height);
+    glBindFramebuffer(GL_FRAMEBUFFER, bench_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, bench_color);
+    glViewport(0, 0, (GLsizei)width, (GLsizei)height);
+
+    shader_library_init(global_shader_library, load);
+    stream_buffer_init(global_stream_buffer);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void bench_gl_deinit() {
+    kernel_cache_clear(global_kernel_cache);
+    stream_buffer_deinit(global_stream_buffer);
+    shader_library_deinit(global_shader_library);
+    glDeleteFramebuffers(1, &bench_framebuffer);
+    glDeleteRenderbuffers(1, &bench_color);
+    bench_framebuffer = bench_color = 0;
+
+#ifdef BENCH_EGL
+    if (bench_context != EGL_NO_CONTEXT) {
+        eglMakeCurrent(bench_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(bench_display, bench_context);
+        eglTerminate(bench_display);
+        bench_context = EGL_NO_CONTEXT;
+    }
+#endif
+    if (bench_window) {
+        glfwDestroyWindow(bench_window);
+        glfwTerminate();
+        bench_window = nullptr;
+    }
+}
@@ -0,0 +1,112 @@
+#include "bench.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+BenchOptions bench_options = {BENCH_WARMUP, BENCH_ITERATIONS, "", 0, 0.0f, nullptr};
+
+struct BenchResult {
+    char suite[32];
+    char name[64];
+    BenchStats stats;
+    f64 throughput; // items per second at the median
+    char unit[16];
+};
+
+static BenchResult bench_results[BENCH_MAX_RESULTS];
+static usize bench_result_count;
+
+// Nearest-rank percentile of sorted samples
+static f64 bench_percentile(const f64 *sorted, u32 count, f64 percentile) {
+    u32 rank = (u32)(percentile / 100.0 * count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+BenchStats bench_stats(f64 *samples, u32 count) {
+    BenchStats stats = {};
+    stats.iterations = count;
+    if (count == 0) return stats;
+
+    std::sort(samples, samples + count);
+    f64 sum = 0.0;
+    for (u32 i = 0; i < count; i++) sum += samples[i];
+
+    stats.min_ms = samples[0];
+    stats.max_ms = samples[count - 1];
+    stats.median_ms = count % 2 ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) * 0.5;
+    stats.p90_ms = bench_percentile(samples, count, 90.0);
+    stats.p99_ms = bench_percentile(samples, count, 99.0);
+    stats.mean_ms = sum / count;
+    return stats;
+}
+
+// Scales a per-second rate into k/M/G for printing
+static void bench_format_rate(char *out, usize size, f64 rate, const char *unit) {
+    const char *prefixes[] = {"", "k", "M", "G", "T"};
+    int p = 0;
+    while (rate >= 1000.0 && p < 4) {
+        rate /= 1000.0;
+        p++;
+    }
+    snprintf(out, size, "%7.2f %s%s/s", rate, prefixes[p], unit);
+}
+
+void bench_report(const char *name, const BenchStats &stats, f64 items, const char *unit) {
+    f64 throughput = stats.median_ms > 0.0 ? items / (stats.median_ms * 1e-3) : 0.0;
+
+    char rate[48];
+    bench_format_rate(rate, sizeof(rate), throughput, unit);
+    printf("%-28s median %9.3f ms  p90 %9.3f  p99 %9.3f  min %9.3f  %s\n", name, stats.median_ms, stats.p90_ms,
+           stats.p99_ms, stats.min_ms, rate);
+
+    if (bench_result_count == BENCH_MAX_RESULTS) return;
+    BenchResult &result = bench_results[bench_result_count++];
+    snprintf(result.suite, sizeof(result.suite), "%s", bench_options.suite);
+    snprintf(result.name, sizeof(result.name), "%s", name);
+    snprintf(result.unit, sizeof(result.unit), "%s", unit);
+    result.stats = stats;
+    result.throughput = throughput;
+}
+
+// Short hash of the checked out commit, so results can be lined up across commits. Empty outside a git tree.
+static void bench_commit(char *out, usize size) {
+    out[0] = '\0';
+#ifndef _WIN32
+    FILE *git = popen("git rev-parse --short HEAD 2>/dev/null", "r");
+    if (!git) return;
+    if (fgets(out, (int)size, git)) out[strcspn(out, "\r\n")] = '\0';
+    pclose(git);
+#endif
+}
+
+bool bench_write_json(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", path);
+        return false;
+    }
+
+    char commit[64];
+    bench_commit(commit, sizeof(commit));
+    fprintf(file, "{\n  \"commit\": \"%s\",\n  \"timestamp\": %lld,\n  \"warmup\": %u,\n  \"results\": [\n", commit,
+            (long long)time(nullptr), bench_options.warmup);
+
+    for (usize i = 0; i < bench_result_count; i++) {
+        const BenchResult &r = bench_results[i];
+        fprintf(file,
+                "    {\"suite\": \"%s\", \"name\": \"%s\", \"iterations\": %u, \"median_ms\": %.6f, \"p90_ms\": %.6f, "
+                "\"p99_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f, \"mean_ms\": %.6f, \"throughput\": %.6g, "
+                "\"unit\": \"%s/s\"}%s\n",
+                r.suite, r.name, r.stats.iterations, r.stats.median_ms, r.stats.p90_ms, r.stats.p99_ms,
+                r.stats.min_ms, r.stats.max_ms, r.stats.mean_ms, r.throughput, r.unit,
+                i + 1 < bench_result_count ? "," : "");
+    }
+
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
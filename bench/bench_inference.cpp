@@ -0,0 +1,91 @@
+#include "bench.h"
+#include "inference.hpp"
+#include "topology.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define INFERENCE_BENCH_LAYERS 6
+#define INFERENCE_BENCH_FAN_IN 16
+#define INFERENCE_BENCH_SAMPLES 256 // every run pushes this many samples through, in batches or one at a time
+#define INFERENCE_BENCH_COPY_ROUNDS 8
+
+// Reference for the bandwidth figures: a plain copy of as many bytes as one batch of 256 must touch at least
+static f64 bench_inference_copy_gbs(usize bytes) {
+    char *source = (char *)malloc(bytes);
+    char *destination = (char *)malloc(bytes);
+    memset(source, 1, bytes);
+    memset(destination, 0, bytes);
+    BenchStats stats = bench_measure([&] {
+        for (int r = 0; r < INFERENCE_BENCH_COPY_ROUNDS; r++) memcpy(destination, source, bytes);
+    });
+    free(source);
+    free(destination);
+    return 2.0 * bytes * INFERENCE_BENCH_COPY_ROUNDS / (stats.median_ms * 1e6);
+}
+
+// Layered feed-forward network run as batched SpMM for several batch sizes, against the same samples pushed
+// through one at a time. Reports samples per second and the traffic a batch has to move at the very least: the
+// synapse rows once, and every neuron's batch row written once and read back once, as a share of what memcpy
+// moves on the same machine.
+void bench_inference(usize neuron_count) {
+    Topology topo;
+    topology_layered(topo, neuron_count, INFERENCE_BENCH_LAYERS, INFERENCE_BENCH_FAN_IN, 1);
+    Network net;
+    network_init_host(net, topo);
+    topology_deinit(topo);
+
+    usize input_count = 0, output_count = 0;
+    for (usize i = 0; i < net.neuron_count; i++) {
+        input_count += net.kind_data[i] == Neuron::Input;
+        output_count += net.kind_data[i] == Neuron::Output;
+    }
+    f32 *inputs = (f32 *)malloc(INFERENCE_BENCH_SAMPLES * input_count * sizeof(f32));
+    f32 *outputs = (f32 *)malloc(INFERENCE_BENCH_SAMPLES * output_count * sizeof(f32));
+    f32 *expected = (f32 *)malloc(INFERENCE_BENCH_SAMPLES * output_count * sizeof(f32));
+    srand(1);
+    for (usize i = 0; i < INFERENCE_BENCH_SAMPLES * input_count; i++) inputs[i] = (f32)rand() / RAND_MAX;
+
+    usize synapse_count = 0;
+    for (usize i = 0; i < net.neuron_count * MAX_SYNAPSES; i++) synapse_count += net.synapse_data[i] >= 0;
+    usize footprint = synapse_count * 8 + 2 * net.neuron_count * INFERENCE_BENCH_SAMPLES * 4;
+    f64 copy_gbs = bench_inference_copy_gbs(footprint);
+    printf("memcpy of %zu MB: %.2f GB/s\n", footprint >> 20, copy_gbs);
+
+    usize batches[] = {1, 16, 64, 256};
+    for (usize batch : batches) {
+        Inference inf;
+        if (!inference_init(inf, net, batch, InferenceRelu)) break;
+        if (batch == 1) {
+            printf("%zu neurons in %zu layers, %zu synapses, %zu inputs, %zu outputs\n", inf.neuron_count,
+                   inf.layer_count, synapse_count, inf.input_count, inf.output_count);
+        }
+
+        BenchStats stats = bench_measure([&] {
+            for (usize s = 0; s < INFERENCE_BENCH_SAMPLES; s += batch) {
+                usize count = INFERENCE_BENCH_SAMPLES - s < batch ? INFERENCE_BENCH_SAMPLES - s : batch;
+                inference_run(inf, &inputs[s * input_count], &outputs[s * output_count], count);
+            }
+        });
+        char name[64];
+        snprintf(name, sizeof(name), "batch %zu", batch);
+        bench_report(name, stats, INFERENCE_BENCH_SAMPLES, "samples");
+
+        usize runs = (INFERENCE_BENCH_SAMPLES + batch - 1) / batch;
+        f64 bytes = (f64)runs * (synapse_count * (sizeof(u32) + sizeof(f32)) + 2.0 * inf.neuron_count * inf.stride * 4);
+        f64 gbs = bytes / (stats.median_ms * 1e6);
+        // Same sums in the same order per column, so any batch size must reproduce the one-sample outputs exactly
+        usize size = INFERENCE_BENCH_SAMPLES * output_count * sizeof(f32);
+        if (batch == 1) memcpy(expected, outputs, size);
+        printf("  %.2f GB/s of minimum traffic (%.0f%% of memcpy), %.2f GMAC/s, outputs %s\n", gbs,
+               100.0 * gbs / copy_gbs, (f64)synapse_count * runs * inf.stride / (stats.median_ms * 1e6),
+               memcmp(expected, outputs, size) == 0 ? "match batch 1" : "DIFFER from batch 1");
+        inference_deinit(inf);
+    }
+
+    free(inputs);
+    free(outputs);
+    free(expected);
+    network_deinit(net);
+}
@@ -0,0 +1,140 @@
+#include "bench.h"
+#include "core/file.h"
+#include "input_stream.hpp"
+#include "streaming.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#define INPUT_BENCH_PATH "bench_input.idx"
+#define INPUT_BENCH_SAMPLES 1000
+#define INPUT_BENCH_SIDE 28
+#define INPUT_BENCH_RATE_TICKS 1024 // ticks the spike rate is measured over
+#define INPUT_BENCH_MAX_RATE 0.25f
+
+// MNIST-shaped u8 IDX file of INPUT_BENCH_SAMPLES diagonal gradients, mean intensity close to 127.5
+static bool bench_input_write_idx(const char *path) {
+    FILE *file = file_open(path, "wb");
+    if (!file) return false;
+    u8 header[16] = {0, 0, 0x08, 3};
+    u32 dims[3] = {INPUT_BENCH_SAMPLES, INPUT_BENCH_SIDE, INPUT_BENCH_SIDE};
+    for (int d = 0; d < 3; d++) {
+        for (int b = 0; b < 4; b++) header[4 + d * 4 + b] = (u8)(dims[d] >> (24 - 8 * b));
+    }
+    fwrite(header, 1, sizeof(header), file);
+
+    u8 sample[INPUT_BENCH_SIDE * INPUT_BENCH_SIDE];
+    for (u32 s = 0; s < INPUT_BENCH_SAMPLES; s++) {
+        for (u32 i = 0; i < sizeof(sample); i++) sample[i] = (u8)(i * 7 + s * 13);
+        fwrite(sample, 1, sizeof(sample), file);
+    }
+    file_close(file);
+    return true;
+}
+
+static f64 bench_input_spike_fraction(InputStream &input, CpuSim &sim) {
+    usize spikes = 0, ticks = 0;
+    for (int t = 0; t < INPUT_BENCH_RATE_TICKS; t++) {
+        usize underruns = input.underruns;
+        input_stream_tick_cpu(input, sim);
+        if (input.underruns != underruns) continue; // the reader is still warming up
+        for (usize k = 0; k < input.input_count; k++) spikes += sim.activation[input.neurons[k]] == 1.0f;
+        ticks++;
+    }
+    return ticks ? (f64)spikes / ((f64)ticks * input.input_count) : 0.0;
+}
+
+// A quarter of the neurons driven from an IDX file through the reader thread, one tick of input per sim tick, against
+// the same ticks without input. Also measures the spike rate each encoding delivers against the rate it was asked
+// for. Underruns count ticks the reader fell behind and the inputs were left alone.
+void bench_input(usize neuron_count) {
+    if (!bench_input_write_idx(INPUT_BENCH_PATH)) {
+        printf("could not write %s, skipping\n", INPUT_BENCH_PATH);
+        return;
+    }
+
+    Network net;
+    network_init_host(net, neuron_count);
+    usize input_count = neuron_count / 4;
+    u32 *neurons = (u32 *)malloc(input_count * sizeof(u32));
+    for (usize k = 0; k < input_count; k++) neurons[k] = (u32)k;
+    printf("%zu inputs from %d-byte samples\n", input_count, INPUT_BENCH_SIDE * INPUT_BENCH_SIDE);
+
+    InputStreamParams params = {
+        .format = InputFormatIdx,
+        .encoding = InputEncodingPoisson,
+        .max_rate = INPUT_BENCH_MAX_RATE,
+        .ticks_per_sample = 20,
+        .sample_size = 0,
+        .loop = true,
+        .seed = 1,
+    };
+    const char *encodings[] = {"poisson", "rate"};
+    char name[64];
+    for (int e = 0; e < 2; e++) {
+        params.encoding = (InputEncoding)e;
+        InputStream input;
+        if (!input_stream_open(input, INPUT_BENCH_PATH, neurons, input_count, params)) break;
+        CpuSim sim;
+        cpu_sim_init(sim, net);
+
+        // Mean intensity of the gradients is 127.5 of 255
+        f64 fraction = bench_input_spike_fraction(input, sim);
+        printf("%-8s spike rate %.4f per tick, asked for %.4f\n", encodings[e], fraction, INPUT_BENCH_MAX_RATE * 0.5);
+
+        usize underruns = input.underruns;
+        BenchStats stats = bench_measure([&] {
+            input_stream_tick_cpu(input, sim);
+            cpu_sim_tick(sim, net);
+        });
+        snprintf(name, sizeof(name), "cpu tick + %s input", encodings[e]);
+        bench_report(name, stats, (f64)input_count, "inputs");
+        printf("  %zu underruns, %llu samples read\n", input.underruns - underruns,
+               (unsigned long long)input.samples_read.load());
+
+        cpu_sim_deinit(sim);
+        input_stream_close(input);
+    }
+
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+    BenchStats stats = bench_measure([&] { cpu_sim_tick(sim, net); });
+    bench_report("cpu tick alone", stats, (f64)input_count, "inputs");
+    cpu_sim_deinit(sim);
+
+    if (bench_gl_init(64, 64)) {
+        params.encoding = InputEncodingPoisson;
+        InputStream input;
+        if (input_stream_open(input, INPUT_BENCH_PATH, neurons, input_count, params)) {
+            network_upload(net);
+            input_stream_upload(input);
+            shader_library_finish(global_shader_library);
+
+            stats = bench_measure([&] {
+                network_tick(net);
+                glFinish();
+            });
+            bench_report("gpu tick alone", stats, (f64)input_count, "inputs");
+
+            usize underruns = input.underruns;
+            stats = bench_measure([&] {
+                input_stream_tick(input, net);
+                network_tick(net);
+                stream_buffer_frame(global_stream_buffer);
+                glFinish();
+            });
+            bench_report("gpu tick + poisson input", stats, (f64)input_count, "inputs");
+            printf("  %zu underruns, %zu batches uploaded\n", input.underruns - underruns, input.consumed);
+
+            input_stream_close(input);
+            network_release_remote_resources(net);
+        }
+        bench_gl_deinit();
+    } else {
+        printf("no GL context, skipping the compute shader\n");
+    }
+
+    free(neurons);
+    network_deinit(net);
+    remove(INPUT_BENCH_PATH);
+}
@@ -0,0 +1,117 @@
+#include "bench.h"
+#include "cpu_sim.hpp"
+#include "storage_format.hpp"
+
+#include <cstdio>
+
+#define KERNELS_SEED_STRIDE 97 // every n-th neuron starts active
+
+static usize bench_kernels_synapses(const Network &net) {
+    usize synapses = 0;
+    for (usize i = 0; i < net.neuron_count * MAX_SYNAPSES; i++) synapses += net.synapse_data[i] >= 0;
+    return synapses;
+}
+
+static void bench_kernels_seed(Network &net) {
+    for (usize i = 0; i < net.neuron_count; i += KERNELS_SEED_STRIDE) {
+        net.neuron_data[i * 4 + 2] = 1.0f;
+    }
+}
+
+// One tick of every engine: the CPU kernel per model and precision, the CPU kernel over reduced-precision rows, and
+// the compute shader when a GL context is available. Throughput counts every stored synapse.
+void bench_kernels(usize neuron_count) {
+    const char *models[] = {"threshold", "lif", "izhikevich"};
+    char name[64];
+
+    for (int m = 0; m < 3; m++) {
+        Network net;
+        network_init_host(net, neuron_count, neuron_model_default_params((NeuronModel)m));
+        bench_kernels_seed(net);
+        usize synapses = bench_kernels_synapses(net);
+
+        for (int p = 0; p < 2; p++) {
+            KernelVariant variant = kernel_variant_for(net);
+            variant.precision = (KernelPrecision)p;
+
+            CpuSim sim;
+            cpu_sim_init(sim, net);
+            BenchStats stats = bench_measure([&] { cpu_sim_tick_variant(sim, net, variant); });
+            cpu_sim_deinit(sim);
+
+            snprintf(name, sizeof(name), "cpu %s %s", models[m], p ? "f64" : "f32");
+            bench_report(name, stats, (f64)synapses, "synapses");
+        }
+
+        // Rows gather from a bitset an activation array 32 times the size would otherwise need
+        KernelVariant variant = kernel_variant_for(net);
+        variant.binary = true;
+        CpuSim sim;
+        cpu_sim_init(sim, net);
+        usize spikes = 0;
+        BenchStats stats = bench_measure([&] {
+            cpu_sim_tick_variant(sim, net, variant);
+            spikes += cpu_sim_spike_count(sim);
+        });
+        cpu_sim_deinit(sim);
+
+        snprintf(name, sizeof(name), "cpu %s binary", models[m]);
+        bench_report(name, stats, (f64)synapses, "synapses");
+        printf("  %.1f spikes/tick, activations %zu KB, bitset %zu KB\n",
+               (f64)spikes / (bench_options.warmup + stats.iterations), net.neuron_count * sizeof(f32) / 1024,
+               (net.neuron_count + 63) / 64 * sizeof(u64) / 1024);
+        network_deinit(net);
+    }
+
+    Network net;
+    network_init_host(net, neuron_count);
+    bench_kernels_seed(net);
+    usize synapses = bench_kernels_synapses(net);
+
+    const StorageFormat formats[] = {
+        {WeightFormatF16, TargetFormatI32, ActivationFormatF32},
+        {WeightFormatQ8, TargetFormatI32, ActivationFormatF32},
+        {WeightFormatQ8, TargetFormatU16, ActivationFormatF16},
+    };
+    const char *format_names[] = {"f16 weights", "q8 weights", "q8 u16 f16"};
+    for (int f = 0; f < 3; f++) {
+        StorageFormat format = storage_format_resolve(formats[f], net.neuron_count);
+        if (format.targets != formats[f].targets) continue; // 16-bit targets need a smaller network
+
+        CompactSynapses compact;
+        compact_init(compact, net, format);
+        CpuSim sim;
+        cpu_sim_init(sim, net);
+        BenchStats stats = bench_measure([&] { cpu_sim_tick_compact(sim, compact); });
+        cpu_sim_deinit(sim);
+        compact_deinit(compact);
+
+        snprintf(name, sizeof(name), "cpu %s", format_names[f]);
+        bench_report(name, stats, (f64)synapses, "synapses");
+    }
+
+    if (!bench_gl_init(64, 64)) {
+        printf("no GL context, skipping the compute shader\n");
+        network_deinit(net);
+        return;
+    }
+
+    network_upload(net);
+    shader_library_finish(global_shader_library);
+    BenchStats stats = bench_measure([&] {
+        network_update(net);
+        glFinish();
+    });
+    bench_report("gpu threshold", stats, (f64)synapses, "synapses");
+
+    network_set_binary(net, true);
+    shader_library_finish(global_shader_library);
+    stats = bench_measure([&] {
+        network_tick(net);
+        glFinish();
+    });
+    bench_report("gpu threshold binary", stats, (f64)synapses, "synapses");
+
+    network_deinit(net);
+    bench_gl_deinit();
+}
@@ -0,0 +1,117 @@
+#include "bench.h"
+#include "core/arena.h"
+#include "core/random.h"
+#include "cpu_sim.hpp"
+#include "reorder.hpp"
+#include "spatial.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define MEMORY_ROUNDS 200
+#define MEMORY_FRAMES 1000
+#define MEMORY_TICKS 20
+#define MEMORY_BRUSH_CAPACITY 4096
+
+static usize bench_heap_allocations() {
+    return global_heap_counters.allocations.load(std::memory_order_relaxed);
+}
+
+static void bench_memory_report(const char *name, f64 ms, usize rounds, usize allocations) {
+    printf("%-22s %9.3f ms", name, ms / rounds);
+    if (heap_counters_enabled()) printf("  %8.2f heap allocations each", (f64)allocations / rounds);
+    printf("\n");
+}
+
+// Transient buffers the size of a reorder pass: four n-element arrays written once and dropped
+static void bench_memory_transient(usize neuron_count) {
+    f64 start = bench_now_ms();
+    usize allocations = bench_heap_allocations();
+    for (int r = 0; r < MEMORY_ROUNDS; r++) {
+        u32 *buffers[4];
+        for (int b = 0; b < 4; b++) {
+            buffers[b] = (u32 *)malloc(neuron_count * sizeof(u32));
+            memset(buffers[b], r, neuron_count * sizeof(u32));
+        }
+        for (int b = 0; b < 4; b++) free(buffers[b]);
+    }
+    bench_memory_report("transient malloc", bench_now_ms() - start, MEMORY_ROUNDS,
+                        bench_heap_allocations() - allocations);
+
+    Arena &scratch = arena_scratch();
+    start = bench_now_ms();
+    allocations = bench_heap_allocations();
+    for (int r = 0; r < MEMORY_ROUNDS; r++) {
+        usize mark = arena_mark(scratch);
+        for (int b = 0; b < 4; b++) {
+            memset(arena_push<u32>(scratch, neuron_count), r, neuron_count * sizeof(u32));
+        }
+        arena_restore(scratch, mark);
+    }
+    bench_memory_report("transient scratch", bench_now_ms() - start, MEMORY_ROUNDS,
+                        bench_heap_allocations() - allocations);
+}
+
+// What a frame does on the CPU while the brush is held: a radius query into the frame arena
+static void bench_memory_frames(usize neuron_count) {
+    f32 *positions = (f32 *)malloc(neuron_count * 2 * sizeof(f32));
+    Rng rng = rng_create(7);
+    for (usize i = 0; i < neuron_count * 2; i++) positions[i] = rng_f32(rng) * 2.0f - 1.0f;
+
+    SpatialGrid grid;
+    spatial_grid_build(grid, positions, 2, neuron_count);
+
+    FrameArena frames;
+    frame_arena_init(frames, ARENA_FRAME_CAPACITY);
+    usize brushed_total = 0;
+    f64 start = bench_now_ms();
+    usize allocations = bench_heap_allocations();
+    for (int f = 0; f < MEMORY_FRAMES; f++) {
+        frame_arena_begin(frames);
+        u32 *brushed = arena_push<u32>(frame_arena(frames), MEMORY_BRUSH_CAPACITY);
+        brushed_total += spatial_grid_radius(grid, rng_f32(rng) * 2.0f - 1.0f, rng_f32(rng) * 2.0f - 1.0f, 0.05f,
+                                             brushed, MEMORY_BRUSH_CAPACITY);
+    }
+    bench_memory_report("brush frame", bench_now_ms() - start, MEMORY_FRAMES, bench_heap_allocations() - allocations);
+    printf("%-22s %9zu KB peak per frame\n", "", frame_arena(frames).peak >> 10);
+
+    frame_arena_deinit(frames);
+    spatial_grid_deinit(grid);
+    free(positions);
+}
+
+// parallel_for starts its threads per call, so multi-threaded ticks still allocate their std::thread state
+static void bench_memory_ticks(usize neuron_count) {
+    Network net;
+    network_init_host(net, neuron_count);
+
+    usize allocations = bench_heap_allocations();
+    f64 start = bench_now_ms();
+    network_reorder(net, ReorderHilbert);
+    bench_memory_report("reorder", bench_now_ms() - start, 1, bench_heap_allocations() - allocations);
+
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+    cpu_sim_tick(sim, net);
+
+    allocations = bench_heap_allocations();
+    start = bench_now_ms();
+    for (int t = 0; t < MEMORY_TICKS; t++) cpu_sim_tick(sim, net);
+    bench_memory_report("cpu tick", bench_now_ms() - start, MEMORY_TICKS, bench_heap_allocations() - allocations);
+
+    cpu_sim_deinit(sim);
+    network_deinit(net);
+}
+
+void bench_memory(usize neuron_count) {
+    if (!heap_counters_enabled()) printf("heap counters disabled, build with ENABLE_ALLOC_COUNTERS to count\n");
+
+    bench_memory_transient(neuron_count);
+    bench_memory_frames(neuron_count);
+    bench_memory_ticks(neuron_count);
+
+    const Arena &scratch = arena_scratch();
+    printf("scratch %zu MB peak, %zu allocations%s\n", scratch.peak >> 20, scratch.allocations,
+           scratch.huge_pages ? ", huge pages" : "");
+}
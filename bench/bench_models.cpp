@@ -0,0 +1,54 @@
+#include "bench.h"
+#include "core/random.h"
+#include "cpu_sim.hpp"
+
+#include <cstdio>
+
+#define MODELS_WARMUP_TICKS 5
+#define MODELS_TICKS 50
+
+void bench_models(usize neuron_count) {
+    const char *names[] = {"threshold", "lif", "izhikevich"};
+    NeuronModel models[] = {NeuronModelThreshold, NeuronModelLif, NeuronModelIzhikevich};
+
+    for (int m = 0; m < 3; m++) {
+        Network net;
+        network_init_host(net, neuron_count, neuron_model_default_params(models[m]));
+
+        usize synapse_count = 0;
+        for (usize i = 0; i < neuron_count * MAX_SYNAPSES; i++) {
+            synapse_count += net.synapse_data[i] >= 0;
+        }
+
+        CpuSim sim;
+        cpu_sim_init(sim, net);
+        Rng rng = rng_create(11);
+
+        f64 elapsed = 0.0;
+        usize spikes = 0;
+        for (int t = 0; t < MODELS_WARMUP_TICKS + MODELS_TICKS; t++) {
+            // Background drive, outside the timed region
+            for (usize i = 0; i < neuron_count / 100; i++) {
+                sim.activation[rng_range(rng, (u32)neuron_count)] = 1.0f;
+            }
+
+            f64 start = bench_now_ms();
+            cpu_sim_tick(sim, net);
+            if (t >= MODELS_WARMUP_TICKS) elapsed += bench_now_ms() - start;
+
+            if (t >= MODELS_WARMUP_TICKS) {
+                for (usize i = 0; i < neuron_count; i++) {
+                    spikes += sim.activation[i] == 1.0f;
+                }
+            }
+        }
+
+        f64 seconds = elapsed / 1e3;
+        printf("%-10s %8.3f ms/tick  %7.1f Mneuron/s  %7.1f Msyn/s  %.2f%% firing\n", names[m],
+               elapsed / MODELS_TICKS, neuron_count * (f64)MODELS_TICKS / seconds / 1e6,
+               synapse_count * (f64)MODELS_TICKS / seconds / 1e6, 100.0 * spikes / ((f64)neuron_count * MODELS_TICKS));
+
+        cpu_sim_deinit(sim);
+        network_deinit(net);
+    }
+}
@@ -0,0 +1,111 @@
+#include "bench.h"
+#include "core/numa.h"
+#include "cpu_sim.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+#define NUMA_BANDWIDTH_BYTES (256ull << 20) // per node
+#define NUMA_BANDWIDTH_ROUNDS 5
+#define NUMA_GRAIN (1 << 16) // u64 elements per chunk
+#define NUMA_WARMUP_TICKS 3
+#define NUMA_TICKS 20
+
+// Bounds giving node all of [0, count) and every other node nothing
+static void bench_numa_single(const NumaTopology &topology, u32 node, usize count, usize *bounds) {
+    for (u32 n = 0; n <= topology.node_count; n++) {
+        bounds[n] = n <= node ? 0 : count;
+    }
+}
+
+// Read bandwidth of node reader's CPUs over data, wherever its pages were placed
+static f64 bench_numa_read(const NumaTopology &topology, u64 *data, usize count, u32 reader) {
+    usize bounds[NUMA_MAX_NODES + 1];
+    bench_numa_single(topology, reader, count, bounds);
+
+    std::atomic<u64> sink(0);
+    f64 start = bench_now_ms();
+    for (int r = 0; r < NUMA_BANDWIDTH_ROUNDS; r++) {
+        numa_parallel_for(topology, bounds, NUMA_GRAIN, [&](u32 node, usize begin, usize end) {
+            u64 sum = 0;
+            for (usize i = begin; i < end; i++) sum += data[i];
+            sink.fetch_add(sum, std::memory_order_relaxed);
+        });
+    }
+    f64 elapsed = bench_now_ms() - start;
+    if (sink.load() == 1) printf("\n"); // keeps the reads alive
+
+    return (f64)count * sizeof(u64) * NUMA_BANDWIDTH_ROUNDS / (elapsed * 1e6);
+}
+
+static void bench_numa_bandwidth(const NumaTopology &topology) {
+    usize count = NUMA_BANDWIDTH_BYTES / sizeof(u64);
+    u64 *data = (u64 *)malloc(count * sizeof(u64));
+
+    printf("read GB/s, rows: memory node, columns: reading node\n");
+    for (u32 home = 0; home < topology.node_count; home++) {
+        // Fresh pages each time so first touch places them on home
+        free(data);
+        data = (u64 *)malloc(count * sizeof(u64));
+        usize bounds[NUMA_MAX_NODES + 1];
+        bench_numa_single(topology, home, count, bounds);
+        numa_parallel_for(topology, bounds, NUMA_GRAIN, [&](u32 node, usize begin, usize end) {
+            for (usize i = begin; i < end; i++) data[i] = i;
+        });
+
+        printf("node %u ", home);
+        for (u32 reader = 0; reader < topology.node_count; reader++) {
+            printf(" %8.2f", bench_numa_read(topology, data, count, reader));
+        }
+        printf("\n");
+    }
+
+    free(data);
+}
+
+static f64 bench_numa_ticks(CpuSim &sim, const Network &net) {
+    for (int i = 0; i < NUMA_WARMUP_TICKS; i++) cpu_sim_tick(sim, net);
+    f64 start = bench_now_ms();
+    for (int i = 0; i < NUMA_TICKS; i++) cpu_sim_tick(sim, net);
+    return (bench_now_ms() - start) / NUMA_TICKS;
+}
+
+// The same tick unpinned, placed on the first node only, and spread across every node
+static void bench_numa_scaling(const NumaTopology &topology, usize neuron_count) {
+    Network net;
+    network_init_host(net, neuron_count);
+
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+    f64 unpinned = bench_numa_ticks(sim, net);
+    cpu_sim_deinit(sim);
+    printf("%-12s %3u threads %9.3f ms/tick\n", "unpinned", (u32)parallel_thread_count(), unpinned);
+
+    NumaTopology subsets[2] = {numa_subset(topology, 1), topology};
+    const char *names[2] = {"one node", "all nodes"};
+    for (int s = 0; s < 2; s++) {
+        if (s == 1 && topology.node_count == 1) break;
+        cpu_sim_init_numa(sim, net, subsets[s]);
+        f64 ms = bench_numa_ticks(sim, net);
+        cpu_sim_deinit(sim);
+        printf("%-12s %3u threads %9.3f ms/tick  %5.2fx\n", names[s], numa_thread_count(subsets[s]), ms,
+               unpinned / ms);
+    }
+
+    network_deinit(net);
+}
+
+void bench_numa(usize neuron_count) {
+    NumaTopology topology;
+    numa_detect(topology);
+
+    printf("%u node%s%s\n", topology.node_count, topology.node_count == 1 ? "" : "s",
+           topology.pinning ? "" : ", no topology found, threads not pinned");
+    for (u32 node = 0; node < topology.node_count; node++) {
+        printf("node %u: %u CPUs\n", node, topology.cpu_count[node]);
+    }
+
+    bench_numa_bandwidth(topology);
+    bench_numa_scaling(topology, neuron_count);
+}
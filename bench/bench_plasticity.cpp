@@ -0,0 +1,163 @@
+#include "bench.h"
+#include "core/random.h"
+#include "cpu_sim.hpp"
+#include "plasticity.hpp"
+#include "streaming.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define PLASTICITY_TICKS 16 // per measured call, a whole number of weight updates at every interval below
+#define PLASTICITY_SPARSE_THRESHOLD 2.0f // the network no longer sustains its own activity, only the drive fires
+#define PLASTICITY_TRACES_ONLY 0x40000000u // an interval no run reaches, so only the trace pass runs
+
+static const u32 plasticity_intervals[] = {1, 4, 16};
+
+// Adds random spikes on top of the network's own, so both STDP branches do work every tick
+static void bench_plasticity_drive(CpuSim &sim, Rng &rng) {
+    for (usize i = 0; i < sim.neuron_count / 50; i++) {
+        sim.activation[rng_range(rng, (u32)sim.neuron_count)] = 1.0f;
+    }
+}
+
+// PLASTICITY_TICKS host ticks per call from the given weights, with STDP unless params is null. spiking gets the
+// fraction of neurons at activation 1 after a tick over a further untimed call, which sets how many rows and columns
+// the weight pass visits.
+static BenchStats bench_plasticity_host(Network &net, const f32 *weights, const PlasticityParams *params,
+                                        f64 *spiking) {
+    memcpy(net.weight_data, weights, net.neuron_count * MAX_SYNAPSES * sizeof(f32));
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+    Plasticity plasticity;
+    if (params) plasticity_init(plasticity, net.neuron_count, *params);
+    Rng rng = rng_create(7);
+
+    // Driven neurons count as spiking on this tick and feed the next one
+    auto run = [&] {
+        for (int t = 0; t < PLASTICITY_TICKS; t++) {
+            cpu_sim_tick(sim, net);
+            bench_plasticity_drive(sim, rng);
+            if (params) plasticity_update(plasticity, net, sim.activation);
+        }
+    };
+    BenchStats stats = bench_measure(run);
+
+    usize spikes = 0;
+    for (int t = 0; t < PLASTICITY_TICKS; t++) {
+        cpu_sim_tick(sim, net);
+        bench_plasticity_drive(sim, rng);
+        if (params) plasticity_update(plasticity, net, sim.activation);
+        for (usize i = 0; i < sim.neuron_count; i++) spikes += sim.activation[i] >= 1.0f;
+    }
+    *spiking = (f64)spikes / ((f64)PLASTICITY_TICKS * sim.neuron_count);
+
+    if (params) plasticity_deinit(plasticity);
+    cpu_sim_deinit(sim);
+    return stats;
+}
+
+// Same on the GPU, ticks and trace and weight passes queued back to back and waited for once per call. The drive
+// goes through network_stimulate, so the ring is recycled between calls.
+static BenchStats bench_plasticity_remote(Network &net, const f32 *weights, const PlasticityParams *params) {
+    memcpy(net.weight_data, weights, net.neuron_count * MAX_SYNAPSES * sizeof(f32));
+    network_upload(net);
+    Plasticity plasticity;
+    if (params) {
+        plasticity_init(plasticity, net.neuron_count, *params);
+        plasticity_init_remote_resources(plasticity, net);
+    }
+    shader_library_finish(global_shader_library);
+
+    Rng rng = rng_create(7);
+    usize drive_count = net.neuron_count / 50;
+    u32 *drive = (u32 *)malloc(drive_count * sizeof(u32));
+    BenchStats stats = bench_measure([&] {
+        for (int t = 0; t < PLASTICITY_TICKS; t++) {
+            network_tick(net);
+            for (usize i = 0; i < drive_count; i++) drive[i] = rng_range(rng, (u32)net.neuron_count);
+            network_stimulate(net, drive, drive_count);
+            if (params) plasticity_update_remote(plasticity, net);
+        }
+        glFinish();
+        stream_buffer_frame(global_stream_buffer);
+    });
+
+    free(drive);
+    if (params) plasticity_deinit(plasticity);
+    return stats;
+}
+
+static void bench_plasticity_line(const char *name, const BenchStats &stats, const BenchStats &plain, usize n) {
+    bench_report(name, stats, (f64)n * PLASTICITY_TICKS, "neurons");
+    printf("    %.2fx a plain tick\n", stats.median_ms / plain.median_ms);
+}
+
+// The network as network_init_host makes it, where most neurons fire every tick and the weight pass has few rows to
+// skip, and the same with thresholds high enough that only the driven neurons fire. Every run starts from the same
+// weights. Each line times PLASTICITY_TICKS ticks, so intervals above 1 include their weight updates.
+void bench_plasticity(usize neuron_count) {
+    Network net;
+    network_init_host(net, neuron_count);
+    usize weight_size = neuron_count * MAX_SYNAPSES * sizeof(f32);
+    f32 *weights = (f32 *)malloc(weight_size);
+    memcpy(weights, net.weight_data, weight_size);
+    f32 *thresholds = (f32 *)malloc(neuron_count * sizeof(f32));
+    for (usize i = 0; i < neuron_count; i++) thresholds[i] = net.neuron_data[i * 4 + 3];
+
+    const char *regimes[] = {"saturated", "sparse"};
+    char name[64];
+    for (int regime = 0; regime < 2; regime++) {
+        if (regime == 1) {
+            for (usize i = 0; i < neuron_count; i++) net.neuron_data[i * 4 + 3] = PLASTICITY_SPARSE_THRESHOLD;
+        }
+
+        f64 spiking;
+        BenchStats plain = bench_plasticity_host(net, weights, nullptr, &spiking);
+        snprintf(name, sizeof(name), "%s tick", regimes[regime]);
+        bench_report(name, plain, (f64)neuron_count * PLASTICITY_TICKS, "neurons");
+        printf("    %.1f%% spiking\n", spiking * 100.0);
+
+        for (u32 interval : plasticity_intervals) {
+            PlasticityParams params = plasticity_default_params();
+            params.interval = interval;
+            BenchStats learning = bench_plasticity_host(net, weights, &params, &spiking);
+            snprintf(name, sizeof(name), "%s tick + stdp / %u", regimes[regime], interval);
+            bench_plasticity_line(name, learning, plain, neuron_count);
+            printf("    %.1f%% spiking\n", spiking * 100.0);
+        }
+    }
+
+    if (!bench_gl_init(64, 64)) {
+        printf("no GL context, skipping the GPU passes\n");
+    } else {
+        for (int regime = 0; regime < 2; regime++) {
+            for (usize i = 0; i < neuron_count; i++) {
+                net.neuron_data[i * 4 + 3] = regime == 1 ? PLASTICITY_SPARSE_THRESHOLD : thresholds[i];
+            }
+
+            BenchStats plain = bench_plasticity_remote(net, weights, nullptr);
+            snprintf(name, sizeof(name), "gpu %s tick", regimes[regime]);
+            bench_report(name, plain, (f64)neuron_count * PLASTICITY_TICKS, "neurons");
+
+            PlasticityParams params = plasticity_default_params();
+            params.interval = PLASTICITY_TRACES_ONLY;
+            BenchStats traces = bench_plasticity_remote(net, weights, &params);
+            snprintf(name, sizeof(name), "gpu %s tick + traces", regimes[regime]);
+            bench_plasticity_line(name, traces, plain, neuron_count);
+
+            for (u32 interval : plasticity_intervals) {
+                params.interval = interval;
+                BenchStats learning = bench_plasticity_remote(net, weights, &params);
+                snprintf(name, sizeof(name), "gpu %s tick + stdp / %u", regimes[regime], interval);
+                bench_plasticity_line(name, learning, plain, neuron_count);
+            }
+        }
+        network_release_remote_resources(net);
+        bench_gl_deinit();
+    }
+
+    free(thresholds);
+    free(weights);
+    network_deinit(net);
+}
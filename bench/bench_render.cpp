@@ -0,0 +1,75 @@
+#include "bench.h"
+#include "renderer.hpp"
+#include "streaming.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#define RENDER_WIDTH 1280
+#define RENDER_HEIGHT 720
+#define RENDER_SEED_STRIDE 7
+
+// Whole frames into an offscreen framebuffer, each waited on with glFinish. The lines modes include the cull passes
+// that build the visible synapse list, zoomed in most synapses are culled or drawn as density tiles.
+void bench_render(usize neuron_count) {
+    if (!bench_gl_init(RENDER_WIDTH, RENDER_HEIGHT)) {
+        printf("no GL context, skipping\n");
+        return;
+    }
+
+    Network net;
+    network_init_host(net, neuron_count);
+    for (usize i = 0; i < net.neuron_count; i += RENDER_SEED_STRIDE) {
+        net.neuron_data[i * 4 + 2] = 1.0f;
+    }
+    usize synapses = 0;
+    for (usize i = 0; i < net.neuron_count * MAX_SYNAPSES; i++) synapses += net.synapse_data[i] >= 0;
+
+    network_upload(net);
+    Renderer renderer;
+    renderer_init(renderer);
+    renderer_attach(renderer, net);
+    shader_library_finish(global_shader_library);
+
+    State state = {};
+    const f32 neuron_active[4] = {1.0f, 1.0f, 1.0f, 1.0f}, neuron_inactive[4] = {0.1f, 0.1f, 0.2f, 1.0f};
+    const f32 synapse_active[4] = {0.0f, 0.5f, 0.0f, 0.5f}, synapse_inactive[4] = {0.5f, 0.0f, 0.0f, 0.5f};
+    memcpy(state.neuron_color.active, neuron_active, sizeof(neuron_active));
+    memcpy(state.neuron_color.inactive, neuron_inactive, sizeof(neuron_inactive));
+    memcpy(state.synapse_color.active, synapse_active, sizeof(synapse_active));
+    memcpy(state.synapse_color.inactive, synapse_inactive, sizeof(synapse_inactive));
+    state.exposure = 1.0f;
+
+    struct {
+        const char *name;
+        RenderMode mode;
+        bool bloom;
+        f32 zoom;
+    } frames[] = {
+        {"lines", RenderModeLines, false, 1.0f},
+        {"lines zoomed", RenderModeLines, false, 16.0f},
+        {"density", RenderModeDensity, false, 1.0f},
+        {"density bloom", RenderModeDensity, true, 1.0f},
+    };
+
+    for (const auto &frame : frames) {
+        state.render_mode = frame.mode;
+        state.bloom_enabled = frame.bloom;
+        state.camera = {0.1f, 0.1f, frame.zoom};
+
+        BenchStats stats = bench_measure([&] {
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderer_render(renderer, net, state);
+            stream_buffer_frame(global_stream_buffer);
+            glFinish();
+        });
+        bench_report(frame.name, stats, (f64)synapses, "synapses");
+    }
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) printf("GL error 0x%x\n", error);
+
+    renderer_deinit(renderer);
+    network_deinit(net);
+    bench_gl_deinit();
+}
@@ -0,0 +1,82 @@
+#include "bench.h"
+#include "cpu_sim.hpp"
+#include "perf_counters.h"
+#include "reorder.hpp"
+#include "topology.hpp"
+
+#include <cstdio>
+
+#define REORDER_WARMUP_TICKS 3
+#define REORDER_TICKS 20
+
+static void bench_reorder_run(const char *topology, const char *method, Network &net) {
+    usize synapse_count = 0;
+    for (usize i = 0; i < net.neuron_count * MAX_SYNAPSES; i++) {
+        synapse_count += net.synapse_data[i] >= 0;
+    }
+
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+    for (int i = 0; i < REORDER_WARMUP_TICKS; i++) {
+        cpu_sim_tick(sim, net);
+    }
+
+    PerfCounters counters;
+    perf_counters_init(counters);
+    perf_counters_start(counters);
+    f64 start = bench_now_ms();
+    for (int i = 0; i < REORDER_TICKS; i++) {
+        cpu_sim_tick(sim, net);
+    }
+    f64 elapsed = bench_now_ms() - start;
+    perf_counters_stop(counters);
+    perf_counters_deinit(counters);
+
+    f64 synapses = (f64)synapse_count * REORDER_TICKS;
+    i64 l1 = counters.values[PerfL1dReadMisses];
+    i64 llc = counters.values[PerfLlcReadMisses];
+    printf("%-10s %-8s %9.3f ms/tick %8.1f Msyn/s", topology, method, elapsed / REORDER_TICKS,
+           synapses / (elapsed * 1e3));
+    if (l1 >= 0) printf("  L1d miss/syn %.3f", l1 / synapses);
+    if (llc >= 0) printf("  LLC miss/syn %.3f", llc / synapses);
+    printf("\n");
+
+    cpu_sim_deinit(sim);
+}
+
+// Random targets from network_init have no locality for any ordering to recover, spatial wiring generated in
+// random index order is where reordering pays off.
+void bench_reorder(usize neuron_count) {
+    const char *methods[] = {"none", "hilbert", "morton", "rcm"};
+
+    for (int topology = 0; topology < 2; topology++) {
+        for (int method = 0; method < 4; method++) {
+            Network net;
+            if (topology == 0) {
+                network_init_host(net, neuron_count);
+            } else {
+                TopologyParams params = {};
+                params.kind = TopologyParams::Spatial;
+                params.neuron_count = neuron_count;
+                params.degree = MAX_SYNAPSES;
+                params.decay_length = 0.05f;
+                params.seed = 1;
+
+                Topology topo;
+                topology_generate(topo, params);
+                network_init_host(net, topo);
+                topology_deinit(topo);
+            }
+
+            if (method > 0) {
+                f64 start = bench_now_ms();
+                network_reorder(net, (ReorderMethod)(method - 1));
+                printf("%-10s %-8s reorder took %.1f ms\n", topology == 0 ? "random" : "spatial", methods[method],
+                       bench_now_ms() - start);
+            }
+
+            bench_reorder_run(topology == 0 ? "random" : "spatial", methods[method], net);
+            network_deinit(net);
+        }
+    }
+}
@@ -0,0 +1,141 @@
+#include "bench.h"
+#include "core/parallel.h"
+#include "cpu_sim.hpp"
+#include "sell.hpp"
+#include "topology.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#define SELL_SEED_STRIDE 97 // every n-th neuron starts active
+#define SELL_CSR_GRAIN 2048
+
+// Plain CSR rows for the baseline: no padding at all, but every row is its own scalar loop of a different length
+struct SellCsr {
+    u32 *offsets;
+    i32 *targets;
+    f32 *weights;
+};
+
+static void bench_sell_csr_init(SellCsr &csr, const Network &net) {
+    csr.offsets = (u32 *)malloc((net.neuron_count + 1) * sizeof(u32));
+    csr.targets = (i32 *)malloc(net.neuron_count * MAX_SYNAPSES * sizeof(i32));
+    csr.weights = (f32 *)malloc(net.neuron_count * MAX_SYNAPSES * sizeof(f32));
+    u32 count = 0;
+    for (usize i = 0; i < net.neuron_count; i++) {
+        csr.offsets[i] = count;
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            usize slot = i * MAX_SYNAPSES + j;
+            if (net.synapse_data[slot] < 0) continue;
+            csr.targets[count] = net.synapse_data[slot];
+            csr.weights[count] = net.weight_data[slot];
+            count++;
+        }
+    }
+    csr.offsets[net.neuron_count] = count;
+}
+
+static void bench_sell_csr_deinit(SellCsr &csr) {
+    free(csr.offsets);
+    free(csr.targets);
+    free(csr.weights);
+}
+
+// Threshold model only, the same update as CpuSim's
+static void bench_sell_csr_tick(const SellCsr &csr, CpuSim &sim) {
+    const f32 *activation = sim.activation;
+    f32 *next = sim.next_activation;
+    parallel_for(0, sim.neuron_count, SELL_CSR_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            f32 sum = 0.0f;
+            for (u32 e = csr.offsets[i]; e < csr.offsets[i + 1]; e++) {
+                sum += csr.weights[e] * activation[csr.targets[e]];
+            }
+            next[i] = sum > sim.threshold[i] ? 1.0f : activation[i] * sim.variant.decay;
+        }
+    });
+    sim.activation = next;
+    sim.next_activation = (f32 *)activation;
+}
+
+static void bench_sell_run(const char *topology, Network &net, bool gl) {
+    for (usize i = 0; i < net.neuron_count; i += SELL_SEED_STRIDE) net.neuron_data[i * 4 + 2] = 1.0f;
+
+    SellSynapses sell;
+    sell_init(sell, net);
+    printf("%s: %zu neurons, %zu synapses, slots per synapse: padded %.2f, sell-%u-%u %.2f, csr 1.00\n", topology,
+           net.neuron_count, sell.synapse_count, (f64)net.neuron_count * MAX_SYNAPSES / sell.synapse_count, sell.chunk,
+           sell.sigma, sell_padding_ratio(sell));
+
+    char name[64];
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+    BenchStats stats = bench_measure([&] { cpu_sim_tick(sim, net); });
+    snprintf(name, sizeof(name), "%s cpu padded", topology);
+    bench_report(name, stats, (f64)sell.synapse_count, "synapses");
+    cpu_sim_deinit(sim);
+
+    SellCsr csr;
+    bench_sell_csr_init(csr, net);
+    cpu_sim_init(sim, net);
+    stats = bench_measure([&] { bench_sell_csr_tick(csr, sim); });
+    snprintf(name, sizeof(name), "%s cpu csr", topology);
+    bench_report(name, stats, (f64)sell.synapse_count, "synapses");
+    cpu_sim_deinit(sim);
+    bench_sell_csr_deinit(csr);
+
+    cpu_sim_init(sim, net);
+    stats = bench_measure([&] { cpu_sim_tick_sell(sim, sell); });
+    snprintf(name, sizeof(name), "%s cpu sell", topology);
+    bench_report(name, stats, (f64)sell.synapse_count, "synapses");
+    cpu_sim_deinit(sim);
+
+    if (gl) {
+        network_upload(net);
+        shader_library_finish(global_shader_library);
+        stats = bench_measure([&] {
+            network_tick(net);
+            glFinish();
+        });
+        snprintf(name, sizeof(name), "%s gpu padded", topology);
+        bench_report(name, stats, (f64)sell.synapse_count, "synapses");
+
+        network_set_sell(net, &sell);
+        shader_library_finish(global_shader_library);
+        stats = bench_measure([&] {
+            network_tick(net);
+            glFinish();
+        });
+        snprintf(name, sizeof(name), "%s gpu sell", topology);
+        bench_report(name, stats, (f64)sell.synapse_count, "synapses");
+        network_release_remote_resources(net);
+    }
+    sell_deinit(sell);
+}
+
+// Threshold ticks over the same rows as padded ELLPACK, CSR and SELL-C-sigma, on uniformly random rows of 3 to 16
+// synapses and on a scale-free graph where most rows are short and a few hubs are full
+void bench_sell(usize neuron_count) {
+    bool gl = bench_gl_init(64, 64);
+    if (!gl) printf("no GL context, skipping the compute shader\n");
+
+    srand(1);
+    Network net;
+    network_init_host(net, neuron_count);
+    bench_sell_run("random", net, gl);
+    network_deinit(net);
+
+    TopologyParams params = {};
+    params.kind = TopologyParams::ScaleFree;
+    params.neuron_count = neuron_count;
+    params.degree = 3;
+    params.seed = 1;
+    Topology topo;
+    topology_generate(topo, params);
+    network_init_host(net, topo);
+    topology_deinit(topo);
+    bench_sell_run("scale-free", net, gl);
+    network_deinit(net);
+
+    if (gl) bench_gl_deinit();
+}
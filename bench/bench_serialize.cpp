@@ -0,0 +1,58 @@
+#include "bench.h"
+#include "core/arena.h"
+#include "neural_net.hpp"
+#include "serialize.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Kinds come back from the current image, and a version 1 image without them still loads, every neuron Hidden
+static void bench_serialize_check_kinds(Network &net, u8 *image, usize size) {
+    Network copy;
+    bool kinds_match = network_deserialize(copy, image, size);
+    for (usize i = 0; kinds_match && i < net.neuron_count; i++) kinds_match = copy.kind_data[i] == net.kind_data[i];
+    if (kinds_match) network_deinit(copy);
+
+    Network old;
+    *reinterpret_cast<usize *>(image) = BIN_MAGIC_V1;
+    bool old_loads = network_deserialize(old, image, size - net.neuron_count);
+    for (usize i = 0; old_loads && i < net.neuron_count; i++) old_loads = old.kind_data[i] == Neuron::Hidden;
+    if (old_loads) network_deinit(old);
+    *reinterpret_cast<usize *>(image) = BIN_MAGIC;
+
+    printf("neuron kinds %s, version 1 image %s\n", kinds_match ? "round trip" : "LOST",
+           old_loads ? "loads" : "REJECTED");
+}
+
+// Round trip through the binary image written by save, bytes counted at the image size
+void bench_serialize(usize neuron_count) {
+    Network net;
+    network_init_host(net, neuron_count);
+    for (usize i = 0; i < net.neuron_count; i++) net.kind_data[i] = (Neuron::Kind)(i % 3);
+    usize size = network_bin_size(net);
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    BenchStats stats = bench_measure([&] {
+        arena_restore(scratch, mark);
+        network_serialize(net, scratch);
+    });
+    bench_report("serialize", stats, (f64)size, "bytes");
+
+    arena_restore(scratch, mark);
+    const u8 *image = network_serialize(net, scratch);
+    stats = bench_measure([&] {
+        Network copy;
+        if (!network_deserialize(copy, image, size)) {
+            fprintf(stderr, "network_deserialize rejected its own image\n");
+            exit(1);
+        }
+        network_deinit(copy);
+    });
+    bench_report("deserialize", stats, (f64)size, "bytes");
+    bench_serialize_check_kinds(net, const_cast<u8 *>(image), size);
+
+    arena_restore(scratch, mark);
+    network_deinit(net);
+}
@@ -0,0 +1,110 @@
+#include "bench.h"
+#include "core/random.h"
+#include "spatial.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+#define SPATIAL_BUILDS 5
+#define SPATIAL_QUERIES 10000
+#define SPATIAL_KNN 16
+#define SPATIAL_BRUSH_CAPACITY 4096
+
+// Nearest point within max_distance by a linear scan, ties to the lower index as the grid does. Also counts the points
+// within max_distance.
+static i32 bench_spatial_scan(const f32 *positions, usize count, f32 x, f32 y, f32 max_distance, usize *within) {
+    i32 nearest = -1;
+    f32 max_dist2 = max_distance * max_distance, nearest_dist2 = max_dist2;
+    *within = 0;
+    for (usize i = 0; i < count; i++) {
+        f32 dx = positions[i * 4 + 0] - x;
+        f32 dy = positions[i * 4 + 1] - y;
+        f32 d2 = dx * dx + dy * dy;
+        *within += d2 <= max_dist2;
+        if (d2 > nearest_dist2 || (d2 == nearest_dist2 && nearest >= 0)) continue;
+        nearest = (i32)i;
+        nearest_dist2 = d2;
+    }
+    return nearest;
+}
+
+// Pick and brush queries off the grid, just past its edges and far away, against a linear scan. Points within reach
+// of a query just outside the grid must still be found, and nothing past the edge cells may be read.
+static usize bench_spatial_check_outside(const SpatialGrid &grid, const f32 *positions, usize count) {
+    const f32 queries[][3] = {
+        {-5.0f, 0.001f, 0.01f}, {5.0f, 0.001f, 0.01f},  {0.001f, -5.0f, 0.01f}, {0.001f, 5.0f, 0.01f},
+        {-5.0f, -5.0f, 1.0f},   {1e30f, -1e30f, 0.05f}, {-1.002f, 0.3f, 0.01f}, {1.002f, -0.3f, 0.01f},
+        {0.3f, -1.002f, 0.01f}, {-0.3f, 1.002f, 0.01f}, {-1.01f, -1.01f, 0.05f}, {1.01f, 1.01f, 0.05f},
+        {-5.0f, -0.999f, 0.01f}, {5.0f, 0.999f, 0.01f},
+    };
+    usize mismatches = 0;
+    u32 brushed[1];
+    for (const f32 *q : queries) {
+        usize within;
+        i32 nearest = bench_spatial_scan(positions, count, q[0], q[1], q[2], &within);
+        mismatches += spatial_grid_nearest(grid, q[0], q[1], q[2]) != nearest;
+        mismatches += spatial_grid_radius(grid, q[0], q[1], q[2], brushed, 1) != within;
+    }
+    return mismatches;
+}
+
+// Grid build and the three interactive queries over uniformly scattered neurons. Pick and brush sizes match what
+// the UI uses at a 1080-pixel-high window.
+void bench_spatial(usize neuron_count) {
+    f32 *positions = (f32 *)malloc(neuron_count * 4 * sizeof(f32));
+    Rng rng = rng_create(5);
+    for (usize i = 0; i < neuron_count; i++) {
+        positions[i * 4 + 0] = rng_f32(rng) * 2.0f - 1.0f;
+        positions[i * 4 + 1] = rng_f32(rng) * 2.0f - 1.0f;
+    }
+
+    SpatialGrid grid;
+    f64 build_ms = 0.0;
+    for (int b = 0; b < SPATIAL_BUILDS; b++) {
+        f64 start = bench_now_ms();
+        spatial_grid_build(grid, positions, 4, neuron_count);
+        build_ms += bench_now_ms() - start;
+        if (b + 1 < SPATIAL_BUILDS) spatial_grid_deinit(grid);
+    }
+    printf("build   %8.3f ms  (%u x %u cells)\n", build_ms / SPATIAL_BUILDS, grid.width, grid.height);
+    printf("off-grid queries: %zu mismatches against a linear scan\n",
+           bench_spatial_check_outside(grid, positions, neuron_count));
+
+    f32 *queries = (f32 *)malloc(SPATIAL_QUERIES * 2 * sizeof(f32));
+    for (usize q = 0; q < SPATIAL_QUERIES * 2; q++) {
+        queries[q] = rng_f32(rng) * 2.0f - 1.0f;
+    }
+
+    f32 pixel = 2.0f / 1080.0f;
+    usize hits = 0;
+    f64 start = bench_now_ms();
+    for (usize q = 0; q < SPATIAL_QUERIES; q++) {
+        hits += spatial_grid_nearest(grid, queries[q * 2], queries[q * 2 + 1], 8.0f * pixel) >= 0;
+    }
+    f64 pick_ms = bench_now_ms() - start;
+    printf("pick    %8.3f us  (%.1f%% hit)\n", pick_ms * 1e3 / SPATIAL_QUERIES, 100.0 * hits / SPATIAL_QUERIES);
+
+    static u32 brushed[SPATIAL_BRUSH_CAPACITY];
+    usize brushed_total = 0;
+    start = bench_now_ms();
+    for (usize q = 0; q < SPATIAL_QUERIES; q++) {
+        brushed_total += spatial_grid_radius(grid, queries[q * 2], queries[q * 2 + 1], 0.05f, brushed,
+                                             SPATIAL_BRUSH_CAPACITY);
+    }
+    f64 brush_ms = bench_now_ms() - start;
+    printf("brush   %8.3f us  (%.0f neurons per query)\n", brush_ms * 1e3 / SPATIAL_QUERIES,
+           (f64)brushed_total / SPATIAL_QUERIES);
+
+    u32 indices[SPATIAL_KNN];
+    f32 dist2[SPATIAL_KNN];
+    start = bench_now_ms();
+    for (usize q = 0; q < SPATIAL_QUERIES; q++) {
+        spatial_grid_knn(grid, queries[q * 2], queries[q * 2 + 1], SPATIAL_KNN, -1, indices, dist2);
+    }
+    f64 knn_ms = bench_now_ms() - start;
+    printf("knn %-3d %8.3f us\n", SPATIAL_KNN, knn_ms * 1e3 / SPATIAL_QUERIES);
+
+    spatial_grid_deinit(grid);
+    free(queries);
+    free(positions);
+}
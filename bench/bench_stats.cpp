@@ -0,0 +1,116 @@
+#include "bench.h"
+#include "gpu_stats.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#define STATS_SEED_STRIDE 7 // every n-th neuron starts active
+#define STATS_TICKS 64      // ticks followed by the asynchronous loop
+
+// The same record computed on the host from a full readback
+static void bench_stats_reference(const Network &net, const GpuStats &stats, GpuStatsRecord &record) {
+    record = {};
+    f64 activation_sum = 0.0, weight_sum = 0.0;
+    for (usize i = 0; i < net.neuron_count; i++) {
+        f32 activation = net.neuron_data[i * 4 + 2];
+        activation_sum += activation;
+        if (activation >= 1.0f) {
+            record.fired[net.kind_data[i]]++;
+            record.fired[3]++;
+        }
+        f32 bin = activation * GPU_STATS_BINS;
+        record.activation_bins[bin < 0.0f ? 0 : bin > GPU_STATS_BINS - 1 ? GPU_STATS_BINS - 1 : (u32)bin]++;
+
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            if (net.synapse_data[i * MAX_SYNAPSES + j] < 0) continue;
+            f32 weight = net.weight_data[i * MAX_SYNAPSES + j];
+            weight_sum += weight;
+            record.weight_sum[2] += 1.0f;
+            bin = (weight - stats.weight_min) * (GPU_STATS_BINS / (stats.weight_max - stats.weight_min));
+            record.weight_bins[bin < 0.0f ? 0 : bin > GPU_STATS_BINS - 1 ? GPU_STATS_BINS - 1 : (u32)bin]++;
+        }
+    }
+    record.activation_sum[3] = (f32)activation_sum;
+    record.weight_sum[0] = (f32)weight_sum;
+}
+
+static usize bench_stats_bin_mismatches(const u32 *a, const u32 *b) {
+    usize mismatches = 0;
+    for (int i = 0; i < GPU_STATS_BINS; i++) mismatches += a[i] != b[i];
+    return mismatches;
+}
+
+// Following a running network: the whole neuron buffer read back every tick, as network_update used to, against the
+// reduction into a GpuStatsRecord, synchronously and in the asynchronous ring. The record is checked against the host
+// computing the same from a full readback.
+void bench_stats(usize neuron_count) {
+    if (!bench_gl_init(64, 64)) {
+        printf("no GL context, skipping\n");
+        return;
+    }
+
+    Network net;
+    network_init_host(net, neuron_count);
+    for (usize i = 0; i < neuron_count; i += STATS_SEED_STRIDE) net.neuron_data[i * 4 + 2] = 1.0f;
+    network_upload(net);
+    GpuStats stats;
+    gpu_stats_init(stats, net, 0.0f, 1.0f);
+    shader_library_finish(global_shader_library);
+    for (int t = 0; t < 8; t++) network_tick(net);
+
+    BenchStats timing = bench_measure([&] { network_read_neurons(net); });
+    bench_report("full readback", timing, (f64)neuron_count, "neurons");
+    printf("  %zu KB per tick\n", neuron_count * 4 * sizeof(f32) >> 10);
+
+    timing = bench_measure([&] {
+        gpu_stats_record(stats, net);
+        while (!gpu_stats_poll(stats)) {
+        }
+    });
+    bench_report("reduce + wait", timing, (f64)neuron_count, "neurons");
+    timing = bench_measure([&] {
+        gpu_stats_record(stats, net, true);
+        while (!gpu_stats_poll(stats)) {
+        }
+    });
+    bench_report("reduce weights + wait", timing, (f64)neuron_count, "neurons");
+    printf("  %zu bytes per tick, %s reductions\n", sizeof(GpuStatsRecord),
+           stats.subgroups ? "subgroup" : "shared memory");
+
+    // The asynchronous loop never waits: ticks keep going while records come back a few ticks late
+    usize dropped = stats.dropped, received = stats.received;
+    f64 start = bench_now_ms();
+    for (int t = 0; t < STATS_TICKS; t++) {
+        network_tick(net);
+        gpu_stats_record(stats, net);
+        gpu_stats_poll(stats);
+    }
+    glFinish();
+    gpu_stats_poll(stats);
+    printf("tick + record + poll: %.3f ms per tick, %zu of %d records back, %zu dropped\n",
+           (bench_now_ms() - start) / STATS_TICKS, stats.received - received, STATS_TICKS, stats.dropped - dropped);
+
+    i32 probe = (i32)(neuron_count / 2);
+    gpu_stats_probe(stats, 0, probe);
+    gpu_stats_record(stats, net, true);
+    glFinish();
+    gpu_stats_poll(stats);
+    network_read_neurons(net);
+    GpuStatsRecord reference;
+    bench_stats_reference(net, stats, reference);
+    const GpuStatsRecord &record = stats.latest;
+    printf("fired %u vs %u on the host, activation sum %.6g vs %.6g, weight sum %.6g vs %.6g over %.0f vs %.0f\n",
+           record.fired[3], reference.fired[3], record.activation_sum[3], reference.activation_sum[3],
+           record.weight_sum[0], reference.weight_sum[0], record.weight_sum[2], reference.weight_sum[2]);
+    printf("histogram bins differing: %zu activation, %zu weight\n",
+           bench_stats_bin_mismatches(record.activation_bins, reference.activation_bins),
+           bench_stats_bin_mismatches(record.weight_bins, reference.weight_bins));
+    const f32 *probed = gpu_stats_probed(stats, 0, probe);
+    printf("probe #%d: activation %.6g vs %.6g on the host\n", probe, probed ? probed[2] : NAN,
+           net.neuron_data[probe * 4 + 2]);
+
+    gpu_stats_deinit(stats);
+    network_deinit(net);
+    bench_gl_deinit();
+}
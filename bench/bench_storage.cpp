@@ -0,0 +1,79 @@
+#include "bench.h"
+#include "core/half.h"
+#include "core/random.h"
+#include "cpu_sim.hpp"
+
+#include <cmath>
+#include <cstdio>
+
+#define STORAGE_WARMUP_TICKS 5
+#define STORAGE_TICKS 50
+
+// Runs each format next to the f32 engine with the same drive, timing only the compact tick. Accuracy is the
+// activation error against f32 and the fraction of neurons whose spike/no-spike outcome agrees.
+void bench_storage(usize neuron_count) {
+    Network net;
+    network_init_host(net, neuron_count, neuron_model_default_params(NeuronModelLif));
+
+    const char *weight_names[] = {"f32", "f16", "q8"};
+    const char *target_names[] = {"i32", "u16"};
+    const char *activation_names[] = {"f32", "f16"};
+
+    for (int w = 0; w < 3; w++) {
+        for (int t = 0; t < 2; t++) {
+            for (int a = 0; a < 2; a++) {
+                StorageFormat format = {(WeightFormat)w, (TargetFormat)t, (ActivationFormat)a};
+                if (format.targets == TargetFormatU16 && neuron_count > STORAGE_U16_MAX_NEURONS) continue;
+
+                CpuSim reference;
+                CpuSim sim;
+                CompactSynapses compact;
+                cpu_sim_init(reference, net);
+                cpu_sim_init(sim, net);
+                compact_init(compact, net, format);
+                Rng rng = rng_create(11);
+
+                f64 elapsed = 0.0;
+                f64 error_sum = 0.0;
+                f32 error_max = 0.0f;
+                usize agree = 0;
+                for (int tick = 0; tick < STORAGE_WARMUP_TICKS + STORAGE_TICKS; tick++) {
+                    for (usize i = 0; i < neuron_count / 100; i++) {
+                        u32 n = rng_range(rng, (u32)neuron_count);
+                        reference.activation[n] = 1.0f;
+                        sim.activation[n] = 1.0f;
+                        if (compact.activation) compact.activation[n] = f16_from_f32(1.0f);
+                    }
+
+                    cpu_sim_tick(reference, net);
+                    f64 start = bench_now_ms();
+                    cpu_sim_tick_compact(sim, compact);
+                    if (tick >= STORAGE_WARMUP_TICKS) elapsed += bench_now_ms() - start;
+
+                    if (tick < STORAGE_WARMUP_TICKS) continue;
+                    cpu_sim_load_compact(sim, compact);
+                    for (usize i = 0; i < neuron_count; i++) {
+                        f32 error = fabsf(sim.activation[i] - reference.activation[i]);
+                        error_sum += error;
+                        error_max = fmaxf(error_max, error);
+                        agree += (sim.activation[i] == 1.0f) == (reference.activation[i] == 1.0f);
+                    }
+                }
+
+                usize bytes = storage_format_bytes_per_tick(compact.format, neuron_count);
+                f64 seconds = elapsed / 1e3;
+                printf("w=%-3s t=%-3s a=%-3s %7.2f MB/tick  %8.3f ms/tick  %7.1f ticks/s  err mean %.2e max %.2e  "
+                       "spikes %.3f%% agree\n",
+                       weight_names[w], target_names[t], activation_names[a], bytes / 1e6, elapsed / STORAGE_TICKS,
+                       STORAGE_TICKS / seconds, error_sum / ((f64)neuron_count * STORAGE_TICKS), error_max,
+                       100.0 * agree / ((f64)neuron_count * STORAGE_TICKS));
+
+                compact_deinit(compact);
+                cpu_sim_deinit(sim);
+                cpu_sim_deinit(reference);
+            }
+        }
+    }
+
+    network_deinit(net);
+}
@@ -0,0 +1,69 @@
+#include "bench.h"
+#include "cpu_sim.hpp"
+#include "topology.hpp"
+
+#include <cstdio>
+
+#define VARIANTS_WARMUP_TICKS 3
+#define VARIANTS_TICKS 20
+
+static f64 bench_variants_run(const Network &net, const KernelVariant &variant) {
+    CpuSim sim;
+    cpu_sim_init(sim, net);
+    for (int t = 0; t < VARIANTS_WARMUP_TICKS; t++) {
+        cpu_sim_tick_variant(sim, net, variant);
+    }
+
+    f64 start = bench_now_ms();
+    for (int t = 0; t < VARIANTS_TICKS; t++) {
+        cpu_sim_tick_variant(sim, net, variant);
+    }
+    f64 elapsed = (bench_now_ms() - start) / VARIANTS_TICKS;
+
+    cpu_sim_deinit(sim);
+    return elapsed;
+}
+
+// Each fan-in gets a small-world network of exactly that degree, then every model and precision runs on it both
+// with the matching specialisation and with the generic full-width kernel.
+void bench_variants(usize neuron_count) {
+    const char *models[] = {"threshold", "lif", "izhikevich"};
+    const u32 fan_ins[] = {4, 8, MAX_SYNAPSES};
+
+    printf("%-10s %-6s %-4s %12s %12s %8s\n", "model", "fan-in", "prec", "specialised", "generic", "speedup");
+    for (u32 fan_in : fan_ins) {
+        TopologyParams params = {};
+        params.kind = TopologyParams::SmallWorld;
+        params.neuron_count = neuron_count;
+        params.degree = fan_in;
+        params.rewire_probability = 0.1f;
+        params.seed = 3;
+
+        Topology topo;
+        topology_generate(topo, params);
+
+        for (int m = 0; m < 3; m++) {
+            Network net;
+            network_init_host(net, topo, neuron_model_default_params((NeuronModel)m));
+            for (usize i = 0; i < neuron_count; i += 97) {
+                net.neuron_data[i * 4 + 2] = 1.0f;
+            }
+
+            for (int p = 0; p < 2; p++) {
+                KernelVariant variant = kernel_variant_for(net);
+                variant.precision = (KernelPrecision)p;
+                KernelVariant generic = variant;
+                generic.fan_in = MAX_SYNAPSES;
+
+                f64 specialised_ms = bench_variants_run(net, variant);
+                f64 generic_ms = bench_variants_run(net, generic);
+                printf("%-10s %-6u %-4s %9.3f ms %9.3f ms %7.2fx\n", models[m], variant.fan_in, p ? "f64" : "f32",
+                       specialised_ms, generic_ms, generic_ms / specialised_ms);
+            }
+
+            network_deinit(net);
+        }
+
+        topology_deinit(topo);
+    }
+}
@@ -0,0 +1,80 @@
+#include "bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+struct BenchSuite {
+    const char *name;
+    void (*run)(usize neuron_count);
+    usize default_neuron_count;
+};
+
+static const BenchSuite suites[] = {
+    {"reorder", bench_reorder, 1 << 20},
+    {"plasticity", bench_plasticity, 1 << 20},
+    {"models", bench_models, 1 << 20},
+    {"variants", bench_variants, 1 << 20},
+    {"storage", bench_storage, 65535},
+    {"spatial", bench_spatial, 1 << 20},
+    {"memory", bench_memory, 1 << 20},
+    {"numa", bench_numa, 1 << 20},
+    {"distributed", bench_distributed, 1 << 18},
+    {"kernels", bench_kernels, 1 << 20},
+    {"serialize", bench_serialize, 1 << 20},
+    {"generate", bench_generate, 1 << 18},
+    {"render", bench_render, 1 << 14},
+    {"equivalence", bench_equivalence, 1 << 14},
+    {"sell", bench_sell, 1 << 20},
+    {"inference", bench_inference, 1 << 18},
+    {"delays", bench_delays, 1 << 20},
+    {"ensemble", bench_ensemble, 1 << 14},
+    {"sweep", bench_sweep, 1 << 14},
+    {"edits", bench_edits, 1 << 20},
+    {"input", bench_input, 1 << 18},
+    {"stats", bench_stats, 1 << 20},
+};
+
+// Usage: bench [suite] [neuron_count] [--warmup n] [--iterations n] [--json path] [--ulps n] [--epsilon x]
+//              [--csv path]
+int main(int argc, char **argv) {
+    const char *filter = nullptr;
+    const char *json = nullptr;
+    usize neuron_count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            bench_options.warmup = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            bench_options.iterations = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json = argv[++i];
+        } else if (strcmp(argv[i], "--ulps") == 0 && i + 1 < argc) {
+            bench_options.max_ulps = (u32)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--epsilon") == 0 && i + 1 < argc) {
+            bench_options.epsilon = strtof(argv[++i], nullptr);
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            bench_options.csv = argv[++i];
+        } else if (!filter) {
+            filter = argv[i];
+        } else {
+            neuron_count = (usize)strtoull(argv[i], nullptr, 10);
+        }
+    }
+    if (filter && strcmp(filter, "all") == 0) filter = nullptr;
+
+    bool ran = false;
+    for (const BenchSuite &suite : suites) {
+        if (filter && strcmp(filter, suite.name) != 0) continue;
+        printf("== %s\n", suite.name);
+        bench_options.suite = suite.name;
+        suite.run(neuron_count ? neuron_count : suite.default_neuron_count);
+        ran = true;
+    }
+
+    if (!ran) {
+        fprintf(stderr, "Unknown suite: %s\n", filter);
+        return 1;
+    }
+    if (json && !bench_write_json(json)) return 1;
+    return 0;
+}
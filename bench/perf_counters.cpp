@@ -0,0 +1,78 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int perf_open(u32 type, u64 config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1; // count worker threads spawned by parallel_for
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static u64 perf_cache_config(u64 cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+void perf_counters_init(PerfCounters &counters) {
+    counters.fds[PerfCycles] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    counters.fds[PerfInstructions] = perf_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    counters.fds[PerfL1dReadMisses] = perf_open(PERF_TYPE_HW_CACHE, perf_cache_config(PERF_COUNT_HW_CACHE_L1D));
+    counters.fds[PerfLlcReadMisses] = perf_open(PERF_TYPE_HW_CACHE, perf_cache_config(PERF_COUNT_HW_CACHE_LL));
+    for (int i = 0; i < PerfCounterCount; i++) {
+        counters.values[i] = -1;
+    }
+}
+
+void perf_counters_deinit(PerfCounters &counters) {
+    for (int i = 0; i < PerfCounterCount; i++) {
+        if (counters.fds[i] >= 0) close(counters.fds[i]);
+        counters.fds[i] = -1;
+    }
+}
+
+void perf_counters_start(PerfCounters &counters) {
+    for (int i = 0; i < PerfCounterCount; i++) {
+        if (counters.fds[i] < 0) continue;
+        ioctl(counters.fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(counters.fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+void perf_counters_stop(PerfCounters &counters) {
+    for (int i = 0; i < PerfCounterCount; i++) {
+        counters.values[i] = -1;
+        if (counters.fds[i] < 0) continue;
+
+        ioctl(counters.fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        u64 value;
+        if (read(counters.fds[i], &value, sizeof(value)) == sizeof(value)) counters.values[i] = (i64)value;
+    }
+}
+#else
+void perf_counters_init(PerfCounters &counters) {
+    for (int i = 0; i < PerfCounterCount; i++) {
+        counters.fds[i] = -1;
+        counters.values[i] = -1;
+    }
+}
+
+void perf_counters_deinit(PerfCounters &counters) {
+}
+
+void perf_counters_start(PerfCounters &counters) {
+}
+
+void perf_counters_stop(PerfCounters &counters) {
+}
+#endif
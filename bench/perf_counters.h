@@ -0,0 +1,23 @@
+#pragma once
+
+#include "core/types.h"
+
+// Hardware cache counters through perf_event_open. Counters that the kernel refuses (perf_event_paranoid,
+// virtual machines without a PMU, non-Linux hosts) read as -1 and the benchmark still reports timings.
+enum PerfCounter {
+    PerfCycles,
+    PerfInstructions,
+    PerfL1dReadMisses,
+    PerfLlcReadMisses,
+    PerfCounterCount,
+};
+
+struct PerfCounters {
+    int fds[PerfCounterCount];
+    i64 values[PerfCounterCount];
+};
+
+void perf_counters_init(PerfCounters &counters);
+void perf_counters_deinit(PerfCounters &counters);
+void perf_counters_start(PerfCounters &counters);
+void perf_counters_stop(PerfCounters &counters);
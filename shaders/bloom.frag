@@ -1,16 +1,14 @@
 #version 430
 
-in vec2 v_texcoord;
-out vec4 frag_color;
+out vec4 fragColor;
 
-uniform sampler2D origin;
+uniform sampler2D original;
 uniform sampler2D bloom;
+uniform float intensity;
 
 void main() {
-    vec3 original = texture(original, v_texcoord).rgb;
-    vec3 bloom = texture(bloom, v_texcoord).rgb;
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    vec3 color = texelFetch(original, p, 0).rgb + texelFetch(bloom, p, 0).rgb * intensity;
 
-    vec3 final = original + bloom * 2.0;
-
-    fragColor = vec4(final, 1.0);
+    fragColor = vec4(color, 1.0);
 }
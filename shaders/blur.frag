@@ -0,0 +1,30 @@
+#version 430
+
+out vec4 fragColor;
+
+uniform sampler2D source;
+uniform ivec2 direction;
+uniform float threshold; // subtracted before blurring, 0 after the first pass
+
+vec3 tap(int offset) {
+    ivec2 size = textureSize(source, 0);
+    ivec2 p = clamp(ivec2(gl_FragCoord.xy) + offset * direction, ivec2(0), size - 1);
+    return max(texelFetch(source, p, 0).rgb - threshold, vec3(0.0));
+}
+
+void main() {
+    vec3 color = vec3(0.0);
+
+    // 9-tap Gaussian blur
+    color += tap(-4) * 0.0162;
+    color += tap(-3) * 0.0540;
+    color += tap(-2) * 0.1216;
+    color += tap(-1) * 0.1945;
+    color += tap(0) * 0.2270;
+    color += tap(1) * 0.1945;
+    color += tap(2) * 0.1216;
+    color += tap(3) * 0.0540;
+    color += tap(4) * 0.0162;
+
+    fragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,26 @@
+#version 430
+
+layout(std430, binding = 9) readonly buffer DensityTiles {
+    uint tiles[]; // count, activation sum in 1/256ths
+};
+
+uniform uint tile_pixels;
+uniform uvec2 tile_count;
+uniform float density_scale; // synapses per tile at which coverage reaches 1 - 1/e
+
+uniform vec4 active_color;
+uniform vec4 inactive_color;
+
+out vec4 fragColor;
+
+void main() {
+    uvec2 tile = uvec2(gl_FragCoord.xy) / tile_pixels;
+    uint index = (tile.y * tile_count.x + tile.x) * 2u;
+    uint count = tiles[index];
+    if (count == 0u) discard;
+
+    float activation = float(tiles[index + 1u]) / (256.0 * float(count));
+    float coverage = 1.0 - exp(-float(count) / density_scale);
+    vec4 color = mix(inactive_color, active_color, activation);
+    fragColor = vec4(color.rgb, color.a * coverage);
+}
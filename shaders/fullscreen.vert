@@ -0,0 +1,7 @@
+#version 430
+
+// Full-screen triangle from gl_VertexID, no vertex buffer. Fragment shaders address texels with gl_FragCoord.
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -3,22 +3,24 @@
 in float v_activation;
 out vec4 fragColor;
 
+uniform vec4 active_color;
+uniform vec4 inactive_color;
+
 void main() {    
     vec2 coord = gl_PointCoord * 2.0 - 1.0;    
     float r = dot(coord, coord);    
     if (r > 1.0) discard;        
     
     // Base color changes with activation
-    vec3 baseColor = mix(        
-        vec3(0.1, 0.1, 0.2),  // Inactive state (darker blue)
-        // vec3(0.4, 0.8, 1.0),  // Active state (bright blue)
-        vec3(1.0, 1.0, 1.0),  // Active state (bright blue)
+    vec4 baseColor = mix(        
+        inactive_color,
+        active_color,
         v_activation    
     );
     
     float glow = exp(-r * 1.5);
-    vec3 finalColor = baseColor + vec3(0.1) * glow;
-    float alpha = min(1.0, glow + 0.2);
+    vec3 finalColor = baseColor.rgb + vec3(0.1) * glow;
+    float alpha = min(baseColor.a, glow + 0.2);
     
     fragColor = vec4(finalColor, alpha);
 }
@@ -1,20 +1,24 @@
 #version 430
 
-layout(location = 0) in vec2 position;
-layout(location = 1) in float activation;
-layout(location = 2) in float threshold;
+layout(std430, binding = 0) readonly buffer NeuronData {
+    vec4 neurons[]; // x,y = position, z = activation, w = threshold
+};
+
+layout(std430, binding = 6) readonly buffer VisibleNeurons {
+    uint visible_neurons[];
+};
 
 uniform vec2 viewport;
+uniform vec3 camera; // x, y = centre, z = zoom
+uniform float point_size;
 
 out float v_activation;
 
-void main() {    
-    v_activation = activation;    
+void main() {
+    vec4 neuron = neurons[visible_neurons[gl_VertexID]];
+    v_activation = neuron.z;
 
-    float aspect = viewport.x / viewport.y;
-    vec2 scale = vec2(1.0 / aspect, 1.0);
-    
-    gl_Position = vec4((position * scale), 0.0, 1.0);  // Scale down positions    
-    // gl_PointSize = 7.5 * viewport.y / viewport.x;
-    gl_PointSize = 10.0 * viewport.y / viewport.x;
+    vec2 scale = vec2(viewport.y / viewport.x, 1.0) * camera.z;
+    gl_Position = vec4((neuron.xy - camera.xy) * scale, 0.0, 1.0);
+    gl_PointSize = point_size;
 }
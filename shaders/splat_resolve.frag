@@ -0,0 +1,25 @@
+#version 430
+
+#define SPLAT_SCALE 256.0
+
+out vec4 fragColor;
+
+uniform usampler2D neuron_density;
+uniform usampler2D synapse_traffic;
+uniform float exposure;
+
+uniform vec4 neuron_color;
+uniform vec4 synapse_color;
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    float neuron = float(texelFetch(neuron_density, p, 0).r) / SPLAT_SCALE;
+    float traffic = float(texelFetch(synapse_traffic, p, 0).r) / SPLAT_SCALE;
+    if (neuron == 0.0 && traffic == 0.0) discard;
+
+    // Exponential tone map, each channel saturates towards its color instead of clipping
+    vec3 color = synapse_color.rgb * synapse_color.a * (1.0 - exp(-traffic * exposure));
+    color += neuron_color.rgb * neuron_color.a * (1.0 - exp(-neuron * exposure * 4.0));
+
+    fragColor = vec4(color, 1.0);
+}
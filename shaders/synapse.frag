@@ -3,14 +3,18 @@
 in float v_activation;
 out vec4 fragColor;
 
+uniform vec4 active_color;
+uniform vec4 inactive_color;
+
 void main() {
-    vec3 color = mix(
-        vec3(0.3, 0.0, 0.0),  // Dim color for inactive connections
-        vec3(0.0, 0.3, 0.0),  // Brighter for active connections
+    vec4 color = mix(
+        inactive_color,
+        active_color,
         v_activation
     );
 
-    // float alpha = 0.3 * v_activation;
-    
-    fragColor = vec4(color, 0.2);  // Semi-transparent lines
+    // float alpha = color.a * v_activation;
+  
+    // fragColor = vec4(color.rgb, alpha);  // Semi-transparent lines
+    fragColor = color;
 }
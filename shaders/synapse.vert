@@ -1,18 +1,23 @@
 #version 430
 
-layout(location = 0) in vec2 position;
-layout(location = 1) in float activation;
+layout(std430, binding = 0) readonly buffer NeuronData {
+    vec4 neurons[]; // x,y = position, z = activation, w = threshold
+};
+
+layout(std430, binding = 7) readonly buffer VisibleSynapses {
+    uvec2 visible_synapses[]; // row neuron, target neuron
+};
 
 uniform vec2 viewport;
+uniform vec3 camera; // x, y = centre, z = zoom
 
 out float v_activation;
 
 void main() {
-    v_activation = activation;    
-    float aspect = viewport.x / viewport.y;    
-    vec2 scale = vec2(1.0 / aspect, 1.0);    
-    gl_Position = vec4(position * scale, 0.0, 1.0);
-    
-    // v_activation = activation;
-    // gl_Position = vec4(position * 0.01, 0.0, 1.0);  // Use same scale as neurons
+    uvec2 synapse = visible_synapses[gl_VertexID >> 1];
+    vec4 neuron = neurons[(gl_VertexID & 1) == 0 ? synapse.x : synapse.y];
+    v_activation = neuron.z;
+
+    vec2 scale = vec2(viewport.y / viewport.x, 1.0) * camera.z;
+    gl_Position = vec4((neuron.xy - camera.xy) * scale, 0.0, 1.0);
 }
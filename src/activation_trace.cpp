@@ -0,0 +1,80 @@
+#include "activation_trace.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+void activation_trace_init(ActivationTrace &trace, usize neuron_count, usize tick_capacity) {
+    trace.neuron_count = neuron_count;
+    trace.tick_count = 0;
+    trace.tick_capacity = tick_capacity;
+    trace.values = (f32 *)malloc(neuron_count * tick_capacity * sizeof(f32));
+}
+
+void activation_trace_deinit(ActivationTrace &trace) {
+    free(trace.values);
+    trace.values = nullptr;
+    trace.tick_count = trace.tick_capacity = 0;
+}
+
+f32 *activation_trace_push(ActivationTrace &trace) {
+    if (trace.tick_count == trace.tick_capacity) return nullptr;
+    return &trace.values[trace.tick_count++ * trace.neuron_count];
+}
+
+// Maps float bits onto unsigned integers in the same order as the floats, so ULP distance is a subtraction
+static u32 f32_ordered_bits(f32 value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+u32 f32_ulp_distance(f32 a, f32 b) {
+    if (a == b) return 0;
+    if (std::isnan(a) || std::isnan(b)) return std::isnan(a) && std::isnan(b) ? 0 : 0xFFFFFFFFu;
+
+    u32 x = f32_ordered_bits(a);
+    u32 y = f32_ordered_bits(b);
+    return x > y ? x - y : y - x;
+}
+
+bool activation_trace_match(f32 expected, f32 actual, const ActivationTolerance &tolerance) {
+    if (f32_ulp_distance(expected, actual) <= tolerance.max_ulps) return true;
+    return fabsf(expected - actual) <= tolerance.epsilon;
+}
+
+ActivationDiff activation_trace_diff(const ActivationTrace &expected, const ActivationTrace &actual,
+                                     const ActivationTolerance &tolerance) {
+    ActivationDiff diff = {};
+    diff.equal = true;
+    if (expected.neuron_count != actual.neuron_count) {
+        diff.equal = false;
+        return diff;
+    }
+
+    usize ticks = expected.tick_count < actual.tick_count ? expected.tick_count : actual.tick_count;
+    diff.ticks_compared = ticks;
+    for (usize t = 0; t < ticks; t++) {
+        const f32 *a = activation_trace_tick(expected, t);
+        const f32 *b = activation_trace_tick(actual, t);
+        for (usize i = 0; i < expected.neuron_count; i++) {
+            if (a[i] == b[i]) continue;
+
+            u32 ulps = f32_ulp_distance(a[i], b[i]);
+            f32 error = fabsf(a[i] - b[i]);
+            if (ulps > diff.max_ulps) diff.max_ulps = ulps;
+            if (error > diff.max_error) diff.max_error = error;
+            if (activation_trace_match(a[i], b[i], tolerance)) continue;
+
+            if (diff.equal) {
+                diff.equal = false;
+                diff.tick = t;
+                diff.neuron = i;
+                diff.expected = a[i];
+                diff.actual = b[i];
+            }
+            diff.mismatches++;
+        }
+    }
+    return diff;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "core/types.h"
+
+// Activations of every neuron after each tick of one run, in neuron index order. Engines are checked against each
+// other by recording the same seeded network through each and diffing the traces tick by tick.
+struct ActivationTrace {
+    usize neuron_count;
+    usize tick_count;
+    usize tick_capacity;
+    f32 *values; // tick_capacity rows of neuron_count
+};
+
+void activation_trace_init(ActivationTrace &trace, usize neuron_count, usize tick_capacity);
+void activation_trace_deinit(ActivationTrace &trace);
+// Appends a tick and returns its row for the caller to fill, null once the trace is full
+f32 *activation_trace_push(ActivationTrace &trace);
+
+static inline const f32 *activation_trace_tick(const ActivationTrace &trace, usize tick) {
+    return &trace.values[tick * trace.neuron_count];
+}
+
+// Two values match when they are within max_ulps representable floats of each other or within epsilon absolute.
+// Zero for both means bit-exact, which the strict kernels are expected to reach.
+struct ActivationTolerance {
+    u32 max_ulps;
+    f32 epsilon;
+};
+
+struct ActivationDiff {
+    bool equal;
+
+    // First mismatch in tick order, then neuron index. Only set when !equal.
+    usize tick;
+    usize neuron;
+    f32 expected;
+    f32 actual;
+
+    usize mismatches; // over the whole compared length
+    usize ticks_compared;
+    f32 max_error;
+    u32 max_ulps;
+};
+
+// Representable floats between a and b, +0 and -0 are one apart. NaN is as far from everything as possible.
+u32 f32_ulp_distance(f32 a, f32 b);
+bool activation_trace_match(f32 expected, f32 actual, const ActivationTolerance &tolerance);
+
+// Compares the ticks both traces have. Traces of different neuron counts never match.
+ActivationDiff activation_trace_diff(const ActivationTrace &expected, const ActivationTrace &actual,
+                                     const ActivationTolerance &tolerance);
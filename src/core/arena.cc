@@ -0,0 +1,185 @@
+#include "core/arena.h"
+
+#include "core/logger.h"
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#define ARENA_COMMIT_GRANULE (1ull << 20)
+#else
+#include <sys/mman.h>
+#endif
+
+HeapCounters global_heap_counters;
+
+void arena_init(Arena &arena, usize capacity, bool huge_pages) {
+    memset(&arena, 0, sizeof(arena));
+    capacity = (capacity + ARENA_HUGE_PAGE_SIZE - 1) & ~(ARENA_HUGE_PAGE_SIZE - 1);
+
+#ifdef _WIN32
+    arena.base = (u8 *)VirtualAlloc(nullptr, capacity, MEM_RESERVE, PAGE_NOACCESS);
+    huge_pages = false;
+#else
+    // Reserve only, pages are committed by the kernel on first touch
+    void *base = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    arena.base = base == MAP_FAILED ? nullptr : (u8 *)base;
+#ifdef MADV_HUGEPAGE
+    if (arena.base && huge_pages && madvise(arena.base, capacity, MADV_HUGEPAGE) != 0) {
+        warn("madvise(MADV_HUGEPAGE) failed, arena uses normal pages");
+        huge_pages = false;
+    }
+#else
+    huge_pages = false;
+#endif
+#endif
+
+    if (!arena.base) {
+        error("Failed to reserve %zu MB for an arena", capacity >> 20);
+        return;
+    }
+    arena.capacity = capacity;
+    arena.huge_pages = huge_pages;
+}
+
+void arena_deinit(Arena &arena) {
+    if (arena.base) {
+#ifdef _WIN32
+        VirtualFree(arena.base, 0, MEM_RELEASE);
+#else
+        munmap(arena.base, arena.capacity);
+#endif
+    }
+    memset(&arena, 0, sizeof(arena));
+}
+
+void *arena_alloc(Arena &arena, usize size, usize alignment) {
+    usize begin = (arena.used + alignment - 1) & ~(alignment - 1);
+    if (!arena.base || begin + size > arena.capacity) {
+        arena.failures++;
+        error("Arena of %zu MB exhausted, %zu bytes requested", arena.capacity >> 20, size);
+        return nullptr;
+    }
+
+#ifdef _WIN32
+    if (begin + size > arena.committed) {
+        usize commit = (begin + size + ARENA_COMMIT_GRANULE - 1) & ~(ARENA_COMMIT_GRANULE - 1);
+        if (commit > arena.capacity) commit = arena.capacity;
+        if (!VirtualAlloc(arena.base + arena.committed, commit - arena.committed, MEM_COMMIT, PAGE_READWRITE)) {
+            arena.failures++;
+            error("Failed to commit %zu bytes of arena memory", commit - arena.committed);
+            return nullptr;
+        }
+        arena.committed = commit;
+    }
+#endif
+
+    arena.used = begin + size;
+    if (arena.used > arena.peak) arena.peak = arena.used;
+    arena.allocations++;
+    arena.allocated_bytes += size;
+    return arena.base + begin;
+}
+
+void *arena_alloc_zero(Arena &arena, usize size, usize alignment) {
+    void *memory = arena_alloc(arena, size, alignment);
+    if (memory) memset(memory, 0, size);
+    return memory;
+}
+
+void arena_reset(Arena &arena) {
+    arena.used = 0;
+    arena.resets++;
+}
+
+Arena &arena_scratch() {
+    struct Scratch {
+        Arena arena;
+        Scratch() {
+            arena_init(arena, ARENA_SCRATCH_CAPACITY, true);
+        }
+        ~Scratch() {
+            arena_deinit(arena);
+        }
+    };
+    thread_local Scratch scratch;
+    return scratch.arena;
+}
+
+void frame_arena_init(FrameArena &frames, usize capacity) {
+    arena_init(frames.arenas[0], capacity);
+    arena_init(frames.arenas[1], capacity);
+    frames.frame = 0;
+}
+
+void frame_arena_deinit(FrameArena &frames) {
+    arena_deinit(frames.arenas[0]);
+    arena_deinit(frames.arenas[1]);
+}
+
+void frame_arena_begin(FrameArena &frames) {
+    frames.frame++;
+    arena_reset(frame_arena(frames));
+}
+
+#if defined(ALLOC_COUNTERS) && defined(__GLIBC__)
+// Interposes the allocator entry points of the executable over glibc's, forwarding to the real implementations
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *pointer);
+
+static inline void heap_count_allocation(size_t size) {
+    global_heap_counters.allocations.fetch_add(1, std::memory_order_relaxed);
+    global_heap_counters.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void *malloc(size_t size) {
+    heap_count_allocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    heap_count_allocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    heap_count_allocation(size);
+    if (pointer) global_heap_counters.frees.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+
+void *memalign(size_t alignment, size_t size) {
+    heap_count_allocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    heap_count_allocation(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+    heap_count_allocation(size);
+    *out = __libc_memalign(alignment, size);
+    return *out ? 0 : ENOMEM;
+}
+
+void free(void *pointer) {
+    if (pointer) global_heap_counters.frees.fetch_add(1, std::memory_order_relaxed);
+    __libc_free(pointer);
+}
+}
+
+bool heap_counters_enabled() {
+    return true;
+}
+#else
+bool heap_counters_enabled() {
+    return false;
+}
+#endif
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <atomic>
+
+#define ARENA_ALIGNMENT 64                   // cache line, covers every SIMD load in core/simd.h
+#define ARENA_SCRATCH_CAPACITY (4ull << 30)  // address space reserved per thread, pages are committed when touched
+#define ARENA_FRAME_CAPACITY (256ull << 20)  // per frame arena
+#define ARENA_HUGE_PAGE_SIZE (2ull << 20)
+
+// Linear allocator over one reserved range of address space. Allocation bumps an offset, memory is only given back
+// all at once by arena_reset or down to an earlier arena_mark. Nothing is freed individually and nothing touches the
+// heap after arena_init, so transient buffers cost a pointer bump and steady-state frames do not allocate.
+//
+// With huge_pages the range is advised MADV_HUGEPAGE, which cuts TLB misses on large scratch arrays (Linux only).
+struct Arena {
+    u8 *base;
+    usize capacity; // reserved bytes
+    usize committed; // bytes backed by memory, on platforms that need explicit commits
+    usize used;
+    bool huge_pages;
+
+    // Counters, kept across resets
+    usize peak;
+    usize allocations;
+    usize allocated_bytes;
+    usize resets;
+    usize failures; // requests that did not fit, they return null
+};
+
+void arena_init(Arena &arena, usize capacity, bool huge_pages = false);
+void arena_deinit(Arena &arena);
+
+// Null when the reservation is exhausted. alignment must be a power of two.
+void *arena_alloc(Arena &arena, usize size, usize alignment = ARENA_ALIGNMENT);
+void *arena_alloc_zero(Arena &arena, usize size, usize alignment = ARENA_ALIGNMENT);
+
+template <typename T> static inline T *arena_push(Arena &arena, usize count, usize alignment = ARENA_ALIGNMENT) {
+    return (T *)arena_alloc(arena, count * sizeof(T), alignment);
+}
+
+template <typename T> static inline T *arena_push_zero(Arena &arena, usize count, usize alignment = ARENA_ALIGNMENT) {
+    return (T *)arena_alloc_zero(arena, count * sizeof(T), alignment);
+}
+
+void arena_reset(Arena &arena);
+
+// Scoped use of a shared arena: take a mark, allocate, restore the mark when done
+static inline usize arena_mark(const Arena &arena) {
+    return arena.used;
+}
+
+static inline void arena_restore(Arena &arena, usize mark) {
+    arena.used = mark;
+}
+
+// Per-thread scratch arena with huge pages, reserved on first use. Functions that need temporary buffers take a mark
+// and restore it before returning, so nested callers share the same arena safely. parallel_for workers are fresh
+// threads, each would reserve and unmap its own arena per call, so callers carve per-chunk buffers from theirs.
+Arena &arena_scratch();
+
+// Two arenas used on alternate frames: memory from frame_arena_alloc stays valid until the end of the next frame,
+// which covers data handed to the GPU through the streaming buffer a frame late.
+struct FrameArena {
+    Arena arenas[2];
+    usize frame;
+};
+
+void frame_arena_init(FrameArena &frames, usize capacity);
+void frame_arena_deinit(FrameArena &frames);
+// Call once at the start of every frame or tick, resets the arena last used two frames ago
+void frame_arena_begin(FrameArena &frames);
+
+static inline Arena &frame_arena(FrameArena &frames) {
+    return frames.arenas[frames.frame & 1];
+}
+
+// Process-wide heap counters. With ALLOC_COUNTERS on glibc every malloc, calloc, realloc and free in the process
+// (including operator new and third party code) is counted, otherwise heap_counters_enabled is false and the
+// counters stay at zero.
+struct HeapCounters {
+    std::atomic<usize> allocations;
+    std::atomic<usize> frees;
+    std::atomic<usize> bytes;
+};
+
+extern HeapCounters global_heap_counters;
+
+bool heap_counters_enabled();
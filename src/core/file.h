@@ -5,10 +5,15 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
 
 static inline void file_close(FILE *file);
 
-static FILE *file_open(const char *path, const char *modes) {
+static inline FILE *file_open(const char *path, const char *modes) {
     FILE *file;
 #ifdef _WIN32
     errno_t err = fopen_s(&file, path, modes);
@@ -28,10 +33,10 @@ static inline void file_close(FILE *file) {
 
 // Reads contents of a file into a string
 // This allocates and must be cleaned up
-static const char *read_file_to_string(const char *path) {
+static inline const char *read_file_to_string(const char *path) {
     char *contents = nullptr;
 #define finish()                                                                                                       \
-    file_close(file);                                                                                                  \
+    if (file) file_close(file);                                                                                        \
     return contents;
 
     FILE *file = file_open(path, "rb");
@@ -58,6 +63,55 @@ static const char *read_file_to_string(const char *path) {
     return contents;
 }
 
+// Reads a whole file, *len receives its size. Returns null if it cannot be read.
+// This allocates and must be cleaned up
+static inline u8 *read_file_to_bytes(const char *path, usize *len) {
+    FILE *file = file_open(path, "rb");
+    if (!file) return nullptr;
+
+    fseek(file, 0, SEEK_END);
+    *len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    u8 *contents = static_cast<u8 *>(malloc(*len ? *len : 1));
+    if (contents && fread(contents, 1, *len, file) != *len) {
+        free(contents);
+        contents = nullptr;
+    }
+    file_close(file);
+    return contents;
+}
+
+static inline bool write_bytes_to_file(const char *path, const void *data, usize len) {
+    FILE *file = file_open(path, "wb");
+    if (!file) return false;
+
+    bool written = fwrite(data, 1, len, file) == len;
+    file_close(file);
+    return written;
+}
+
 // Assumes data is null terminated
-static void write_string_to_file(const char *path, const char *data) {
+static inline void write_string_to_file(const char *path, const char *data) {
+    usize len = 0;
+    while (data[len]) len++;
+    if (!write_bytes_to_file(path, data, len)) info("Failed to write file: %s", path);
+}
+
+// Modification time in seconds, 0 if the file does not exist
+static inline i64 file_mtime(const char *path) {
+    struct stat status;
+    if (stat(path, &status) != 0) return 0;
+    return (i64)status.st_mtime;
+}
+
+// Creates a single directory level, succeeds if it already exists
+static inline bool make_directory(const char *path) {
+#ifdef _WIN32
+    int result = _mkdir(path);
+#else
+    int result = mkdir(path, 0755);
+#endif
+    struct stat status;
+    return result == 0 || (stat(path, &status) == 0 && (status.st_mode & S_IFDIR));
 }
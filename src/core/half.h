@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <cstring>
+
+// IEEE 754 binary16 conversions for packing buffers on the host. Kernels decode with F16C or unpackHalf2x16.
+
+static inline u16 f16_from_f32(f32 value) {
+    u32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    u32 sign = (bits >> 16) & 0x8000u;
+    u32 exponent = (bits >> 23) & 0xffu;
+    u32 mantissa = bits & 0x7fffffu;
+
+    if (exponent == 0xffu) return (u16)(sign | 0x7c00u | (mantissa ? 0x200u : 0u)); // inf, nan
+
+    i32 half_exponent = (i32)exponent - 127 + 15;
+    if (half_exponent >= 0x1f) return (u16)(sign | 0x7c00u); // overflow to inf
+
+    if (half_exponent <= 0) {
+        // Subnormal or zero
+        if (half_exponent < -10) return (u16)sign;
+        mantissa |= 0x800000u;
+        u32 shift = (u32)(14 - half_exponent);
+        u32 half_mantissa = mantissa >> shift;
+        u32 remainder = mantissa & ((1u << shift) - 1);
+        u32 halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half_mantissa & 1u))) half_mantissa++;
+        return (u16)(sign | half_mantissa);
+    }
+
+    // Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+    u32 half = sign | ((u32)half_exponent << 10) | (mantissa >> 13);
+    u32 remainder = mantissa & 0x1fffu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) half++;
+    return (u16)half;
+}
+
+static inline f32 f32_from_f16(u16 half) {
+    u32 sign = ((u32)half & 0x8000u) << 16;
+    u32 exponent = ((u32)half >> 10) & 0x1fu;
+    u32 mantissa = (u32)half & 0x3ffu;
+
+    u32 bits;
+    if (exponent == 0x1fu) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Renormalise a subnormal
+        exponent = 127 - 15 + 1;
+        while ((mantissa & 0x400u) == 0) {
+            mantissa <<= 1;
+            exponent--;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+
+    f32 value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
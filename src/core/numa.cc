@@ -0,0 +1,115 @@
+#include "core/numa.h"
+
+#include "core/file.h"
+#include "core/logger.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Parses a sysfs CPU list such as "0-3,8-11" into cpus, returns how many were written
+static u32 numa_parse_cpu_list(const char *list, u16 *cpus, u32 capacity) {
+    u32 count = 0;
+    const char *p = list;
+    while (*p && count < capacity) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p) break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && count < capacity; cpu++) {
+            cpus[count++] = (u16)cpu;
+        }
+        while (*p == ',' || *p == '\n' || *p == ' ') p++;
+    }
+    return count;
+}
+
+void numa_detect(NumaTopology &topology) {
+    memset(&topology, 0, sizeof(topology));
+
+#ifdef __linux__
+    // Only CPUs this process may run on, cgroups and taskset can hide part of a node
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+
+    for (u32 node = 0; node < NUMA_MAX_NODES; node++) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+        const char *list = read_file_to_string(path);
+        if (!list) break;
+
+        u16 *cpus = topology.cpus[topology.node_count];
+        u32 listed = numa_parse_cpu_list(list, cpus, NUMA_MAX_CPUS);
+        free((void *)list);
+
+        u32 count = 0;
+        for (u32 i = 0; i < listed; i++) {
+            if (CPU_ISSET(cpus[i], &allowed)) cpus[count++] = cpus[i];
+        }
+        // Memory-only nodes (CXL, HBM without cores) have no CPUs to run on
+        if (count > 0) topology.cpu_count[topology.node_count++] = count;
+    }
+#endif
+
+    if (topology.node_count > 0) {
+        topology.pinning = true;
+        info("NUMA: %u nodes, %u CPUs", topology.node_count, numa_thread_count(topology));
+        return;
+    }
+
+    u32 count = (u32)parallel_thread_count();
+    topology.node_count = 1;
+    topology.cpu_count[0] = count;
+    for (u32 cpu = 0; cpu < count; cpu++) {
+        topology.cpus[0][cpu] = (u16)cpu;
+    }
+    topology.pinning = false;
+}
+
+NumaTopology numa_subset(const NumaTopology &topology, u32 node_count) {
+    NumaTopology subset = topology;
+    if (node_count < subset.node_count) subset.node_count = node_count;
+    return subset;
+}
+
+u32 numa_thread_count(const NumaTopology &topology) {
+    u32 count = 0;
+    for (u32 node = 0; node < topology.node_count; node++) {
+        count += topology.cpu_count[node];
+    }
+    return count;
+}
+
+bool numa_pin_thread(u32 cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+void numa_partition(const NumaTopology &topology, usize count, usize grain, usize *bounds) {
+    u32 cpus = numa_thread_count(topology);
+    if (grain == 0) grain = 1;
+
+    bounds[0] = 0;
+    usize assigned = 0;
+    for (u32 node = 0; node < topology.node_count; node++) {
+        assigned += topology.cpu_count[node];
+        usize end = node + 1 == topology.node_count ? count : (count * assigned / cpus + grain - 1) / grain * grain;
+        bounds[node + 1] = end < count ? end : count;
+    }
+}
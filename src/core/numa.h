@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core/parallel.h"
+#include "core/types.h"
+
+#include <thread>
+
+#define NUMA_MAX_NODES 8
+#define NUMA_MAX_CPUS 256
+
+// CPUs grouped by memory node, read from /sys/devices/system/node on Linux. Without that tree (other platforms,
+// containers that hide it) everything is one node holding every CPU, and pinning is skipped.
+struct NumaTopology {
+    u32 node_count;
+    u32 cpu_count[NUMA_MAX_NODES];
+    u16 cpus[NUMA_MAX_NODES][NUMA_MAX_CPUS];
+    bool pinning; // false when the CPU list is a guess and threads should float
+};
+
+void numa_detect(NumaTopology &topology);
+// First node_count nodes of topology, for measuring how a kernel scales with sockets
+NumaTopology numa_subset(const NumaTopology &topology, u32 node_count);
+u32 numa_thread_count(const NumaTopology &topology);
+
+// Restricts the calling thread to one CPU with pthread_setaffinity_np. False where affinity is unsupported.
+bool numa_pin_thread(u32 cpu);
+
+// Splits [0, count) into one contiguous range per node, sized by the node's share of CPUs and rounded to grain.
+// bounds receives node_count + 1 entries.
+void numa_partition(const NumaTopology &topology, usize count, usize grain, usize *bounds);
+
+// parallel_for over a partition: node n's range is split across threads pinned to node n's CPUs, so a row is
+// always processed, and its pages first touched, on the same node. fn(node, chunk_begin, chunk_end). Blocks until
+// done, the calling thread only waits.
+template <typename Fn> void numa_parallel_for(const NumaTopology &topology, const usize *bounds, usize grain, Fn fn) {
+    std::thread threads[NUMA_MAX_NODES * PARALLEL_MAX_THREADS];
+    usize thread_count = 0;
+    if (grain == 0) grain = 1;
+
+    for (u32 node = 0; node < topology.node_count; node++) {
+        usize begin = bounds[node], end = bounds[node + 1];
+        if (end <= begin) continue;
+
+        usize count = end - begin;
+        usize chunks = topology.cpu_count[node];
+        if (chunks > PARALLEL_MAX_THREADS) chunks = PARALLEL_MAX_THREADS;
+        if ((count + grain - 1) / grain < chunks) chunks = (count + grain - 1) / grain;
+        if (chunks == 0) chunks = 1;
+
+        usize chunk_size = ((count + chunks - 1) / chunks + grain - 1) / grain * grain;
+        for (usize c = 0; c < chunks; c++) {
+            usize chunk_begin = begin + c * chunk_size;
+            if (chunk_begin >= end) break;
+            usize chunk_end = chunk_begin + chunk_size < end ? chunk_begin + chunk_size : end;
+            u32 cpu = topology.cpus[node][c % topology.cpu_count[node]];
+            bool pin = topology.pinning;
+            threads[thread_count++] = std::thread([=, &fn] {
+                if (pin) numa_pin_thread(cpu);
+                fn(node, chunk_begin, chunk_end);
+            });
+        }
+    }
+
+    for (usize t = 0; t < thread_count; t++) {
+        threads[t].join();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <cassert>
+#include <thread>
+
+#define PARALLEL_MAX_THREADS 64
+
+static inline usize parallel_thread_count() {
+    usize count = std::thread::hardware_concurrency();
+    if (count == 0) count = 1;
+    return count < PARALLEL_MAX_THREADS ? count : PARALLEL_MAX_THREADS;
+}
+
+// Splits [begin, end) into one contiguous chunk per hardware thread and calls fn(chunk_begin, chunk_end) for each.
+// Chunk sizes are a multiple of grain, so small ranges run inline on the calling thread and kernels that step in
+// SIMD blocks never share a block between threads. Blocks until done.
+template <typename Fn> void parallel_for(usize begin, usize end, usize grain, Fn fn) {
+    if (end <= begin) return;
+
+    usize count = end - begin;
+    usize chunks = parallel_thread_count();
+    if (grain == 0) grain = 1;
+    if (count / grain < chunks) chunks = count / grain;
+    if (chunks <= 1) {
+        fn(begin, end);
+        return;
+    }
+
+    // Every chunk starts a whole number of grains past begin, callers that own blocks of grain elements rely on it
+    std::thread threads[PARALLEL_MAX_THREADS];
+    usize chunk_size = ((count + chunks - 1) / chunks + grain - 1) / grain * grain;
+    assert(chunk_size % grain == 0);
+    for (usize i = 1; i < chunks; i++) {
+        usize chunk_begin = begin + i * chunk_size;
+        usize chunk_end = chunk_begin + chunk_size < end ? chunk_begin + chunk_size : end;
+        if (chunk_begin >= end) break;
+        threads[i] = std::thread(fn, chunk_begin, chunk_end);
+    }
+
+    fn(begin, begin + chunk_size < end ? begin + chunk_size : end);
+
+    for (usize i = 1; i < chunks; i++) {
+        if (threads[i].joinable()) threads[i].join();
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/types.h"
+
+// splitmix64 finaliser. Also used to derive independent streams from (seed, index) pairs so that
+// parallel generators produce the same output regardless of how work is split between threads.
+static inline u64 hash_u64(u64 x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// FNV-1a over a byte range, chain calls through seed to hash several ranges as one
+static inline u64 hash_bytes(const void *data, usize len, u64 seed = 0xcbf29ce484222325ull) {
+    const u8 *bytes = (const u8 *)data;
+    u64 h = seed;
+    for (usize i = 0; i < len; i++) {
+        h = (h ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return h;
+}
+
+struct Rng {
+    u64 state;
+};
+
+static inline Rng rng_create(u64 seed, u64 stream = 0) {
+    return {hash_u64(seed ^ hash_u64(stream))};
+}
+
+static inline u64 rng_next(Rng &rng) {
+    rng.state += 0x9e3779b97f4a7c15ull;
+    return hash_u64(rng.state);
+}
+
+// Uniform integer in [0, n)
+static inline u32 rng_range(Rng &rng, u32 n) {
+    return (u32)(((rng_next(rng) >> 32) * (u64)n) >> 32);
+}
+
+// Uniform float in [0, 1)
+static inline f32 rng_f32(Rng &rng) {
+    return (f32)(rng_next(rng) >> 40) * (1.0f / 16777216.0f);
+}
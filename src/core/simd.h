@@ -0,0 +1,361 @@
+#pragma once
+
+#include "core/half.h"
+#include "core/types.h"
+
+// Minimal 8-lane float vector used by the CPU kernels. Maps to AVX2/FMA/F16C when the compiler targets it and to
+// plain arrays otherwise, which compilers still vectorise to whatever the target offers.
+
+#define SIMD_WIDTH 8
+
+#if defined(__AVX2__) && defined(__FMA__) && defined(__F16C__)
+#include <immintrin.h>
+
+#define SIMD_AVX2 1
+
+struct f32x8 {
+    __m256 v;
+};
+
+struct i32x8 {
+    __m256i v;
+};
+
+// All-ones lanes are true
+struct mask8 {
+    __m256 v;
+};
+
+static inline f32x8 f32x8_load(const f32 *p) {
+    return {_mm256_loadu_ps(p)};
+}
+
+static inline void f32x8_store(f32 *p, f32x8 a) {
+    _mm256_storeu_ps(p, a.v);
+}
+
+static inline f32x8 f32x8_set1(f32 x) {
+    return {_mm256_set1_ps(x)};
+}
+
+static inline f32x8 f32x8_add(f32x8 a, f32x8 b) {
+    return {_mm256_add_ps(a.v, b.v)};
+}
+
+static inline f32x8 f32x8_sub(f32x8 a, f32x8 b) {
+    return {_mm256_sub_ps(a.v, b.v)};
+}
+
+static inline f32x8 f32x8_mul(f32x8 a, f32x8 b) {
+    return {_mm256_mul_ps(a.v, b.v)};
+}
+
+// a * b rounded to f32, passed through a volatile so the compiler cannot contract it into a later add
+static inline f32x8 f32x8_mul_rounded(f32x8 a, f32x8 b) {
+    volatile __m256 product = _mm256_mul_ps(a.v, b.v);
+    return {product};
+}
+
+// a * b + c
+static inline f32x8 f32x8_fmadd(f32x8 a, f32x8 b, f32x8 c) {
+    return {_mm256_fmadd_ps(a.v, b.v, c.v)};
+}
+
+static inline f32x8 f32x8_min(f32x8 a, f32x8 b) {
+    return {_mm256_min_ps(a.v, b.v)};
+}
+
+static inline f32x8 f32x8_max(f32x8 a, f32x8 b) {
+    return {_mm256_max_ps(a.v, b.v)};
+}
+
+static inline mask8 f32x8_gt(f32x8 a, f32x8 b) {
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)};
+}
+
+static inline mask8 f32x8_ge(f32x8 a, f32x8 b) {
+    return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)};
+}
+
+static inline mask8 mask8_and(mask8 a, mask8 b) {
+    return {_mm256_and_ps(a.v, b.v)};
+}
+
+static inline mask8 mask8_or(mask8 a, mask8 b) {
+    return {_mm256_or_ps(a.v, b.v)};
+}
+
+static inline mask8 mask8_not(mask8 a) {
+    return {_mm256_xor_ps(a.v, _mm256_castsi256_ps(_mm256_set1_epi32(-1)))};
+}
+
+static inline bool mask8_any(mask8 m) {
+    return _mm256_movemask_ps(m.v) != 0;
+}
+
+// Lanes where m is true take a, the rest take b
+static inline f32x8 f32x8_select(mask8 m, f32x8 a, f32x8 b) {
+    return {_mm256_blendv_ps(b.v, a.v, m.v)};
+}
+
+static inline f32 f32x8_reduce_add(f32x8 a) {
+    __m128 lo = _mm256_castps256_ps128(a.v);
+    __m128 hi = _mm256_extractf128_ps(a.v, 1);
+    lo = _mm_add_ps(lo, hi);
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+    return _mm_cvtss_f32(lo);
+}
+
+static inline i32x8 i32x8_load(const i32 *p) {
+    return {_mm256_loadu_si256((const __m256i *)p)};
+}
+
+static inline mask8 i32x8_ge_zero(i32x8 a) {
+    return {_mm256_castsi256_ps(_mm256_cmpgt_epi32(a.v, _mm256_set1_epi32(-1)))};
+}
+
+// Lanes where m is false read nothing and return 0, so -1 padding indices are never dereferenced
+static inline f32x8 f32x8_gather(const f32 *base, i32x8 index, mask8 m) {
+    return {_mm256_mask_i32gather_ps(_mm256_setzero_ps(), base, index.v, m.v, 4)};
+}
+
+static inline f32x8 f32x8_gather_all(const f32 *base, i32x8 index) {
+    return {_mm256_i32gather_ps(base, index.v, 4)};
+}
+
+// Bit index[l] of a packed bitset, 32 bits per word with bit 0 lowest. Lanes where m is false read nothing and are
+// false.
+static inline mask8 bits8_gather(const u32 *words, i32x8 index, mask8 m) {
+    __m256i word = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int *)words,
+                                               _mm256_srli_epi32(index.v, 5), _mm256_castps_si256(m.v), 4);
+    __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(word, _mm256_and_si256(index.v, _mm256_set1_epi32(31))),
+                                   _mm256_set1_epi32(1));
+    return {_mm256_castsi256_ps(_mm256_cmpeq_epi32(bit, _mm256_set1_epi32(1)))};
+}
+
+// Lane l of m as bit l
+static inline u32 mask8_bits(mask8 m) {
+    return (u32)_mm256_movemask_ps(m.v);
+}
+
+// Zero-extends 8 u16 indices
+static inline i32x8 i32x8_load_u16(const u16 *p) {
+    return {_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p))};
+}
+
+// Lanes whose u8 is 0
+static inline mask8 u8x8_eq_zero(const u8 *p) {
+    __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p));
+    return {_mm256_castsi256_ps(_mm256_cmpeq_epi32(bytes, _mm256_setzero_si256()))};
+}
+
+// Sign-extends 8 i8 values and converts them to float
+static inline f32x8 f32x8_load_i8(const i8 *p) {
+    return {_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)p)))};
+}
+
+static inline f32x8 f32x8_load_f16(const u16 *p) {
+    return {_mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)p))};
+}
+
+static inline void f32x8_store_f16(u16 *p, f32x8 a) {
+    _mm_storeu_si128((__m128i *)p, _mm256_cvtps_ph(a.v, _MM_FROUND_TO_NEAREST_INT));
+}
+
+// Gathers 8 halves. Each lane loads 32 bits starting at its element, so the array needs one spare u16 at the end.
+static inline f32x8 f32x8_gather_f16(const u16 *base, i32x8 index) {
+    __m256i words = _mm256_i32gather_epi32((const int *)base, index.v, 2);
+    words = _mm256_and_si256(words, _mm256_set1_epi32(0xffff));
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(words, words), 0x08);
+    return {_mm256_cvtph_ps(_mm256_castsi256_si128(packed))};
+}
+
+#else
+
+struct f32x8 {
+    f32 v[8];
+};
+
+struct i32x8 {
+    i32 v[8];
+};
+
+struct mask8 {
+    bool v[8];
+};
+
+#define SIMD_LANES(expr)                                                                                               \
+    for (int l = 0; l < 8; l++) {                                                                                      \
+        expr;                                                                                                          \
+    }
+
+static inline f32x8 f32x8_load(const f32 *p) {
+    f32x8 r;
+    SIMD_LANES(r.v[l] = p[l]);
+    return r;
+}
+
+static inline void f32x8_store(f32 *p, f32x8 a) {
+    SIMD_LANES(p[l] = a.v[l]);
+}
+
+static inline f32x8 f32x8_set1(f32 x) {
+    f32x8 r;
+    SIMD_LANES(r.v[l] = x);
+    return r;
+}
+
+static inline f32x8 f32x8_add(f32x8 a, f32x8 b) {
+    SIMD_LANES(a.v[l] += b.v[l]);
+    return a;
+}
+
+static inline f32x8 f32x8_sub(f32x8 a, f32x8 b) {
+    SIMD_LANES(a.v[l] -= b.v[l]);
+    return a;
+}
+
+static inline f32x8 f32x8_mul(f32x8 a, f32x8 b) {
+    SIMD_LANES(a.v[l] *= b.v[l]);
+    return a;
+}
+
+static inline f32x8 f32x8_mul_rounded(f32x8 a, f32x8 b) {
+    SIMD_LANES(volatile f32 product = a.v[l] * b.v[l]; a.v[l] = product);
+    return a;
+}
+
+static inline f32x8 f32x8_fmadd(f32x8 a, f32x8 b, f32x8 c) {
+    SIMD_LANES(a.v[l] = a.v[l] * b.v[l] + c.v[l]);
+    return a;
+}
+
+static inline f32x8 f32x8_min(f32x8 a, f32x8 b) {
+    SIMD_LANES(a.v[l] = b.v[l] < a.v[l] ? b.v[l] : a.v[l]);
+    return a;
+}
+
+static inline f32x8 f32x8_max(f32x8 a, f32x8 b) {
+    SIMD_LANES(a.v[l] = b.v[l] > a.v[l] ? b.v[l] : a.v[l]);
+    return a;
+}
+
+static inline mask8 f32x8_gt(f32x8 a, f32x8 b) {
+    mask8 r;
+    SIMD_LANES(r.v[l] = a.v[l] > b.v[l]);
+    return r;
+}
+
+static inline mask8 f32x8_ge(f32x8 a, f32x8 b) {
+    mask8 r;
+    SIMD_LANES(r.v[l] = a.v[l] >= b.v[l]);
+    return r;
+}
+
+static inline mask8 mask8_and(mask8 a, mask8 b) {
+    SIMD_LANES(a.v[l] = a.v[l] && b.v[l]);
+    return a;
+}
+
+static inline mask8 mask8_or(mask8 a, mask8 b) {
+    SIMD_LANES(a.v[l] = a.v[l] || b.v[l]);
+    return a;
+}
+
+static inline mask8 mask8_not(mask8 a) {
+    SIMD_LANES(a.v[l] = !a.v[l]);
+    return a;
+}
+
+static inline bool mask8_any(mask8 m) {
+    bool any = false;
+    SIMD_LANES(any = any || m.v[l]);
+    return any;
+}
+
+static inline f32x8 f32x8_select(mask8 m, f32x8 a, f32x8 b) {
+    SIMD_LANES(a.v[l] = m.v[l] ? a.v[l] : b.v[l]);
+    return a;
+}
+
+static inline f32 f32x8_reduce_add(f32x8 a) {
+    // Same pairing as the AVX2 path so both builds round identically
+    f32 s0 = (a.v[0] + a.v[4]) + (a.v[2] + a.v[6]);
+    f32 s1 = (a.v[1] + a.v[5]) + (a.v[3] + a.v[7]);
+    return s0 + s1;
+}
+
+static inline i32x8 i32x8_load(const i32 *p) {
+    i32x8 r;
+    SIMD_LANES(r.v[l] = p[l]);
+    return r;
+}
+
+static inline mask8 i32x8_ge_zero(i32x8 a) {
+    mask8 r;
+    SIMD_LANES(r.v[l] = a.v[l] >= 0);
+    return r;
+}
+
+static inline f32x8 f32x8_gather(const f32 *base, i32x8 index, mask8 m) {
+    f32x8 r;
+    SIMD_LANES(r.v[l] = m.v[l] ? base[index.v[l]] : 0.0f);
+    return r;
+}
+
+static inline f32x8 f32x8_gather_all(const f32 *base, i32x8 index) {
+    f32x8 r;
+    SIMD_LANES(r.v[l] = base[index.v[l]]);
+    return r;
+}
+
+static inline mask8 bits8_gather(const u32 *words, i32x8 index, mask8 m) {
+    mask8 r;
+    SIMD_LANES(r.v[l] = m.v[l] && (words[index.v[l] >> 5] >> (index.v[l] & 31) & 1));
+    return r;
+}
+
+static inline u32 mask8_bits(mask8 m) {
+    u32 bits = 0;
+    SIMD_LANES(bits |= (u32)m.v[l] << l);
+    return bits;
+}
+
+static inline i32x8 i32x8_load_u16(const u16 *p) {
+    i32x8 r;
+    SIMD_LANES(r.v[l] = p[l]);
+    return r;
+}
+
+static inline mask8 u8x8_eq_zero(const u8 *p) {
+    mask8 r;
+    SIMD_LANES(r.v[l] = p[l] == 0);
+    return r;
+}
+
+static inline f32x8 f32x8_load_i8(const i8 *p) {
+    f32x8 r;
+    SIMD_LANES(r.v[l] = (f32)p[l]);
+    return r;
+}
+
+static inline f32x8 f32x8_load_f16(const u16 *p) {
+    f32x8 r;
+    SIMD_LANES(r.v[l] = f32_from_f16(p[l]));
+    return r;
+}
+
+static inline void f32x8_store_f16(u16 *p, f32x8 a) {
+    SIMD_LANES(p[l] = f16_from_f32(a.v[l]));
+}
+
+static inline f32x8 f32x8_gather_f16(const u16 *base, i32x8 index) {
+    f32x8 r;
+    SIMD_LANES(r.v[l] = f32_from_f16(base[index.v[l]]));
+    return r;
+}
+
+#undef SIMD_LANES
+
+#endif
@@ -0,0 +1,58 @@
+#include "core/task_graph.h"
+
+#include "core/logger.h"
+#include "core/trace.h"
+
+void task_graph_init(TaskGraph &graph) {
+    graph.count = 0;
+}
+
+u32 task_graph_add(TaskGraph &graph, const char *name, std::function<void()> fn,
+                   std::initializer_list<u32> dependencies) {
+    assert(graph.count < TASK_GRAPH_CAPACITY && dependencies.size() <= TASK_MAX_DEPENDENCIES);
+
+    u32 id = (u32)graph.count++;
+    TaskGraph::Task &task = graph.tasks[id];
+    task.name = name;
+    task.fn = fn;
+    task.dependency_count = 0;
+    task.done = false;
+    for (u32 dependency : dependencies) {
+        assert(dependency < id);
+        task.dependencies[task.dependency_count++] = dependency;
+    }
+    return id;
+}
+
+static void task_graph_run(TaskGraph &graph, u32 id) {
+    TaskGraph::Task &task = graph.tasks[id];
+    for (usize i = 0; i < task.dependency_count; i++) {
+        task_graph_wait(graph, task.dependencies[i]);
+    }
+
+    usize event = trace_begin(global_trace, task.name);
+    task.fn();
+    trace_end(global_trace, event);
+
+    std::lock_guard<std::mutex> lock(graph.mutex);
+    task.done = true;
+    graph.finished.notify_all();
+}
+
+void task_graph_start(TaskGraph &graph) {
+    for (u32 i = 0; i < graph.count; i++) {
+        graph.tasks[i].thread = std::thread(task_graph_run, std::ref(graph), i);
+    }
+}
+
+void task_graph_wait(TaskGraph &graph, u32 task) {
+    std::unique_lock<std::mutex> lock(graph.mutex);
+    graph.finished.wait(lock, [&] { return graph.tasks[task].done; });
+}
+
+void task_graph_finish(TaskGraph &graph) {
+    for (usize i = 0; i < graph.count; i++) {
+        if (graph.tasks[i].thread.joinable()) graph.tasks[i].thread.join();
+    }
+    graph.count = 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <condition_variable>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+
+#define TASK_GRAPH_CAPACITY 16
+#define TASK_MAX_DEPENDENCIES 4
+
+// Background tasks with dependencies between them. Each task runs on its own thread once its dependencies are done,
+// while the calling thread carries on with work that has to stay on it (the GL context) and waits only for the
+// tasks it needs. Tasks are traced in global_trace under their name.
+struct TaskGraph {
+    struct Task {
+        const char *name;
+        std::function<void()> fn;
+        u32 dependencies[TASK_MAX_DEPENDENCIES];
+        usize dependency_count;
+        bool done;
+        std::thread thread;
+    };
+
+    Task tasks[TASK_GRAPH_CAPACITY];
+    usize count;
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+void task_graph_init(TaskGraph &graph);
+// Dependencies must be tasks added earlier, so the graph cannot have cycles
+u32 task_graph_add(TaskGraph &graph, const char *name, std::function<void()> fn,
+                   std::initializer_list<u32> dependencies = {});
+void task_graph_start(TaskGraph &graph);
+void task_graph_wait(TaskGraph &graph, u32 task);
+// Waits for every task and joins the threads
+void task_graph_finish(TaskGraph &graph);
@@ -0,0 +1,77 @@
+#include "core/trace.h"
+
+#include "core/file.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+Trace global_trace;
+
+static f64 trace_now_ms() {
+    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+    return std::chrono::duration<f64, std::milli>(now).count();
+}
+
+// Small stable thread numbers in order of first use, the main thread calls trace_init and gets 0
+static u32 trace_thread_id() {
+    static std::atomic<u32> next_thread(0);
+    thread_local u32 id = next_thread++;
+    return id;
+}
+
+void trace_init(Trace &trace) {
+    trace.count = 0;
+    trace.origin_ms = trace_now_ms();
+    trace_thread_id();
+}
+
+usize trace_begin(Trace &trace, const char *name) {
+    usize event = trace.count++;
+    if (event >= TRACE_CAPACITY) return TRACE_CAPACITY;
+
+    trace.events[event] = {name, trace_now_ms() - trace.origin_ms, -1.0, trace_thread_id()};
+    return event;
+}
+
+void trace_end(Trace &trace, usize event) {
+    if (event >= TRACE_CAPACITY) return;
+    trace.events[event].end_ms = trace_now_ms() - trace.origin_ms;
+}
+
+static usize trace_sorted(const Trace &trace, const TraceEvent **out) {
+    usize count = std::min((usize)trace.count, (usize)TRACE_CAPACITY);
+    for (usize i = 0; i < count; i++) {
+        out[i] = &trace.events[i];
+    }
+    std::sort(out, out + count, [](const TraceEvent *a, const TraceEvent *b) { return a->begin_ms < b->begin_ms; });
+    return count;
+}
+
+void trace_print(const Trace &trace) {
+    const TraceEvent *events[TRACE_CAPACITY];
+    usize count = trace_sorted(trace, events);
+    for (usize i = 0; i < count; i++) {
+        const TraceEvent &event = *events[i];
+        printf("  [%u] %8.2f .. %8.2f ms  %8.2f ms  %s\n", event.thread, event.begin_ms, event.end_ms,
+               event.end_ms - event.begin_ms, event.name);
+    }
+}
+
+bool trace_write_json(const Trace &trace, const char *path) {
+    FILE *file = file_open(path, "wb");
+    if (!file) return false;
+
+    const TraceEvent *events[TRACE_CAPACITY];
+    usize count = trace_sorted(trace, events);
+    fprintf(file, "[\n");
+    for (usize i = 0; i < count; i++) {
+        const TraceEvent &event = *events[i];
+        fprintf(file, "  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}%s\n",
+                event.name, event.thread, event.begin_ms * 1e3, (event.end_ms - event.begin_ms) * 1e3,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(file, "]\n");
+    file_close(file);
+    return true;
+}
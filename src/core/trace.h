@@ -0,0 +1,34 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <atomic>
+
+#define TRACE_CAPACITY 256
+
+// Named intervals recorded from any thread, for looking at where startup time goes. Events past the capacity are
+// dropped.
+struct TraceEvent {
+    const char *name;
+    f64 begin_ms;
+    f64 end_ms;
+    u32 thread;
+};
+
+struct Trace {
+    TraceEvent events[TRACE_CAPACITY];
+    std::atomic<usize> count;
+    f64 origin_ms;
+};
+
+extern Trace global_trace;
+
+void trace_init(Trace &trace);
+// Returns an event handle for trace_end, or TRACE_CAPACITY when full
+usize trace_begin(Trace &trace, const char *name);
+void trace_end(Trace &trace, usize event);
+
+// One line per event, ordered by start time, with the thread it ran on
+void trace_print(const Trace &trace);
+// Chrome trace format, open with chrome://tracing or Perfetto
+bool trace_write_json(const Trace &trace, const char *path);
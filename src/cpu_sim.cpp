@@ -0,0 +1,839 @@
+#include "cpu_sim.hpp"
+
+#include "core/parallel.h"
+#include "core/simd.h"
+
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define CPU_SIM_GRAIN 2048
+#define CPU_SIM_SELL_GRAIN 64 // chunks per thread task
+
+static_assert(MAX_SYNAPSES % SIMD_WIDTH == 0, "synapse rows must be a whole number of SIMD vectors");
+static_assert(CPU_SIM_GRAIN % SIMD_WIDTH == 0, "chunks must start on a SIMD boundary");
+static_assert(CPU_SIM_GRAIN % 64 == 0, "SpikeState::store needs every thread to own whole u64 spike words");
+
+// Each model updates SIMD_WIDTH neurons at a time from their summed input and returns which of them spiked. The
+// tick is instantiated per model, fan-in and precision, so the inner loop has no switch on any of them.
+struct ThresholdKernel {
+    const NeuronModelParams &params;
+
+    inline mask8 step(CpuSim &sim, usize i, f32x8 input) const {
+        return f32x8_gt(input, f32x8_load(&sim.threshold[i]));
+    }
+};
+
+// Multiply-adds of the model updates. Fused is the fast path. Rounded is KernelPrecisionStrict: every product is
+// rounded before its add, as the strict compute shader evaluates them, since GLSL's fma() need not be fused.
+struct FusedMath {
+    static inline f32x8 mul(f32x8 a, f32x8 b) {
+        return f32x8_mul(a, b);
+    }
+    static inline f32x8 mul_add(f32x8 a, f32x8 b, f32x8 c) {
+        return f32x8_fmadd(a, b, c);
+    }
+};
+
+struct RoundedMath {
+    static inline f32x8 mul(f32x8 a, f32x8 b) {
+        return f32x8_mul_rounded(a, b);
+    }
+    static inline f32x8 mul_add(f32x8 a, f32x8 b, f32x8 c) {
+        return f32x8_add(f32x8_mul_rounded(a, b), c);
+    }
+};
+
+template <typename Math> struct LifKernel {
+    const NeuronModelParams &params;
+
+    inline mask8 step(CpuSim &sim, usize i, f32x8 input) const {
+        f32x8 zero = f32x8_set1(0.0f);
+        f32x8 v_reset = f32x8_set1(params.v_reset);
+        f32x8 potential = f32x8_load(&sim.potential[i]);
+        f32x8 refractory = f32x8_load(&sim.refractory[i]);
+
+        // v += (v_rest - v) / tau + gain * input
+        f32x8 leak = Math::mul(f32x8_sub(f32x8_set1(params.v_rest), potential), f32x8_set1(1.0f / params.tau));
+        f32x8 v = Math::mul_add(f32x8_set1(params.input_gain), input, f32x8_add(potential, leak));
+
+        mask8 active = mask8_not(f32x8_gt(refractory, zero));
+        mask8 spike = mask8_and(active, f32x8_ge(v, f32x8_load(&sim.threshold[i])));
+
+        f32x8_store(&sim.potential[i], f32x8_select(mask8_and(active, mask8_not(spike)), v, v_reset));
+        f32x8 counted_down = f32x8_max(f32x8_sub(refractory, f32x8_set1(1.0f)), zero);
+        f32x8_store(&sim.refractory[i], f32x8_select(spike, f32x8_set1(params.refractory_ticks), counted_down));
+        return spike;
+    }
+};
+
+template <typename Math> struct IzhikevichKernel {
+    const NeuronModelParams &params;
+
+    inline f32x8 dv(f32x8 v, f32x8 u, f32x8 current) const {
+        // 0.04 v^2 + 5 v + 140 - u + I
+        f32x8 poly = Math::mul_add(Math::mul_add(f32x8_set1(0.04f), v, f32x8_set1(5.0f)), v, f32x8_set1(140.0f));
+        return f32x8_add(f32x8_sub(poly, u), current);
+    }
+
+    inline mask8 step(CpuSim &sim, usize i, f32x8 input) const {
+        f32x8 half = f32x8_set1(0.5f);
+        f32x8 v = f32x8_load(&sim.potential[i]);
+        f32x8 u = f32x8_load(&sim.recovery[i]);
+        f32x8 current = Math::mul(f32x8_set1(params.input_gain), input);
+
+        // Two half-millisecond steps for v, as in the reference implementation
+        v = Math::mul_add(half, dv(v, u, current), v);
+        v = Math::mul_add(half, dv(v, u, current), v);
+        u = Math::mul_add(f32x8_set1(params.a), f32x8_sub(Math::mul(f32x8_set1(params.b), v), u), u);
+
+        mask8 spike = f32x8_ge(v, f32x8_set1(30.0f));
+        f32x8_store(&sim.potential[i], f32x8_select(spike, f32x8_set1(params.c), v));
+        f32x8_store(&sim.recovery[i], f32x8_select(spike, f32x8_add(u, f32x8_set1(params.d)), u));
+        return spike;
+    }
+};
+
+// Where rows read presynaptic state from. Activations are gathered as floats, spike bits as 1 or 0 so the same
+// multiply-add only counts the weights of set bits.
+struct DecayState {
+    const f32 *current;
+    f32 *next;
+    f32x8 decay;
+
+    DecayState(CpuSim &sim, f32 decay_factor)
+        : current(sim.activation), next(sim.next_activation), decay(f32x8_set1(decay_factor)) {
+    }
+    inline f32 presynaptic(i32 target) const {
+        return current[target];
+    }
+    inline f32x8 gather(i32x8 index, mask8 valid) const {
+        return f32x8_gather(current, index, valid);
+    }
+    inline void store(const CpuSim & /* sim */, usize i, mask8 spike) const {
+        f32x8 decayed = f32x8_mul(f32x8_load(&current[i]), decay);
+        f32x8_store(&next[i], f32x8_select(spike, f32x8_set1(1.0f), decayed));
+    }
+    static void swap(CpuSim &sim) {
+        f32 *previous = sim.activation;
+        sim.activation = sim.next_activation;
+        sim.next_activation = previous;
+    }
+};
+
+// The u64 bitset is read as u32 words, which on little-endian targets is the same bit order and the layout the
+// compute shader sees. Stores assemble a word from 8 spike masks, threads own whole words since chunks start on
+// CPU_SIM_GRAIN boundaries.
+struct SpikeState {
+    const u32 *current;
+    u64 *next;
+
+    SpikeState(CpuSim &sim, f32 /* decay_factor */) : current((const u32 *)sim.spikes), next(sim.next_spikes) {
+    }
+    inline f32 presynaptic(i32 target) const {
+        return current[target >> 5] >> (target & 31) & 1 ? 1.0f : 0.0f;
+    }
+    inline f32x8 gather(i32x8 index, mask8 valid) const {
+        return f32x8_select(bits8_gather(current, index, valid), f32x8_set1(1.0f), f32x8_set1(0.0f));
+    }
+    inline void store(const CpuSim &sim, usize i, mask8 spike) const {
+        u64 bits = mask8_bits(spike);
+        if (i + SIMD_WIDTH > sim.neuron_count) bits &= (1u << (sim.neuron_count - i)) - 1; // no padding spikes
+        if (i % 64 == 0) next[i / 64] = 0;
+        next[i / 64] |= bits << (i % 64);
+    }
+    static void swap(CpuSim &sim) {
+        u64 *previous = sim.spikes;
+        sim.spikes = sim.next_spikes;
+        sim.next_spikes = previous;
+    }
+};
+
+// Synaptic input of one row over its first FanIn columns. Rows whose width is a whole number of SIMD vectors use
+// masked gathers, narrower rows and double accumulation use a scalar loop with a constant trip count that the
+// compiler unrolls completely.
+template <u32 FanIn, typename Real, bool Vector> struct RowInput {
+    template <typename State> static inline f32 sum(const i32 *targets, const f32 *weights, const State &state) {
+        Real sum = 0;
+        for (u32 j = 0; j < FanIn; j++) {
+            i32 target = targets[j];
+            sum += target >= 0 ? (Real)weights[j] * (Real)state.presynaptic(target) : (Real)0;
+        }
+        return (f32)sum;
+    }
+};
+
+template <u32 FanIn> struct RowInput<FanIn, f32, true> {
+    template <typename State> static inline f32 sum(const i32 *targets, const f32 *weights, const State &state) {
+        f32x8 sum = f32x8_set1(0.0f);
+        for (u32 j = 0; j < FanIn; j += SIMD_WIDTH) {
+            i32x8 index = i32x8_load(&targets[j]);
+            f32x8 presynaptic = state.gather(index, i32x8_ge_zero(index));
+            sum = f32x8_fmadd(f32x8_load(&weights[j]), presynaptic, sum);
+        }
+        return f32x8_reduce_add(sum);
+    }
+};
+
+// KernelPrecisionStrict: one synapse at a time in column order, as the strict compute shader adds them. The product
+// goes through a volatile so it is rounded to f32 before the add and never contracted into a fused multiply-add.
+template <u32 FanIn> struct StrictRowInput {
+    template <typename State> static inline f32 sum(const i32 *targets, const f32 *weights, const State &state) {
+        f32 sum = 0.0f;
+        for (u32 j = 0; j < FanIn; j++) {
+            i32 target = targets[j];
+            if (target < 0) continue;
+            volatile f32 product = weights[j] * state.presynaptic(target);
+            sum += product;
+        }
+        return sum;
+    }
+};
+
+// Strict products go through a volatile as in StrictRowInput, so they are rounded before the add and never fused
+template <typename Real, bool Strict> static inline Real cpu_sim_product(f32 weight, f32 presynaptic) {
+    if (Strict) {
+        volatile Real product = (Real)weight * (Real)presynaptic;
+        return product;
+    }
+    return (Real)weight * (Real)presynaptic;
+}
+
+// Splits the neurons across threads, per node when the sim was placed with cpu_sim_init_numa. Chunks start on
+// CPU_SIM_GRAIN boundaries, which SpikeState::store relies on.
+template <typename Fn> static void cpu_sim_parallel_for(const CpuSim &sim, Fn fn) {
+    auto chunk = [&](usize begin, usize end) {
+        assert(begin % CPU_SIM_GRAIN == 0);
+        fn(begin, end);
+    };
+    if (sim.numa) {
+        numa_parallel_for(*sim.numa, sim.partition, CPU_SIM_GRAIN, [&](u32 /* node */, usize begin, usize end) {
+            chunk(begin, end);
+        });
+    } else {
+        parallel_for(0, sim.neuron_count, CPU_SIM_GRAIN, chunk);
+    }
+}
+
+template <typename Row, typename State, typename Kernel>
+static void cpu_sim_tick_variant(CpuSim &sim, const Network &net, const Kernel &kernel, f32 decay_factor) {
+    const State state(sim, decay_factor);
+    const i32 *synapses = sim.synapses ? sim.synapses : net.synapse_data;
+    const f32 *weights = sim.weights ? sim.weights : net.weight_data;
+
+    cpu_sim_parallel_for(sim, [&](usize begin, usize end) {
+        f32 input[SIMD_WIDTH];
+        for (usize i = begin; i < end; i += SIMD_WIDTH) {
+            // Sum inputs from connected neurons, lanes past the last neuron see no input
+            for (usize l = 0; l < SIMD_WIDTH; l++) {
+                usize row = (i + l) * MAX_SYNAPSES;
+                input[l] = i + l < sim.neuron_count ? Row::sum(&synapses[row], &weights[row], state) : 0.0f;
+            }
+
+            state.store(sim, i, kernel.step(sim, i, f32x8_load(input)));
+        }
+    });
+
+    State::swap(sim);
+}
+
+// Ring entry delay ticks after tick. Both are below slots, so one conditional subtract replaces the modulo.
+static inline u32 cpu_sim_ring_slot(u32 tick, u32 delay, u32 slots) {
+    u32 slot = tick + delay;
+    return slot >= slots ? slot - slots : slot;
+}
+
+// Synaptic input of one delayed row: returns the undelayed sum on top of arriving, and adds each delayed product to
+// the row's ring entry d ticks ahead. The scalar loop adds in column order for strict and double accumulation.
+template <u32 FanIn, typename Real, bool Strict, bool Vector> struct DelayedRowInput {
+    template <typename State>
+    static inline f32 sum(const i32 *targets, const f32 *weights, const u8 *delays, f32 arriving, f32 *ring, u32 tick,
+                          u32 slots, const State &state) {
+        Real sum = arriving;
+        for (u32 j = 0; j < FanIn; j++) {
+            i32 target = targets[j];
+            if (target < 0) continue;
+            Real product = cpu_sim_product<Real, Strict>(weights[j], state.presynaptic(target));
+            if (delays[j] == 0) {
+                sum += product;
+            } else {
+                ring[cpu_sim_ring_slot(tick, delays[j], slots)] += (f32)product;
+            }
+        }
+        return (f32)sum;
+    }
+};
+
+// F32 rows gather 8 columns at a time as RowInput does and accumulate the delay-0 columns in the vector, so like
+// RowInput they do not add in column order. Blocks with a delayed column scatter all 8 lanes without branching on
+// them, the others add 0.
+template <u32 FanIn> struct DelayedRowInput<FanIn, f32, false, true> {
+    template <typename State>
+    static inline f32 sum(const i32 *targets, const f32 *weights, const u8 *delays, f32 arriving, f32 *ring, u32 tick,
+                          u32 slots, const State &state) {
+        f32x8 sum = f32x8_set1(0.0f);
+        f32x8 zero = f32x8_set1(0.0f);
+        f32 products[SIMD_WIDTH];
+        for (u32 j = 0; j < FanIn; j += SIMD_WIDTH) {
+            i32x8 index = i32x8_load(&targets[j]);
+            mask8 valid = i32x8_ge_zero(index);
+            f32x8 product = f32x8_mul(f32x8_load(&weights[j]), state.gather(index, valid));
+            mask8 immediate = u8x8_eq_zero(&delays[j]);
+            sum = f32x8_add(sum, f32x8_select(immediate, product, zero));
+
+            mask8 delayed = mask8_and(valid, mask8_not(immediate));
+            if (!mask8_any(delayed)) continue;
+            f32x8_store(products, f32x8_select(delayed, product, zero));
+            for (u32 l = 0; l < SIMD_WIDTH; l++) {
+                ring[cpu_sim_ring_slot(tick, delays[j + l], slots)] += products[l];
+            }
+        }
+        return arriving + f32x8_reduce_add(sum);
+    }
+};
+
+// Rows with synaptic delays. Each neuron starts from the input that arrives this tick and clears that ring entry,
+// adds its undelayed synapses and adds every delayed product to the entry d ticks ahead. A neuron's delay_slots
+// entries are contiguous and only its own row writes them, so the scatter stays in a few cache lines, threads never
+// share an entry, and a synapse costs the same whatever its delay. The longest delay lands on the entry just
+// cleared, which is next read delay_slots ticks from now.
+template <typename Row, typename State, typename Kernel>
+static void cpu_sim_tick_delayed_variant(CpuSim &sim, const Network &net, const Kernel &kernel, f32 decay_factor) {
+    const State state(sim, decay_factor);
+    const i32 *synapses = sim.synapses ? sim.synapses : net.synapse_data;
+    const f32 *weights = sim.weights ? sim.weights : net.weight_data;
+    const u8 *delays = net.delay_data;
+    u32 slots = sim.delay_slots;
+    u32 tick = sim.delay_tick;
+
+    cpu_sim_parallel_for(sim, [&](usize begin, usize end) {
+        f32 input[SIMD_WIDTH];
+        for (usize i = begin; i < end; i += SIMD_WIDTH) {
+            for (usize l = 0; l < SIMD_WIDTH; l++) {
+                f32 *ring = &sim.delay_ring[(i + l) * slots];
+                input[l] = ring[tick];
+                ring[tick] = 0.0f;
+                if (i + l >= sim.neuron_count) continue;
+
+                usize row = (i + l) * MAX_SYNAPSES;
+                input[l] = Row::sum(&synapses[row], &weights[row], &delays[row], input[l], ring, tick, slots, state);
+            }
+            state.store(sim, i, kernel.step(sim, i, f32x8_load(input)));
+        }
+    });
+
+    State::swap(sim);
+    sim.delay_tick = tick + 1 == slots ? 0 : tick + 1;
+}
+
+template <u32 FanIn, typename Real, bool Strict, typename Kernel>
+static void cpu_sim_delayed_state(CpuSim &sim, const Network &net, const KernelVariant &variant,
+                                  const Kernel &kernel) {
+    typedef DelayedRowInput<FanIn, Real, Strict, FanIn % SIMD_WIDTH == 0> Row;
+    if (variant.binary) {
+        cpu_sim_tick_delayed_variant<Row, SpikeState>(sim, net, kernel, variant.decay);
+    } else {
+        cpu_sim_tick_delayed_variant<Row, DecayState>(sim, net, kernel, variant.decay);
+    }
+}
+
+template <typename Row, typename Kernel>
+static void cpu_sim_tick_state(CpuSim &sim, const Network &net, const KernelVariant &variant, const Kernel &kernel) {
+    if (variant.binary) {
+        cpu_sim_tick_variant<Row, SpikeState>(sim, net, kernel, variant.decay);
+    } else {
+        cpu_sim_tick_variant<Row, DecayState>(sim, net, kernel, variant.decay);
+    }
+}
+
+template <u32 FanIn, typename Kernel>
+static void cpu_sim_dispatch_precision(CpuSim &sim, const Network &net, const KernelVariant &variant,
+                                       const Kernel &kernel) {
+    if (variant.delay_slots) {
+        switch (variant.precision) {
+        case KernelPrecisionF32:
+            cpu_sim_delayed_state<FanIn, f32, false>(sim, net, variant, kernel);
+            break;
+        case KernelPrecisionF64:
+            cpu_sim_delayed_state<FanIn, f64, false>(sim, net, variant, kernel);
+            break;
+        case KernelPrecisionStrict:
+            cpu_sim_delayed_state<FanIn, f32, true>(sim, net, variant, kernel);
+            break;
+        }
+        return;
+    }
+
+    switch (variant.precision) {
+    case KernelPrecisionF32:
+        cpu_sim_tick_state<RowInput<FanIn, f32, FanIn % SIMD_WIDTH == 0>>(sim, net, variant, kernel);
+        break;
+    case KernelPrecisionF64:
+        cpu_sim_tick_state<RowInput<FanIn, f64, false>>(sim, net, variant, kernel);
+        break;
+    case KernelPrecisionStrict:
+        cpu_sim_tick_state<StrictRowInput<FanIn>>(sim, net, variant, kernel);
+        break;
+    }
+}
+
+// Ensemble members own whole SIMD vectors, so every lane of a step shares the first lane's member
+template <typename Kernel> struct MemberKernel {
+    const u32 *member_of;
+    const NeuronModelParams *params;
+
+    inline mask8 step(CpuSim &sim, usize i, f32x8 input) const {
+        return Kernel{params[member_of[i]]}.step(sim, i, input);
+    }
+};
+
+template <typename Kernel>
+static void cpu_sim_dispatch(CpuSim &sim, const Network &net, const KernelVariant &variant, const Kernel &kernel) {
+    switch (variant.fan_in) {
+    case 4:
+        cpu_sim_dispatch_precision<4>(sim, net, variant, kernel);
+        break;
+    case 8:
+        cpu_sim_dispatch_precision<8>(sim, net, variant, kernel);
+        break;
+    default:
+        cpu_sim_dispatch_precision<MAX_SYNAPSES>(sim, net, variant, kernel);
+        break;
+    }
+}
+
+// Reduced-precision storage. Codecs decode 8 slots at a time, padding slots hold target 0 with weight 0, so gathers
+// need no mask. Q8 rows accumulate raw integers and apply the row scale once.
+template <WeightFormat Format> struct WeightCodec;
+
+template <> struct WeightCodec<WeightFormatF32> {
+    static inline f32x8 load(const CompactSynapses &compact, usize slot) {
+        return f32x8_load((const f32 *)compact.weights + slot);
+    }
+    static inline f32 scale(const CompactSynapses & /* compact */, usize /* row */) {
+        return 1.0f;
+    }
+};
+
+template <> struct WeightCodec<WeightFormatF16> {
+    static inline f32x8 load(const CompactSynapses &compact, usize slot) {
+        return f32x8_load_f16((const u16 *)compact.weights + slot);
+    }
+    static inline f32 scale(const CompactSynapses & /* compact */, usize /* row */) {
+        return 1.0f;
+    }
+};
+
+template <> struct WeightCodec<WeightFormatQ8> {
+    static inline f32x8 load(const CompactSynapses &compact, usize slot) {
+        return f32x8_load_i8((const i8 *)compact.weights + slot);
+    }
+    static inline f32 scale(const CompactSynapses &compact, usize row) {
+        return compact.row_scale[row];
+    }
+};
+
+template <TargetFormat Format> struct TargetCodec;
+
+template <> struct TargetCodec<TargetFormatI32> {
+    static inline i32x8 load(const CompactSynapses &compact, usize slot) {
+        return i32x8_load((const i32 *)compact.targets + slot);
+    }
+};
+
+template <> struct TargetCodec<TargetFormatU16> {
+    static inline i32x8 load(const CompactSynapses &compact, usize slot) {
+        return i32x8_load_u16((const u16 *)compact.targets + slot);
+    }
+};
+
+template <ActivationFormat Format> struct ActivationCodec;
+
+template <> struct ActivationCodec<ActivationFormatF32> {
+    const f32 *current;
+    f32 *next;
+
+    ActivationCodec(CpuSim &sim, CompactSynapses & /* compact */) : current(sim.activation), next(sim.next_activation) {
+    }
+    inline f32x8 gather(i32x8 index) const {
+        return f32x8_gather_all(current, index);
+    }
+    inline f32x8 load(usize i) const {
+        return f32x8_load(&current[i]);
+    }
+    inline void store(usize i, f32x8 value) const {
+        f32x8_store(&next[i], value);
+    }
+    static void swap(CpuSim &sim, CompactSynapses & /* compact */) {
+        f32 *previous = sim.activation;
+        sim.activation = sim.next_activation;
+        sim.next_activation = previous;
+    }
+};
+
+template <> struct ActivationCodec<ActivationFormatF16> {
+    const u16 *current;
+    u16 *next;
+
+    ActivationCodec(CpuSim & /* sim */, CompactSynapses &compact)
+        : current(compact.activation), next(compact.next_activation) {
+    }
+    inline f32x8 gather(i32x8 index) const {
+        return f32x8_gather_f16(current, index);
+    }
+    inline f32x8 load(usize i) const {
+        return f32x8_load_f16(&current[i]);
+    }
+    inline void store(usize i, f32x8 value) const {
+        f32x8_store_f16(&next[i], value);
+    }
+    static void swap(CpuSim & /* sim */, CompactSynapses &compact) {
+        u16 *previous = compact.activation;
+        compact.activation = compact.next_activation;
+        compact.next_activation = previous;
+    }
+};
+
+template <WeightFormat W, TargetFormat T, ActivationFormat A, typename Kernel>
+static void cpu_sim_tick_compact_variant(CpuSim &sim, CompactSynapses &compact, const Kernel &kernel,
+                                         f32 decay_factor) {
+    const ActivationCodec<A> activation(sim, compact);
+    f32x8 decay = f32x8_set1(decay_factor);
+
+    cpu_sim_parallel_for(sim, [&](usize begin, usize end) {
+        f32 input[SIMD_WIDTH];
+        for (usize i = begin; i < end; i += SIMD_WIDTH) {
+            for (usize l = 0; l < SIMD_WIDTH; l++) {
+                usize row = i + l;
+                if (row >= sim.neuron_count) {
+                    input[l] = 0.0f;
+                    continue;
+                }
+
+                f32x8 sum = f32x8_set1(0.0f);
+                for (int j = 0; j < MAX_SYNAPSES; j += SIMD_WIDTH) {
+                    usize slot = row * MAX_SYNAPSES + j;
+                    f32x8 presynaptic = activation.gather(TargetCodec<T>::load(compact, slot));
+                    sum = f32x8_fmadd(WeightCodec<W>::load(compact, slot), presynaptic, sum);
+                }
+                input[l] = f32x8_reduce_add(sum) * WeightCodec<W>::scale(compact, row);
+            }
+
+            mask8 spike = kernel.step(sim, i, f32x8_load(input));
+            f32x8 decayed = f32x8_mul(activation.load(i), decay);
+            activation.store(i, f32x8_select(spike, f32x8_set1(1.0f), decayed));
+        }
+    });
+
+    ActivationCodec<A>::swap(sim, compact);
+}
+
+template <WeightFormat W, TargetFormat T, typename Kernel>
+static void cpu_sim_compact_activations(CpuSim &sim, CompactSynapses &compact, const Kernel &kernel, f32 decay) {
+    if (compact.format.activations == ActivationFormatF16) {
+        cpu_sim_tick_compact_variant<W, T, ActivationFormatF16>(sim, compact, kernel, decay);
+    } else {
+        cpu_sim_tick_compact_variant<W, T, ActivationFormatF32>(sim, compact, kernel, decay);
+    }
+}
+
+template <WeightFormat W, typename Kernel>
+static void cpu_sim_compact_targets(CpuSim &sim, CompactSynapses &compact, const Kernel &kernel, f32 decay) {
+    if (compact.format.targets == TargetFormatU16) {
+        cpu_sim_compact_activations<W, TargetFormatU16>(sim, compact, kernel, decay);
+    } else {
+        cpu_sim_compact_activations<W, TargetFormatI32>(sim, compact, kernel, decay);
+    }
+}
+
+template <typename Kernel>
+static void cpu_sim_compact_weights(CpuSim &sim, CompactSynapses &compact, const Kernel &kernel) {
+    f32 decay = sim.variant.decay;
+    switch (compact.format.weights) {
+    case WeightFormatF32:
+        cpu_sim_compact_targets<WeightFormatF32>(sim, compact, kernel, decay);
+        break;
+    case WeightFormatF16:
+        cpu_sim_compact_targets<WeightFormatF16>(sim, compact, kernel, decay);
+        break;
+    case WeightFormatQ8:
+        cpu_sim_compact_targets<WeightFormatQ8>(sim, compact, kernel, decay);
+        break;
+    }
+}
+
+// SELL-C-sigma rows in two passes. The first sums C sorted rows at a time, each lane accumulating its own row in
+// column order, and scatters the sums to sell.input in network order. The second runs the model over consecutive
+// neurons as the padded tick does, so model state is never permuted.
+template <typename State, typename Kernel>
+static void cpu_sim_tick_sell_variant(CpuSim &sim, SellSynapses &sell, const Kernel &kernel, f32 decay_factor) {
+    const State state(sim, decay_factor);
+
+    parallel_for(0, sell.chunk_count, CPU_SIM_SELL_GRAIN, [&](usize begin, usize end) {
+        f32 sums[SIMD_WIDTH];
+        for (usize c = begin; c < end; c++) {
+            usize offset = sell.chunks[c * 2 + 0];
+            u32 width = sell.chunks[c * 2 + 1];
+            for (u32 v = 0; v < sell.chunk; v += SIMD_WIDTH) {
+                f32x8 sum = f32x8_set1(0.0f);
+                for (u32 j = 0; j < width; j++) {
+                    usize entry = offset + (usize)j * sell.chunk + v;
+                    i32x8 index = i32x8_load(&sell.targets[entry]);
+                    sum = f32x8_fmadd(f32x8_load(&sell.weights[entry]), state.gather(index, i32x8_ge_zero(index)), sum);
+                }
+
+                f32x8_store(sums, sum);
+                const u32 *rows = &sell.rows[c * sell.chunk + v];
+                for (u32 l = 0; l < SIMD_WIDTH; l++) {
+                    if (rows[l] != SELL_NO_ROW) sell.input[rows[l]] = sums[l];
+                }
+            }
+        }
+    });
+
+    cpu_sim_parallel_for(sim, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i += SIMD_WIDTH) {
+            state.store(sim, i, kernel.step(sim, i, f32x8_load(&sell.input[i])));
+        }
+    });
+
+    State::swap(sim);
+}
+
+template <typename Kernel> static void cpu_sim_sell_state(CpuSim &sim, SellSynapses &sell, const Kernel &kernel) {
+    if (sim.variant.binary) {
+        cpu_sim_tick_sell_variant<SpikeState>(sim, sell, kernel, sim.variant.decay);
+    } else {
+        cpu_sim_tick_sell_variant<DecayState>(sim, sell, kernel, sim.variant.decay);
+    }
+}
+
+// Writes the initial state of neurons [begin, end), end may run into the padding
+static void cpu_sim_fill(CpuSim &sim, const Network &net, usize begin, usize end) {
+    for (usize i = begin; i < end; i++) {
+        bool real = i < net.neuron_count;
+        sim.activation[i] = real ? net.neuron_data[i * 4 + 2] : 0.0f;
+        sim.next_activation[i] = 0.0f;
+        sim.threshold[i] = real ? net.neuron_data[i * 4 + 3] : 0.0f;
+        sim.potential[i] = neuron_model_initial_potential(net.model);
+        sim.recovery[i] = neuron_model_initial_recovery(net.model);
+        sim.refractory[i] = 0.0f;
+    }
+}
+
+static void cpu_sim_alloc(CpuSim &sim, const Network &net, usize padded, usize halo_count) {
+    sim.neuron_count = net.neuron_count;
+    sim.halo_count = halo_count;
+    sim.model = net.model;
+    sim.variant = kernel_variant_for(net);
+    // malloc rather than calloc so no page is touched before cpu_sim_fill runs on its owning node
+    sim.activation = (f32 *)malloc((padded + halo_count) * sizeof(f32));
+    sim.next_activation = (f32 *)malloc((padded + halo_count) * sizeof(f32));
+    sim.threshold = (f32 *)malloc(padded * sizeof(f32));
+    sim.potential = (f32 *)malloc(padded * sizeof(f32));
+    sim.recovery = (f32 *)malloc(padded * sizeof(f32));
+    sim.refractory = (f32 *)malloc(padded * sizeof(f32));
+    sim.numa = nullptr;
+    sim.synapses = nullptr;
+    sim.weights = nullptr;
+
+    sim.delay_slots = net.delay_data ? net.delay_slots : 0;
+    sim.delay_tick = 0;
+    sim.delay_ring = sim.delay_slots ? (f32 *)calloc(padded * sim.delay_slots, sizeof(f32)) : nullptr;
+
+    // Filled in by cpu_sim_convert on the first binary tick
+    usize words = (padded + 63) / 64;
+    sim.spikes = (u64 *)calloc(words, sizeof(u64));
+    sim.next_spikes = (u64 *)calloc(words, sizeof(u64));
+    sim.binary = false;
+}
+
+// Switches the current state between activations and spike bits. Going binary, neurons at 1 spiked last tick,
+// going back, activations restart from 1 or 0.
+static void cpu_sim_convert(CpuSim &sim, bool binary) {
+    if (binary) {
+        usize words = (sim.neuron_count + 63) / 64;
+        memset(sim.spikes, 0, words * sizeof(u64));
+        for (usize i = 0; i < sim.neuron_count; i++) {
+            sim.spikes[i / 64] |= (u64)(sim.activation[i] >= 1.0f) << (i % 64);
+        }
+    } else {
+        for (usize i = 0; i < sim.neuron_count; i++) sim.activation[i] = cpu_sim_activation(sim, i);
+    }
+    sim.binary = binary;
+}
+
+void cpu_sim_init(CpuSim &sim, const Network &net, usize halo_count) {
+    usize padded = (net.neuron_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    cpu_sim_alloc(sim, net, padded, halo_count);
+    cpu_sim_fill(sim, net, 0, padded);
+    memset(sim.activation + padded, 0, halo_count * sizeof(f32));
+    memset(sim.next_activation + padded, 0, halo_count * sizeof(f32));
+}
+
+void cpu_sim_init_numa(CpuSim &sim, const Network &net, const NumaTopology &topology) {
+    usize padded = (net.neuron_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    cpu_sim_alloc(sim, net, padded, 0);
+
+    sim.numa = &topology;
+    numa_partition(topology, net.neuron_count, CPU_SIM_GRAIN, sim.partition);
+    sim.synapses = (i32 *)malloc(padded * MAX_SYNAPSES * sizeof(i32));
+    sim.weights = (f32 *)malloc(padded * MAX_SYNAPSES * sizeof(f32));
+
+    // Same split as the tick, so the thread that first writes a page is on the node that will read it. Chunks start on
+    // SIMD boundaries, a page straddling two chunks lands on whichever touches it first.
+    numa_parallel_for(topology, sim.partition, CPU_SIM_GRAIN, [&](u32 /* node */, usize begin, usize end) {
+        if (end == net.neuron_count) end = padded;
+        cpu_sim_fill(sim, net, begin, end);
+
+        usize real = end < net.neuron_count ? end : net.neuron_count;
+        if (real > begin) {
+            usize rows = (real - begin) * MAX_SYNAPSES;
+            memcpy(&sim.synapses[begin * MAX_SYNAPSES], &net.synapse_data[begin * MAX_SYNAPSES], rows * sizeof(i32));
+            memcpy(&sim.weights[begin * MAX_SYNAPSES], &net.weight_data[begin * MAX_SYNAPSES], rows * sizeof(f32));
+        }
+        for (usize i = real * MAX_SYNAPSES; i < end * MAX_SYNAPSES; i++) {
+            sim.synapses[i] = -1;
+            sim.weights[i] = 0.0f;
+        }
+    });
+}
+
+void cpu_sim_deinit(CpuSim &sim) {
+    free(sim.delay_ring);
+    free(sim.spikes);
+    free(sim.next_spikes);
+    free(sim.synapses);
+    free(sim.weights);
+    free(sim.activation);
+    free(sim.next_activation);
+    free(sim.threshold);
+    free(sim.potential);
+    free(sim.recovery);
+    free(sim.refractory);
+}
+
+void cpu_sim_tick(CpuSim &sim, const Network &net) {
+    cpu_sim_tick_variant(sim, net, sim.variant);
+}
+
+void cpu_sim_tick_variant(CpuSim &sim, const Network &net, const KernelVariant &variant) {
+    if (variant.binary != sim.binary) cpu_sim_convert(sim, variant.binary);
+    if (variant.delay_slots != sim.delay_slots) {
+        warn("Variant expects %u delay slots, the sim was made with %u", variant.delay_slots, sim.delay_slots);
+        return;
+    }
+
+    bool strict = variant.precision == KernelPrecisionStrict;
+    switch (variant.model) {
+    case NeuronModelThreshold:
+        cpu_sim_dispatch(sim, net, variant, ThresholdKernel{sim.model});
+        break;
+    case NeuronModelLif:
+        if (strict) {
+            cpu_sim_dispatch(sim, net, variant, LifKernel<RoundedMath>{sim.model});
+        } else {
+            cpu_sim_dispatch(sim, net, variant, LifKernel<FusedMath>{sim.model});
+        }
+        break;
+    case NeuronModelIzhikevich:
+        if (strict) {
+            cpu_sim_dispatch(sim, net, variant, IzhikevichKernel<RoundedMath>{sim.model});
+        } else {
+            cpu_sim_dispatch(sim, net, variant, IzhikevichKernel<FusedMath>{sim.model});
+        }
+        break;
+    }
+}
+
+void cpu_sim_tick_members(CpuSim &sim, const Network &net, const KernelVariant &variant, const u32 *member_of,
+                          const NeuronModelParams *params) {
+    if (variant.binary != sim.binary) cpu_sim_convert(sim, variant.binary);
+    if (variant.delay_slots != sim.delay_slots) {
+        warn("Variant expects %u delay slots, the sim was made with %u", variant.delay_slots, sim.delay_slots);
+        return;
+    }
+
+    bool strict = variant.precision == KernelPrecisionStrict;
+    switch (variant.model) {
+    case NeuronModelThreshold:
+        cpu_sim_dispatch(sim, net, variant, MemberKernel<ThresholdKernel>{member_of, params});
+        break;
+    case NeuronModelLif:
+        if (strict) {
+            cpu_sim_dispatch(sim, net, variant, MemberKernel<LifKernel<RoundedMath>>{member_of, params});
+        } else {
+            cpu_sim_dispatch(sim, net, variant, MemberKernel<LifKernel<FusedMath>>{member_of, params});
+        }
+        break;
+    case NeuronModelIzhikevich:
+        if (strict) {
+            cpu_sim_dispatch(sim, net, variant, MemberKernel<IzhikevichKernel<RoundedMath>>{member_of, params});
+        } else {
+            cpu_sim_dispatch(sim, net, variant, MemberKernel<IzhikevichKernel<FusedMath>>{member_of, params});
+        }
+        break;
+    }
+}
+
+void cpu_sim_tick_compact(CpuSim &sim, CompactSynapses &compact) {
+    if (sim.binary) cpu_sim_convert(sim, false); // compact rows always tick activations
+    switch (sim.model.model) {
+    case NeuronModelThreshold:
+        cpu_sim_compact_weights(sim, compact, ThresholdKernel{sim.model});
+        break;
+    case NeuronModelLif:
+        cpu_sim_compact_weights(sim, compact, LifKernel<FusedMath>{sim.model});
+        break;
+    case NeuronModelIzhikevich:
+        cpu_sim_compact_weights(sim, compact, IzhikevichKernel<FusedMath>{sim.model});
+        break;
+    }
+}
+
+void cpu_sim_tick_sell(CpuSim &sim, SellSynapses &sell) {
+    if (sim.variant.binary != sim.binary) cpu_sim_convert(sim, sim.variant.binary);
+    switch (sim.model.model) {
+    case NeuronModelThreshold:
+        cpu_sim_sell_state(sim, sell, ThresholdKernel{sim.model});
+        break;
+    case NeuronModelLif:
+        cpu_sim_sell_state(sim, sell, LifKernel<FusedMath>{sim.model});
+        break;
+    case NeuronModelIzhikevich:
+        cpu_sim_sell_state(sim, sell, IzhikevichKernel<FusedMath>{sim.model});
+        break;
+    }
+}
+
+void cpu_sim_load_compact(CpuSim &sim, const CompactSynapses &compact) {
+    if (compact.format.activations != ActivationFormatF16) return;
+    for (usize i = 0; i < sim.neuron_count; i++) {
+        sim.activation[i] = f32_from_f16(compact.activation[i]);
+    }
+}
+
+void cpu_sim_store(const CpuSim &sim, Network &net) {
+    for (usize i = 0; i < sim.neuron_count; i++) {
+        net.neuron_data[i * 4 + 2] = cpu_sim_activation(sim, i);
+    }
+}
+
+static u32 cpu_sim_popcount(u64 word) {
+#ifdef _MSC_VER
+    return (u32)__popcnt64(word);
+#else
+    return (u32)__builtin_popcountll(word);
+#endif
+}
+
+usize cpu_sim_spike_count(const CpuSim &sim) {
+    if (!sim.binary) return 0;
+    usize count = 0;
+    for (usize w = 0; w < (sim.neuron_count + 63) / 64; w++) count += cpu_sim_popcount(sim.spikes[w]);
+    return count;
+}
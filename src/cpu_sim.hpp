@@ -0,0 +1,78 @@
+#pragma once
+
+#include "core/numa.h"
+#include "core/types.h"
+#include "neural_net.hpp"
+#include "sell.hpp"
+#include "storage_format.hpp"
+
+// Host-side simulation of a Network. Per-neuron state is kept as structure-of-arrays and double-buffered, so a
+// tick reads only the previous activations and the result does not depend on how neurons are split across threads.
+// Arrays are padded to a whole number of SIMD vectors.
+struct CpuSim {
+    usize neuron_count;
+    NeuronModelParams model;
+    KernelVariant variant; // chosen from the network at init
+
+    f32 *activation; // padded neuron count plus halo_count entries
+    f32 *next_activation;
+    f32 *threshold;
+
+    // Binary spike mode (KernelVariant::binary): bit i of the bitset is whether neuron i spiked last tick, 64
+    // neurons per word. binary says which representation is current, ticks convert when the variant switches.
+    u64 *spikes;
+    u64 *next_spikes;
+    bool binary;
+
+    // Input of delayed synapses (Network::delay_data) waiting to arrive: delay_slots floats per padded neuron, entry
+    // delay_tick of each arrives on the next tick. Null when the network has no delays.
+    f32 *delay_ring;
+    u32 delay_slots;
+    u32 delay_tick;
+
+    // Model state, unused arrays stay untouched for models that do not need them
+    f32 *potential;
+    f32 *recovery;
+    f32 *refractory;
+
+    // Activations of neurons owned elsewhere, stored after the padded local ones. Rows may read them, ticks never
+    // write them, the distributed engine fills them in from the spikes it receives.
+    usize halo_count;
+
+    // NUMA placement, null when ticking with plain parallel_for. Node n owns neurons [partition[n], partition[n+1]),
+    // their state pages and a copy of their synapse rows, all first touched by threads pinned to that node.
+    const NumaTopology *numa;
+    usize partition[NUMA_MAX_NODES + 1];
+    i32 *synapses;
+    f32 *weights;
+};
+
+void cpu_sim_init(CpuSim &sim, const Network &net, usize halo_count = 0);
+// Like cpu_sim_init, but places each node's share of neurons and synapse rows in that node's memory and ticks them
+// on its CPUs. The topology must outlive the sim. Rows are copied, edits to the network's synapses are not seen.
+void cpu_sim_init_numa(CpuSim &sim, const Network &net, const NumaTopology &topology);
+void cpu_sim_deinit(CpuSim &sim);
+void cpu_sim_tick(CpuSim &sim, const Network &net);
+// Runs a specific instantiation. The variant's model must match the network's, its fan-in must cover every row and
+// its delay_slots must be the sim's.
+void cpu_sim_tick_variant(CpuSim &sim, const Network &net, const KernelVariant &variant);
+// Ticks the packed members of an ensemble (ensemble.hpp): neuron i steps with params[member_of[i]] instead of the
+// sim's model. Members must start on SIMD boundaries, run the variant's model and cover whole SIMD vectors.
+void cpu_sim_tick_members(CpuSim &sim, const Network &net, const KernelVariant &variant, const u32 *member_of,
+                          const NeuronModelParams *params);
+// Ticks from reduced-precision synapses instead of the network's rows. With F16 activations the current state lives
+// in compact.activation, cpu_sim_load_compact decodes it into sim.activation.
+void cpu_sim_tick_compact(CpuSim &sim, CompactSynapses &compact);
+void cpu_sim_load_compact(CpuSim &sim, const CompactSynapses &compact);
+// Ticks from SELL-C-sigma rows instead of the network's padded rows, in f32 and in the mode of sim.variant.binary.
+// Like compact rows, SELL rows carry no delays, every synapse is instantaneous.
+void cpu_sim_tick_sell(CpuSim &sim, SellSynapses &sell);
+// Copies activations back into neuron_data so the renderer and serializer see them
+void cpu_sim_store(const CpuSim &sim, Network &net);
+// Neurons that spiked on the last binary tick, a popcount over the bitset
+usize cpu_sim_spike_count(const CpuSim &sim);
+
+static inline f32 cpu_sim_activation(const CpuSim &sim, usize index) {
+    if (sim.binary) return sim.spikes[index / 64] >> (index % 64) & 1 ? 1.0f : 0.0f;
+    return sim.activation[index];
+}
@@ -0,0 +1,254 @@
+#include "distributed.hpp"
+
+#include "core/arena.h"
+#include "core/logger.h"
+#include "core/simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#define SPIKE_HEADER_SIZE 5 // encoding byte and u32 spike count
+
+static f64 distributed_now_ms() {
+    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+    return std::chrono::duration<f64, std::milli>(now).count();
+}
+
+// Local index of a global target: owned neurons first, then the halo
+static i32 distributed_local_target(const DistributedSim &dist, i32 target) {
+    if (target < 0) return -1;
+    if ((usize)target >= dist.begin && (usize)target < dist.end) return (i32)(target - dist.begin);
+    const u32 *found = std::lower_bound(dist.halo_ids, dist.halo_ids + dist.halo_count, (u32)target);
+    return (i32)(dist.halo_offset + (found - dist.halo_ids));
+}
+
+bool distributed_init(DistributedSim &dist, const Network &net, const usize *bounds, Transport &transport) {
+    memset(&dist, 0, sizeof(dist));
+    dist.rank = transport.rank;
+    dist.rank_count = transport.rank_count;
+    dist.begin = bounds[dist.rank];
+    dist.end = bounds[dist.rank + 1];
+    dist.transport = &transport;
+    usize count = dist.end - dist.begin;
+
+    // Presynaptic neurons owned elsewhere, sorted by global index so they come out grouped by owner
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u32 *remote = arena_push<u32>(scratch, count * MAX_SYNAPSES);
+    usize remote_count = 0;
+    for (usize i = dist.begin * MAX_SYNAPSES; i < dist.end * MAX_SYNAPSES; i++) {
+        i32 target = net.synapse_data[i];
+        if (target >= 0 && ((usize)target < dist.begin || (usize)target >= dist.end)) remote[remote_count++] = target;
+    }
+    std::sort(remote, remote + remote_count);
+    dist.halo_count = std::unique(remote, remote + remote_count) - remote;
+    dist.halo_ids = (u32 *)malloc(dist.halo_count * sizeof(u32));
+    memcpy(dist.halo_ids, remote, dist.halo_count * sizeof(u32));
+    arena_restore(scratch, mark);
+
+    for (u32 peer = 0; peer <= dist.rank_count; peer++) {
+        dist.halo_bounds[peer] = std::lower_bound(dist.halo_ids, dist.halo_ids + dist.halo_count, bounds[peer]) -
+                                 dist.halo_ids;
+    }
+    dist.halo_offset = (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+    Network &local = dist.local;
+    local.model = net.model;
+    local.format = net.format;
+    local.neuron_count = count;
+    local.neuron_data = (f32 *)malloc(count * 4 * sizeof(f32));
+    local.synapse_data = (i32 *)malloc(count * MAX_SYNAPSES * sizeof(i32));
+    local.weight_data = (f32 *)malloc(count * MAX_SYNAPSES * sizeof(f32));
+    memcpy(local.neuron_data, &net.neuron_data[dist.begin * 4], count * 4 * sizeof(f32));
+    memcpy(local.weight_data, &net.weight_data[dist.begin * MAX_SYNAPSES], count * MAX_SYNAPSES * sizeof(f32));
+    for (usize i = 0; i < count * MAX_SYNAPSES; i++) {
+        local.synapse_data[i] = distributed_local_target(dist, net.synapse_data[dist.begin * MAX_SYNAPSES + i]);
+    }
+    local.delay_data = nullptr;
+    local.delay_slots = net.delay_slots;
+    if (net.delay_data) {
+        local.delay_data = (u8 *)malloc(count * MAX_SYNAPSES);
+        memcpy(local.delay_data, &net.delay_data[dist.begin * MAX_SYNAPSES], count * MAX_SYNAPSES);
+    }
+    local.variant = kernel_variant_for(local);
+    cpu_sim_init(dist.sim, local, dist.halo_count);
+
+    // Tell each owner which of its neurons this rank reads, their requests become our send lists
+    for (u32 peer = 0; peer < dist.rank_count; peer++) {
+        TransportBuffer &message = dist.send[peer];
+        usize ids = dist.halo_bounds[peer + 1] - dist.halo_bounds[peer];
+        transport_buffer_reserve(message, ids * sizeof(u32));
+        memcpy(message.data, &dist.halo_ids[dist.halo_bounds[peer]], ids * sizeof(u32));
+        message.size = ids * sizeof(u32);
+    }
+    if (!transport_exchange(transport, dist.send)) return false;
+
+    usize send_total = 0;
+    for (u32 peer = 0; peer < dist.rank_count; peer++) {
+        dist.send_bounds[peer] = send_total;
+        if (peer != dist.rank) send_total += transport.received[peer].size / sizeof(u32);
+    }
+    dist.send_bounds[dist.rank_count] = send_total;
+    dist.send_indices = (u32 *)malloc(send_total * sizeof(u32));
+    for (u32 peer = 0; peer < dist.rank_count; peer++) {
+        if (peer == dist.rank) continue;
+        const u32 *ids = (const u32 *)transport.received[peer].data;
+        for (usize k = dist.send_bounds[peer]; k < dist.send_bounds[peer + 1]; k++) {
+            u32 id = ids[k - dist.send_bounds[peer]];
+            if (id < dist.begin || id >= dist.end) {
+                error("Rank %u asked rank %u for neuron %u it does not own", peer, dist.rank, id);
+                return false;
+            }
+            dist.send_indices[k] = (u32)(id - dist.begin);
+        }
+    }
+
+    // Initial activations of the halo, every later tick only carries spikes
+    for (u32 peer = 0; peer < dist.rank_count; peer++) {
+        TransportBuffer &message = dist.send[peer];
+        usize n = dist.send_bounds[peer + 1] - dist.send_bounds[peer];
+        transport_buffer_reserve(message, SPIKE_HEADER_SIZE + (n + 7) / 8 + n * sizeof(f32));
+        f32 *values = (f32 *)message.data;
+        for (usize k = 0; k < n; k++) {
+            values[k] = dist.sim.activation[dist.send_indices[dist.send_bounds[peer] + k]];
+        }
+        message.size = n * sizeof(f32);
+    }
+    if (!transport_exchange(transport, dist.send)) return false;
+
+    for (u32 peer = 0; peer < dist.rank_count; peer++) {
+        if (peer == dist.rank) continue;
+        usize n = dist.halo_bounds[peer + 1] - dist.halo_bounds[peer];
+        if (transport.received[peer].size != n * sizeof(f32)) return false;
+        memcpy(&dist.sim.activation[dist.halo_offset + dist.halo_bounds[peer]], transport.received[peer].data,
+               n * sizeof(f32));
+    }
+
+    info("Rank %u: %zu neurons, %zu halo, %zu sent per tick at most", dist.rank, count, dist.halo_count, send_total);
+    return true;
+}
+
+void distributed_deinit(DistributedSim &dist) {
+    cpu_sim_deinit(dist.sim);
+    free(dist.local.neuron_data);
+    free(dist.local.synapse_data);
+    free(dist.local.weight_data);
+    free(dist.local.delay_data);
+    free(dist.halo_ids);
+    free(dist.send_indices);
+    for (u32 peer = 0; peer < TRANSPORT_MAX_RANKS; peer++) {
+        transport_buffer_free(dist.send[peer]);
+    }
+}
+
+// Positions in list whose neuron spiked this tick, as a delta list unless that would outgrow the bitset
+static void distributed_encode(DistributedSim &dist, const u32 *list, usize n, TransportBuffer &message) {
+    const f32 *activation = dist.sim.activation;
+    usize bitset_size = (n + 7) / 8;
+    u8 *payload = message.data + SPIKE_HEADER_SIZE;
+
+    u32 spikes = 0;
+    usize size = 0;
+    usize previous = 0;
+    bool delta = true;
+    for (usize k = 0; k < n; k++) {
+        if (activation[list[k]] != 1.0f) continue;
+        spikes++;
+
+        u32 gap = (u32)(k - previous);
+        previous = k + 1;
+        // A varint is at most 5 bytes, stop before writing past the bitset
+        if (size + 5 > bitset_size) {
+            delta = false;
+            continue;
+        }
+        while (gap >= 0x80) {
+            payload[size++] = (u8)(gap | 0x80);
+            gap >>= 7;
+        }
+        payload[size++] = (u8)gap;
+    }
+
+    if (!delta) {
+        memset(payload, 0, bitset_size);
+        for (usize k = 0; k < n; k++) {
+            if (activation[list[k]] == 1.0f) payload[k >> 3] |= (u8)(1u << (k & 7));
+        }
+        size = bitset_size;
+    }
+
+    message.data[0] = (u8)(delta ? SpikeEncodingDelta : SpikeEncodingBitset);
+    memcpy(&message.data[1], &spikes, sizeof(u32));
+    message.size = SPIKE_HEADER_SIZE + size;
+
+    dist.spikes_sent += spikes;
+    dist.bytes_sent += message.size;
+    dist.raw_bytes += spikes * sizeof(u32);
+    delta ? dist.delta_messages++ : dist.bitset_messages++;
+}
+
+static bool distributed_decode(DistributedSim &dist, const TransportBuffer &message, f32 *halo, usize n) {
+    if (message.size < SPIKE_HEADER_SIZE) return false;
+    const u8 *payload = message.data + SPIKE_HEADER_SIZE;
+    usize size = message.size - SPIKE_HEADER_SIZE;
+
+    if (message.data[0] == SpikeEncodingBitset) {
+        if (size != (n + 7) / 8) return false;
+        for (usize k = 0; k < n; k++) {
+            if (payload[k >> 3] & (1u << (k & 7))) halo[k] = 1.0f;
+        }
+        return true;
+    }
+
+    u32 spikes;
+    memcpy(&spikes, &message.data[1], sizeof(u32));
+    usize read = 0, position = 0;
+    for (u32 s = 0; s < spikes; s++) {
+        u32 gap = 0;
+        for (u32 shift = 0; read < size; shift += 7) {
+            u8 byte = payload[read++];
+            gap |= (u32)(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        position += gap;
+        if (position >= n) return false;
+        halo[position++] = 1.0f;
+    }
+    return read == size;
+}
+
+bool distributed_tick(DistributedSim &dist) {
+    f64 start = distributed_now_ms();
+    cpu_sim_tick(dist.sim, dist.local);
+
+    for (u32 peer = 0; peer < dist.rank_count; peer++) {
+        if (peer == dist.rank) continue;
+        usize n = dist.send_bounds[peer + 1] - dist.send_bounds[peer];
+        distributed_encode(dist, &dist.send_indices[dist.send_bounds[peer]], n, dist.send[peer]);
+    }
+    if (!transport_exchange(*dist.transport, dist.send)) return false;
+
+    // The tick swapped buffers, so last tick's halo is in next_activation. Decay all of it, then apply the spikes.
+    f32 decay = dist.sim.variant.decay;
+    f32 *halo = &dist.sim.activation[dist.halo_offset];
+    const f32 *previous = &dist.sim.next_activation[dist.halo_offset];
+    for (usize g = 0; g < dist.halo_count; g++) {
+        halo[g] = previous[g] * decay;
+    }
+
+    bool ok = true;
+    for (u32 peer = 0; peer < dist.rank_count; peer++) {
+        if (peer == dist.rank) continue;
+        usize n = dist.halo_bounds[peer + 1] - dist.halo_bounds[peer];
+        if (!distributed_decode(dist, dist.transport->received[peer], &halo[dist.halo_bounds[peer]], n)) {
+            error("Rank %u: malformed spike message from rank %u", dist.rank, peer);
+            ok = false;
+        }
+    }
+
+    dist.ticks++;
+    dist.tick_ms += distributed_now_ms() - start;
+    return ok;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "core/types.h"
+#include "cpu_sim.hpp"
+#include "neural_net.hpp"
+#include "transport.hpp"
+
+// Spike lists are sent as whichever encoding is smaller for that tick
+enum SpikeEncoding {
+    SpikeEncodingBitset, // one bit per neuron the receiver reads from this rank
+    SpikeEncodingDelta,  // LEB128 varints of the gaps between spiking positions
+};
+
+// One rank of a network partitioned across processes. The rank owns a contiguous neuron range of the global order
+// (see partition_order) and the incoming synapse rows of those neurons. Presynaptic neurons owned by other ranks are
+// kept as a halo after the local activations.
+//
+// A neuron's activation is either 1 after a spike or its previous value times the decay, so each tick only the
+// spikes of neurons some other rank reads are sent, and the receiver replays the decay for the rest. The halo stays
+// bit-identical to the owner's activations, and so does the whole run compared with a single-process CpuSim.
+struct DistributedSim {
+    u32 rank;
+    u32 rank_count;
+    usize begin; // owned global range
+    usize end;
+
+    Network local; // owned rows, targets renumbered to local indices followed by halo indices
+    CpuSim sim;
+    usize halo_offset; // index of the first halo activation in sim.activation
+    usize halo_count;
+    u32 *halo_ids; // global index of each halo neuron, grouped by owner in rank order
+    usize halo_bounds[TRANSPORT_MAX_RANKS + 1];
+
+    // Local indices of neurons each peer reads, in the order of that peer's halo
+    u32 *send_indices;
+    usize send_bounds[TRANSPORT_MAX_RANKS + 1];
+    TransportBuffer send[TRANSPORT_MAX_RANKS];
+
+    Transport *transport;
+
+    // Stats
+    usize ticks;
+    usize spikes_sent;
+    usize bytes_sent; // spike messages only, without the setup exchanges
+    usize raw_bytes; // a u32 index per spike, what the messages would cost uncompressed
+    usize bitset_messages;
+    usize delta_messages;
+    f64 tick_ms;
+};
+
+// Copies the owned rows out of net and sets up the halo with the other ranks, which must all call this with the same
+// bounds. Only the owned part of net is read, so each process may load just its own rows as long as the indices are
+// global. Ranks exchange their halo lists and initial activations through transport.
+bool distributed_init(DistributedSim &dist, const Network &net, const usize *bounds, Transport &transport);
+void distributed_deinit(DistributedSim &dist);
+
+// Ticks the local neurons, then exchanges spikes with every other rank and updates the halo
+bool distributed_tick(DistributedSim &dist);
+
+// Activation of an owned neuron by global index
+static inline f32 distributed_activation(const DistributedSim &dist, usize index) {
+    return dist.sim.activation[index - dist.begin];
+}
@@ -0,0 +1,262 @@
+#include "ensemble.hpp"
+
+#include "core/arena.h"
+#include "core/file.h"
+#include "core/logger.h"
+#include "core/simd.h"
+
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+
+bool ensemble_init(Ensemble &ens, const Network *members, const NeuronModelParams *params, usize count,
+                   KernelPrecision precision) {
+    if (count == 0) {
+        error("Ensemble needs at least one member");
+        return false;
+    }
+    for (usize m = 1; m < count; m++) {
+        if (params[m].model != params[0].model) {
+            error("Ensemble member %zu runs a different model than member 0, members must share one", m);
+            return false;
+        }
+    }
+
+    ens.member_count = count;
+    ens.offsets = (usize *)malloc((count + 1) * sizeof(usize));
+    ens.sizes = (usize *)malloc(count * sizeof(usize));
+    ens.params = (NeuronModelParams *)malloc(count * sizeof(NeuronModelParams));
+    memcpy(ens.params, params, count * sizeof(NeuronModelParams));
+
+    usize total = 0;
+    u32 delay_slots = 0;
+    for (usize m = 0; m < count; m++) {
+        ens.offsets[m] = total;
+        ens.sizes[m] = members[m].neuron_count;
+        total += (members[m].neuron_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+        if (members[m].delay_data && members[m].delay_slots > delay_slots) delay_slots = members[m].delay_slots;
+    }
+    ens.offsets[count] = total;
+
+    Network &net = ens.net;
+    net = {}; // no GL buffers until ensemble_upload
+    net.model = params[0];
+    net.format = storage_format_default();
+    net.neuron_count = total;
+    net.neuron_data = (f32 *)malloc(total * 4 * sizeof(f32));
+    net.synapse_data = (i32 *)malloc(total * MAX_SYNAPSES * sizeof(i32));
+    net.weight_data = (f32 *)malloc(total * MAX_SYNAPSES * sizeof(f32));
+    net.kind_data = (Neuron::Kind *)malloc(total * sizeof(Neuron::Kind));
+    net.delay_data = delay_slots ? (u8 *)calloc(total * MAX_SYNAPSES, 1) : nullptr;
+    net.delay_slots = delay_slots;
+    net.id_of_index = nullptr;
+    net.index_of_id = nullptr;
+    ens.member_of = (u32 *)malloc(total * sizeof(u32));
+
+    for (usize m = 0; m < count; m++) {
+        const Network &member = members[m];
+        usize base = ens.offsets[m];
+        for (usize i = base; i < ens.offsets[m + 1]; i++) {
+            ens.member_of[i] = (u32)m;
+            usize local = i - base;
+            i32 *row = &net.synapse_data[i * MAX_SYNAPSES];
+            f32 *weights = &net.weight_data[i * MAX_SYNAPSES];
+
+            if (local >= member.neuron_count) {
+                // Padding: no synapses in or out and a threshold no input can reach
+                f32 padding[4] = {0.0f, 0.0f, 0.0f, FLT_MAX};
+                memcpy(&net.neuron_data[i * 4], padding, sizeof(padding));
+                net.kind_data[i] = Neuron::Hidden;
+                for (int j = 0; j < MAX_SYNAPSES; j++) {
+                    row[j] = -1;
+                    weights[j] = 0.0f;
+                }
+                continue;
+            }
+
+            memcpy(&net.neuron_data[i * 4], &member.neuron_data[local * 4], 4 * sizeof(f32));
+            net.kind_data[i] = member.kind_data[local];
+            for (int j = 0; j < MAX_SYNAPSES; j++) {
+                i32 target = member.synapse_data[local * MAX_SYNAPSES + j];
+                row[j] = target >= 0 ? target + (i32)base : -1;
+                weights[j] = member.weight_data[local * MAX_SYNAPSES + j];
+            }
+            if (member.delay_data) {
+                memcpy(&net.delay_data[i * MAX_SYNAPSES], &member.delay_data[local * MAX_SYNAPSES], MAX_SYNAPSES);
+            }
+        }
+    }
+
+    net.variant = kernel_variant_for(net);
+    net.variant.precision = precision;
+    ens.member_buffer = ens.param_buffer = 0;
+    return true;
+}
+
+void ensemble_deinit(Ensemble &ens) {
+    if (ens.member_buffer) {
+        GLuint buffers[] = {ens.member_buffer, ens.param_buffer};
+        glDeleteBuffers(2, buffers);
+    }
+    network_deinit(ens.net);
+    free(ens.offsets);
+    free(ens.sizes);
+    free(ens.params);
+    free(ens.member_of);
+}
+
+void ensemble_sim_init(const Ensemble &ens, CpuSim &sim) {
+    cpu_sim_init(sim, ens.net);
+    sim.variant = ens.net.variant;
+    for (usize m = 0; m < ens.member_count; m++) {
+        for (usize i = ens.offsets[m]; i < ens.offsets[m + 1]; i++) {
+            sim.potential[i] = neuron_model_initial_potential(ens.params[m]);
+            sim.recovery[i] = neuron_model_initial_recovery(ens.params[m]);
+        }
+    }
+}
+
+void ensemble_tick_cpu(const Ensemble &ens, CpuSim &sim) {
+    cpu_sim_tick_members(sim, ens.net, sim.variant, ens.member_of, ens.params);
+}
+
+void ensemble_upload(Ensemble &ens) {
+    if (ens.member_buffer) {
+        GLuint buffers[] = {ens.member_buffer, ens.param_buffer};
+        glDeleteBuffers(2, buffers);
+    }
+
+    KernelPrecision precision = ens.net.variant.precision;
+    network_upload(ens.net);
+    ens.net.variant.ensemble = true;
+    network_set_precision(ens.net, precision); // selects the ensemble program
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+
+    // network_upload started every neuron from member 0's model
+    usize total = ens.net.neuron_count;
+    f32 *states = arena_push_zero<f32>(scratch, total * 4);
+    EnsembleGpuParams *params = arena_push_zero<EnsembleGpuParams>(scratch, ens.member_count);
+    for (usize m = 0; m < ens.member_count; m++) {
+        const NeuronModelParams &model = ens.params[m];
+        for (usize i = ens.offsets[m]; i < ens.offsets[m + 1]; i++) {
+            states[i * 4 + 0] = neuron_model_initial_potential(model);
+            states[i * 4 + 1] = neuron_model_initial_recovery(model);
+        }
+
+        EnsembleGpuParams &gpu = params[m];
+        gpu.input_gain = model.input_gain;
+        gpu.inverse_tau = 1.0f / model.tau; // rounded as the CPU kernel
+        gpu.v_rest = model.v_rest;
+        gpu.v_reset = model.v_reset;
+        gpu.refractory_ticks = model.refractory_ticks;
+        gpu.a = model.a;
+        gpu.b = model.b;
+        gpu.c = model.c;
+        gpu.d = model.d;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ens.net.state_buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, total * 4 * sizeof(f32), states);
+
+    glGenBuffers(1, &ens.member_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ens.member_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, total * sizeof(u32), ens.member_of, GL_STATIC_DRAW);
+
+    glGenBuffers(1, &ens.param_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ens.param_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, ens.member_count * sizeof(EnsembleGpuParams), params, GL_STATIC_DRAW);
+
+    arena_restore(scratch, mark);
+}
+
+void ensemble_tick(Ensemble &ens) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ENSEMBLE_MEMBER_BINDING, ens.member_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ENSEMBLE_PARAM_BINDING, ens.param_buffer);
+    network_tick(ens.net);
+}
+
+void ensemble_stats_init(EnsembleStats &stats, const Ensemble &ens) {
+    stats.ticks = 0;
+    stats.spikes = (u64 *)calloc(ens.member_count, sizeof(u64));
+    stats.peak_spikes = (u32 *)calloc(ens.member_count, sizeof(u32));
+    stats.active_ticks = (u32 *)calloc(ens.member_count, sizeof(u32));
+    stats.activation_sum = (f64 *)calloc(ens.member_count, sizeof(f64));
+}
+
+void ensemble_stats_deinit(EnsembleStats &stats) {
+    free(stats.spikes);
+    free(stats.peak_spikes);
+    free(stats.active_ticks);
+    free(stats.activation_sum);
+}
+
+// Activation of packed neuron i is values[i * stride], a spike sets it to exactly 1
+static void ensemble_record_values(EnsembleStats &stats, const Ensemble &ens, const f32 *values, usize stride) {
+    for (usize m = 0; m < ens.member_count; m++) {
+        u32 spikes = 0;
+        f64 sum = 0.0;
+        for (usize i = ens.offsets[m]; i < ens.offsets[m] + ens.sizes[m]; i++) {
+            f32 activation = values[i * stride];
+            spikes += activation >= 1.0f;
+            sum += activation;
+        }
+        stats.spikes[m] += spikes;
+        if (spikes > stats.peak_spikes[m]) stats.peak_spikes[m] = spikes;
+        stats.active_ticks[m] += spikes > 0;
+        if (ens.sizes[m]) stats.activation_sum[m] += sum / ens.sizes[m];
+    }
+    stats.ticks++;
+}
+
+void ensemble_record(EnsembleStats &stats, const Ensemble &ens, const CpuSim &sim) {
+    if (!sim.binary) {
+        ensemble_record_values(stats, ens, sim.activation, 1);
+        return;
+    }
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    f32 *values = arena_push<f32>(scratch, sim.neuron_count);
+    for (usize i = 0; i < sim.neuron_count; i++) values[i] = cpu_sim_activation(sim, i);
+    ensemble_record_values(stats, ens, values, 1);
+    arena_restore(scratch, mark);
+}
+
+void ensemble_record_gpu(EnsembleStats &stats, const Ensemble &ens) {
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    usize size = ens.net.neuron_count * 4 * sizeof(f32);
+    f32 *neurons = arena_push<f32>(scratch, ens.net.neuron_count * 4);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ens.net.neuron_buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, neurons);
+    ensemble_record_values(stats, ens, neurons + 2, 4);
+    arena_restore(scratch, mark);
+}
+
+bool ensemble_write_csv(const Ensemble &ens, const EnsembleStats &stats, const char *path, const char *engine,
+                        bool append) {
+    FILE *file = file_open(path, append ? "ab" : "wb");
+    if (!file) {
+        error("Failed to open %s", path);
+        return false;
+    }
+
+    const char *models[] = {"threshold", "lif", "izhikevich"};
+    if (!append) {
+        fprintf(file, "engine,member,neurons,model,input_gain,tau,v_rest,v_reset,refractory_ticks,a,b,c,d,ticks,spikes,"
+                      "rate,peak_fraction,active_fraction,mean_activation\n");
+    }
+    for (usize m = 0; m < ens.member_count; m++) {
+        const NeuronModelParams &p = ens.params[m];
+        f64 neurons = ens.sizes[m] ? (f64)ens.sizes[m] : 1.0;
+        f64 ticks = stats.ticks ? (f64)stats.ticks : 1.0;
+        fprintf(file, "%s,%zu,%zu,%s,%g,%g,%g,%g,%g,%g,%g,%g,%g,%zu,%llu,%.6g,%.6g,%.6g,%.6g\n", engine, m,
+                ens.sizes[m], models[p.model], p.input_gain, p.tau, p.v_rest, p.v_reset, p.refractory_ticks, p.a, p.b,
+                p.c, p.d, stats.ticks, (unsigned long long)stats.spikes[m], stats.spikes[m] / (neurons * ticks),
+                stats.peak_spikes[m] / neurons, stats.active_ticks[m] / ticks, stats.activation_sum[m] / ticks);
+    }
+    file_close(file);
+    return true;
+}
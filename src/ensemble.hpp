@@ -0,0 +1,71 @@
+#pragma once
+
+#include "core/types.h"
+#include "cpu_sim.hpp"
+#include "neural_net.hpp"
+
+#define ENSEMBLE_MEMBER_BINDING 18
+#define ENSEMBLE_PARAM_BINDING 19
+
+// Model parameters of one member as the tick shader reads them, three vec4s
+struct EnsembleGpuParams {
+    f32 input_gain, inverse_tau, v_rest, v_reset;
+    f32 refractory_ticks, a, b, c;
+    f32 d, unused[3];
+};
+
+// Many small independent networks packed back to back into one Network, so the whole ensemble ticks in one dispatch
+// or one parallel loop instead of one per member. Member m owns neurons [offsets[m], offsets[m + 1]), its synapse
+// targets are rebased onto that range and no row reaches into another member. Members are padded to whole SIMD
+// vectors with unconnected neurons that never fire, so a vector of the CPU tick never straddles two members.
+//
+// All members run the same model but each with its own parameters: the CPU tick looks them up per vector, the
+// compute shader per neuron from two extra buffers.
+struct Ensemble {
+    usize member_count;
+    usize *offsets;            // member_count + 1
+    usize *sizes;              // neurons of each member without its padding
+    NeuronModelParams *params; // per member
+    u32 *member_of;            // member of each packed neuron, padding included
+
+    Network net;
+
+    // GPU copy of member_of and of params as EnsembleGpuParams, 0 until ensemble_upload
+    GLuint member_buffer;
+    GLuint param_buffer;
+};
+
+// Per-member summary of a run, accumulated one tick at a time
+struct EnsembleStats {
+    usize ticks;
+    u64 *spikes;         // over all ticks
+    u32 *peak_spikes;    // most neurons firing in a single tick
+    u32 *active_ticks;   // ticks with at least one spike
+    f64 *activation_sum; // mean activation of each tick, summed
+};
+
+// Copies the host arrays of count networks, which must all run params[m].model. Delays are packed too when any member
+// has them. Fails when the models differ. The ensemble ticks in precision on both engines.
+bool ensemble_init(Ensemble &ens, const Network *members, const NeuronModelParams *params, usize count,
+                   KernelPrecision precision = KernelPrecisionF32);
+void ensemble_deinit(Ensemble &ens);
+
+// CPU engine: a sim of the packed network starting every member from its own model's initial state
+void ensemble_sim_init(const Ensemble &ens, CpuSim &sim);
+void ensemble_tick_cpu(const Ensemble &ens, CpuSim &sim);
+
+// GPU engine: uploads the packed network with the member buffers and selects the ensemble kernel
+void ensemble_upload(Ensemble &ens);
+void ensemble_tick(Ensemble &ens);
+
+void ensemble_stats_init(EnsembleStats &stats, const Ensemble &ens);
+void ensemble_stats_deinit(EnsembleStats &stats);
+// Adds the spikes and activations of the tick just run
+void ensemble_record(EnsembleStats &stats, const Ensemble &ens, const CpuSim &sim);
+// Reads the activations back from the GPU, which waits for the ticks in flight
+void ensemble_record_gpu(EnsembleStats &stats, const Ensemble &ens);
+
+// One row per member: its parameters, then rates over the recorded ticks. engine goes into the first column so the
+// CPU and GPU runs of a sweep can share a file, append adds rows to an existing one without the header.
+bool ensemble_write_csv(const Ensemble &ens, const EnsembleStats &stats, const char *path, const char *engine,
+                        bool append = false);
@@ -0,0 +1,212 @@
+#include "gpu_stats.hpp"
+
+#include "core/arena.h"
+#include "core/logger.h"
+#include "shader.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+// GL_KHR_shader_subgroup, not in the generated loader
+#define GL_SUBGROUP_SUPPORTED_STAGES_KHR 0x9533
+#define GL_SUBGROUP_SUPPORTED_FEATURES_KHR 0x9534
+#define GL_SUBGROUP_FEATURE_BASIC_BIT_KHR 0x1
+#define GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR 0x4
+
+#define GPU_STATS_PASS_NEURONS 0
+#define GPU_STATS_PASS_WEIGHTS 1
+#define GPU_STATS_PASS_FINAL 2
+
+static_assert(sizeof(GpuStatsRecord) == 48 + 2 * GPU_STATS_BINS * sizeof(u32), "record must match std430");
+
+static bool gpu_stats_has_subgroups() {
+    if (!shader_has_extension("GL_KHR_shader_subgroup")) return false;
+    GLint stages = 0, features = 0;
+    glGetIntegerv(GL_SUBGROUP_SUPPORTED_STAGES_KHR, &stages);
+    glGetIntegerv(GL_SUBGROUP_SUPPORTED_FEATURES_KHR, &features);
+    GLint needed = GL_SUBGROUP_FEATURE_BASIC_BIT_KHR | GL_SUBGROUP_FEATURE_ARITHMETIC_BIT_KHR;
+    return (stages & GL_COMPUTE_SHADER_BIT) && (features & needed) == needed;
+}
+
+static usize gpu_stats_groups(const GpuStats &stats) {
+    usize per_group = GPU_STATS_WORKGROUP * GPU_STATS_ITEMS;
+    return (stats.neuron_count + per_group - 1) / per_group;
+}
+
+static GLuint gpu_stats_compile(const GpuStats &stats, int pass) {
+    char preamble[SHADER_PREAMBLE_LENGTH];
+    snprintf(preamble, sizeof(preamble),
+             "#version 430\n"
+             "#define STATS_PASS %d\n"
+             "#define STATS_BINS %d\n"
+             "#define ITEMS %d\n"
+             "#define MAX_SYNAPSES %d\n"
+             "#define SUBGROUPS %d\n",
+             pass, GPU_STATS_BINS, GPU_STATS_ITEMS, MAX_SYNAPSES, stats.subgroups);
+    return shader_library_compute(global_shader_library, "stats.comp", preamble);
+}
+
+void gpu_stats_init(GpuStats &stats, const Network &net, f32 weight_min, f32 weight_max) {
+    memset(&stats, 0, sizeof(stats));
+    stats.neuron_count = net.neuron_count;
+    stats.weight_min = weight_min;
+    stats.weight_max = weight_max > weight_min ? weight_max : weight_min + 1.0f;
+    stats.subgroups = gpu_stats_has_subgroups();
+    for (usize probe = 0; probe < GPU_STATS_PROBES; probe++) stats.probes[probe] = stats.probed[probe] = -1;
+
+    stats.neuron_program = gpu_stats_compile(stats, GPU_STATS_PASS_NEURONS);
+    stats.weight_program = gpu_stats_compile(stats, GPU_STATS_PASS_WEIGHTS);
+    stats.final_program = gpu_stats_compile(stats, GPU_STATS_PASS_FINAL);
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u32 *kinds = arena_push<u32>(scratch, net.neuron_count);
+    for (usize i = 0; i < net.neuron_count; i++) {
+        kinds[i] = (u32)net.kind_data[i];
+        stats.neurons_of_kind[kinds[i]]++;
+    }
+    glGenBuffers(1, &stats.kind_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stats.kind_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, net.neuron_count * sizeof(u32), kinds, GL_STATIC_DRAW);
+    arena_restore(scratch, mark);
+
+    // A partial per workgroup of each of the two passes
+    usize groups = gpu_stats_groups(stats);
+    glGenBuffers(1, &stats.partial_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stats.partial_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, 2 * groups * 4 * sizeof(f32), nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &stats.record_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stats.record_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GpuStatsRecord), nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &stats.readback_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stats.readback_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, GPU_STATS_FRAMES * sizeof(GpuStatsRecord), nullptr, GL_STREAM_READ);
+
+    glGenBuffers(1, &stats.probe_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stats.probe_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, GPU_STATS_FRAMES * GPU_STATS_PROBES * 4 * sizeof(f32), nullptr,
+                 GL_STREAM_READ);
+
+    info("GPU stats: %zu neurons, %s reductions", net.neuron_count, stats.subgroups ? "subgroup" : "shared memory");
+}
+
+void gpu_stats_deinit(GpuStats &stats) {
+    for (usize i = 0; i < GPU_STATS_FRAMES; i++) {
+        if (stats.fences[i]) glDeleteSync(stats.fences[i]);
+    }
+    GLuint buffers[] = {stats.kind_buffer, stats.partial_buffer, stats.record_buffer, stats.readback_buffer,
+                        stats.probe_buffer};
+    glDeleteBuffers(5, buffers);
+    memset(&stats, 0, sizeof(stats));
+}
+
+void gpu_stats_record(GpuStats &stats, const Network &net, bool weights) {
+    if (stats.pending == GPU_STATS_FRAMES) {
+        stats.dropped++;
+        return;
+    }
+    weights = weights && net.format.weights == WeightFormatF32 && net.format.targets == TargetFormatI32;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stats.record_buffer);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_STATS_KIND_BINDING, stats.kind_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_STATS_PARTIAL_BINDING, stats.partial_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GPU_STATS_RECORD_BINDING, stats.record_buffer);
+
+    GLuint groups = (GLuint)gpu_stats_groups(stats);
+    glUseProgram(stats.neuron_program);
+    glUniform1ui(glGetUniformLocation(stats.neuron_program, "count"), (GLuint)stats.neuron_count);
+    glDispatchCompute(groups, 1, 1);
+
+    if (weights) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, net.synapse_buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, net.weight_buffer);
+        glUseProgram(stats.weight_program);
+        glUniform1ui(glGetUniformLocation(stats.weight_program, "count"), (GLuint)stats.neuron_count);
+        glUniform1f(glGetUniformLocation(stats.weight_program, "weight_min"), stats.weight_min);
+        glUniform1f(glGetUniformLocation(stats.weight_program, "weight_scale"),
+                    GPU_STATS_BINS / (stats.weight_max - stats.weight_min));
+        glDispatchCompute(groups, 1, 1);
+    }
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    glUseProgram(stats.final_program);
+    glUniform1ui(glGetUniformLocation(stats.final_program, "count"), groups);
+    glUniform1ui(glGetUniformLocation(stats.final_program, "weight_groups"), weights ? groups : 0);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    usize slot = (stats.head + stats.pending) % GPU_STATS_FRAMES;
+    glBindBuffer(GL_COPY_READ_BUFFER, stats.record_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stats.readback_buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, slot * sizeof(GpuStatsRecord),
+                        sizeof(GpuStatsRecord));
+    glBindBuffer(GL_COPY_READ_BUFFER, net.neuron_buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stats.probe_buffer);
+    for (usize probe = 0; probe < GPU_STATS_PROBES; probe++) {
+        i32 index = stats.probes[probe];
+        stats.slot_probes[slot][probe] = index;
+        if (index < 0) continue;
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (usize)index * 4 * sizeof(f32),
+                            (slot * GPU_STATS_PROBES + probe) * 4 * sizeof(f32), 4 * sizeof(f32));
+    }
+    stats.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stats.with_weights[slot] = weights;
+    stats.pending++;
+    stats.recorded++;
+}
+
+static void gpu_stats_push_history(GpuStats &stats) {
+    const GpuStatsRecord &record = stats.latest;
+    usize slot = (stats.history_head + stats.history_count) % GPU_STATS_HISTORY;
+    if (stats.history_count < GPU_STATS_HISTORY) {
+        stats.history_count++;
+    } else {
+        stats.history_head = (stats.history_head + 1) % GPU_STATS_HISTORY;
+    }
+
+    stats.history[GpuStatsMeanActivation][slot] = gpu_stats_mean_activation(stats);
+    for (int kind = 0; kind < 3; kind++) {
+        u32 neurons = stats.neurons_of_kind[kind];
+        stats.history[GpuStatsFiredInput + kind][slot] = neurons ? (f32)record.fired[kind] / neurons : 0.0f;
+    }
+}
+
+usize gpu_stats_poll(GpuStats &stats) {
+    usize arrived = 0;
+    while (stats.pending) {
+        GLsync fence = stats.fences[stats.head];
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_TIMEOUT_EXPIRED) break;
+        if (status == GL_WAIT_FAILED) error("GPU stats fence wait failed");
+        glDeleteSync(fence);
+        stats.fences[stats.head] = 0;
+
+        glBindBuffer(GL_COPY_READ_BUFFER, stats.readback_buffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, stats.head * sizeof(GpuStatsRecord), sizeof(GpuStatsRecord),
+                           &stats.latest);
+        if (stats.with_weights[stats.head]) stats.latest_weights = stats.latest;
+        glBindBuffer(GL_COPY_READ_BUFFER, stats.probe_buffer);
+        glGetBufferSubData(GL_COPY_READ_BUFFER, stats.head * GPU_STATS_PROBES * 4 * sizeof(f32),
+                           GPU_STATS_PROBES * 4 * sizeof(f32), stats.probed_data);
+        memcpy(stats.probed, stats.slot_probes[stats.head], sizeof(stats.probed));
+        gpu_stats_push_history(stats);
+
+        stats.head = (stats.head + 1) % GPU_STATS_FRAMES;
+        stats.pending--;
+        stats.received++;
+        arrived++;
+    }
+    return arrived;
+}
+
+void gpu_stats_probe(GpuStats &stats, usize probe, i32 index) {
+    stats.probes[probe] = index < 0 || (usize)index >= stats.neuron_count ? -1 : index;
+}
+
+bool gpu_stats_probes_stale(const GpuStats &stats) {
+    return memcmp(stats.probes, stats.probed, sizeof(stats.probes)) != 0;
+}
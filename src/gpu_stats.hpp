@@ -0,0 +1,99 @@
+#pragma once
+
+#include "core/types.h"
+#include "neural_net.hpp"
+
+#define GPU_STATS_BINS 32
+#define GPU_STATS_WORKGROUP 256 // WORKGROUP_SIZE of stats.comp
+#define GPU_STATS_ITEMS 16      // neurons, or rows, each invocation reduces before the workgroup does
+#define GPU_STATS_FRAMES 4      // records in flight, a record is read back once its fence signals
+#define GPU_STATS_HISTORY 240   // records kept for the plots
+#define GPU_STATS_PROBES 2      // neurons read back with every record, the hovered and selected ones in the viewer
+#define GPU_STATS_KIND_BINDING 22
+#define GPU_STATS_PARTIAL_BINDING 23
+#define GPU_STATS_RECORD_BINDING 24
+
+// Reduction of one tick as stats.comp writes it, std430
+struct GpuStatsRecord {
+    f32 activation_sum[4];               // per Neuron::Kind, then over all neurons
+    u32 fired[4];                        // neurons at activation 1, per kind and in total
+    f32 weight_sum[4];                   // sum, sum of squares and count of the present synapses
+    u32 activation_bins[GPU_STATS_BINS]; // [0, 1]
+    u32 weight_bins[GPU_STATS_BINS];     // [weight_min, weight_max], outliers in the end bins
+};
+
+// Series of the plots, one value per record
+enum GpuStatsSeries {
+    GpuStatsMeanActivation,
+    GpuStatsFiredInput, // fraction of the kind's neurons that fired
+    GpuStatsFiredHidden,
+    GpuStatsFiredOutput,
+    GpuStatsSeriesCount,
+};
+
+// Network-wide aggregates computed on the GPU, so following a run costs a few hundred bytes of readback per tick
+// instead of the whole neuron buffer. gpu_stats_record reduces the current activations, and every so often the
+// weights, into a small record with a tree reduction in stats.comp, subgroup arithmetic first where the driver has
+// GL_KHR_shader_subgroup. The record is copied into a ring of GPU_STATS_FRAMES readback slots behind a fence and
+// gpu_stats_poll reads those whose fence has signalled, so neither side ever waits for the other. A full ring drops
+// the tick's record instead.
+//
+// Probed neurons ride along: their four floats of the neuron buffer are copied next to the record, so inspecting a
+// neuron never stalls on glGetBufferSubData either.
+struct GpuStats {
+    usize neuron_count;
+    u32 neurons_of_kind[3];
+    f32 weight_min, weight_max;
+    bool subgroups;
+
+    GLuint neuron_program;
+    GLuint weight_program;
+    GLuint final_program;
+    GLuint kind_buffer;
+    GLuint partial_buffer;
+    GLuint record_buffer;
+    GLuint readback_buffer; // GPU_STATS_FRAMES records
+    GLuint probe_buffer;    // GPU_STATS_FRAMES * GPU_STATS_PROBES neurons
+    i32 probes[GPU_STATS_PROBES]; // neuron indices, -1 for none
+
+    GLsync fences[GPU_STATS_FRAMES];
+    bool with_weights[GPU_STATS_FRAMES];
+    i32 slot_probes[GPU_STATS_FRAMES][GPU_STATS_PROBES]; // probes as they were when the slot was recorded
+    usize head;    // oldest slot in flight
+    usize pending; // slots in flight
+    usize recorded;
+    usize dropped;
+
+    // Host side, updated by gpu_stats_poll
+    GpuStatsRecord latest;
+    GpuStatsRecord latest_weights; // last record that reduced the weights
+    i32 probed[GPU_STATS_PROBES];  // neuron each probed_data entry belongs to, -1 until one arrives
+    f32 probed_data[GPU_STATS_PROBES][4];
+    usize received;
+    f32 history[GpuStatsSeriesCount][GPU_STATS_HISTORY]; // ring, oldest at history_head once full
+    usize history_head;
+    usize history_count;
+};
+
+// Needs a current context and an uploaded network. Weights are binned over [weight_min, weight_max].
+void gpu_stats_init(GpuStats &stats, const Network &net, f32 weight_min, f32 weight_max);
+void gpu_stats_deinit(GpuStats &stats);
+
+// Reduces the activations the last tick left, and the weights too when asked. Weights need the default f32 weights
+// and 32-bit targets on the GPU, other formats skip them.
+void gpu_stats_record(GpuStats &stats, const Network &net, bool weights = false);
+// Reads back every record that is ready, returns how many arrived
+usize gpu_stats_poll(GpuStats &stats);
+
+// Follows neuron index (-1 for none) in probe slot probe from the next record on
+void gpu_stats_probe(GpuStats &stats, usize probe, i32 index);
+// True while some probe changed and no record holding it has arrived, a paused caller records once to fetch it
+bool gpu_stats_probes_stale(const GpuStats &stats);
+// Latest readback of the probed neuron, null while index is not probed or its first record is still in flight
+static inline const f32 *gpu_stats_probed(const GpuStats &stats, usize probe, i32 index) {
+    return index >= 0 && stats.probed[probe] == index ? stats.probed_data[probe] : nullptr;
+}
+
+static inline f32 gpu_stats_mean_activation(const GpuStats &stats) {
+    return stats.neuron_count ? stats.latest.activation_sum[3] / stats.neuron_count : 0.0f;
+}
@@ -0,0 +1,185 @@
+#include "inference.hpp"
+
+#include "core/arena.h"
+#include "core/logger.h"
+#include "core/parallel.h"
+#include "core/simd.h"
+
+#include <cstdlib>
+#include <cstring>
+
+// Longest path from an input, by relaxation. Levels only grow, so a cycle shows up as still changing after
+// INFERENCE_MAX_LAYERS rounds.
+static bool inference_levels(const Network &net, u32 *level) {
+    usize n = net.neuron_count;
+    for (usize i = 0; i < n; i++) level[i] = net.kind_data[i] == Neuron::Input ? 0 : 1;
+
+    for (int round = 0; round < INFERENCE_MAX_LAYERS; round++) {
+        bool changed = false;
+        for (usize i = 0; i < n; i++) {
+            if (net.kind_data[i] == Neuron::Input) continue;
+            u32 deepest = 0;
+            for (int j = 0; j < MAX_SYNAPSES; j++) {
+                i32 target = net.synapse_data[i * MAX_SYNAPSES + j];
+                if (target >= 0 && level[target] > deepest) deepest = level[target];
+            }
+            if (deepest + 1 != level[i]) {
+                level[i] = deepest + 1;
+                changed = true;
+            }
+        }
+        if (!changed) return true;
+    }
+    return false;
+}
+
+bool inference_init(Inference &inf, const Network &net, usize batch, InferenceActivation activation) {
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+
+    usize n = net.neuron_count;
+    u32 *level = arena_push<u32>(scratch, n);
+    if (!inference_levels(net, level)) {
+        error("Network is cyclic or deeper than %d layers, it cannot run feed-forward", INFERENCE_MAX_LAYERS);
+        arena_restore(scratch, mark);
+        return false;
+    }
+
+    inf.neuron_count = n;
+    inf.batch = batch;
+    inf.tile = (batch + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    if (inf.tile > INFERENCE_TILE) inf.tile = INFERENCE_TILE;
+    inf.stride = (batch + inf.tile - 1) / inf.tile * inf.tile;
+    inf.activation = activation;
+
+    // Counting sort by level, network order kept within a layer
+    inf.layer_count = 0;
+    memset(inf.layer_bounds, 0, sizeof(inf.layer_bounds));
+    for (usize i = 0; i < n; i++) {
+        inf.layer_bounds[level[i] + 1]++;
+        if (level[i] + 1 > inf.layer_count) inf.layer_count = level[i] + 1;
+    }
+    for (usize l = 0; l < inf.layer_count; l++) inf.layer_bounds[l + 1] += inf.layer_bounds[l];
+
+    u32 *position = arena_push<u32>(scratch, n);
+    usize *cursor = arena_push<usize>(scratch, inf.layer_count);
+    memcpy(cursor, inf.layer_bounds, inf.layer_count * sizeof(usize));
+    inf.order = (u32 *)malloc(n * sizeof(u32));
+    for (usize i = 0; i < n; i++) {
+        position[i] = (u32)cursor[level[i]]++;
+        inf.order[position[i]] = (u32)i;
+    }
+
+    inf.offsets = (u32 *)malloc((n + 1) * sizeof(u32));
+    inf.targets = (u32 *)malloc(n * MAX_SYNAPSES * sizeof(u32));
+    inf.weights = (f32 *)malloc(n * MAX_SYNAPSES * sizeof(f32));
+    inf.thresholds = (f32 *)malloc(n * sizeof(f32));
+    u32 count = 0;
+    for (usize p = 0; p < n; p++) {
+        u32 i = inf.order[p];
+        inf.offsets[p] = count;
+        inf.thresholds[p] = net.neuron_data[i * 4 + 3];
+        if (net.kind_data[i] == Neuron::Input) continue; // inputs are set, not computed
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            i32 target = net.synapse_data[i * MAX_SYNAPSES + j];
+            if (target < 0) continue;
+            inf.targets[count] = position[target];
+            inf.weights[count] = net.weight_data[i * MAX_SYNAPSES + j];
+            count++;
+        }
+    }
+    inf.offsets[n] = count;
+
+    inf.input_count = inf.output_count = 0;
+    inf.inputs = (u32 *)malloc(n * sizeof(u32));
+    inf.outputs = (u32 *)malloc(n * sizeof(u32));
+    for (usize id = 0; id < n; id++) {
+        usize i = network_index_of(net, id);
+        if (net.kind_data[i] == Neuron::Input) inf.inputs[inf.input_count++] = position[i];
+        if (net.kind_data[i] == Neuron::Output) inf.outputs[inf.output_count++] = position[i];
+    }
+
+    inf.values = (f32 *)calloc(n * inf.stride, sizeof(f32));
+
+    arena_restore(scratch, mark);
+    return true;
+}
+
+void inference_deinit(Inference &inf) {
+    free(inf.order);
+    free(inf.offsets);
+    free(inf.targets);
+    free(inf.weights);
+    free(inf.thresholds);
+    free(inf.inputs);
+    free(inf.outputs);
+    free(inf.values);
+}
+
+// One tile of one row, the accumulators stay in registers across the row's synapses
+template <u32 Vectors, InferenceActivation Activation>
+static inline void inference_block(const Inference &inf, const f32 *tile, f32 *out, usize row) {
+    f32x8 sum[Vectors];
+    for (u32 v = 0; v < Vectors; v++) sum[v] = f32x8_set1(0.0f);
+
+    for (u32 e = inf.offsets[row]; e < inf.offsets[row + 1]; e++) {
+        f32x8 weight = f32x8_set1(inf.weights[e]);
+        const f32 *source = &tile[(usize)inf.targets[e] * Vectors * SIMD_WIDTH];
+        for (u32 v = 0; v < Vectors; v++) sum[v] = f32x8_fmadd(weight, f32x8_load(source + v * SIMD_WIDTH), sum[v]);
+    }
+
+    f32x8 threshold = f32x8_set1(inf.thresholds[row]);
+    for (u32 v = 0; v < Vectors; v++) {
+        f32x8 value = Activation == InferenceStep
+                          ? f32x8_select(f32x8_gt(sum[v], threshold), f32x8_set1(1.0f), f32x8_set1(0.0f))
+                          : f32x8_max(f32x8_sub(sum[v], threshold), f32x8_set1(0.0f));
+        f32x8_store(out + v * SIMD_WIDTH, value);
+    }
+}
+
+// Tile by tile, so the slice of the earlier layers a layer gathers from is only tile columns wide and stays in cache
+template <u32 Vectors, InferenceActivation Activation> static void inference_layers(Inference &inf) {
+    usize n = inf.neuron_count;
+    for (usize t = 0; t < inf.stride / inf.tile; t++) {
+        f32 *tile = &inf.values[t * n * inf.tile];
+        for (usize l = 1; l < inf.layer_count; l++) {
+            parallel_for(inf.layer_bounds[l], inf.layer_bounds[l + 1], INFERENCE_GRAIN, [&](usize begin, usize end) {
+                for (usize row = begin; row < end; row++) {
+                    inference_block<Vectors, Activation>(inf, tile, &tile[row * inf.tile], row);
+                }
+            });
+        }
+    }
+}
+
+template <InferenceActivation Activation> static void inference_tiles(Inference &inf) {
+    switch (inf.tile / SIMD_WIDTH) {
+    case 1: inference_layers<1, Activation>(inf); break;
+    default: inference_layers<INFERENCE_TILE / SIMD_WIDTH, Activation>(inf); break;
+    }
+}
+
+void inference_run(Inference &inf, const f32 *inputs, f32 *outputs, usize sample_count) {
+    if (sample_count > inf.batch) sample_count = inf.batch;
+
+    // Samples arrive one after another, the layers want one row per neuron across the batch. Sample by sample, so
+    // the reads are sequential and each write lands in the same column of one tile.
+    for (usize b = 0; b < inf.stride; b++) {
+        f32 *column = inference_value(inf, 0, b);
+        for (usize k = 0; k < inf.input_count; k++) {
+            column[inf.inputs[k] * inf.tile] = b < sample_count ? inputs[b * inf.input_count + k] : 0.0f;
+        }
+    }
+
+    if (inf.activation == InferenceStep) {
+        inference_tiles<InferenceStep>(inf);
+    } else {
+        inference_tiles<InferenceRelu>(inf);
+    }
+
+    for (usize b = 0; b < sample_count; b++) {
+        const f32 *column = inference_value(inf, 0, b);
+        f32 *sample = &outputs[b * inf.output_count];
+        for (usize k = 0; k < inf.output_count; k++) sample[k] = column[inf.outputs[k] * inf.tile];
+    }
+}
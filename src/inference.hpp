@@ -0,0 +1,62 @@
+#pragma once
+
+#include "core/types.h"
+#include "neural_net.hpp"
+
+#define INFERENCE_MAX_LAYERS 64
+#define INFERENCE_GRAIN 64 // rows per thread task
+#define INFERENCE_TILE 16  // batch columns per tile, held in registers while a row is summed
+
+// Response of a non-input neuron to its summed input in a feed-forward pass
+enum InferenceActivation {
+    InferenceStep, // 1 above the neuron's threshold, else 0, as the threshold model spikes
+    InferenceRelu, // max(sum - threshold, 0)
+};
+
+// The network as a feed-forward model evaluated on a batch of samples at once. Input neurons are layer 0, every
+// other neuron is one layer past the deepest neuron it reads, so rows within a layer are independent. Rows are
+// stored in that order as CSR with targets renumbered to it. A layer is then a sparse x dense multiply: each synapse
+// multiplies a contiguous tile of batch columns of its source by one weight, so the rows are read once per tile
+// instead of once per sample. values is tile-major, tile t of the neuron at position p starts at
+// (t * neuron_count + p) * tile.
+//
+// Tiles are two SIMD vectors at most. Wider tiles spill their accumulators at -O2 and widen the slice of the earlier
+// layers a row gathers from past the cache, 32 columns ran at about half the rate per sample.
+struct Inference {
+    usize neuron_count;
+    usize batch;
+    usize tile;   // batch columns per tile, whole SIMD vectors up to INFERENCE_TILE
+    usize stride; // batch padded to whole tiles
+    InferenceActivation activation;
+
+    usize layer_count;
+    usize layer_bounds[INFERENCE_MAX_LAYERS + 1]; // positions of layer l are [layer_bounds[l], layer_bounds[l + 1])
+    u32 *order;                                   // neuron index at each position
+
+    u32 *offsets; // neuron_count + 1
+    u32 *targets; // positions
+    f32 *weights;
+    f32 *thresholds;
+
+    // Input and Output neurons by ID, as positions. Sample tensors list their values in this order.
+    usize input_count;
+    usize output_count;
+    u32 *inputs;
+    u32 *outputs;
+
+    f32 *values; // neuron_count * stride
+};
+
+static inline f32 *inference_value(const Inference &inf, usize position, usize column) {
+    usize t = column / inf.tile;
+    return &inf.values[(t * inf.neuron_count + position) * inf.tile + column % inf.tile];
+}
+
+// Fails when the synapse graph between non-input neurons has a cycle or is deeper than INFERENCE_MAX_LAYERS. Rows
+// are copied, later edits to the network are not seen.
+bool inference_init(Inference &inf, const Network &net, usize batch, InferenceActivation activation = InferenceStep);
+void inference_deinit(Inference &inf);
+
+// inputs holds batch samples of input_count values, outputs receives batch samples of output_count values. Fewer
+// than batch samples may be passed, the rest of the batch is computed on zeros.
+void inference_run(Inference &inf, const f32 *inputs, f32 *outputs, usize sample_count);
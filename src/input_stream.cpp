@@ -0,0 +1,294 @@
+#include "input_stream.hpp"
+
+#include "core/file.h"
+#include "core/logger.h"
+#include "shader.hpp"
+#include "streaming.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#define IDX_TYPE_U8 0x08
+
+// IDX: two zero bytes, the element type, the dimension count, then each dimension as a big-endian u32
+static bool input_stream_read_idx_header(InputStream &stream) {
+    u8 magic[4];
+    if (fread(magic, 1, 4, stream.file) != 4 || magic[0] || magic[1] || magic[3] == 0) {
+        error("Not an IDX file");
+        return false;
+    }
+    if (magic[2] != IDX_TYPE_U8) {
+        error("IDX element type 0x%02x is not supported, only u8", magic[2]);
+        return false;
+    }
+
+    stream.sample_size = 1;
+    for (u32 d = 0; d < magic[3]; d++) {
+        u8 be[4];
+        if (fread(be, 1, 4, stream.file) != 4) {
+            error("Truncated IDX header");
+            return false;
+        }
+        usize dim = (usize)be[0] << 24 | (usize)be[1] << 16 | (usize)be[2] << 8 | be[3];
+        if (d == 0) {
+            stream.samples = dim;
+        } else {
+            stream.sample_size *= dim;
+        }
+    }
+    return true;
+}
+
+static bool input_stream_read_sample(InputStream &stream) {
+    if (fread(stream.sample, 1, stream.sample_size, stream.file) == stream.sample_size) return true;
+    if (!stream.params.loop || stream.data_offset < 0 || fseek(stream.file, stream.data_offset, SEEK_SET) != 0) {
+        return false;
+    }
+    return fread(stream.sample, 1, stream.sample_size, stream.file) == stream.sample_size;
+}
+
+static void input_stream_encode_tick(InputStream &stream, u32 *bits) {
+    memset(bits, 0, stream.words * sizeof(u32));
+    if (stream.params.encoding == InputEncodingPoisson) {
+        for (usize k = 0; k < stream.input_count; k++) {
+            if (rng_f32(stream.rng) < stream.rates[k]) bits[k / 32] |= 1u << (k % 32);
+        }
+        return;
+    }
+
+    for (usize k = 0; k < stream.input_count; k++) {
+        f32 phase = stream.phases[k] + stream.rates[k];
+        if (phase >= 1.0f) {
+            phase -= 1.0f;
+            bits[k / 32] |= 1u << (k % 32);
+        }
+        stream.phases[k] = phase;
+    }
+}
+
+// Fills batches until the source ends or the stream closes, blocking only on a full queue and on reads
+static void input_stream_read(InputStream &stream) {
+    usize batch_size = INPUT_STREAM_BATCH_TICKS * stream.words;
+    f32 rate_scale = stream.params.max_rate / 255.0f;
+    u32 sample_tick = 0;
+    bool ended = false;
+
+    while (!ended) {
+        usize slot;
+        {
+            std::unique_lock<std::mutex> lock(stream.mutex);
+            stream.space.wait(lock, [&] { return stream.stop || stream.ready < INPUT_STREAM_QUEUE; });
+            if (stream.stop) return;
+            slot = (stream.front + stream.ready) % INPUT_STREAM_QUEUE;
+        }
+
+        // A source that ends mid-batch leaves the rest of it silent
+        u32 *batch = &stream.batches[slot * batch_size];
+        memset(batch, 0, batch_size * sizeof(u32));
+        usize t = 0;
+        for (; t < INPUT_STREAM_BATCH_TICKS; t++) {
+            if (sample_tick == 0) {
+                if (!input_stream_read_sample(stream)) {
+                    ended = true;
+                    break;
+                }
+                for (usize k = 0; k < stream.input_count; k++) {
+                    stream.rates[k] = stream.sample[stream.byte_of[k]] * rate_scale;
+                }
+                stream.samples_read.fetch_add(1, std::memory_order_relaxed);
+            }
+            input_stream_encode_tick(stream, &batch[t * stream.words]);
+            sample_tick = (sample_tick + 1) % stream.params.ticks_per_sample;
+        }
+
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        if (t) stream.ready++;
+        stream.finished = ended;
+    }
+}
+
+bool input_stream_open(InputStream &stream, const char *path, const u32 *neurons, usize input_count,
+                       const InputStreamParams &params) {
+    bool pipe = strcmp(path, "-") == 0;
+    stream.file = pipe ? stdin : file_open(path, "rb");
+    if (!stream.file) {
+        error("Failed to open %s", path);
+        return false;
+    }
+
+    stream.params = params;
+    if (stream.params.ticks_per_sample == 0) stream.params.ticks_per_sample = 1;
+    stream.samples = 0;
+    if (params.format == InputFormatIdx) {
+        if (!input_stream_read_idx_header(stream)) {
+            if (!pipe) file_close(stream.file);
+            return false;
+        }
+    } else {
+        stream.sample_size = params.sample_size;
+    }
+    if (stream.sample_size == 0 || input_count == 0) {
+        error("Input stream needs a sample size and at least one input");
+        if (!pipe) file_close(stream.file);
+        return false;
+    }
+    stream.data_offset = pipe ? -1 : ftell(stream.file);
+
+    stream.input_count = input_count;
+    stream.words = (input_count + 31) / 32;
+    stream.neurons = (u32 *)malloc(input_count * sizeof(u32));
+    memcpy(stream.neurons, neurons, input_count * sizeof(u32));
+    stream.byte_of = (u32 *)malloc(input_count * sizeof(u32));
+    for (usize k = 0; k < input_count; k++) stream.byte_of[k] = (u32)(k * stream.sample_size / input_count);
+    stream.rates = (f32 *)calloc(input_count, sizeof(f32));
+    stream.phases = (f32 *)calloc(input_count, sizeof(f32));
+    stream.sample = (u8 *)malloc(stream.sample_size);
+    stream.rng = rng_create(params.seed);
+
+    stream.batches = (u32 *)malloc(INPUT_STREAM_QUEUE * INPUT_STREAM_BATCH_TICKS * stream.words * sizeof(u32));
+    stream.front = stream.ready = 0;
+    stream.finished = stream.stop = false;
+    stream.tick = INPUT_STREAM_BATCH_TICKS;
+    stream.consumed = stream.underruns = 0;
+    stream.samples_read = 0;
+    stream.program = stream.neuron_buffer = 0;
+    stream.batch_buffers[0] = stream.batch_buffers[1] = 0;
+    stream.holding = stream.prefetched = false;
+    stream.current = 0;
+
+    info("Streaming %zu-byte samples from %s into %zu inputs", stream.sample_size, pipe ? "stdin" : path, input_count);
+    stream.reader = std::thread(input_stream_read, std::ref(stream));
+    return true;
+}
+
+void input_stream_close(InputStream &stream) {
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.stop = true;
+    }
+    stream.space.notify_one();
+    stream.reader.join();
+    if (stream.file != stdin) file_close(stream.file);
+
+    if (stream.program) {
+        GLuint buffers[] = {stream.batch_buffers[0], stream.batch_buffers[1], stream.neuron_buffer};
+        glDeleteBuffers(3, buffers);
+    }
+    free(stream.neurons);
+    free(stream.byte_of);
+    free(stream.rates);
+    free(stream.phases);
+    free(stream.sample);
+    free(stream.batches);
+}
+
+usize input_stream_input_neurons(const Network &net, u32 *neurons, usize capacity) {
+    usize count = 0;
+    for (usize i = 0; i < net.neuron_count; i++) {
+        if (net.kind_data[i] != Neuron::Input) continue;
+        if (count < capacity) neurons[count] = (u32)i;
+        count++;
+    }
+    return count;
+}
+
+// Takes the front batch when the reader has one ready, never waits for it
+static const u32 *input_stream_take(InputStream &stream) {
+    std::lock_guard<std::mutex> lock(stream.mutex);
+    if (stream.ready == 0) return nullptr;
+    return &stream.batches[stream.front * INPUT_STREAM_BATCH_TICKS * stream.words];
+}
+
+static void input_stream_underrun(InputStream &stream) {
+    std::lock_guard<std::mutex> lock(stream.mutex);
+    if (!stream.finished) stream.underruns++;
+}
+
+static void input_stream_release(InputStream &stream) {
+    {
+        std::lock_guard<std::mutex> lock(stream.mutex);
+        stream.front = (stream.front + 1) % INPUT_STREAM_QUEUE;
+        stream.ready--;
+    }
+    stream.space.notify_one();
+    stream.consumed++;
+}
+
+void input_stream_tick_cpu(InputStream &stream, CpuSim &sim) {
+    if (stream.tick == INPUT_STREAM_BATCH_TICKS) {
+        // The batch stays queued while its ticks are read, so the reader cannot refill it underneath
+        if (stream.holding) input_stream_release(stream);
+        stream.holding = input_stream_take(stream) != nullptr;
+        if (!stream.holding) {
+            input_stream_underrun(stream);
+            return;
+        }
+        stream.tick = 0;
+    }
+
+    const u32 *bits = &stream.batches[(stream.front * INPUT_STREAM_BATCH_TICKS + stream.tick++) * stream.words];
+    for (usize k = 0; k < stream.input_count; k++) {
+        u32 neuron = stream.neurons[k];
+        bool spike = bits[k / 32] >> (k % 32) & 1;
+        if (sim.binary) {
+            u64 bit = 1ull << (neuron % 64);
+            sim.spikes[neuron / 64] = spike ? sim.spikes[neuron / 64] | bit : sim.spikes[neuron / 64] & ~bit;
+        } else {
+            sim.activation[neuron] = spike ? 1.0f : 0.0f;
+        }
+    }
+}
+
+void input_stream_upload(InputStream &stream) {
+    stream.program = shader_library_compute(global_shader_library, "input.comp");
+
+    usize batch_bytes = INPUT_STREAM_BATCH_TICKS * stream.words * sizeof(u32);
+    glGenBuffers(2, stream.batch_buffers);
+    for (GLuint buffer : stream.batch_buffers) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, batch_bytes, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glGenBuffers(1, &stream.neuron_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stream.neuron_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, stream.input_count * sizeof(u32), stream.neurons, GL_STATIC_DRAW);
+}
+
+// Copies the next ready batch into the buffer the ticks are not reading. The ring takes a copy right away, so the
+// host slot goes back to the reader at once.
+static void input_stream_prefetch(InputStream &stream) {
+    if (stream.prefetched) return;
+    const u32 *batch = input_stream_take(stream);
+    if (!batch) return;
+    stream_buffer_upload(global_stream_buffer, stream.batch_buffers[stream.current ^ 1], 0, batch,
+                         INPUT_STREAM_BATCH_TICKS * stream.words * sizeof(u32));
+    input_stream_release(stream);
+    stream.prefetched = true;
+}
+
+void input_stream_tick(InputStream &stream, Network &net) {
+    if (!stream.program) return;
+
+    if (stream.tick == INPUT_STREAM_BATCH_TICKS) {
+        input_stream_prefetch(stream);
+        if (!stream.prefetched) {
+            input_stream_underrun(stream);
+            return;
+        }
+        stream.current ^= 1;
+        stream.prefetched = false;
+        stream.tick = 0;
+    }
+    input_stream_prefetch(stream);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_SPIKE_BINDING, net.spike_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INPUT_STREAM_BATCH_BINDING, stream.batch_buffers[stream.current]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INPUT_STREAM_NEURON_BINDING, stream.neuron_buffer);
+    glUseProgram(stream.program);
+    glUniform1ui(glGetUniformLocation(stream.program, "count"), (GLuint)stream.input_count);
+    glUniform1ui(glGetUniformLocation(stream.program, "offset"), (GLuint)(stream.tick++ * stream.words));
+    glUniform1i(glGetUniformLocation(stream.program, "binary"), net.variant.binary);
+    glDispatchCompute((GLuint)((stream.input_count + 63) / 64), 1, 1);
+    // The tick copies the neurons with glCopyBufferSubData before its dispatch
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "core/random.h"
+#include "core/types.h"
+#include "cpu_sim.hpp"
+#include "neural_net.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#define INPUT_STREAM_BATCH_TICKS 16 // ticks of encoded spikes per batch
+#define INPUT_STREAM_QUEUE 4        // batches the reader may run ahead of the sim
+#define INPUT_STREAM_BATCH_BINDING 20
+#define INPUT_STREAM_NEURON_BINDING 21
+
+enum InputFormat {
+    InputFormatIdx, // u8 IDX file as in MNIST, one sample per entry of the first dimension
+    InputFormatRaw, // headerless u8 samples of sample_size bytes
+};
+
+enum InputEncoding {
+    InputEncodingPoisson, // independent spikes with probability intensity * max_rate every tick
+    InputEncodingRate,    // an accumulator per input, a spike whenever it crosses 1, so the same rate without noise
+};
+
+struct InputStreamParams {
+    InputFormat format;
+    InputEncoding encoding;
+    f32 max_rate;         // spikes per tick at intensity 255
+    u32 ticks_per_sample; // ticks each sample is presented for
+    usize sample_size;    // bytes per raw sample, IDX files give their own
+    bool loop;            // start a file over at its end, pipes end with the writer
+    u64 seed;
+};
+
+// Drives Input neurons from a dataset or a sensor stream. A reader thread reads samples from a file or a pipe ("-"
+// for stdin), encodes them as spikes and packs INPUT_STREAM_BATCH_TICKS ticks at a time into a bitset per tick, one
+// bit per input, into a queue of INPUT_STREAM_QUEUE batches. Input k reads byte k * sample_size / input_count of
+// each sample, so any input count can sample any image size.
+//
+// The sim side takes one tick of the front batch per tick and writes it into the driven neurons: activation 1 when
+// the input spikes and 0 when it does not, in the spike bitset too for binary ticks. It never waits for the reader, a
+// tick without a ready batch leaves the inputs alone and counts an underrun. On the GPU each batch is copied through
+// the streaming ring into one of two buffers while the ticks read the other, and one dispatch per tick scatters it.
+struct InputStream {
+    InputStreamParams params;
+    FILE *file;
+    long data_offset; // where samples start, for looping
+    usize sample_size;
+    usize samples; // in the file, 0 when unknown
+    usize input_count;
+    usize words; // u32 bitset words per tick
+
+    u32 *neurons; // neuron index of each input
+    u32 *byte_of; // sample byte of each input
+    f32 *rates;   // spike probability of each input for the current sample
+    f32 *phases;  // rate encoding accumulators
+    u8 *sample;
+    Rng rng;
+
+    // Queue of encoded batches, the reader fills slot (front + ready) % INPUT_STREAM_QUEUE
+    u32 *batches; // INPUT_STREAM_QUEUE * INPUT_STREAM_BATCH_TICKS * words
+    usize front;
+    usize ready;
+    bool finished; // the reader hit the end of a source it does not loop
+    bool stop;
+    std::mutex mutex;
+    std::condition_variable space;
+    std::thread reader;
+
+    // Sim side
+    usize tick;     // into the current batch, INPUT_STREAM_BATCH_TICKS when there is none
+    bool holding;   // the CPU engine reads the front batch in place, it stays queued until the next is taken
+    usize consumed; // batches taken
+    usize underruns;
+    std::atomic<u64> samples_read;
+
+    // GPU side, 0 until input_stream_upload
+    GLuint program;
+    GLuint batch_buffers[2];
+    GLuint neuron_buffer;
+    u32 current;     // batch buffer the ticks read
+    bool prefetched; // the other one holds the next batch
+};
+
+// Opens path and starts the reader. neurons lists the driven neurons, usually those of kind Input. Fails when the file
+// cannot be opened or its IDX header is not u8 data.
+bool input_stream_open(InputStream &stream, const char *path, const u32 *neurons, usize input_count,
+                       const InputStreamParams &params);
+// Stops the reader, which first finishes a read it is blocked in
+void input_stream_close(InputStream &stream);
+
+// Every neuron of kind Input, in index order. Returns the count, writes at most capacity.
+usize input_stream_input_neurons(const Network &net, u32 *neurons, usize capacity);
+
+// CPU engine: writes this tick's input into sim, call before cpu_sim_tick
+void input_stream_tick_cpu(InputStream &stream, CpuSim &sim);
+
+// GPU engine: needs a current context, call input_stream_upload once and input_stream_tick before network_tick
+void input_stream_upload(InputStream &stream);
+void input_stream_tick(InputStream &stream, Network &net);
@@ -0,0 +1,100 @@
+#include "kernel_variant.hpp"
+
+#include "neural_net.hpp"
+#include "shader.hpp"
+
+#include <cstdio>
+
+KernelCache global_kernel_cache;
+
+bool kernel_variant_equal(const KernelVariant &a, const KernelVariant &b) {
+    return a.model == b.model && a.precision == b.precision && a.fan_in == b.fan_in &&
+           a.workgroup_size == b.workgroup_size && a.decay == b.decay && a.weight_format == b.weight_format &&
+           a.target_format == b.target_format && a.binary == b.binary && a.sell_chunk == b.sell_chunk &&
+           a.delay_slots == b.delay_slots && a.ensemble == b.ensemble;
+}
+
+u32 network_fan_in(const Network &net) {
+    u32 widest = 0;
+    for (usize i = 0; i < net.neuron_count; i++) {
+        for (u32 j = widest; j < MAX_SYNAPSES; j++) {
+            if (net.synapse_data[i * MAX_SYNAPSES + j] >= 0) widest = j + 1;
+        }
+    }
+
+    if (widest <= 4) return 4;
+    if (widest <= 8) return 8;
+    return MAX_SYNAPSES;
+}
+
+KernelVariant kernel_variant_for(const Network &net) {
+    KernelVariant variant;
+    variant.model = net.model.model;
+    variant.precision = KernelPrecisionF32;
+    variant.fan_in = network_fan_in(net);
+    variant.workgroup_size = KERNEL_WORKGROUP_SIZE;
+    variant.decay = KERNEL_DECAY;
+    variant.weight_format = net.format.weights;
+    variant.target_format = net.format.targets;
+    variant.binary = false;
+    variant.sell_chunk = 0;
+    variant.delay_slots = net.delay_data ? net.delay_slots : 0;
+    variant.ensemble = false;
+    return variant;
+}
+
+usize kernel_variant_preamble(const KernelVariant &variant, char *out, usize capacity) {
+    int written = snprintf(out, capacity,
+                           "#version 430\n"
+                           "#define MAX_SYNAPSES %d\n"
+                           "#define FAN_IN %u\n"
+                           "#define WORKGROUP_SIZE %u\n"
+                           "#define DECAY %.9g\n"
+                           "#define MODEL_THRESHOLD %d\n"
+                           "#define MODEL_LIF %d\n"
+                           "#define MODEL_IZHIKEVICH %d\n"
+                           "#define MODEL %d\n"
+                           "#define PRECISION_F64 %d\n"
+                           "#define PRECISION_STRICT %d\n"
+                           "#define WEIGHT_FORMAT_F32 %d\n"
+                           "#define WEIGHT_FORMAT_F16 %d\n"
+                           "#define WEIGHT_FORMAT_Q8 %d\n"
+                           "#define WEIGHT_FORMAT %d\n"
+                           "#define TARGET_FORMAT_I32 %d\n"
+                           "#define TARGET_FORMAT_U16 %d\n"
+                           "#define TARGET_FORMAT %d\n"
+                           "#define BINARY_SPIKES %d\n"
+                           "#define SELL_CHUNK %u\n"
+                           "#define DELAY_SLOTS %u\n"
+                           "#define ENSEMBLE %d\n",
+                           MAX_SYNAPSES, variant.fan_in, variant.workgroup_size, variant.decay, NeuronModelThreshold,
+                           NeuronModelLif, NeuronModelIzhikevich, variant.model,
+                           variant.precision == KernelPrecisionF64, variant.precision == KernelPrecisionStrict,
+                           WeightFormatF32, WeightFormatF16, WeightFormatQ8, variant.weight_format, TargetFormatI32,
+                           TargetFormatU16, variant.target_format, variant.binary, variant.sell_chunk,
+                           variant.delay_slots, variant.ensemble);
+    return written < 0 ? 0 : (usize)written;
+}
+
+GLuint kernel_cache_program(KernelCache &cache, const KernelVariant &variant) {
+    for (usize i = 0; i < cache.count; i++) {
+        if (kernel_variant_equal(cache.entries[i].variant, variant)) return cache.entries[i].program;
+    }
+
+    // Model and precision select blocks in tick.comp with #if, sizes and constants come straight from the preamble.
+    // Variants that did not fit in the cache were still added to the shader library, which finds them by preamble.
+    char preamble[SHADER_PREAMBLE_LENGTH];
+    kernel_variant_preamble(variant, preamble, sizeof(preamble));
+    GLuint program = shader_library_find_compute(global_shader_library, "tick.comp", preamble);
+    if (!program) program = shader_library_compute(global_shader_library, "tick.comp", preamble);
+
+    if (cache.count < KERNEL_CACHE_CAPACITY) cache.entries[cache.count++] = {variant, program};
+    return program;
+}
+
+void kernel_cache_clear(KernelCache &cache) {
+    for (usize i = 0; i < cache.count; i++) {
+        shader_library_release(global_shader_library, cache.entries[i].program);
+    }
+    cache.count = 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "core/types.h"
+#include "neuron_model.hpp"
+#include "storage_format.hpp"
+
+#include <glad/glad.h>
+
+#define KERNEL_WORKGROUP_SIZE 256
+#define KERNEL_DECAY 0.9f
+#define KERNEL_CACHE_CAPACITY 32
+
+struct Network;
+
+enum KernelPrecision {
+    KernelPrecisionF32,
+    KernelPrecisionF64, // double accumulation of synaptic input, a reference for checking the f32 kernels
+    // f32 summed one synapse at a time in column order, every product rounded before the add. Slower, but CPU and GPU
+    // agree bit for bit, see activation_trace.hpp.
+    KernelPrecisionStrict,
+};
+
+// Everything a tick kernel is specialised on. The CPU engine instantiates a template per combination and the
+// compute shader is generated with these values as #defines, so none of them is a runtime branch or a loop bound.
+struct KernelVariant {
+    NeuronModel model;
+    KernelPrecision precision;
+    u32 fan_in;         // synapse columns read per row, the rest of the MAX_SYNAPSES row must be padding
+    u32 workgroup_size; // compute shader only
+    f32 decay;          // activation decay on ticks without a spike
+    WeightFormat weight_format;
+    TargetFormat target_format;
+    // Neurons carry only whether they spiked last tick, as one bit each in a bitset read by every row. Activations
+    // are 1 or 0 and never decay.
+    bool binary;
+    u32 sell_chunk; // 0 for the padded rows, else rows per chunk of the SELL-C-sigma rows the network ticks from
+    u32 delay_slots; // 0 when every synapse is instantaneous, else the length of each neuron's ring of delayed input
+    bool ensemble;   // compute shader only, model parameters come per neuron from the ensemble buffers (ensemble.hpp)
+};
+
+bool kernel_variant_equal(const KernelVariant &a, const KernelVariant &b);
+
+// Smallest supported fan-in that covers every row of the network: 4, 8 or MAX_SYNAPSES
+u32 network_fan_in(const Network &net);
+KernelVariant kernel_variant_for(const Network &net);
+
+// Writes the #version line and the variant's #defines, for any compute shader that indexes synapse rows
+usize kernel_variant_preamble(const KernelVariant &variant, char *out, usize capacity);
+
+// Compiled tick programs keyed by variant. Programs are shared between networks and owned by the cache. Past
+// KERNEL_CACHE_CAPACITY variants a program is still built once, then owned by the shader library and found there.
+struct KernelCache {
+    struct Entry {
+        KernelVariant variant;
+        GLuint program;
+    };
+
+    Entry entries[KERNEL_CACHE_CAPACITY];
+    usize count;
+};
+
+extern KernelCache global_kernel_cache;
+
+GLuint kernel_cache_program(KernelCache &cache, const KernelVariant &variant);
+void kernel_cache_clear(KernelCache &cache);
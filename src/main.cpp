@@ -1,22 +1,63 @@
+#include "core/arena.h"
+#include "core/file.h"
 #include "core/logger.h"
+#include "core/task_graph.h"
+#include "core/trace.h"
+#include "gpu_stats.hpp"
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "input_stream.hpp"
 #include "neural_net.hpp"
+#include "plasticity.hpp"
 #include "renderer.hpp"
+#include "reorder.hpp"
+#include "shader.hpp"
+#include "spatial.hpp"
 #include "state.hpp"
+#include "streaming.hpp"
 
 #include <GLFW/glfw3.h>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
 #include <glad/glad.h>
 
+#define PICK_RADIUS_PIXELS 8.0f
+#define BRUSH_CAPACITY 4096
+#define ZOOM_STEP 1.15f
+#define ZOOM_MIN 0.25f
+#define ZOOM_MAX 4096.0f
+#define INPUT_FALLBACK_NEURONS 1024 // driven when the network has no Input neurons, one patch after the Hilbert reorder
+#define INPUT_RAW_SAMPLE_SIZE 784    // 28x28 bytes per sample on stdin
+#define STATS_WEIGHT_INTERVAL 60     // ticks between weight histograms
+
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
+void scroll_callback(GLFWwindow *window, double x_offset, double y_offset);
 void process_input(GLFWwindow *window);
+void update_camera(GLFWwindow *window);
+void update_picking(GLFWwindow *window, Network &network, const SpatialGrid &grid, Arena &frame);
+void show_neuron(const char *label, const Network &network, const GpuStats &stats, usize probe, i32 index);
+void show_stats(const GpuStats &stats);
+bool open_input(InputStream &input, const Network &network, const char *path);
 
 static State state = {
     .network_paused = false,
     .renderer_paused = false,
+    .plasticity_enabled = false,
     .neuron_color = {.active = {1.0, 1.0, 1.0, 1.0}, .inactive = {0.1, 0.1, 0.2, 1.0}},
     .synapse_color = {.active = {0.0, 0.5, 0.0, 0.5}, .inactive = {0.5, 0.0, 0.0, 0.5}},
+    .camera = {.x = 0.0f, .y = 0.0f, .zoom = 1.0f},
+    .render_mode = RenderModeAuto,
+    .bloom_enabled = true,
+    .exposure = 1.0f,
+    .hovered_neuron = -1,
+    .selected_neuron = -1,
+    .select_requested = false,
+    .brush_enabled = false,
+    .brush_active = false,
+    .brush_radius = 0.05f,
 };
 
 // void try_load_state() {
@@ -25,9 +66,45 @@ static State state = {
 // void try_save_state() {
 // }
 
-int main() {
+static const char *startup_shaders[] = {
+    "neuron.vert", "neuron.frag", "synapse.vert", "synapse.frag", "tick.comp", "plasticity_trace.comp",
+    "plasticity_weight.comp", "cull_neurons.comp", "cull_synapses.comp", "fullscreen.vert", "density.frag",
+    "splat.comp", "splat_resolve.frag", "blur.frag", "bloom.frag", "stimulate.comp", "input.comp", "stats.comp",
+};
+
+// example [samples.idx | -]: an IDX file, or raw 28x28 samples on stdin, drives the Input neurons
+int main(int argc, char **argv) {
+    trace_init(global_trace);
+    usize first_frame = trace_begin(global_trace, "time to first frame");
+
+    // Startup work that does not need the GL context runs on worker threads while the window comes up
+    Network network;
+    SpatialGrid grid;
+    u8 *imgui_ini = nullptr;
+    usize imgui_ini_len = 0;
+
+    TaskGraph startup;
+    task_graph_init(startup);
+    u32 load_shaders = task_graph_add(startup, "load shader sources", [] {
+        shader_library_prefetch(global_shader_library, startup_shaders, sizeof(startup_shaders) / sizeof(char *));
+    });
+    u32 load_ini = task_graph_add(startup, "load imgui.ini",
+                                  [&] { imgui_ini = read_file_to_bytes("imgui.ini", &imgui_ini_len); });
+    u32 generate = task_graph_add(startup, "generate network", [&] {
+        // network_init(network, MAX_NEURONS / 8);
+        network_init_host(network, MAX_NEURONS / 32);
+    });
+    u32 reorder = task_graph_add(
+        startup, "reorder network", [&] { network_reorder(network, ReorderHilbert); }, {generate});
+    task_graph_add(
+        startup, "build spatial index", [&] { spatial_grid_build(grid, network.neuron_data, 4, network.neuron_count); },
+        {reorder});
+    task_graph_start(startup);
+
+    usize event = trace_begin(global_trace, "create context");
     if (!glfwInit()) {
         error("Failed to initialize GLFW");
+        task_graph_finish(startup);
         return -1;
     }
 
@@ -36,6 +113,7 @@ int main() {
     const GLFWvidmode *mode = glfwGetVideoMode(primary);
     if (!mode) {
         error("Failed to get video mode");
+        task_graph_finish(startup);
         glfwTerminate();
         return -1;
     }
@@ -57,6 +135,7 @@ int main() {
     GLFWwindow *window = glfwCreateWindow(width, height, "example", nullptr, nullptr);
     if (!window) {
         error("Failed to create window");
+        task_graph_finish(startup);
         glfwTerminate();
         return -1;
     }
@@ -66,23 +145,27 @@ int main() {
 
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         error("Failed to initialize GLAD");
+        task_graph_finish(startup);
         return -1;
     }
 
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback); // before imgui, which chains to both
+    glfwSetScrollCallback(window, scroll_callback);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    trace_end(global_trace, event);
 
-    // const char *data = file_read_to_string("example.xiu");
-
-    Network network;
-    // const auto temp = network_deserialize(network, (u8 *)data, strlen(data));
-    // network_init(network, MAX_NEURONS / 8);
-    network_init(network, MAX_NEURONS / 32);
-
+    // With parallel shader compilation these return immediately and build on driver threads
+    task_graph_wait(startup, load_shaders);
+    event = trace_begin(global_trace, "issue render programs");
+    shader_library_init(global_shader_library, (GLADloadproc)glfwGetProcAddress);
+    stream_buffer_init(global_stream_buffer);
     Renderer renderer;
     renderer_init(renderer);
+    trace_end(global_trace, event);
 
     // Initialize imgui
+    event = trace_begin(global_trace, "init imgui");
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO &io = ImGui::GetIO();
@@ -93,16 +176,50 @@ int main() {
     ImGui_ImplOpenGL3_Init("#version 430");
 
     ImGui::StyleColorsDark();
-    ImGui::LoadIniSettingsFromDisk("imgui.ini");
+    task_graph_wait(startup, load_ini);
+    if (imgui_ini) ImGui::LoadIniSettingsFromMemory((const char *)imgui_ini, imgui_ini_len);
+    free(imgui_ini);
+    trace_end(global_trace, event);
+
+    // const char *data = file_read_to_string("example.xiu");
+    // const auto temp = network_deserialize(network, (u8 *)data, strlen(data));
+    task_graph_wait(startup, reorder);
+    event = trace_begin(global_trace, "upload network");
+    network_upload(network);
+    renderer_attach(renderer, network);
+
+    Plasticity plasticity;
+    plasticity_init(plasticity, network.neuron_count, plasticity_default_params());
+    plasticity_init_remote_resources(plasticity, network);
+    InputStream input;
+    bool streaming = argc > 1 && open_input(input, network, argv[1]);
+    if (streaming) input_stream_upload(input);
+    GpuStats stats;
+    gpu_stats_init(stats, network, plasticity.params.w_min, plasticity.params.w_max);
+    trace_end(global_trace, event);
+    task_graph_finish(startup);
+
+    event = trace_begin(global_trace, "finish shaders");
+    shader_library_finish(global_shader_library);
+    trace_end(global_trace, event);
 
     // TODO: track time delta for network
     usize frame = 0;
+    FrameArena frames;
+    frame_arena_init(frames, ARENA_FRAME_CAPACITY);
+    usize heap_allocations = 0, frame_heap_allocations = 0;
     while (!glfwWindowShouldClose(window)) {
+        frame_arena_begin(frames);
+        usize allocations = global_heap_counters.allocations.load(std::memory_order_relaxed);
+        frame_heap_allocations = allocations - heap_allocations;
+        heap_allocations = allocations;
+
         // Start imgui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
+        gpu_stats_poll(stats);
         ImGui::Begin("Mother Ship");
         if (ImGui::Button(state.network_paused ? "Unpause Network" : "Pause Network")) {
             state.network_paused = !state.network_paused;
@@ -112,7 +229,67 @@ int main() {
             state.renderer_paused = !state.renderer_paused;
         }
 
-        static bool show_colors = false;
+        ImGui::Checkbox("Plasticity", &state.plasticity_enabled);
+        int interval = (int)plasticity.params.interval;
+        if (ImGui::SliderInt("Plasticity Interval", &interval, 1, 60)) {
+            plasticity.params.interval = (u32)interval;
+        }
+
+        if (ImGui::CollapsingHeader("Neurons", ImGuiTreeNodeFlags_DefaultOpen)) {
+            show_neuron("Hovered", network, stats, 0, state.hovered_neuron);
+            show_neuron("Selected", network, stats, 1, state.selected_neuron);
+            ImGui::Checkbox("Stimulus Brush (right drag)", &state.brush_enabled);
+            ImGui::SliderFloat("Brush Radius", &state.brush_radius, 0.005f, 0.5f);
+        }
+
+        if (ImGui::CollapsingHeader("View")) {
+            ImGui::Text("Zoom %.2fx at %.3f, %.3f (scroll to zoom, middle drag to pan)", state.camera.zoom,
+                        state.camera.x, state.camera.y);
+            if (ImGui::Button("Reset View")) state.camera = {.x = 0.0f, .y = 0.0f, .zoom = 1.0f};
+
+            static const char *modes[] = {"Auto", "Lines", "Density"};
+            int mode = (int)state.render_mode;
+            if (ImGui::Combo("Render Mode", &mode, modes, 3)) state.render_mode = (RenderMode)mode;
+
+            if (renderer_uses_density(renderer, state)) {
+                ImGui::Checkbox("Bloom", &state.bloom_enabled);
+                ImGui::SliderFloat("Exposure", &state.exposure, 0.05f, 8.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+            } else {
+                u32 visible_neurons, visible_lines;
+                renderer_visible_counts(renderer, &visible_neurons, &visible_lines);
+                ImGui::Text("Visible: %u neurons, %u synapse lines", visible_neurons, visible_lines);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Memory")) {
+            if (heap_counters_enabled()) {
+                ImGui::Text("Heap allocations last frame: %zu (%zu total)", frame_heap_allocations, heap_allocations);
+            } else {
+                ImGui::Text("Heap allocations: not counted, build with ENABLE_ALLOC_COUNTERS");
+            }
+            const Arena &arena = frame_arena(frames);
+            ImGui::Text("Frame arena: %zu KB peak, %zu allocations", arena.peak >> 10, arena.allocations);
+            ImGui::Text("Main thread scratch: %zu MB peak%s", arena_scratch().peak >> 20,
+                        arena_scratch().huge_pages ? ", huge pages" : "");
+        }
+
+        if (ImGui::CollapsingHeader("Uploads")) {
+            const StreamBuffer &stream = global_stream_buffer;
+            ImGui::Text("Last frame: %zu bytes in %zu uploads", stream.frame_bytes, stream.frame_uploads);
+            ImGui::Text("Total: %.1f KB in %zu uploads, %zu overflowed", stream.bytes / 1024.0, stream.uploads,
+                        stream.overflows);
+            ImGui::Text("Fence waits: %zu (%.2f ms)%s", stream.fence_waits, stream.fence_wait_ms,
+                        stream.mapped ? "" : ", not persistently mapped");
+        }
+
+        if (ImGui::CollapsingHeader("Statistics")) show_stats(stats);
+
+        if (streaming && ImGui::CollapsingHeader("Input")) {
+            ImGui::Text("%zu inputs, %llu samples read, %zu batches", input.input_count,
+                        (unsigned long long)input.samples_read.load(std::memory_order_relaxed), input.consumed);
+            ImGui::Text("Underruns: %zu ticks without input", input.underruns);
+        }
+
         if (ImGui::CollapsingHeader("Color Settings")) {
             ImGui::ColorEdit4("Active Neuron", state.neuron_color.active);
             ImGui::ColorEdit4("Inactive Neuron", state.neuron_color.inactive);
@@ -122,9 +299,21 @@ int main() {
         ImGui::End();
 
         process_input(window);
+        shader_library_poll(global_shader_library);
+        if (!io.WantCaptureMouse) {
+            update_camera(window);
+            update_picking(window, network, grid, frame_arena(frames));
+        }
+        gpu_stats_probe(stats, 0, state.hovered_neuron);
+        gpu_stats_probe(stats, 1, state.selected_neuron);
 
         if (!state.network_paused && frame++ % 3 == 0) {
-            network_update(network);
+            if (streaming) input_stream_tick(input, network);
+            network_update(network, !streaming);
+            gpu_stats_record(stats, network, stats.recorded % STATS_WEIGHT_INTERVAL == 0);
+            if (state.plasticity_enabled) plasticity_update_remote(plasticity, network);
+        } else if (state.network_paused && stats.pending == 0 && gpu_stats_probes_stale(stats)) {
+            gpu_stats_record(stats, network);
         }
 
         glClear(GL_COLOR_BUFFER_BIT);
@@ -137,7 +326,19 @@ int main() {
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
         glfwSwapBuffers(window);
+        stream_buffer_frame(global_stream_buffer);
         glfwPollEvents();
+
+        // Cold starts compile every program, warm starts load them from the binary cache
+        if (first_frame < TRACE_CAPACITY) {
+            trace_end(global_trace, first_frame);
+            printf("First frame after %.1f ms, shaders %.1f ms (%zu compiled, %zu from cache)\n",
+                   global_trace.events[first_frame].end_ms, global_shader_library.build_ms,
+                   global_shader_library.compiled, global_shader_library.cached);
+            trace_print(global_trace);
+            trace_write_json(global_trace, "startup_trace.json");
+            first_frame = TRACE_CAPACITY;
+        }
     }
 
     ImGui::SaveIniSettingsToDisk("imgui.ini");
@@ -147,8 +348,16 @@ int main() {
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    if (streaming) input_stream_close(input);
+    gpu_stats_deinit(stats);
     renderer_deinit(renderer);
+    plasticity_deinit(plasticity);
+    spatial_grid_deinit(grid);
     network_deinit(network);
+    kernel_cache_clear(global_kernel_cache);
+    frame_arena_deinit(frames);
+    stream_buffer_deinit(global_stream_buffer);
+    shader_library_deinit(global_shader_library);
     glfwTerminate();
 
     return 0;
@@ -163,3 +372,168 @@ void process_input(GLFWwindow *window) {
         glfwSetWindowShouldClose(window, true);
     }
 }
+
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
+    if (ImGui::GetIO().WantCaptureMouse) return;
+
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) state.select_requested = true;
+    if (button == GLFW_MOUSE_BUTTON_RIGHT) state.brush_active = action == GLFW_PRESS;
+}
+
+// Inverse of the renderer's transform: x is scaled by the aspect ratio, y spans [-1, 1] at zoom 1
+static void cursor_to_world(GLFWwindow *window, f32 *x, f32 *y, f32 *pixel) {
+    double cursor_x, cursor_y;
+    int width, height;
+    glfwGetCursorPos(window, &cursor_x, &cursor_y);
+    glfwGetWindowSize(window, &width, &height);
+    if (width <= 0 || height <= 0) width = height = 1;
+
+    f32 aspect = (f32)width / height;
+    *x = state.camera.x + ((f32)(2.0 * cursor_x / width) - 1.0f) * aspect / state.camera.zoom;
+    *y = state.camera.y + (1.0f - (f32)(2.0 * cursor_y / height)) / state.camera.zoom;
+    *pixel = 2.0f / (height * state.camera.zoom);
+}
+
+// Zooms around the cursor, so the world point under it stays put
+void scroll_callback(GLFWwindow *window, double x_offset, double y_offset) {
+    if (ImGui::GetIO().WantCaptureMouse) return;
+
+    f32 x, y, pixel;
+    cursor_to_world(window, &x, &y, &pixel);
+
+    f32 zoom = state.camera.zoom * powf(ZOOM_STEP, (f32)y_offset);
+    zoom = zoom < ZOOM_MIN ? ZOOM_MIN : zoom > ZOOM_MAX ? ZOOM_MAX : zoom;
+    f32 ratio = state.camera.zoom / zoom;
+    state.camera.x = x + (state.camera.x - x) * ratio;
+    state.camera.y = y + (state.camera.y - y) * ratio;
+    state.camera.zoom = zoom;
+}
+
+// Middle drag pans the camera
+void update_camera(GLFWwindow *window) {
+    static double last_x, last_y;
+    static bool dragging = false;
+
+    double cursor_x, cursor_y;
+    glfwGetCursorPos(window, &cursor_x, &cursor_y);
+    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_MIDDLE) != GLFW_PRESS) {
+        dragging = false;
+        return;
+    }
+
+    if (dragging) {
+        int width, height;
+        glfwGetWindowSize(window, &width, &height);
+        f32 pixel = 2.0f / ((height > 0 ? height : 1) * state.camera.zoom);
+        state.camera.x -= (f32)(cursor_x - last_x) * pixel;
+        state.camera.y += (f32)(cursor_y - last_y) * pixel;
+    }
+    last_x = cursor_x;
+    last_y = cursor_y;
+    dragging = true;
+}
+
+void update_picking(GLFWwindow *window, Network &network, const SpatialGrid &grid, Arena &frame) {
+    f32 x, y, pixel;
+    cursor_to_world(window, &x, &y, &pixel);
+
+    state.hovered_neuron = spatial_grid_nearest(grid, x, y, PICK_RADIUS_PIXELS * pixel);
+    if (state.select_requested) {
+        state.selected_neuron = state.hovered_neuron;
+        state.select_requested = false;
+    }
+
+    if (state.brush_enabled && state.brush_active) {
+        u32 *brushed = arena_push<u32>(frame, BRUSH_CAPACITY);
+        usize count = spatial_grid_radius(grid, x, y, state.brush_radius, brushed, BRUSH_CAPACITY);
+        network_stimulate(network, brushed, count < BRUSH_CAPACITY ? count : BRUSH_CAPACITY);
+    }
+}
+
+void show_neuron(const char *label, const Network &network, const GpuStats &stats, usize probe, i32 index) {
+    if (index < 0 || (usize)index >= network.neuron_count) {
+        ImGui::Text("%s: none", label);
+        return;
+    }
+
+    static const char *kinds[] = {"input", "hidden", "output"};
+    usize synapses = 0;
+    for (int j = 0; j < MAX_SYNAPSES; j++) {
+        synapses += network.synapse_data[index * MAX_SYNAPSES + j] >= 0;
+    }
+
+    // Positions are host data, activation and threshold arrive with the stats records a few frames late
+    const f32 *neuron = &network.neuron_data[index * 4];
+    ImGui::Text("%s: #%zu (%s) at %.3f, %.3f", label, network_id_of(network, index), kinds[network.kind_data[index]],
+                neuron[0], neuron[1]);
+    const f32 *probed = gpu_stats_probed(stats, probe, index);
+    if (probed) {
+        ImGui::Text("  activation %.3f  threshold %.3f  inputs %zu", probed[2], probed[3], synapses);
+    } else {
+        ImGui::Text("  reading back...  inputs %zu", synapses);
+    }
+}
+
+bool open_input(InputStream &input, const Network &network, const char *path) {
+    InputStreamParams params = {
+        .format = strcmp(path, "-") == 0 ? InputFormatRaw : InputFormatIdx,
+        .encoding = InputEncodingPoisson,
+        .max_rate = 0.25f,
+        .ticks_per_sample = 20,
+        .sample_size = INPUT_RAW_SAMPLE_SIZE,
+        .loop = true,
+        .seed = 1,
+    };
+
+    usize count = input_stream_input_neurons(network, nullptr, 0);
+    usize fallback = network.neuron_count < INPUT_FALLBACK_NEURONS ? network.neuron_count : INPUT_FALLBACK_NEURONS;
+    u32 *neurons = (u32 *)malloc((count ? count : fallback) * sizeof(u32));
+    if (count) {
+        input_stream_input_neurons(network, neurons, count);
+    } else {
+        warn("Network has no Input neurons, streaming into the first %zu", fallback);
+        count = fallback;
+        for (usize i = 0; i < count; i++) neurons[i] = (u32)i;
+    }
+
+    bool opened = input_stream_open(input, path, neurons, count, params);
+    free(neurons);
+    return opened;
+}
+
+void show_stats(const GpuStats &stats) {
+    static const char *kinds[] = {"Input", "Hidden", "Output"};
+    const GpuStatsRecord &record = stats.latest;
+    ImGui::Text("Mean activation %.4f, %u of %zu fired", gpu_stats_mean_activation(stats), record.fired[3],
+                stats.neuron_count);
+    ImGui::Text("Readback %zu bytes per tick, %zu records, %zu dropped, %s reductions", sizeof(GpuStatsRecord),
+                stats.received, stats.dropped, stats.subgroups ? "subgroup" : "shared memory");
+
+    usize count = stats.history_count;
+    int offset = (int)stats.history_head;
+    ImGui::PlotLines("Mean Activation", stats.history[GpuStatsMeanActivation], (int)count, offset, nullptr, 0.0f,
+                     1.0f, ImVec2(0, 60));
+    for (int kind = 0; kind < 3; kind++) {
+        if (!stats.neurons_of_kind[kind]) continue;
+        char label[32];
+        snprintf(label, sizeof(label), "%s Fired", kinds[kind]);
+        ImGui::PlotLines(label, stats.history[GpuStatsFiredInput + kind], (int)count, offset, nullptr, 0.0f, 1.0f,
+                         ImVec2(0, 40));
+    }
+
+    f32 bins[GPU_STATS_BINS];
+    for (int b = 0; b < GPU_STATS_BINS; b++) bins[b] = (f32)record.activation_bins[b];
+    ImGui::PlotHistogram("Activations", bins, GPU_STATS_BINS, 0, "0 .. 1", 0.0f, FLT_MAX, ImVec2(0, 60));
+
+    const GpuStatsRecord &weights = stats.latest_weights;
+    f32 synapses = weights.weight_sum[2];
+    if (synapses > 0.0f) {
+        f32 mean = weights.weight_sum[0] / synapses;
+        ImGui::Text("Weights: mean %.4f, std %.4f over %.0f synapses", mean,
+                    sqrtf(fmaxf(weights.weight_sum[1] / synapses - mean * mean, 0.0f)), synapses);
+        for (int b = 0; b < GPU_STATS_BINS; b++) bins[b] = (f32)weights.weight_bins[b];
+        char range[32];
+        snprintf(range, sizeof(range), "%.2f .. %.2f", stats.weight_min, stats.weight_max);
+        ImGui::PlotHistogram("Weights", bins, GPU_STATS_BINS, 0, range, 0.0f, FLT_MAX, ImVec2(0, 60));
+    }
+}
@@ -0,0 +1,428 @@
+#include "network_edit.hpp"
+
+#include "core/arena.h"
+#include "core/logger.h"
+#include "shader.hpp"
+#include "streaming.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+
+#define NETWORK_EDIT_INITIAL_SLOTS 1024
+#define NETWORK_EDIT_WORKGROUP 64 // local_size_x of edit.comp
+
+static inline bool network_editor_bit(const u64 *bits, usize i) {
+    return bits[i / 64] >> (i % 64) & 1;
+}
+
+static inline bool network_editor_alive(const NetworkEditor &editor, u32 neuron) {
+    return neuron < editor.capacity && network_editor_bit(editor.alive, neuron);
+}
+
+static void network_editor_mark_neuron(NetworkEditor &editor, u32 neuron) {
+    if (network_editor_bit(editor.dirty_neuron_bits, neuron)) return;
+    editor.dirty_neuron_bits[neuron / 64] |= 1ull << (neuron % 64);
+    editor.dirty_neurons[editor.dirty_neuron_count++] = neuron;
+}
+
+static void network_editor_mark_slot(NetworkEditor &editor, u32 slot) {
+    if (network_editor_bit(editor.dirty_slot_bits, slot)) return;
+    editor.dirty_slot_bits[slot / 64] |= 1ull << (slot % 64);
+    if (editor.dirty_slot_count == editor.dirty_slot_capacity) {
+        editor.dirty_slot_capacity = editor.dirty_slot_capacity ? editor.dirty_slot_capacity * 2
+                                                                : NETWORK_EDIT_INITIAL_SLOTS;
+        editor.dirty_slots = (u32 *)realloc(editor.dirty_slots, editor.dirty_slot_capacity * sizeof(u32));
+    }
+    editor.dirty_slots[editor.dirty_slot_count++] = slot;
+}
+
+static void network_editor_link(NetworkEditor &editor, u32 source, u32 slot) {
+    u32 head = editor.out_head[source];
+    editor.out_next[slot] = head;
+    editor.out_prev[slot] = NETWORK_EDIT_NONE;
+    if (head != NETWORK_EDIT_NONE) editor.out_prev[head] = slot;
+    editor.out_head[source] = slot;
+}
+
+static void network_editor_unlink(NetworkEditor &editor, u32 source, u32 slot) {
+    u32 next = editor.out_next[slot], prev = editor.out_prev[slot];
+    if (next != NETWORK_EDIT_NONE) editor.out_prev[next] = prev;
+    if (prev != NETWORK_EDIT_NONE) {
+        editor.out_next[prev] = next;
+    } else {
+        editor.out_head[source] = next;
+    }
+    editor.out_next[slot] = editor.out_prev[slot] = NETWORK_EDIT_NONE;
+}
+
+static void network_editor_clear_slot(Network &net, usize slot) {
+    net.synapse_data[slot] = -1;
+    net.weight_data[slot] = 0.0f;
+    if (net.delay_data) net.delay_data[slot] = 0;
+}
+
+// A dead slot: no synapses, activation 0 and a threshold no input reaches, so it never fires
+static void network_editor_kill(Network &net, usize neuron) {
+    net.neuron_data[neuron * 4 + 2] = 0.0f;
+    net.neuron_data[neuron * 4 + 3] = FLT_MAX;
+    for (usize j = 0; j < MAX_SYNAPSES; j++) network_editor_clear_slot(net, neuron * MAX_SYNAPSES + j);
+}
+
+static void network_editor_clear_dirty(NetworkEditor &editor) {
+    for (usize k = 0; k < editor.dirty_neuron_count; k++) {
+        editor.dirty_neuron_bits[editor.dirty_neurons[k] / 64] = 0;
+    }
+    for (usize k = 0; k < editor.dirty_slot_count; k++) editor.dirty_slot_bits[editor.dirty_slots[k] / 64] = 0;
+    editor.dirty_neuron_count = 0;
+    editor.dirty_slot_count = 0;
+}
+
+// Bitsets and per-slot lists for capacity neurons, words past the old capacity start clear
+static void network_editor_alloc(NetworkEditor &editor, usize old_capacity, usize capacity) {
+    usize old_words = (old_capacity + 63) / 64, words = (capacity + 63) / 64;
+    u64 **bitsets[] = {&editor.alive, &editor.dirty_neuron_bits};
+    for (u64 **bits : bitsets) {
+        *bits = (u64 *)realloc(*bits, words * sizeof(u64));
+        memset(*bits + old_words, 0, (words - old_words) * sizeof(u64));
+    }
+    editor.dirty_slot_bits = (u64 *)realloc(editor.dirty_slot_bits, words * MAX_SYNAPSES * sizeof(u64));
+    memset(editor.dirty_slot_bits + old_words * MAX_SYNAPSES, 0, (words - old_words) * MAX_SYNAPSES * sizeof(u64));
+
+    editor.free_neurons = (u32 *)realloc(editor.free_neurons, capacity * sizeof(u32));
+    editor.removed = (u32 *)realloc(editor.removed, capacity * sizeof(u32));
+    editor.dirty_neurons = (u32 *)realloc(editor.dirty_neurons, capacity * sizeof(u32));
+
+    // New neurons and their slots start with no synapses, all bytes 0xFF is NETWORK_EDIT_NONE
+    editor.out_head = (u32 *)realloc(editor.out_head, capacity * sizeof(u32));
+    memset(editor.out_head + old_capacity, 0xFF, (capacity - old_capacity) * sizeof(u32));
+    u32 **lists[] = {&editor.out_next, &editor.out_prev};
+    for (u32 **list : lists) {
+        *list = (u32 *)realloc(*list, capacity * MAX_SYNAPSES * sizeof(u32));
+        memset(*list + old_capacity * MAX_SYNAPSES, 0xFF, (capacity - old_capacity) * MAX_SYNAPSES * sizeof(u32));
+    }
+    editor.capacity = capacity;
+}
+
+void network_editor_init(NetworkEditor &editor, const Network &net) {
+    editor.alive = editor.dirty_neuron_bits = editor.dirty_slot_bits = nullptr;
+    editor.free_neurons = editor.removed = editor.dirty_neurons = editor.dirty_slots = nullptr;
+    editor.out_head = editor.out_next = editor.out_prev = nullptr;
+    editor.free_count = editor.removed_count = 0;
+    editor.dirty_neuron_count = editor.dirty_slot_count = editor.dirty_slot_capacity = 0;
+    network_editor_alloc(editor, 0, net.neuron_count);
+    for (usize i = 0; i < net.neuron_count; i++) editor.alive[i / 64] |= 1ull << (i % 64);
+
+    // Linked from the last slot down, so each list runs in slot order
+    for (usize slot = net.neuron_count * MAX_SYNAPSES; slot > 0; slot--) {
+        i32 source = net.synapse_data[slot - 1];
+        if (source >= 0) network_editor_link(editor, (u32)source, (u32)(slot - 1));
+    }
+
+    editor.columns = 0;
+    for (usize i = 0; i < net.neuron_count; i++) {
+        for (u32 j = editor.columns; j < MAX_SYNAPSES; j++) {
+            if (net.synapse_data[i * MAX_SYNAPSES + j] >= 0) editor.columns = j + 1;
+        }
+    }
+    editor.flush_runs = editor.flush_bytes = editor.flush_swept = 0;
+    editor.program = 0;
+}
+
+void network_editor_deinit(NetworkEditor &editor) {
+    free(editor.free_neurons);
+    free(editor.alive);
+    free(editor.removed);
+    free(editor.dirty_neurons);
+    free(editor.dirty_neuron_bits);
+    free(editor.dirty_slots);
+    free(editor.dirty_slot_bits);
+    free(editor.out_head);
+    free(editor.out_next);
+    free(editor.out_prev);
+}
+
+void network_editor_reserve(NetworkEditor &editor, Network &net, usize capacity) {
+    usize old = editor.capacity;
+    if (capacity <= old) return;
+
+    net.neuron_data = (f32 *)realloc(net.neuron_data, capacity * 4 * sizeof(f32));
+    net.synapse_data = (i32 *)realloc(net.synapse_data, capacity * MAX_SYNAPSES * sizeof(i32));
+    net.weight_data = (f32 *)realloc(net.weight_data, capacity * MAX_SYNAPSES * sizeof(f32));
+    net.kind_data = (Neuron::Kind *)realloc(net.kind_data, capacity * sizeof(Neuron::Kind));
+    if (net.delay_data) net.delay_data = (u8 *)realloc(net.delay_data, capacity * MAX_SYNAPSES);
+    if (net.id_of_index) {
+        net.id_of_index = (u32 *)realloc(net.id_of_index, capacity * sizeof(u32));
+        net.index_of_id = (u32 *)realloc(net.index_of_id, capacity * sizeof(u32));
+    }
+    for (usize i = old; i < capacity; i++) {
+        net.neuron_data[i * 4 + 0] = 0.0f;
+        net.neuron_data[i * 4 + 1] = 0.0f;
+        net.kind_data[i] = Neuron::Hidden;
+        network_editor_kill(net, i);
+        if (net.id_of_index) net.id_of_index[i] = net.index_of_id[i] = (u32)i; // new IDs follow the old ones
+    }
+    net.neuron_count = capacity;
+
+    network_editor_alloc(editor, old, capacity);
+    for (usize i = capacity; i > old; i--) editor.free_neurons[editor.free_count++] = (u32)(i - 1); // lowest on top
+
+    if (net.neuron_buffer) {
+        // The full upload carries every pending edit, keep the kernel the network was running
+        KernelVariant variant = net.variant;
+        network_upload(net);
+        network_set_precision(net, variant.precision);
+        if (variant.binary) network_set_binary(net, true);
+        network_editor_clear_dirty(editor);
+    }
+}
+
+u32 network_editor_add_neuron(NetworkEditor &editor, Network &net, f32 x, f32 y, f32 threshold, Neuron::Kind kind) {
+    if (editor.free_count == 0) return NETWORK_EDIT_NONE;
+    u32 neuron = editor.free_neurons[--editor.free_count];
+    editor.alive[neuron / 64] |= 1ull << (neuron % 64);
+
+    // The row of a dead slot is already clear
+    f32 *data = &net.neuron_data[neuron * 4];
+    data[0] = x;
+    data[1] = y;
+    data[2] = 0.0f;
+    data[3] = threshold;
+    net.kind_data[neuron] = kind;
+    network_editor_mark_neuron(editor, neuron);
+    return neuron;
+}
+
+void network_editor_remove_neuron(NetworkEditor &editor, Network &net, u32 neuron) {
+    if (!network_editor_alive(editor, neuron)) return;
+    editor.alive[neuron / 64] &= ~(1ull << (neuron % 64));
+    editor.removed[editor.removed_count++] = neuron;
+
+    for (u32 slot = neuron * MAX_SYNAPSES; slot < (neuron + 1) * MAX_SYNAPSES; slot++) {
+        if (net.synapse_data[slot] < 0) continue;
+        network_editor_unlink(editor, (u32)net.synapse_data[slot], slot);
+        network_editor_mark_slot(editor, slot);
+    }
+    network_editor_kill(net, neuron);
+    network_editor_mark_neuron(editor, neuron);
+}
+
+u32 network_editor_add_synapse(NetworkEditor &editor, Network &net, u32 neuron, u32 source, f32 weight, u8 delay) {
+    if (!network_editor_alive(editor, neuron) || !network_editor_alive(editor, source)) return NETWORK_EDIT_NONE;
+
+    for (u32 j = 0; j < MAX_SYNAPSES; j++) {
+        u32 slot = neuron * MAX_SYNAPSES + j;
+        if (net.synapse_data[slot] >= 0) continue;
+
+        net.synapse_data[slot] = (i32)source;
+        net.weight_data[slot] = weight;
+        if (net.delay_data) net.delay_data[slot] = delay < net.delay_slots ? delay : (u8)net.delay_slots;
+        if (j + 1 > editor.columns) editor.columns = j + 1;
+        network_editor_link(editor, source, slot);
+        network_editor_mark_slot(editor, slot);
+        return slot;
+    }
+    return NETWORK_EDIT_NONE;
+}
+
+void network_editor_remove_synapse(NetworkEditor &editor, Network &net, u32 slot) {
+    if (net.synapse_data[slot] < 0) return;
+    network_editor_unlink(editor, (u32)net.synapse_data[slot], slot);
+    network_editor_clear_slot(net, slot);
+    network_editor_mark_slot(editor, slot);
+}
+
+void network_editor_set_weight(NetworkEditor &editor, Network &net, u32 slot, f32 weight) {
+    if (net.synapse_data[slot] < 0) return;
+    net.weight_data[slot] = weight;
+    network_editor_mark_slot(editor, slot);
+}
+
+// Calls fn(begin, end) for each run of sorted indices, joining neighbours at most gap apart
+template <typename Fn> static void network_editor_runs(const u32 *sorted, usize count, u32 gap, Fn fn) {
+    usize k = 0;
+    while (k < count) {
+        u32 begin = sorted[k], last = begin;
+        while (++k < count && sorted[k] - last <= gap + 1) last = sorted[k];
+        fn(begin, last + 1);
+    }
+}
+
+static void network_editor_upload(NetworkEditor &editor, GLuint buffer, usize offset, const void *data, usize size) {
+    stream_buffer_upload(global_stream_buffer, buffer, offset, data, size);
+    editor.flush_runs++;
+    editor.flush_bytes += size;
+}
+
+// Stages every dirty slot and neuron into one allocation of the streaming ring, laid out as edit.comp reads it, and
+// scatters them with a dispatch per kind. False when the ring has no room, the caller uploads runs instead.
+static bool network_editor_scatter(NetworkEditor &editor, Network &net, const f32 *initial) {
+    usize slots = editor.dirty_slot_count, neurons = editor.dirty_neuron_count;
+    bool delays = net.delay_buffer != 0;
+    usize slot_words = slots * 3 + (delays ? (slots + 3) / 4 : 0);
+    usize words = slot_words + neurons * 5;
+    if (words == 0) return true;
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u32 *staged = arena_push_zero<u32>(scratch, words);
+    for (usize k = 0; k < slots; k++) {
+        u32 slot = editor.dirty_slots[k];
+        staged[k] = slot;
+        staged[slots + k] = (u32)net.synapse_data[slot];
+        memcpy(&staged[2 * slots + k], &net.weight_data[slot], sizeof(f32));
+        if (delays) staged[3 * slots + k / 4] |= (u32)net.delay_data[slot] << (k % 4 * 8);
+    }
+    u32 *neuron_words = staged + slot_words;
+    for (usize k = 0; k < neurons; k++) {
+        u32 neuron = editor.dirty_neurons[k];
+        neuron_words[k] = neuron;
+        memcpy(&neuron_words[neurons + k * 4], &net.neuron_data[neuron * 4], 4 * sizeof(f32));
+    }
+
+    usize offset;
+    bool pushed = stream_buffer_push(global_stream_buffer, staged, words * sizeof(u32), &offset);
+    arena_restore(scratch, mark);
+    if (!pushed) return false;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, net.synapse_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, net.weight_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, net.state_buffer);
+    if (delays) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_DELAY_BINDING, net.delay_buffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_DELAY_RING_BINDING, net.delay_ring_buffer);
+    }
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, STREAM_STIMULUS_BINDING, global_stream_buffer.buffer, offset,
+                      words * sizeof(u32));
+    glUseProgram(editor.program);
+    glUniform1i(glGetUniformLocation(editor.program, "with_delays"), delays);
+    glUniform1ui(glGetUniformLocation(editor.program, "delay_slots"), (GLuint)net.delay_slots);
+    glUniform4fv(glGetUniformLocation(editor.program, "initial_state"), 1, initial);
+
+    GLint neuron_pass = glGetUniformLocation(editor.program, "neuron_pass");
+    GLint count = glGetUniformLocation(editor.program, "count");
+    GLint base = glGetUniformLocation(editor.program, "base");
+    if (slots) {
+        glUniform1i(neuron_pass, 0);
+        glUniform1ui(count, (GLuint)slots);
+        glUniform1ui(base, 0);
+        glDispatchCompute((GLuint)((slots + NETWORK_EDIT_WORKGROUP - 1) / NETWORK_EDIT_WORKGROUP), 1, 1);
+        editor.flush_runs++;
+    }
+    if (neurons) {
+        glUniform1i(neuron_pass, 1);
+        glUniform1ui(count, (GLuint)neurons);
+        glUniform1ui(base, (GLuint)slot_words);
+        glDispatchCompute((GLuint)((neurons + NETWORK_EDIT_WORKGROUP - 1) / NETWORK_EDIT_WORKGROUP), 1, 1);
+        editor.flush_runs++;
+    }
+    // The tick copies the neurons with glCopyBufferSubData before its dispatch
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    editor.flush_bytes += words * sizeof(u32);
+    return true;
+}
+
+static void network_editor_flush_gpu(NetworkEditor &editor, Network &net) {
+    if (net.format.weights != WeightFormatF32 || net.format.targets != TargetFormatI32) {
+        warn("Topology edits need f32 weights and 32-bit targets on the GPU, the uploaded rows were not patched");
+        return;
+    }
+    if (net.variant.sell_chunk) {
+        warn("Topology edits are not applied to the SELL copy of the rows, ticking from the padded rows again");
+        network_set_sell(net, nullptr);
+    }
+
+    f32 initial[4] = {neuron_model_initial_potential(net.model), neuron_model_initial_recovery(net.model), 0.0f, 0.0f};
+    if (!editor.program) editor.program = shader_library_compute(global_shader_library, "edit.comp");
+    if (editor.program && network_editor_scatter(editor, net, initial)) return;
+
+    // Too many edits for the ring: one upload per run of each buffer
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+
+    network_editor_runs(editor.dirty_neurons, editor.dirty_neuron_count, 0, [&](u32 begin, u32 end) {
+        usize count = end - begin;
+        network_editor_upload(editor, net.neuron_buffer, begin * 4 * sizeof(f32), &net.neuron_data[begin * 4],
+                              count * 4 * sizeof(f32));
+
+        usize run_mark = arena_mark(scratch);
+        f32 *states = arena_push<f32>(scratch, count * 4);
+        for (usize i = 0; i < count; i++) memcpy(&states[i * 4], initial, sizeof(initial));
+        network_editor_upload(editor, net.state_buffer, begin * 4 * sizeof(f32), states, count * 4 * sizeof(f32));
+        if (net.delay_ring_buffer) {
+            usize slots = count * net.delay_slots;
+            f32 *zeros = arena_push_zero<f32>(scratch, slots);
+            network_editor_upload(editor, net.delay_ring_buffer, begin * net.delay_slots * sizeof(f32), zeros,
+                                  slots * sizeof(f32));
+        }
+        arena_restore(scratch, run_mark);
+    });
+
+    // Nothing on the GPU writes targets or delays, so their runs may re-send a few clean slots to save an upload.
+    // Weights may have been changed by plasticity since they were uploaded, only edited slots are written.
+    network_editor_runs(editor.dirty_slots, editor.dirty_slot_count, NETWORK_EDIT_TARGET_GAP, [&](u32 begin, u32 end) {
+        network_editor_upload(editor, net.synapse_buffer, begin * sizeof(i32), &net.synapse_data[begin],
+                              (end - begin) * sizeof(i32));
+        if (net.delay_buffer) {
+            network_editor_upload(editor, net.delay_buffer, begin, &net.delay_data[begin], end - begin);
+        }
+    });
+    network_editor_runs(editor.dirty_slots, editor.dirty_slot_count, 0, [&](u32 begin, u32 end) {
+        network_editor_upload(editor, net.weight_buffer, begin * sizeof(f32), &net.weight_data[begin],
+                              (end - begin) * sizeof(f32));
+    });
+
+    arena_restore(scratch, mark);
+}
+
+// Rows are read straight from the network, only the per-neuron copies need resetting
+static void network_editor_flush_sim(NetworkEditor &editor, const Network &net, CpuSim &sim) {
+    if (sim.synapses) warn("CpuSim ticks from a NUMA copy of the rows, topology edits are not seen by it");
+
+    for (usize k = 0; k < editor.dirty_neuron_count; k++) {
+        u32 i = editor.dirty_neurons[k];
+        sim.activation[i] = net.neuron_data[i * 4 + 2];
+        sim.threshold[i] = net.neuron_data[i * 4 + 3];
+        sim.potential[i] = neuron_model_initial_potential(net.model);
+        sim.recovery[i] = neuron_model_initial_recovery(net.model);
+        sim.refractory[i] = 0.0f;
+        sim.spikes[i / 64] &= ~(1ull << (i % 64));
+        if (sim.delay_ring) memset(&sim.delay_ring[(usize)i * sim.delay_slots], 0, sim.delay_slots * sizeof(f32));
+    }
+}
+
+void network_editor_flush(NetworkEditor &editor, Network &net, CpuSim *sim) {
+    editor.flush_runs = editor.flush_bytes = editor.flush_swept = 0;
+
+    for (usize k = 0; k < editor.removed_count; k++) {
+        u32 neuron = editor.removed[k];
+        for (u32 slot = editor.out_head[neuron]; slot != NETWORK_EDIT_NONE;) {
+            u32 next = editor.out_next[slot];
+            editor.out_next[slot] = editor.out_prev[slot] = NETWORK_EDIT_NONE;
+            network_editor_clear_slot(net, slot);
+            network_editor_mark_slot(editor, slot);
+            editor.flush_swept++;
+            slot = next;
+        }
+        editor.out_head[neuron] = NETWORK_EDIT_NONE;
+        editor.free_neurons[editor.free_count++] = neuron;
+    }
+    editor.removed_count = 0;
+
+    std::sort(editor.dirty_neurons, editor.dirty_neurons + editor.dirty_neuron_count);
+    std::sort(editor.dirty_slots, editor.dirty_slots + editor.dirty_slot_count);
+
+    if (net.neuron_buffer) network_editor_flush_gpu(editor, net);
+    if (sim) network_editor_flush_sim(editor, net, *sim);
+
+    u32 fan_in = editor.columns <= 4 ? 4 : editor.columns <= 8 ? 8 : MAX_SYNAPSES;
+    if (net.neuron_buffer && fan_in > net.variant.fan_in) {
+        net.variant.fan_in = fan_in;
+        net.program = kernel_cache_program(global_kernel_cache, net.variant);
+    }
+    if (sim && fan_in > sim->variant.fan_in) sim->variant.fan_in = fan_in;
+
+    network_editor_clear_dirty(editor);
+}
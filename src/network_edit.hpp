@@ -0,0 +1,82 @@
+#pragma once
+
+#include "core/types.h"
+#include "cpu_sim.hpp"
+#include "neural_net.hpp"
+
+#define NETWORK_EDIT_NONE 0xFFFFFFFFu
+#define NETWORK_EDIT_TARGET_GAP 8 // clean target slots a flush re-sends to join two dirty runs into one upload
+
+// Adds and removes neurons and synapses of a live network without re-uploading it. Every neuron slot exists in the
+// buffers, dead ones have no synapses, an unreachable threshold and activation 0, so the tick kernels need no idea of
+// liveness. Free slots are kept on a stack. Synapses go into the first free column of their row, which keeps rows
+// packed at the front and the kernel's fan-in small.
+//
+// Edits change the host arrays at once and note which neurons and synapse slots they touched. network_editor_flush
+// stages those into one allocation of the streaming ring and edit.comp scatters them, one dispatch for the slots and
+// one for the neurons, so a flush moves bytes in proportion to the edits rather than the network and never re-sends
+// entries the GPU may have written itself (weights under plasticity). A flush too large for the ring falls back to
+// sorted runs, one upload per run and buffer, where target and delay runs may bridge small clean gaps.
+//
+// Removed neurons are only recycled by the next flush, which also clears every synapse still reading them. Each
+// neuron keeps a list of the synapse slots that read it, linked through the slots, so that costs the removed neurons'
+// fan-out rather than a pass over the rows. Synapse edits cost only themselves. The rows must only change through
+// the editor while it is in use, or the lists go stale.
+struct NetworkEditor {
+    usize capacity; // neuron slots, the network's neuron_count
+
+    u32 *free_neurons; // stack of dead slots ready for reuse
+    usize free_count;
+    u64 *alive; // bitset over slots
+
+    u32 *removed; // removed since the last flush, not yet free
+    usize removed_count;
+
+    // Deduplicated by their bitsets, sorted by the flush
+    u32 *dirty_neurons; // neuron_data, model state and delay ring of the slot
+    usize dirty_neuron_count;
+    u64 *dirty_neuron_bits;
+    u32 *dirty_slots; // synapse slots, row * MAX_SYNAPSES + column: target, weight and delay
+    usize dirty_slot_count;
+    usize dirty_slot_capacity;
+    u64 *dirty_slot_bits;
+
+    // Outgoing synapses: per neuron the first slot reading it, per slot the next and previous slots reading the same
+    // neuron, NETWORK_EDIT_NONE at either end and on empty slots
+    u32 *out_head;
+    u32 *out_next;
+    u32 *out_prev;
+
+    u32 columns; // widest row in use, the tick kernels' fan-in must cover it
+    GLuint program; // edit.comp, compiled by the first flush of an uploaded network
+
+    // Last flush
+    usize flush_runs; // scatter dispatches, or uploads on the fallback path
+    usize flush_bytes;
+    usize flush_swept; // synapses cleared because their presynaptic neuron was removed
+};
+
+// Every neuron of net starts alive, with no free slots until some are removed or reserved
+void network_editor_init(NetworkEditor &editor, const Network &net);
+void network_editor_deinit(NetworkEditor &editor);
+
+// Grows net to capacity neuron slots, the new ones dead and free. An uploaded network is uploaded again in full and
+// restarts from the host state, CpuSims and anything else sized by neuron_count must be made again.
+void network_editor_reserve(NetworkEditor &editor, Network &net, usize capacity);
+
+// Brings a free slot to life with no synapses, NETWORK_EDIT_NONE when none is free
+u32 network_editor_add_neuron(NetworkEditor &editor, Network &net, f32 x, f32 y, f32 threshold,
+                              Neuron::Kind kind = Neuron::Hidden);
+// Clears the neuron's row and activation. Synapses of other neurons that read it go at the next flush.
+void network_editor_remove_neuron(NetworkEditor &editor, Network &net, u32 neuron);
+
+// Makes neuron read source with weight, arriving delay ticks later (capped at net.delay_slots, 0 without delays).
+// Returns the synapse slot, NETWORK_EDIT_NONE when the row is full or either neuron is dead.
+u32 network_editor_add_synapse(NetworkEditor &editor, Network &net, u32 neuron, u32 source, f32 weight,
+                               u8 delay = 0);
+void network_editor_remove_synapse(NetworkEditor &editor, Network &net, u32 slot);
+void network_editor_set_weight(NetworkEditor &editor, Network &net, u32 slot, f32 weight);
+
+// Writes the edits since the last flush to the GPU copy, when net is uploaded, and to sim, when given. sim must tick
+// from the network's own rows, not a NUMA copy of them. Widens the kernels' fan-in when rows outgrew it.
+void network_editor_flush(NetworkEditor &editor, Network &net, CpuSim *sim = nullptr);
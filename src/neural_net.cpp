@@ -1,87 +1,133 @@
 #include "neural_net.hpp"
 
+#include "sell.hpp"
 #include "serialize.hpp"
+#include "shader.hpp"
+#include "streaming.hpp"
+#include "topology.hpp"
 
 #include <string.h>
 
-const char *compute_shader_source = R"(
-#version 430
-
-layout(local_size_x = 256) in;
-
-layout(std430, binding = 0) buffer NeuronData {
-  vec4 neurons[]; // x,y = position, z = activation, w = threshold
-};
-
-layout(std430, binding = 1) buffer SynapseData {
-  int synapses[];
-};
-
-layout(std430, binding = 2) buffer WeightData {
-  float weights[]; 
-};
-
-uniform float delta_t;
-
-void main() {
-  uint neuronId = gl_GlobalInvocationID.x;
-  if (neuronId >= neurons.length()) return;
-
-  // Get current neuron data
-  vec4 neuron = neurons[neuronId];
-  float activation = neuron.z;
-  float threshold = neuron.w;
-
-  // Sum inputs from connected neurons
-  float input_sum = 0.0;
-  uint synapse_offset = neuronId * 16;  // MAX_SYNAPSES
+// Delays packed four to a uint as the compute shader reads them, and a zeroed ring of pending input
+static void network_create_delay_buffers(Network &net) {
+    if (net.delay_buffer) {
+        GLuint buffers[] = {net.delay_buffer, net.delay_ring_buffer};
+        glDeleteBuffers(2, buffers);
+        net.delay_buffer = net.delay_ring_buffer = 0;
+    }
+    net.delay_tick = 0;
+    if (!net.delay_data) return;
+
+    usize slots = net.neuron_count * MAX_SYNAPSES;
+    glGenBuffers(1, &net.delay_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.delay_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, slots, net.delay_data, GL_STATIC_DRAW); // rows are 16 bytes
+
+    glGenBuffers(1, &net.delay_ring_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.delay_ring_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, net.neuron_count * net.delay_slots * sizeof(f32), nullptr, GL_DYNAMIC_COPY);
+    f32 zero = 0.0f;
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, &zero);
+}
 
-  // Update activation
-  if (input_sum > threshold) {
-    activation = 1.0;
-  } else {
-    // activation *= 0.95;  // Decay
-    activation *= 0.9;  // Decay
-  }
+// Zeroed handles mean nothing to delete, so a host-only network never touches GL
+static void network_reset_remote_handles(Network &net) {
+    net.neuron_buffer = net.synapse_buffer = net.weight_buffer = net.state_buffer = 0;
+    net.scale_buffer = 0;
+    net.previous_buffer = 0;
+    net.spike_buffer = net.next_spike_buffer = 0;
+    net.sell.targets = net.sell.weights = net.sell.rows = net.sell.chunks = 0;
+    net.delay_buffer = net.delay_ring_buffer = 0;
+}
 
-  // Store updated activation
-  neurons[neuronId].z = activation;
+void network_release_remote_resources(Network &net) {
+    GLuint buffers[] = {net.neuron_buffer, net.synapse_buffer, net.weight_buffer,    net.state_buffer,
+                        net.scale_buffer,  net.previous_buffer, net.spike_buffer,   net.next_spike_buffer,
+                        net.sell.targets,  net.sell.weights,    net.sell.rows,      net.sell.chunks,
+                        net.delay_buffer,  net.delay_ring_buffer};
+    bool any = false;
+    for (GLuint buffer : buffers) any |= buffer != 0;
+    if (any) glDeleteBuffers(sizeof(buffers) / sizeof(buffers[0]), buffers); // zero names are ignored
+    network_reset_remote_handles(net);
 }
-)";
 
 void network_init_remote_resources(Network &net, usize neuron_data_size, usize synapse_data_size,
                                    usize weight_data_size) {
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+
+    // Uploading again replaces the previous copy instead of leaking it
+    network_release_remote_resources(net);
+
     // Create OpenGL buffers
     glGenBuffers(1, &net.neuron_buffer);
+    glGenBuffers(1, &net.previous_buffer);
     glGenBuffers(1, &net.synapse_buffer);
     glGenBuffers(1, &net.weight_buffer);
 
     // Initialize buffers
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.neuron_buffer);
     glBufferData(GL_SHADER_STORAGE_BUFFER, neuron_data_size, net.neuron_data, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.previous_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, neuron_data_size, nullptr, GL_DYNAMIC_COPY);
+
+    // Synapse rows are re-encoded when the network asks for a narrower storage format
+    net.format = storage_format_resolve(net.format, net.neuron_count);
+    network_create_delay_buffers(net);
 
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.synapse_buffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, synapse_data_size, net.synapse_data, GL_STATIC_DRAW);
+    if (net.format.targets == TargetFormatI32) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, synapse_data_size, net.synapse_data, GL_STATIC_DRAW);
+    } else {
+        void *targets;
+        usize size = compact_pack_targets(net, net.format.targets, scratch, &targets);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, targets, GL_STATIC_DRAW);
+    }
 
+    // Plasticity rewrites weights on the GPU every few ticks
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.weight_buffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, weight_data_size, net.weight_data, GL_STATIC_DRAW);
-}
+    if (net.format.weights == WeightFormatF32) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, weight_data_size, net.weight_data, GL_DYNAMIC_COPY);
+    } else {
+        void *weights;
+        f32 *row_scale;
+        usize size = compact_pack_weights(net, net.format.weights, scratch, &weights, &row_scale);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, weights, GL_STATIC_DRAW);
+
+        if (row_scale) {
+            glGenBuffers(1, &net.scale_buffer);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.scale_buffer);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, net.neuron_count * sizeof(f32), row_scale, GL_STATIC_DRAW);
+        }
+    }
 
-void network_init_shaders(Network &net) {
-    GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
-    glShaderSource(shader, 1, &compute_shader_source, NULL);
-    glCompileShader(shader);
-    check_shader_compilation(shader);
+    // Model state only lives on the GPU, the host engine keeps its own copy in CpuSim
+    f32 *state_data = arena_push<f32>(scratch, net.neuron_count * 4);
+    for (usize i = 0; i < net.neuron_count; i++) {
+        state_data[i * 4 + 0] = neuron_model_initial_potential(net.model);
+        state_data[i * 4 + 1] = neuron_model_initial_recovery(net.model);
+        state_data[i * 4 + 2] = 0.0f;
+        state_data[i * 4 + 3] = 0.0f;
+    }
+
+    glGenBuffers(1, &net.state_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.state_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, net.neuron_count * 4 * sizeof(f32), state_data, GL_DYNAMIC_COPY);
 
-    net.program = glCreateProgram();
-    glAttachShader(net.program, shader);
-    glLinkProgram(net.program);
+    arena_restore(scratch, mark);
+}
 
-    glDeleteShader(shader);
+// Tick programs come from the kernel cache, so networks with the same variant share one compiled program
+void network_init_shaders(Network &net) {
+    net.variant = kernel_variant_for(net);
+    net.program = kernel_cache_program(global_kernel_cache, net.variant);
+    net.stimulate_program = shader_library_compute(global_shader_library, "stimulate.comp");
 }
 
-void network_init(Network &net, usize neuron_count) {
+static void network_alloc(Network &net, usize neuron_count, const NeuronModelParams &model) {
     net.neuron_count = neuron_count;
+    net.model = model;
+    net.format = storage_format_default();
 
     // Allocate host memory
     usize neuron_data_size = neuron_count * 4 * sizeof(float); // vec4 per neuron
@@ -91,6 +137,16 @@ void network_init(Network &net, usize neuron_count) {
     net.neuron_data = (f32 *)malloc(neuron_data_size);
     net.synapse_data = (i32 *)malloc(synapse_data_size);
     net.weight_data = (f32 *)malloc(weight_data_size);
+    net.kind_data = (Neuron::Kind *)malloc(neuron_count * sizeof(Neuron::Kind));
+    net.delay_data = nullptr;
+    net.delay_slots = 0;
+    net.id_of_index = nullptr;
+    net.index_of_id = nullptr;
+    network_reset_remote_handles(net);
+}
+
+void network_init_host(Network &net, usize neuron_count, const NeuronModelParams &model) {
+    network_alloc(net, neuron_count, model);
 
     // Initialize neurons in a spiral pattern
     for (usize i = 0; i < neuron_count; i++) {
@@ -102,6 +158,7 @@ void network_init(Network &net, usize neuron_count) {
         net.neuron_data[i * 4 + 1] = sin(angle) * radius;
         net.neuron_data[i * 4 + 2] = 0.0f; // activation
         net.neuron_data[i * 4 + 3] = 0.5f; // threshold
+        net.kind_data[i] = Neuron::Hidden;
 
         // Random connections
         for (int j = 0; j < MAX_SYNAPSES; j++) {
@@ -114,108 +171,360 @@ void network_init(Network &net, usize neuron_count) {
             }
         }
     }
+}
+
+// Packs CSR rows into the padded MAX_SYNAPSES-wide layout, rows longer than that are truncated
+void network_init_host(Network &net, const Topology &topo, const NeuronModelParams &model) {
+    network_alloc(net, topo.neuron_count, model);
+
+    usize truncated = 0;
+    for (usize i = 0; i < topo.neuron_count; i++) {
+        net.neuron_data[i * 4 + 0] = topo.positions[i * 2 + 0];
+        net.neuron_data[i * 4 + 1] = topo.positions[i * 2 + 1];
+        net.neuron_data[i * 4 + 2] = 0.0f; // activation
+        net.neuron_data[i * 4 + 3] = 0.5f; // threshold
+        net.kind_data[i] = topo.kinds[i];
+
+        u32 row_begin = topo.offsets[i];
+        u32 row_length = topo.offsets[i + 1] - row_begin;
+        if (row_length > MAX_SYNAPSES) truncated += row_length - MAX_SYNAPSES;
+
+        for (u32 j = 0; j < MAX_SYNAPSES; j++) {
+            if (j < row_length) {
+                net.synapse_data[i * MAX_SYNAPSES + j] = topo.targets[row_begin + j];
+                net.weight_data[i * MAX_SYNAPSES + j] = topo.weights[row_begin + j];
+            } else {
+                net.synapse_data[i * MAX_SYNAPSES + j] = -1;
+                net.weight_data[i * MAX_SYNAPSES + j] = 0.0f;
+            }
+        }
+    }
+
+    if (truncated > 0) {
+        warn("Dropped %zu synapses beyond MAX_SYNAPSES (%d) per neuron", truncated, MAX_SYNAPSES);
+    }
+}
+
+void network_upload(Network &net) {
+    usize neuron_data_size = net.neuron_count * 4 * sizeof(float); // vec4 per neuron
+    usize synapse_data_size = net.neuron_count * MAX_SYNAPSES * sizeof(int);
+    usize weight_data_size = net.neuron_count * MAX_SYNAPSES * sizeof(float);
 
     network_init_remote_resources(net, neuron_data_size, synapse_data_size, weight_data_size);
     network_init_shaders(net);
 }
 
+void network_init(Network &net, usize neuron_count, const NeuronModelParams &model) {
+    network_init_host(net, neuron_count, model);
+    network_upload(net);
+}
+
+void network_init(Network &net, const Topology &topo, const NeuronModelParams &model) {
+    network_init_host(net, topo, model);
+    network_upload(net);
+}
+
 void network_deinit(Network &net) {
+    network_release_remote_resources(net);
     free(net.neuron_data);
     free(net.synapse_data);
     free(net.weight_data);
+    free(net.kind_data);
+    free(net.delay_data);
+    free(net.id_of_index);
+    free(net.index_of_id);
+}
+
+// Header and neuron count, then neuron vec4s, targets, weights and, from version 2, one byte per neuron kind
+static usize network_image_size(usize neuron_count, bool kinds) {
+    usize neuron_data_size = neuron_count * 4 * sizeof(f32);
+    usize synapse_data_size = neuron_count * MAX_SYNAPSES * sizeof(i32);
+    usize weight_data_size = neuron_count * MAX_SYNAPSES * sizeof(f32);
+    return sizeof(usize) * 2 + neuron_data_size + synapse_data_size + weight_data_size + (kinds ? neuron_count : 0);
 }
 
-const u8 *network_serialize(Network &net) {
+const u8 *network_serialize(Network &net, Arena &arena) {
     usize neuron_data_size = net.neuron_count * 4 * sizeof(f32); // vec4 per neuron
     usize synapse_data_size = net.neuron_count * MAX_SYNAPSES * sizeof(i32);
     usize weight_data_size = net.neuron_count * MAX_SYNAPSES * sizeof(f32);
-    usize total_size = sizeof(usize) * 2 + neuron_data_size + synapse_data_size + weight_data_size;
+    usize total_size = network_image_size(net.neuron_count, true);
 
-    u8 *data = static_cast<u8 *>(calloc(total_size, sizeof(u8)));
+    u8 *data = arena_push_zero<u8>(arena, total_size, alignof(usize));
+    if (!data) return nullptr;
 
     usize *header = reinterpret_cast<usize *>(data);
     usize *neuron_count = reinterpret_cast<usize *>(data + sizeof(usize));
     f32 *neuron_data = reinterpret_cast<f32 *>(data + sizeof(usize) * 2);
-    i32 *synapse_data = reinterpret_cast<i32 *>(data + +sizeof(usize) * 2 + neuron_data_size);
+    i32 *synapse_data = reinterpret_cast<i32 *>(data + sizeof(usize) * 2 + neuron_data_size);
     f32 *weight_data = reinterpret_cast<f32 *>(data + sizeof(usize) * 2 + neuron_data_size + synapse_data_size);
+    u8 *kind_data = data + sizeof(usize) * 2 + neuron_data_size + synapse_data_size + weight_data_size;
 
     *header = BIN_MAGIC;
     *neuron_count = net.neuron_count;
     memcpy(neuron_data, net.neuron_data, neuron_data_size);
     memcpy(synapse_data, net.synapse_data, synapse_data_size);
     memcpy(weight_data, net.weight_data, weight_data_size);
+    for (usize i = 0; i < net.neuron_count; i++) kind_data[i] = (u8)net.kind_data[i];
 
     return data;
 }
 
-bool network_deserialize(Network &net, const u8 *data, usize len) {
+bool network_deserialize(Network &net, const u8 *data, usize len, const NeuronModelParams &model) {
     if (len < 2 * sizeof(usize)) {
         return false;
     }
 
     const usize *header = reinterpret_cast<const usize *>(data);
-    if (*header != BIN_MAGIC) {
+    if (*header != BIN_MAGIC && *header != BIN_MAGIC_V1) {
         return false;
     }
+    bool kinds = *header != BIN_MAGIC_V1;
 
     const usize *neuron_count = reinterpret_cast<const usize *>(data + sizeof(usize));
-    usize neuron_data_size = *neuron_count * sizeof(Neuron);
+    usize neuron_data_size = *neuron_count * 4 * sizeof(f32); // vec4 per neuron, as written by network_serialize
     usize synapse_data_size = *neuron_count * MAX_SYNAPSES * sizeof(i32);
     usize weight_data_size = *neuron_count * MAX_SYNAPSES * sizeof(f32);
-    usize expected_size = sizeof(usize) * 2 + neuron_data_size + synapse_data_size + weight_data_size;
+    const u8 *kind_data = data + sizeof(usize) * 2 + neuron_data_size + synapse_data_size + weight_data_size;
 
-    if (len != expected_size) {
+    if (len != network_image_size(*neuron_count, kinds)) {
         return false;
     }
+    for (usize i = 0; kinds && i < *neuron_count; i++) {
+        if (kind_data[i] > Neuron::Output) return false;
+    }
 
-    net.neuron_count = *neuron_count;
+    network_alloc(net, *neuron_count, model);
     memcpy(net.neuron_data, data + sizeof(usize) * 2, neuron_data_size);
     memcpy(net.synapse_data, data + neuron_data_size + sizeof(usize) * 2, synapse_data_size);
     memcpy(net.weight_data, data + neuron_data_size + synapse_data_size + sizeof(usize) * 2, weight_data_size);
-
-    network_init_remote_resources(net, neuron_data_size, synapse_data_size, weight_data_size);
-    network_init_shaders(net);
+    for (usize i = 0; i < net.neuron_count; i++) {
+        net.kind_data[i] = kinds ? (Neuron::Kind)kind_data[i] : Neuron::Hidden; // version 1 images carry no kinds
+    }
 
     return true;
 }
 
 usize network_bin_size(Network &net) {
-    usize neuron_data_size = net.neuron_count * 4 * sizeof(f32); // vec4 per neuron
-    usize synapse_data_size = net.neuron_count * MAX_SYNAPSES * sizeof(i32);
-    usize weight_data_size = net.neuron_count * MAX_SYNAPSES * sizeof(f32);
-    return sizeof(usize) * 2 + neuron_data_size + synapse_data_size + weight_data_size;
+    return network_image_size(net.neuron_count, true);
 }
 
-void network_update(Network &net) {
-    static int frame = 0;
-    if (frame++ % 120 == 0) { // Every 120 frames
-        // Stimulate neuron 0
-        net.neuron_data[2] = 1.0f; // Set activation to max
+void network_stimulate(Network &net, const u32 *indices, usize count, f32 value) {
+    for (usize i = 0; i < count; i++) net.neuron_data[indices[i] * 4 + 2] = value;
+    if (count == 0) return;
+
+    // Binary ticks read spike bits, not activations, so those are set too, at the threshold network_set_binary uses
+    bool binary = net.variant.binary;
+
+    // One dispatch reading the indices out of the streaming buffer instead of a glBufferSubData per neuron
+    usize offset;
+    if (net.stimulate_program && stream_buffer_push(global_stream_buffer, indices, count * sizeof(u32), &offset)) {
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_buffer);
+        if (binary) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_SPIKE_BINDING, net.spike_buffer);
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, STREAM_STIMULUS_BINDING, global_stream_buffer.buffer, offset,
+                          count * sizeof(u32));
+        glUseProgram(net.stimulate_program);
+        glUniform1ui(glGetUniformLocation(net.stimulate_program, "count"), (GLuint)count);
+        glUniform1f(glGetUniformLocation(net.stimulate_program, "value"), value);
+        glUniform1i(glGetUniformLocation(net.stimulate_program, "binary"), binary);
+        glDispatchCompute((GLuint)((count + 63) / 64), 1, 1);
+        // The tick copies the neurons with glCopyBufferSubData before its dispatch
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        return;
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.neuron_buffer);
+    for (usize i = 0; i < count; i++) {
+        usize slot = indices[i] * 4 + 2;
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, slot * sizeof(f32), sizeof(f32), &net.neuron_data[slot]);
+    }
+    if (!binary) return;
+
+    // Bits share words with their neighbours, whose state only the GPU knows
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.spike_buffer);
+    for (usize i = 0; i < count; i++) {
+        u32 word, bit = 1u << (indices[i] % 32);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, indices[i] / 32 * sizeof(u32), sizeof(u32), &word);
+        word = value >= 1.0f ? word | bit : word & ~bit;
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, indices[i] / 32 * sizeof(u32), sizeof(u32), &word);
+    }
+}
 
-        // Upload the changed data
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.neuron_buffer);
-        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_count * 4 * sizeof(float), net.neuron_data);
+void network_set_precision(Network &net, KernelPrecision precision) {
+    net.variant.precision = precision;
+    net.program = kernel_cache_program(global_kernel_cache, net.variant);
+}
+
+void network_set_sell(Network &net, const SellSynapses *sell) {
+    if (net.sell.targets) {
+        GLuint buffers[] = {net.sell.targets, net.sell.weights, net.sell.rows, net.sell.chunks};
+        glDeleteBuffers(4, buffers);
+        net.sell.targets = net.sell.weights = net.sell.rows = net.sell.chunks = 0;
+    }
+
+    if (sell && (net.format.weights != WeightFormatF32 || net.format.targets != TargetFormatI32)) {
+        warn("SELL rows need f32 weights and i32 targets, keeping the padded rows");
+        sell = nullptr;
     }
+    if (sell && net.variant.delay_slots) {
+        warn("SELL rows carry no delays, keeping the padded rows");
+        sell = nullptr;
+    }
+
+    net.variant.sell_chunk = sell ? sell->chunk : 0;
+    net.program = kernel_cache_program(global_kernel_cache, net.variant);
+    if (!sell) return;
+
+    GLuint buffers[4];
+    glGenBuffers(4, buffers);
+    net.sell.targets = buffers[0];
+    net.sell.weights = buffers[1];
+    net.sell.rows = buffers[2];
+    net.sell.chunks = buffers[3];
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.sell.targets);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sell->entry_count * sizeof(i32), sell->targets, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.sell.weights);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sell->entry_count * sizeof(f32), sell->weights, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.sell.rows);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sell->chunk_count * sell->chunk * sizeof(u32), sell->rows, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.sell.chunks);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sell->chunk_count * 2 * sizeof(u32), sell->chunks, GL_STATIC_DRAW);
+}
+
+void network_set_delays(Network &net, const u8 *delays) {
+    usize slots = net.neuron_count * MAX_SYNAPSES;
+    u32 longest = 0;
+    usize capped = 0;
+    if (delays) {
+        if (!net.delay_data) net.delay_data = (u8 *)malloc(slots);
+        for (usize i = 0; i < slots; i++) {
+            u8 delay = delays[i] > NETWORK_MAX_DELAY ? NETWORK_MAX_DELAY : delays[i];
+            capped += delay != delays[i];
+            net.delay_data[i] = delay;
+            if (delay > longest) longest = delay;
+        }
+    }
+    if (capped > 0) warn("Capped %zu synapse delays at %d ticks", capped, NETWORK_MAX_DELAY);
+
+    if (longest == 0) {
+        free(net.delay_data);
+        net.delay_data = nullptr;
+    }
+    net.delay_slots = longest;
+}
 
+void network_upload_delays(Network &net) {
+    if (net.delay_data && net.variant.sell_chunk) network_set_sell(net, nullptr);
+    network_create_delay_buffers(net);
+    net.variant.delay_slots = net.delay_slots;
+    net.program = kernel_cache_program(global_kernel_cache, net.variant);
+}
+
+void network_set_binary(Network &net, bool binary) {
+    net.variant.binary = binary;
+    net.program = kernel_cache_program(global_kernel_cache, net.variant);
+    if (!binary) return;
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    usize words = (net.neuron_count + 31) / 32;
+    u32 *bits = arena_push_zero<u32>(scratch, words);
+    for (usize i = 0; i < net.neuron_count; i++) {
+        bits[i / 32] |= (u32)(net.neuron_data[i * 4 + 2] >= 1.0f) << (i % 32);
+    }
+
+    if (!net.spike_buffer) {
+        glGenBuffers(1, &net.spike_buffer);
+        glGenBuffers(1, &net.next_spike_buffer);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.spike_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, words * sizeof(u32), bits, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.next_spike_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, words * sizeof(u32), nullptr, GL_DYNAMIC_COPY);
+    arena_restore(scratch, mark);
+}
+
+void network_tick(Network &net) {
     glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_buffer);
-    glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, net.synapse_buffer);
-    glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, net.weight_buffer);
+    glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, net.variant.sell_chunk ? net.sell.targets : net.synapse_buffer);
+    glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, net.variant.sell_chunk ? net.sell.weights : net.weight_buffer);
+    glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, net.state_buffer);
+    if (net.variant.sell_chunk) {
+        glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_SELL_ROW_BINDING, net.sell.rows);
+        glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_SELL_CHUNK_BINDING, net.sell.chunks);
+    }
+    if (net.scale_buffer) glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, net.scale_buffer);
+    if (net.variant.delay_slots) {
+        glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_DELAY_BINDING, net.delay_buffer);
+        glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_DELAY_RING_BINDING, net.delay_ring_buffer);
+    }
+
+    // Binary kernels read last tick's bits and set this tick's, the others gather from a snapshot instead of the
+    // buffer they are writing
+    if (net.variant.binary) {
+        GLuint zero = 0;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.next_spike_buffer);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+        glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_SPIKE_BINDING, net.spike_buffer);
+        glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_NEXT_SPIKE_BINDING, net.next_spike_buffer);
+    } else {
+        glBindBuffer(GL_COPY_READ_BUFFER, net.neuron_buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, net.previous_buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, net.neuron_count * 4 * sizeof(f32));
+        glad_glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NETWORK_PREVIOUS_BINDING, net.previous_buffer);
+    }
 
     GLint delta_t_location = glGetUniformLocation(net.program, "delta_t");
     glUseProgram(net.program);
     glUniform1f(delta_t_location, 0.016f); // ~60fps
 
-    glUseProgram(net.program);
-    glDispatchCompute((net.neuron_count + 255) / 256, 1, 1);
+    // Programs are shared between networks, so model parameters are set per dispatch. Uniforms the variant does
+    // not use resolve to -1 and are ignored.
+    const NeuronModelParams &model = net.model;
+    glUniform1f(glGetUniformLocation(net.program, "input_gain"), model.input_gain);
+    glUniform1f(glGetUniformLocation(net.program, "inverse_tau"), 1.0f / model.tau); // rounded as the CPU kernel
+    glUniform1f(glGetUniformLocation(net.program, "v_rest"), model.v_rest);
+    glUniform1f(glGetUniformLocation(net.program, "v_reset"), model.v_reset);
+    glUniform1f(glGetUniformLocation(net.program, "refractory_ticks"), model.refractory_ticks);
+    glUniform1f(glGetUniformLocation(net.program, "a"), model.a);
+    glUniform1f(glGetUniformLocation(net.program, "b"), model.b);
+    glUniform1f(glGetUniformLocation(net.program, "c"), model.c);
+    glUniform1f(glGetUniformLocation(net.program, "d"), model.d);
+    glUniform1ui(glGetUniformLocation(net.program, "delay_tick"), net.delay_tick);
+
+    // SELL rows run one invocation per sorted slot, padded to whole chunks
+    usize chunk = net.variant.sell_chunk;
+    usize invocations = chunk ? (net.neuron_count + chunk - 1) / chunk * chunk : net.neuron_count;
+    glDispatchCompute((GLuint)((invocations + net.variant.workgroup_size - 1) / net.variant.workgroup_size), 1, 1);
 
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
 
-    // // Read back the updated data from GPU
-    // glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_count * 4 * sizeof(f32), net.neuron_data);
+    if (net.variant.binary) {
+        GLuint spikes = net.spike_buffer;
+        net.spike_buffer = net.next_spike_buffer;
+        net.next_spike_buffer = spikes;
+    }
+    if (net.variant.delay_slots) net.delay_tick = (net.delay_tick + 1) % net.variant.delay_slots;
+}
 
-    // Read back activation values
-    for (usize i = 0; i < net.neuron_count; i++) {
-        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, (i * 4 + 2) * sizeof(f32), sizeof(f32),
-                           &net.neuron_data[i * 4 + 2]);
+void network_update(Network &net, bool stimulate) {
+    static int frame = 0;
+    if (stimulate && frame++ % 120 == 0) { // Every 120 frames
+        // Stimulate neuron 0, only its activation changes so the rest of the buffer is not re-uploaded
+        u32 stimulus = (u32)network_index_of(net, 0);
+        network_stimulate(net, &stimulus, 1, 1.0f);
     }
+
+    network_tick(net);
+}
+
+void network_read_neuron(Network &net, usize index) {
+    if (index >= net.neuron_count) return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.neuron_buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, index * 4 * sizeof(f32), 4 * sizeof(f32), &net.neuron_data[index * 4]);
+}
+
+void network_read_neurons(Network &net) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, net.neuron_buffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_count * 4 * sizeof(f32), net.neuron_data);
 }
@@ -1,37 +1,80 @@
 #pragma once
 
+#include "core/arena.h"
 #include "core/logger.h"
 #include "core/types.h"
+#include "kernel_variant.hpp"
+#include "neuron_model.hpp"
 #include "shader.hpp"
+#include "storage_format.hpp"
 
 #include <cmath>
 #include <cstdlib>
 
 #define MAX_NEURONS 2048
 #define MAX_SYNAPSES 16
+#define NETWORK_PREVIOUS_BINDING 11
+#define NETWORK_SPIKE_BINDING 12
+#define NETWORK_NEXT_SPIKE_BINDING 13
+#define NETWORK_SELL_ROW_BINDING 14
+#define NETWORK_SELL_CHUNK_BINDING 15
+#define NETWORK_DELAY_BINDING 16
+#define NETWORK_DELAY_RING_BINDING 17
+#define NETWORK_MAX_DELAY 64 // ticks, delays are stored as one byte per synapse slot
+
+struct Neuron {
+    enum Kind {
+        Input,
+        Hidden,
+        Output,
+    };
+
+    Kind kind;
+    f32 activation;
+    f32 threshold;
+};
 
 struct Network {
     GLuint program;
+    GLuint stimulate_program; // scatters activations from index lists in the streaming buffer
     GLuint neuron_buffer;
     GLuint synapse_buffer;
     GLuint weight_buffer;
+    GLuint state_buffer;
+    GLuint scale_buffer; // Q8 row scales, 0 for other weight formats
+    GLuint previous_buffer; // activations at the start of the tick, the kernel gathers from it
+    GLuint spike_buffer;    // binary spike bitsets, swapped every tick, 0 until binary mode is selected
+    GLuint next_spike_buffer;
+
+    struct { // SELL-C-sigma copy of the rows, bound in place of the padded ones while variant.sell_chunk is set
+        GLuint targets;
+        GLuint weights;
+        GLuint rows;
+        GLuint chunks;
+    } sell;
+
+    GLuint delay_buffer;      // delay_data packed four per uint, 0 while every synapse is instantaneous
+    GLuint delay_ring_buffer; // delay_slots floats of pending input per neuron
+    u32 delay_tick;           // ring entry the next GPU tick reads
+
+    NeuronModelParams model;
+    KernelVariant variant;
+    StorageFormat format; // encoding of the uploaded synapse rows, set before network_upload
 
     f32 *neuron_data;
     i32 *synapse_data;
     f32 *weight_data;
+    Neuron::Kind *kind_data;
     usize neuron_count;
-};
 
-struct Neuron {
-    enum Kind {
-        Input,
-        Hidden,
-        Output,
-    };
+    // Ticks before each synapse slot's input reaches its neuron, parallel to weight_data. 0 arrives in the tick the
+    // presynaptic neuron fired in, as every synapse does while delay_data is null. delay_slots is the longest delay.
+    u8 *delay_data;
+    u32 delay_slots;
 
-    Kind kind;
-    f32 activation;
-    f32 threshold;
+    // ID translation after reordering, null while neurons are still in creation order
+    u32 *id_of_index;
+    u32 *index_of_id;
 };
 
 struct NeuronTwo {
@@ -73,11 +116,62 @@ struct NetworkTwo {
     } compute;
 };
 
-void network_init(Network &net, usize neuron_count);
+struct Topology;
+
+void network_init(Network &net, usize neuron_count,
+                  const NeuronModelParams &model = neuron_model_default_params(NeuronModelThreshold));
+void network_init(Network &net, const Topology &topo,
+                  const NeuronModelParams &model = neuron_model_default_params(NeuronModelThreshold));
+void network_init_host(Network &net, usize neuron_count,
+                       const NeuronModelParams &model = neuron_model_default_params(NeuronModelThreshold));
+void network_init_host(Network &net, const Topology &topo,
+                       const NeuronModelParams &model = neuron_model_default_params(NeuronModelThreshold));
+// Creates the GL buffers from the host arrays, replacing any the network already has
+void network_upload(Network &net);
+// Deletes the GL buffers and zeroes their handles, the host arrays stay
+void network_release_remote_resources(Network &net);
+// Frees the host arrays and releases the GL buffers, which needs the context the network was uploaded in
 void network_deinit(Network &net);
 bool save(Network &net, const char *path);
 bool load(Network &net, const char *path);
-const u8 *serialize(Network &net);
-bool deserialize(Network &net, const u8 *data, usize len);
+// Writes the binary image into arena, valid until the arena is reset or restored past it
+const u8 *network_serialize(Network &net, Arena &arena);
+// Allocates net's host arrays from a network_serialize image, call network_upload for the GPU copy. net must be new or
+// deinitialised, loading over a live network would lose its arrays and buffers.
+bool network_deserialize(Network &net, const u8 *data, usize len,
+                         const NeuronModelParams &model = neuron_model_default_params(NeuronModelThreshold));
 usize network_bin_size(Network &net);
-void network_update(Network &net);
+// Stimulates neuron 0 every 120 calls unless the caller drives the inputs itself, and ticks. Nothing is read back,
+// GpuStats follows the aggregates and the readers below fetch neurons when the host needs them.
+void network_update(Network &net, bool stimulate = true);
+// Copy one neuron, or all of them, from the GPU into neuron_data. Both wait for the GPU to finish its queued ticks.
+void network_read_neuron(Network &net, usize index);
+void network_read_neurons(Network &net);
+// One dispatch of the tick kernel and nothing else, the results stay on the GPU
+void network_tick(Network &net);
+// Switches the tick kernel's accumulation
+void network_set_precision(Network &net, KernelPrecision precision);
+// Uploads sell and ticks from it, or from the padded rows again when sell is null. Needs f32 weights and i32
+// targets. Like the CPU copy, the uploaded rows do not follow later weight changes of the network.
+struct SellSynapses;
+void network_set_sell(Network &net, const SellSynapses *sell);
+// Copies one delay per synapse slot into delay_data, capped at NETWORK_MAX_DELAY. Null, or all zeros, makes every
+// synapse instantaneous again. Host only, sims and uploads made afterwards pick the delays up.
+void network_set_delays(Network &net, const u8 *delays);
+// Re-uploads the delays of a network that is already on the GPU, clears the pending input and selects the kernel.
+// Delayed synapses need the padded rows, SELL rows are dropped.
+void network_upload_delays(Network &net);
+// Switches to or from binary spikes. The bitset starts from the host activations, neurons at 1 spiked last tick.
+void network_set_binary(Network &net, bool binary);
+// Sets the activation of the given neurons (by index) to value and uploads just those entries. In binary mode their
+// spike bits follow, set at value 1.
+void network_stimulate(Network &net, const u32 *indices, usize count, f32 value = 1.0f);
+
+// Stable neuron IDs for external APIs, independent of how neurons are laid out in memory
+static inline usize network_index_of(const Network &net, usize id) {
+    return net.index_of_id ? net.index_of_id[id] : id;
+}
+
+static inline usize network_id_of(const Network &net, usize index) {
+    return net.id_of_index ? net.id_of_index[index] : index;
+}
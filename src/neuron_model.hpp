@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/types.h"
+
+// Membrane dynamics, chosen once per network. Every model reports a spike by setting activation to 1.0, which
+// then decays for display, so the renderer and plasticity work the same for all of them.
+enum NeuronModel {
+    NeuronModelThreshold,  // fires when summed input exceeds the threshold, no membrane state
+    NeuronModelLif,        // leaky integrate-and-fire with refractory period
+    NeuronModelIzhikevich, // Izhikevich 2003, one tick is one millisecond
+};
+
+struct NeuronModelParams {
+    NeuronModel model;
+    f32 input_gain; // summed synaptic input to membrane current
+
+    // Lif, the per-neuron threshold comes from neuron_data
+    f32 tau; // membrane time constant, in ticks
+    f32 v_rest;
+    f32 v_reset;
+    f32 refractory_ticks;
+
+    // Izhikevich
+    f32 a, b, c, d;
+};
+
+static inline NeuronModelParams neuron_model_default_params(NeuronModel model) {
+    NeuronModelParams params;
+    params.model = model;
+    params.input_gain = model == NeuronModelIzhikevich ? 20.0f : 1.0f;
+
+    params.tau = 10.0f;
+    params.v_rest = 0.0f;
+    params.v_reset = 0.0f;
+    params.refractory_ticks = 3.0f;
+
+    // Regular spiking cortical neuron
+    params.a = 0.02f;
+    params.b = 0.2f;
+    params.c = -65.0f;
+    params.d = 8.0f;
+    return params;
+}
+
+// Membrane potential and recovery variable a neuron starts from
+static inline f32 neuron_model_initial_potential(const NeuronModelParams &params) {
+    return params.model == NeuronModelIzhikevich ? params.c : params.v_rest;
+}
+
+static inline f32 neuron_model_initial_recovery(const NeuronModelParams &params) {
+    return params.model == NeuronModelIzhikevich ? params.b * params.c : 0.0f;
+}
@@ -0,0 +1,106 @@
+#include "partition.hpp"
+
+#include "core/arena.h"
+
+#include <cstring>
+
+void partition_ranges(usize neuron_count, u32 part_count, u32 *part) {
+    for (usize i = 0; i < neuron_count; i++) {
+        part[i] = (u32)(i * part_count / neuron_count);
+    }
+}
+
+void partition_compute(const Network &net, u32 part_count, u32 *part) {
+    usize n = net.neuron_count;
+    if (part_count > PARTITION_MAX_PARTS) part_count = PARTITION_MAX_PARTS;
+    partition_ranges(n, part_count, part);
+    if (part_count <= 1) return;
+
+    // Undirected adjacency, a cut synapse costs the same whichever side it is stored on
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u32 *offsets = arena_push_zero<u32>(scratch, n + 1);
+    for (usize i = 0; i < n; i++) {
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            i32 target = net.synapse_data[i * MAX_SYNAPSES + j];
+            if (target < 0 || (usize)target == i) continue;
+            offsets[i + 1]++;
+            offsets[target + 1]++;
+        }
+    }
+    for (usize i = 0; i < n; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    u32 *adjacency = arena_push<u32>(scratch, offsets[n]);
+    u32 *cursor = arena_push<u32>(scratch, n);
+    memcpy(cursor, offsets, n * sizeof(u32));
+    for (usize i = 0; i < n; i++) {
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            i32 target = net.synapse_data[i * MAX_SYNAPSES + j];
+            if (target < 0 || (usize)target == i) continue;
+            adjacency[cursor[i]++] = (u32)target;
+            adjacency[cursor[target]++] = (u32)i;
+        }
+    }
+
+    usize sizes[PARTITION_MAX_PARTS] = {};
+    for (usize i = 0; i < n; i++) {
+        sizes[part[i]]++;
+    }
+    usize cap = (usize)((f32)n / part_count * (1.0f + PARTITION_IMBALANCE)) + 1;
+
+    // Sequential sweeps so the result is deterministic, a neuron sees the moves made earlier in the same sweep
+    for (int iteration = 0; iteration < PARTITION_ITERATIONS; iteration++) {
+        usize moves = 0;
+        for (usize i = 0; i < n; i++) {
+            u32 counts[PARTITION_MAX_PARTS] = {};
+            for (u32 e = offsets[i]; e < offsets[i + 1]; e++) {
+                counts[part[adjacency[e]]]++;
+            }
+
+            u32 current = part[i];
+            u32 best = current;
+            for (u32 p = 0; p < part_count; p++) {
+                if (counts[p] > counts[best] && sizes[p] < cap) best = p;
+            }
+            if (best == current) continue;
+
+            sizes[current]--;
+            sizes[best]++;
+            part[i] = best;
+            moves++;
+        }
+        if (moves == 0) break;
+    }
+
+    arena_restore(scratch, mark);
+}
+
+usize partition_cut(const Network &net, const u32 *part) {
+    usize cut = 0;
+    for (usize i = 0; i < net.neuron_count; i++) {
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            i32 target = net.synapse_data[i * MAX_SYNAPSES + j];
+            cut += target >= 0 && part[target] != part[i];
+        }
+    }
+    return cut;
+}
+
+void partition_order(const Network &net, const u32 *part, u32 part_count, u32 *order, usize *bounds) {
+    usize n = net.neuron_count;
+    memset(bounds, 0, (part_count + 1) * sizeof(usize));
+    for (usize i = 0; i < n; i++) {
+        bounds[part[i] + 1]++;
+    }
+    for (u32 p = 0; p < part_count; p++) {
+        bounds[p + 1] += bounds[p];
+    }
+
+    usize cursor[PARTITION_MAX_PARTS];
+    memcpy(cursor, bounds, part_count * sizeof(usize));
+    for (usize i = 0; i < n; i++) {
+        order[cursor[part[i]]++] = (u32)i;
+    }
+}
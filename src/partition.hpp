@@ -0,0 +1,24 @@
+#pragma once
+
+#include "core/types.h"
+#include "neural_net.hpp"
+
+#define PARTITION_MAX_PARTS 64
+#define PARTITION_ITERATIONS 16
+#define PARTITION_IMBALANCE 0.03f // parts may grow this far past an even share
+
+// Splits neurons into parts with few synapses crossing between them, for the distributed engine where every cut
+// synapse is a spike sent over the transport. Label propagation over the undirected synapse graph: starting from
+// contiguous ranges of the current order, each neuron moves to the part most of its neighbours are in, as long as
+// that part stays under its size cap. Run it after network_reorder, a spatial order is already a good start.
+void partition_compute(const Network &net, u32 part_count, u32 *part);
+
+// Synapses whose two ends are in different parts
+usize partition_cut(const Network &net, const u32 *part);
+
+// Computes order[new_index] = old_index grouping each part contiguously, original order kept within a part, for
+// network_permute. bounds receives part_count + 1 entries, part p owns [bounds[p], bounds[p + 1]).
+void partition_order(const Network &net, const u32 *part, u32 part_count, u32 *order, usize *bounds);
+
+// Contiguous ranges of the current order without looking at the graph, the baseline the partitioner improves on
+void partition_ranges(usize neuron_count, u32 part_count, u32 *part);
@@ -0,0 +1,326 @@
+#include "plasticity.hpp"
+
+#include "core/parallel.h"
+#include "core/simd.h"
+
+#include <cmath>
+#include <cstdlib>
+
+#define PLASTICITY_GRAIN 2048
+#define PLASTICITY_COLUMN_COST 8 // swept slots per column slot, measured where the two passes break even
+#define PLASTICITY_RESCALE_SPAN 64.0f // time constants between rescales, stored traces grow to about e^64
+
+static_assert(MAX_SYNAPSES % SIMD_WIDTH == 0, "synapse rows must be a whole number of SIMD vectors");
+
+// Both shaders are compiled behind the network's kernel variant preamble
+static GLuint plasticity_compile(const KernelVariant &variant, const char *name) {
+    char preamble[SHADER_PREAMBLE_LENGTH];
+    kernel_variant_preamble(variant, preamble, sizeof(preamble));
+    return shader_library_compute(global_shader_library, name, preamble);
+}
+
+PlasticityParams plasticity_default_params() {
+    PlasticityParams params;
+    params.a_plus = 0.01f;
+    params.a_minus = 0.012f;
+    params.tau_pre = 20.0f;
+    params.tau_post = 20.0f;
+    params.w_min = 0.0f;
+    params.w_max = 1.0f;
+    params.trace_cutoff = 0.01f; // about 92 ticks after a lone spike at tau 20
+    params.interval = 1;
+    return params;
+}
+
+void plasticity_init(Plasticity &plasticity, usize neuron_count, const PlasticityParams &params) {
+    plasticity.params = params;
+    if (plasticity.params.interval == 0) plasticity.params.interval = 1;
+    plasticity.neuron_count = neuron_count;
+    plasticity.tick = 0;
+    plasticity.reset_spikes = true;
+
+    plasticity.pre_trace = (f32 *)calloc(neuron_count, sizeof(f32));
+    plasticity.post_trace = (f32 *)calloc(neuron_count, sizeof(f32));
+    plasticity.pre_scale = 1.0f;
+    plasticity.post_scale = 1.0f;
+    plasticity.rescale_tick = 0;
+    plasticity.spiked_bits = (u32 *)calloc((neuron_count + 31) / 32, sizeof(u32));
+    plasticity.source_offsets = nullptr;
+    plasticity.source_slots = nullptr;
+
+    plasticity.trace_program = 0;
+    plasticity.weight_program = 0;
+    plasticity.trace_buffer = 0;
+}
+
+void plasticity_init_remote_resources(Plasticity &plasticity, const Network &net) {
+    // The weight pass rewrites f32 weights in place and reads 32-bit targets
+    if (net.format.weights != WeightFormatF32 || net.format.targets != TargetFormatI32) {
+        warn("Plasticity needs f32 weights and 32-bit targets on the GPU, remote updates disabled");
+        return;
+    }
+
+    glGenBuffers(1, &plasticity.trace_buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, plasticity.trace_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, plasticity.neuron_count * 4 * sizeof(f32), NULL, GL_DYNAMIC_COPY);
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32F, GL_RED, GL_FLOAT, NULL);
+
+    plasticity.trace_program = plasticity_compile(net.variant, "plasticity_trace.comp");
+    plasticity.weight_program = plasticity_compile(net.variant, "plasticity_weight.comp");
+}
+
+void plasticity_deinit(Plasticity &plasticity) {
+    free(plasticity.pre_trace);
+    free(plasticity.post_trace);
+    free(plasticity.spiked_bits);
+    free(plasticity.source_offsets);
+    free(plasticity.source_slots);
+
+    if (plasticity.trace_buffer) glDeleteBuffers(1, &plasticity.trace_buffer);
+    if (plasticity.trace_program) shader_library_release(global_shader_library, plasticity.trace_program);
+    if (plasticity.weight_program) shader_library_release(global_shader_library, plasticity.weight_program);
+}
+
+// Advances the tick counter, returns true when this tick also updates weights
+static bool plasticity_advance(Plasticity &plasticity) {
+    return ++plasticity.tick % plasticity.params.interval == 0;
+}
+
+static u32 plasticity_popcount(u32 word) {
+#ifdef _MSC_VER
+    return (u32)__popcnt(word);
+#else
+    return (u32)__builtin_popcount(word);
+#endif
+}
+
+static u32 plasticity_lowest_bit(u32 word) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, word);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctz(word);
+#endif
+}
+
+static inline bool plasticity_spiked(const u32 *spiked_bits, usize i) {
+    return (spiked_bits[i / 32] >> (i % 32)) & 1;
+}
+
+void plasticity_index_sources(Plasticity &plasticity, const Network &net) {
+    usize n = plasticity.neuron_count;
+    usize slots = n * MAX_SYNAPSES;
+    free(plasticity.source_offsets);
+    free(plasticity.source_slots);
+    plasticity.source_offsets = (u32 *)calloc(n + 1, sizeof(u32));
+
+    // Counting sort of the slots by target, each column comes out in slot order
+    u32 *offsets = plasticity.source_offsets;
+    for (usize s = 0; s < slots; s++) {
+        if (net.synapse_data[s] >= 0) offsets[net.synapse_data[s] + 1]++;
+    }
+    for (usize i = 0; i < n; i++) offsets[i + 1] += offsets[i];
+
+    plasticity.source_slots = (u32 *)malloc((offsets[n] > 0 ? offsets[n] : 1) * sizeof(u32));
+    for (usize s = 0; s < slots; s++) {
+        if (net.synapse_data[s] >= 0) plasticity.source_slots[offsets[net.synapse_data[s]]++] = (u32)s;
+    }
+    // The fill advanced each offset to the start of the next column
+    for (usize i = n; i > 0; i--) offsets[i] = offsets[i - 1];
+    offsets[0] = 0;
+}
+
+// Folds the decay accumulated since rescale_tick into the traces before the stored values outgrow f32. Runs once
+// every PLASTICITY_RESCALE_SPAN time constants.
+static void plasticity_rescale(Plasticity &plasticity) {
+    f32 pre_scale = plasticity.pre_scale;
+    f32 post_scale = plasticity.post_scale;
+    f32 cutoff = plasticity.params.trace_cutoff;
+    parallel_for(0, plasticity.neuron_count, PLASTICITY_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            // A spiked neuron keeps its sign however far its trace decayed, the weight update reads the flag from it
+            f32 pre = plasticity.pre_trace[i] * pre_scale;
+            f32 post = plasticity.post_trace[i] * post_scale;
+            plasticity.pre_trace[i] = pre < 0.0f || pre >= cutoff ? pre : 0.0f;
+            plasticity.post_trace[i] = post < cutoff ? 0.0f : post;
+        }
+    });
+    plasticity.pre_scale = 1.0f;
+    plasticity.post_scale = 1.0f;
+    plasticity.rescale_tick = plasticity.tick;
+}
+
+void plasticity_update(Plasticity &plasticity, Network &net, const f32 *activation) {
+    const PlasticityParams &params = plasticity.params;
+    usize n = plasticity.neuron_count;
+    usize words = (n + 31) / 32;
+    f32 cutoff = params.trace_cutoff;
+
+    f32 elapsed = (f32)(plasticity.tick + 1 - plasticity.rescale_tick);
+    if (elapsed > PLASTICITY_RESCALE_SPAN * fminf(params.tau_pre, params.tau_post)) {
+        plasticity_rescale(plasticity);
+        elapsed = 1.0f;
+    }
+    plasticity.pre_scale = expf(-elapsed / params.tau_pre);
+    plasticity.post_scale = expf(-elapsed / params.tau_post);
+    f32 pre_scale = plasticity.pre_scale;
+    f32 post_scale = plasticity.post_scale;
+    f32 pre_inverse = 1.0f / pre_scale;
+    f32 post_inverse = 1.0f / post_scale;
+
+    f32 *pre_trace = plasticity.pre_trace;
+    f32 *post_trace = plasticity.post_trace;
+    u32 *spiked_bits = plasticity.spiked_bits;
+
+    // Decay is all in the scales, so the tick itself is a scan for spikes. A spike adds 1 to the true trace, flushing
+    // what was left of it first when that had decayed below the cutoff, and negates the stored pre trace until the
+    // next weight update.
+    f32x8 one = f32x8_set1(1.0f);
+    parallel_for(0, words, PLASTICITY_GRAIN / 32, [&](usize begin, usize end) {
+        for (usize w = begin; w < end; w++) {
+            u32 bits = 0;
+            if (w * 32 + 32 <= n) {
+                for (usize k = 0; k < 32; k += SIMD_WIDTH) {
+                    bits |= mask8_bits(f32x8_ge(f32x8_load(&activation[w * 32 + k]), one)) << k;
+                }
+            } else {
+                for (usize i = w * 32; i < n; i++) bits |= (u32)(activation[i] >= 1.0f) << (i % 32);
+            }
+            spiked_bits[w] |= bits;
+
+            for (; bits; bits &= bits - 1) {
+                usize i = w * 32 + plasticity_lowest_bit(bits);
+                f32 pre = fabsf(pre_trace[i]);
+                pre_trace[i] = -((pre * pre_scale < cutoff ? 0.0f : pre) + pre_inverse);
+                post_trace[i] = (post_trace[i] * post_scale < cutoff ? 0.0f : post_trace[i]) + post_inverse;
+            }
+        }
+    });
+
+    if (!plasticity_advance(plasticity)) return;
+    if (!plasticity.source_offsets) plasticity_index_sources(plasticity, net);
+
+    usize spiked_count = 0;
+    for (usize w = 0; w < words; w++) spiked_count += plasticity_popcount(spiked_bits[w]);
+
+    f32x8 w_min = f32x8_set1(params.w_min);
+    f32x8 w_max = f32x8_set1(params.w_max);
+    f32x8 a_plus = f32x8_set1(params.a_plus);
+    f32x8 pre_scale8 = f32x8_set1(pre_scale);
+    f32x8 cutoff8 = f32x8_set1(cutoff);
+    f32x8 zero = f32x8_set1(0.0f);
+
+    // A row whose neuron spiked is potentiated by every pre trace and depressed by a_minus * post for each target
+    // that spiked. A row that did not spike is only depressed, and only in the columns of targets that spiked.
+    auto update_row = [&](usize i, bool post_spiked) {
+        f32 post = post_trace[i] * post_scale;
+        f32x8 depression = f32x8_set1(post < cutoff ? 0.0f : params.a_minus * post);
+
+        for (int j = 0; j < MAX_SYNAPSES; j += SIMD_WIDTH) {
+            i32x8 targets = i32x8_load(&net.synapse_data[i * MAX_SYNAPSES + j]);
+            mask8 valid = i32x8_ge_zero(targets);
+            if (!mask8_any(valid)) continue;
+
+            f32x8 dw;
+            if (post_spiked) {
+                f32x8 stored = f32x8_gather(pre_trace, targets, valid);
+                mask8 pre_spiked = f32x8_gt(zero, stored);
+                f32x8 pre = f32x8_mul(f32x8_max(stored, f32x8_sub(zero, stored)), pre_scale8);
+                pre = f32x8_select(f32x8_ge(pre, cutoff8), pre, zero);
+                dw = f32x8_sub(f32x8_mul(a_plus, pre), f32x8_select(pre_spiked, depression, zero));
+            } else {
+                valid = bits8_gather(spiked_bits, targets, valid);
+                if (!mask8_any(valid)) continue;
+                dw = f32x8_sub(zero, depression);
+            }
+
+            f32 *row = &net.weight_data[i * MAX_SYNAPSES + j];
+            f32x8 weights = f32x8_load(row);
+            f32x8 updated = f32x8_min(f32x8_max(f32x8_add(weights, dw), w_min), w_max);
+            f32x8_store(row, f32x8_select(valid, updated, weights));
+        }
+    };
+
+    // Depression of the quiet rows either walks the columns of the spiked neurons or sweeps every quiet row that
+    // still has a post trace, whichever is cheaper. A column slot is a random read-modify-write, priced at
+    // PLASTICITY_COLUMN_COST swept slots. Sparse activity takes the columns, busy activity the sweep.
+    usize column_slots = n > 0 ? spiked_count * plasticity.source_offsets[n] / n : 0;
+    if (column_slots * PLASTICITY_COLUMN_COST < (n - spiked_count) * MAX_SYNAPSES) {
+        parallel_for(0, words, PLASTICITY_GRAIN / 32, [&](usize begin, usize end) {
+            for (usize w = begin; w < end; w++) {
+                for (u32 bits = spiked_bits[w]; bits; bits &= bits - 1) {
+                    update_row(w * 32 + plasticity_lowest_bit(bits), true);
+                }
+            }
+        });
+
+        // Every slot has one source, so chunks of sources write disjoint slots, and none in the spiked rows above
+        f32 a_minus = params.a_minus;
+        parallel_for(0, words, PLASTICITY_GRAIN / 32, [&](usize begin, usize end) {
+            for (usize w = begin; w < end; w++) {
+                for (u32 bits = spiked_bits[w]; bits; bits &= bits - 1) {
+                    usize k = w * 32 + plasticity_lowest_bit(bits);
+                    for (u32 c = plasticity.source_offsets[k]; c < plasticity.source_offsets[k + 1]; c++) {
+                        u32 s = plasticity.source_slots[c];
+                        usize i = s / MAX_SYNAPSES;
+                        if (plasticity_spiked(spiked_bits, i)) continue;
+                        f32 post = post_trace[i] * post_scale;
+                        if (post < cutoff) continue;
+                        f32 weight = net.weight_data[s] - a_minus * post;
+                        net.weight_data[s] = fminf(fmaxf(weight, params.w_min), params.w_max);
+                    }
+                }
+            }
+        });
+    } else {
+        parallel_for(0, n, PLASTICITY_GRAIN, [&](usize begin, usize end) {
+            for (usize i = begin; i < end; i++) {
+                bool post_spiked = plasticity_spiked(spiked_bits, i);
+                if (!post_spiked && post_trace[i] * post_scale < cutoff) continue;
+                update_row(i, post_spiked);
+            }
+        });
+    }
+
+    parallel_for(0, words, PLASTICITY_GRAIN / 32, [&](usize begin, usize end) {
+        for (usize w = begin; w < end; w++) {
+            for (u32 bits = spiked_bits[w]; bits; bits &= bits - 1) {
+                usize i = w * 32 + plasticity_lowest_bit(bits);
+                pre_trace[i] = fabsf(pre_trace[i]);
+            }
+            spiked_bits[w] = 0;
+        }
+    });
+}
+
+void plasticity_update_remote(Plasticity &plasticity, const Network &net) {
+    if (!plasticity.weight_program) return;
+
+    const PlasticityParams &params = plasticity.params;
+    GLuint groups = (GLuint)((plasticity.neuron_count + net.variant.workgroup_size - 1) / net.variant.workgroup_size);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, net.neuron_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, net.synapse_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, net.weight_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, plasticity.trace_buffer);
+
+    glUseProgram(plasticity.trace_program);
+    glUniform1f(glGetUniformLocation(plasticity.trace_program, "pre_decay"), expf(-1.0f / params.tau_pre));
+    glUniform1f(glGetUniformLocation(plasticity.trace_program, "post_decay"), expf(-1.0f / params.tau_post));
+    glUniform1f(glGetUniformLocation(plasticity.trace_program, "trace_cutoff"), params.trace_cutoff);
+    glUniform1i(glGetUniformLocation(plasticity.trace_program, "reset_spikes"), plasticity.reset_spikes);
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    plasticity.reset_spikes = plasticity_advance(plasticity);
+    if (!plasticity.reset_spikes) return;
+
+    glUseProgram(plasticity.weight_program);
+    glUniform1f(glGetUniformLocation(plasticity.weight_program, "a_plus"), params.a_plus);
+    glUniform1f(glGetUniformLocation(plasticity.weight_program, "a_minus"), params.a_minus);
+    glUniform1f(glGetUniformLocation(plasticity.weight_program, "w_min"), params.w_min);
+    glUniform1f(glGetUniformLocation(plasticity.weight_program, "w_max"), params.w_max);
+    glDispatchCompute(groups, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
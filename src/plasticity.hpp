@@ -0,0 +1,56 @@
+#pragma once
+
+#include "core/types.h"
+#include "neural_net.hpp"
+
+// Pair-based STDP with exponential per-neuron traces. A neuron counts as spiking on a tick when its activation
+// reaches 1.0. Traces advance every tick; weights are updated every `interval` ticks from the current traces and
+// the neurons that spiked since the previous weight update.
+struct PlasticityParams {
+    f32 a_plus;    // potentiation when a post spike follows pre activity
+    f32 a_minus;   // depression when a pre spike follows post activity
+    f32 tau_pre;   // pre trace time constant, in ticks
+    f32 tau_post;  // post trace time constant, in ticks
+    f32 w_min, w_max;
+    f32 trace_cutoff; // traces that decay below this are flushed to 0, so rows of quiet neurons skip the weight pass
+    u32 interval;
+};
+
+struct Plasticity {
+    PlasticityParams params;
+    usize neuron_count;
+    u64 tick;
+    bool reset_spikes;
+
+    // Host state. Traces are kept divided by their decay since rescale_tick, so a tick only writes the neurons that
+    // spiked and decay costs one expf per tick. The true trace of neuron i is |pre_trace[i]| * pre_scale, negative
+    // while the neuron has spiked since the last weight update so one gather gives a row both.
+    f32 *pre_trace;
+    f32 *post_trace;
+    f32 pre_scale, post_scale;
+    u64 rescale_tick;
+    u32 *spiked_bits; // neurons that spiked since the last weight update, 32 per word
+    // Slots reading neuron i are source_slots[source_offsets[i] .. source_offsets[i + 1]], so depression after a pre
+    // spike walks the neuron's column instead of every row. Built by the first host weight update.
+    u32 *source_offsets;
+    u32 *source_slots;
+
+    // Remote state, vec4 per neuron: x = pre trace, y = post trace, z = spiked
+    GLuint trace_program;
+    GLuint weight_program;
+    GLuint trace_buffer;
+};
+
+PlasticityParams plasticity_default_params();
+
+void plasticity_init(Plasticity &plasticity, usize neuron_count, const PlasticityParams &params);
+void plasticity_init_remote_resources(Plasticity &plasticity, const Network &net);
+void plasticity_deinit(Plasticity &plasticity);
+
+// Host path, activation is the post-tick state from CpuSim. Updates net.weight_data in place. A tick only writes the
+// traces of the neurons that spiked, a weight update only their rows and columns unless most neurons spiked.
+void plasticity_update(Plasticity &plasticity, Network &net, const f32 *activation);
+// Rebuilds the outgoing slots from net.synapse_data, needed after edits change any synapse target
+void plasticity_index_sources(Plasticity &plasticity, const Network &net);
+// Remote path, run after network_update. Updates the weight SSBO in place.
+void plasticity_update_remote(Plasticity &plasticity, const Network &net);
@@ -2,357 +2,370 @@
 
 #include "neural_net.hpp"
 #include "shader.hpp"
+#include "streaming.hpp"
 
-const char *neuron_vertex_shader_source = R"(
-#version 430
+#include <cstddef>
 
-layout(location = 0) in vec2 position;
-layout(location = 1) in float activation;
-layout(location = 2) in float threshold;
+#define RENDERER_DENSITY_SCALE 8.0f // synapses per tile at which a tile reaches 1 - 1/e coverage
+#define RENDERER_POINT_SIZE 7.5f
+#define RENDERER_MAX_POINT_ZOOM 8.0f // neurons stop growing past this zoom
 
-uniform vec2 viewport;
+static const RendererDrawCommands RENDERER_EMPTY_COMMANDS = {0, 1, 0, 0, 0, 1, 0, 0, 0};
 
-out float v_activation;
+// Camera and viewport shared by every pass of a frame
+struct RendererView {
+    f32 width, height;
+    f32 min_x, min_y, max_x, max_y; // visible world rectangle
+    f32 point_size;
+};
 
-void main() {    
-    v_activation = activation;    
-
-    float aspect = viewport.x / viewport.y;
-    float inverse_aspect = viewport.y / viewport.x;
-    vec2 scale = vec2(1.0 / aspect, 1.0);
-    
-    gl_Position = vec4((position * scale), 0.0, 1.0);  // Scale down positions    
-    // gl_PointSize = 7.5 * viewport.y / viewport.x;
-    gl_PointSize = 7.5 * inverse_aspect;
-}
-)";
-
-const char *neuron_fragment_shader_source = R"(
-#version 430
-
-in float v_activation;
-out vec4 fragColor;
-
-uniform vec4 active_color;
-uniform vec4 inactive_color;
-
-void main() {    
-    vec2 coord = gl_PointCoord * 2.0 - 1.0;    
-    float r = dot(coord, coord);    
-    if (r > 1.0) discard;        
-    
-    // Base color changes with activation
-    vec4 baseColor = mix(        
-        inactive_color,
-        active_color,
-        v_activation    
-    );
-    
-    float glow = exp(-r * 1.5);
-    vec3 finalColor = baseColor.rgb + vec3(0.1) * glow;
-    float alpha = min(baseColor.a, glow + 0.2);
-    
-    fragColor = vec4(finalColor, alpha);
+static usize renderer_line_capacity(const Network &network) {
+    usize lines = network.neuron_count * MAX_SYNAPSES;
+    return lines < RENDERER_SYNAPSE_LINE_CAPACITY ? lines : RENDERER_SYNAPSE_LINE_CAPACITY;
 }
-)";
-
-const char *synapse_vertex_shader_source = R"(
-#version 430
-
-layout(location = 0) in vec2 position;
-layout(location = 1) in float activation;
 
-uniform vec2 viewport;
-
-out float v_activation;
+static RendererView renderer_view(const State &state) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
 
-void main() {
-    v_activation = activation;    
-    float aspect = viewport.x / viewport.y;    
-    vec2 scale = vec2(1.0 / aspect, 1.0);    
-    gl_Position = vec4(position * scale, 0.0, 1.0);
-    
-    // v_activation = activation;
-    // gl_Position = vec4(position * 0.01, 0.0, 1.0);  // Use same scale as neurons
+    RendererView view;
+    view.width = (f32)viewport[2];
+    view.height = (f32)viewport[3];
+
+    const State::Camera &camera = state.camera;
+    f32 inverse_aspect = view.height / view.width;
+    f32 point_zoom = camera.zoom < RENDERER_MAX_POINT_ZOOM ? camera.zoom : RENDERER_MAX_POINT_ZOOM;
+    view.point_size = RENDERER_POINT_SIZE * inverse_aspect * point_zoom;
+    if (view.point_size < 1.0f) view.point_size = 1.0f;
+
+    // Padded by the point radius so neurons straddling the edge are kept
+    f32 pixel = 2.0f / (view.height * camera.zoom);
+    f32 half_width = 1.0f / (inverse_aspect * camera.zoom) + view.point_size * pixel;
+    f32 half_height = 1.0f / camera.zoom + view.point_size * pixel;
+    view.min_x = camera.x - half_width;
+    view.max_x = camera.x + half_width;
+    view.min_y = camera.y - half_height;
+    view.max_y = camera.y + half_height;
+    return view;
 }
-)";
-
-const char *synapse_fragment_shader_source = R"(
-#version 430
 
-in float v_activation;
-out vec4 fragColor;
-
-uniform vec4 active_color;
-uniform vec4 inactive_color;
-
-void main() {
-    vec4 color = mix(
-        inactive_color,
-        active_color,
-        v_activation
-    );
-
-    // float alpha = color.a * v_activation;
-  
-    // fragColor = vec4(color.rgb, alpha);  // Semi-transparent lines
-    fragColor = color;
+static void renderer_set_camera(GLuint program, const RendererView &view, const State &state) {
+    glUniform2f(glGetUniformLocation(program, "viewport"), view.width, view.height);
+    glUniform3f(glGetUniformLocation(program, "camera"), state.camera.x, state.camera.y, state.camera.zoom);
 }
-)";
 
-const char *bloom_vertex_shader_source = R"(
-#version 430
+void renderer_init(Renderer &renderer) {
+    glEnable(GL_PROGRAM_POINT_SIZE);
 
-layout(location = 0) in vec2 position;
-layout(location = 0) in vec2 texcoord;
+    renderer.neuron_program = shader_library_render(global_shader_library, "neuron.vert", "neuron.frag");
+    renderer.synapse_program = shader_library_render(global_shader_library, "synapse.vert", "synapse.frag");
+    renderer.density_program = shader_library_render(global_shader_library, "fullscreen.vert", "density.frag");
+    renderer.splat_resolve_program =
+        shader_library_render(global_shader_library, "fullscreen.vert", "splat_resolve.frag");
+    renderer.blur_program = shader_library_render(global_shader_library, "fullscreen.vert", "blur.frag");
+    renderer.bloom_program = shader_library_render(global_shader_library, "fullscreen.vert", "bloom.frag");
 
-out vec2 v_texcoord;
+    // Vertices are pulled from storage buffers by gl_VertexID, the VAOs stay empty
+    glGenVertexArrays(1, &renderer.neuron_vao);
+    glGenVertexArrays(1, &renderer.synapse_vao);
 
-void main() {
-    v_texcoord = texcoord;
-    gl_Position = vec4(position, 0.0, 1.0);
-}
-)";
-
-const char *blur_vertex_shader_source = R"(
-#version 430
-
-layout(location = 0) in vec2 position;
-layout(location = 0) in vec2 texcoord;
-
-uniform sampler2D texture;
-uniform vec2 direction;
-uniform vec2 resolution;
-
-void main() {
-    vec2 texel = 1.0 / resolution;
-    vec3 color = vec3(0.0);
-    
-    // 9-tap Gaussian blur
-    color += texture(texture, v_texcoord + texel * direction * -4.0).rgb * 0.0162;
-    color += texture(texture, v_texcoord + texel * direction * -3.0).rgb * 0.0540;
-    color += texture(texture, v_texcoord + texel * direction * -2.0).rgb * 0.1216;
-    color += texture(texture, v_texcoord + texel * direction * -1.0).rgb * 0.1945;
-    color += texture(texture, v_texcoord).rgb * 0.2270;
-    color += texture(texture, v_texcoord + texel * direction * 1.0).rgb * 0.1945;
-    color += texture(texture, v_texcoord + texel * direction * 2.0).rgb * 0.1216;
-    color += texture(texture, v_texcoord + texel * direction * 3.0).rgb * 0.0540;
-    color += texture(texture, v_texcoord + texel * direction * 4.0).rgb * 0.0162;
-
-    fragColor = vec4(color, 1.0);
+    glGenBuffers(1, &renderer.draw_buffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.draw_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(RendererDrawCommands), &RENDERER_EMPTY_COMMANDS, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glGenBuffers(1, &renderer.density_buffer);
+    renderer.tiles_x = 0;
+    renderer.tiles_y = 0;
+
+    // Sized on first use by renderer_resize_targets
+    GLuint textures[5];
+    glGenTextures(5, textures);
+    renderer.splat_neuron_texture = textures[0];
+    renderer.splat_synapse_texture = textures[1];
+    renderer.bloom_texture = textures[2];
+    renderer.bloom_ping_texture = textures[3];
+    renderer.bloom_pong_texture = textures[4];
+    glGenFramebuffers(1, &renderer.bloom_fbo);
+    renderer.splat_width = 0;
+    renderer.splat_height = 0;
+
+    renderer.cull_neuron_program = 0;
+    renderer.cull_synapse_program = 0;
+    renderer.splat_program = 0;
+    renderer.visible_neuron_buffer = 0;
+    renderer.visible_synapse_buffer = 0;
+    renderer.neuron_capacity = 0;
+    renderer.synapse_count = 0;
 }
-)";
 
-const char *bloom_fragment_shader = R"(
-#version 430
+void renderer_attach(Renderer &renderer, const Network &network) {
+    char preamble[SHADER_PREAMBLE_LENGTH];
+    kernel_variant_preamble(network.variant, preamble, sizeof(preamble));
 
-in vec2 v_texcoord;
-out vec4 frag_color;
+    if (renderer.cull_neuron_program) shader_library_release(global_shader_library, renderer.cull_neuron_program);
+    if (renderer.cull_synapse_program) shader_library_release(global_shader_library, renderer.cull_synapse_program);
+    renderer.cull_neuron_program = shader_library_compute(global_shader_library, "cull_neurons.comp", preamble);
+    renderer.cull_synapse_program = shader_library_compute(global_shader_library, "cull_synapses.comp", preamble);
+    if (renderer.splat_program) shader_library_release(global_shader_library, renderer.splat_program);
+    renderer.splat_program = shader_library_compute(global_shader_library, "splat.comp", preamble);
 
-uniform sampler2D origin;
-uniform sampler2D bloom;
-
-void main() {
-    vec3 original = texture(original, v_texcoord).rgb;
-    vec3 bloom = texture(bloom, v_texcoord).rgb;
-
-    vec3 final = original + bloom * 2.0;
-
-    fragColor = vec4(final, 1.0);
-}
-)";
-
-// void create_framebuffers(Renderer &renderer, usize width, usize height) {
-// }
+    renderer.synapse_count = 0;
+    for (usize i = 0; i < network.neuron_count * MAX_SYNAPSES; i++) {
+        renderer.synapse_count += network.synapse_data[i] >= 0;
+    }
 
-void renderer_render_synapses(const Renderer &renderer, const Network &network, const State &state);
-void renderer_render_neurons(const Renderer &renderer, const Network &network, const State &state);
-void renderer_update_synapse_buffer(const Renderer &renderer, const Network &network, f32 *synapse_data,
-                                    usize &synapse_count);
+    if (renderer.neuron_capacity != network.neuron_count) {
+        usize lines = renderer_line_capacity(network);
 
-void renderer_init(Renderer &renderer) {
-    glEnable(GL_PROGRAM_POINT_SIZE);
+        if (!renderer.visible_neuron_buffer) glGenBuffers(1, &renderer.visible_neuron_buffer);
+        if (!renderer.visible_synapse_buffer) glGenBuffers(1, &renderer.visible_synapse_buffer);
 
-    // Neuron
-    //
-    // Create and compile shaders
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &neuron_vertex_shader_source, NULL);
-    glCompileShader(vertex_shader);
-    check_shader_compilation(vertex_shader);
-
-    GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &neuron_fragment_shader_source, NULL);
-    glCompileShader(fragment_shader);
-    check_shader_compilation(fragment_shader);
-
-    // Create shader program
-    renderer.neuron_program = glCreateProgram();
-    glAttachShader(renderer.neuron_program, vertex_shader);
-    glAttachShader(renderer.neuron_program, fragment_shader);
-    glLinkProgram(renderer.neuron_program);
-
-    // Cleanup shaders
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-
-    // Create VAO
-    glGenVertexArrays(1, &renderer.neuron_vao);
-    glBindVertexArray(renderer.neuron_vao);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, renderer.visible_neuron_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, network.neuron_count * sizeof(u32), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, renderer.visible_synapse_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, lines * 2 * sizeof(u32), nullptr, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-    // Synapse
-    //
-    // Create and compile shaders
-    vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &synapse_vertex_shader_source, NULL);
-    glCompileShader(vertex_shader);
-    check_shader_compilation(vertex_shader);
-
-    fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &synapse_fragment_shader_source, NULL);
-    glCompileShader(fragment_shader);
-    check_shader_compilation(fragment_shader);
-
-    // Create shader program
-    renderer.synapse_program = glCreateProgram();
-    glAttachShader(renderer.synapse_program, vertex_shader);
-    glAttachShader(renderer.synapse_program, fragment_shader);
-    glLinkProgram(renderer.synapse_program);
-
-    // Cleanup shaders
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-
-    // Create VAO and buffer
-    glGenVertexArrays(1, &renderer.synapse_vao);
-    glGenBuffers(1, &renderer.synapse_buffer);
+        renderer.neuron_capacity = network.neuron_count;
+        info("Renderer attached to %zu neurons, %zu synapse lines", network.neuron_count, lines);
+    }
 }
 
 void renderer_deinit(Renderer &renderer) {
-    glDeleteProgram(renderer.neuron_program);
-    glDeleteProgram(renderer.synapse_program);
+    shader_library_release(global_shader_library, renderer.neuron_program);
+    shader_library_release(global_shader_library, renderer.synapse_program);
+    shader_library_release(global_shader_library, renderer.density_program);
+    shader_library_release(global_shader_library, renderer.splat_resolve_program);
+    shader_library_release(global_shader_library, renderer.blur_program);
+    shader_library_release(global_shader_library, renderer.bloom_program);
+    if (renderer.splat_program) shader_library_release(global_shader_library, renderer.splat_program);
+    if (renderer.cull_neuron_program) shader_library_release(global_shader_library, renderer.cull_neuron_program);
+    if (renderer.cull_synapse_program) shader_library_release(global_shader_library, renderer.cull_synapse_program);
 
     glDeleteVertexArrays(1, &renderer.neuron_vao);
     glDeleteVertexArrays(1, &renderer.synapse_vao);
-}
 
-void renderer_render(const Renderer &renderer, const Network &network, const State &state) {
-    // Render synapses first (they should be behind neurons)
-    renderer_render_synapses(renderer, network, state);
+    glDeleteBuffers(1, &renderer.draw_buffer);
+    glDeleteBuffers(1, &renderer.density_buffer);
+    if (renderer.visible_neuron_buffer) glDeleteBuffers(1, &renderer.visible_neuron_buffer);
+    if (renderer.visible_synapse_buffer) glDeleteBuffers(1, &renderer.visible_synapse_buffer);
 
-    // Then render neurons on top
-    renderer_render_neurons(renderer, network, state);
+    GLuint textures[5] = {renderer.splat_neuron_texture, renderer.splat_synapse_texture, renderer.bloom_texture,
+                          renderer.bloom_ping_texture, renderer.bloom_pong_texture};
+    glDeleteTextures(5, textures);
+    glDeleteFramebuffers(1, &renderer.bloom_fbo);
 }
 
-void renderer_render_neurons(const Renderer &renderer, const Network &network, const State &state) {
-    // Get viewport dimensions
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    float width = static_cast<float>(viewport[2]);
-    float height = static_cast<float>(viewport[3]);
-
-    glUseProgram(renderer.neuron_program);
-
-    GLint viewport_loc = glGetUniformLocation(renderer.neuron_program, "viewport");
-    GLint active_loc = glGetUniformLocation(renderer.neuron_program, "active_color");
-    GLint inactive_loc = glGetUniformLocation(renderer.neuron_program, "inactive_color");
-
-    glUniform2f(viewport_loc, width, height);
-    glUniform4fv(active_loc, 1, state.neuron_color.active);
-    glUniform4fv(inactive_loc, 1, state.neuron_color.inactive);
-
-    glBindVertexArray(renderer.neuron_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, network.neuron_buffer);
-
-    // Position (x,y)
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void *)0);
-    // Activation
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void *)(sizeof(float) * 2));
-    // Threshold
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void *)(sizeof(float) * 3));
+// Resets the draw commands and density tiles, then appends everything on screen
+static void renderer_cull(Renderer &renderer, const Network &network, const State &state, const RendererView &view) {
+    stream_buffer_upload(global_stream_buffer, renderer.draw_buffer, 0, &RENDERER_EMPTY_COMMANDS,
+                         sizeof(RendererDrawCommands));
+
+    u32 tiles_x = ((u32)view.width + RENDERER_TILE_PIXELS - 1) / RENDERER_TILE_PIXELS;
+    u32 tiles_y = ((u32)view.height + RENDERER_TILE_PIXELS - 1) / RENDERER_TILE_PIXELS;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, renderer.density_buffer);
+    if (tiles_x != renderer.tiles_x || tiles_y != renderer.tiles_y) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (usize)tiles_x * tiles_y * 2 * sizeof(u32), nullptr, GL_DYNAMIC_COPY);
+        renderer.tiles_x = tiles_x;
+        renderer.tiles_y = tiles_y;
+    }
+    glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, network.neuron_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, network.synapse_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, renderer.visible_neuron_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, renderer.visible_synapse_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, renderer.draw_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, renderer.density_buffer);
+
+    GLuint groups = (GLuint)((network.neuron_count + network.variant.workgroup_size - 1) /
+                             network.variant.workgroup_size);
+
+    glUseProgram(renderer.cull_neuron_program);
+    glUniform4f(glGetUniformLocation(renderer.cull_neuron_program, "view"), view.min_x, view.min_y, view.max_x,
+                view.max_y);
+    glDispatchCompute(groups, 1, 1);
+
+    GLuint program = renderer.cull_synapse_program;
+    glUseProgram(program);
+    renderer_set_camera(program, view, state);
+    glUniform4f(glGetUniformLocation(program, "view"), view.min_x, view.min_y, view.max_x, view.max_y);
+    glUniform1f(glGetUniformLocation(program, "lod_pixels"), RENDERER_LOD_PIXELS);
+    glUniform1ui(glGetUniformLocation(program, "tile_pixels"), RENDERER_TILE_PIXELS);
+    glUniform2ui(glGetUniformLocation(program, "tile_count"), tiles_x, tiles_y);
+    glUniform1ui(glGetUniformLocation(program, "line_capacity"), (GLuint)renderer_line_capacity(network));
+    glDispatchCompute(groups, 1, 1);
+
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
 
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
+static void renderer_render_lines(Renderer &renderer, const Network &network, const State &state,
+                                  const RendererView &view) {
+    renderer_cull(renderer, network, state, view);
 
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    glDrawArrays(GL_POINTS, 0, network.neuron_count);
+    // Sub-pixel synapses first, as a single full-screen pass over the tiles
+    glUseProgram(renderer.density_program);
+    glUniform1ui(glGetUniformLocation(renderer.density_program, "tile_pixels"), RENDERER_TILE_PIXELS);
+    glUniform2ui(glGetUniformLocation(renderer.density_program, "tile_count"), renderer.tiles_x, renderer.tiles_y);
+    glUniform1f(glGetUniformLocation(renderer.density_program, "density_scale"), RENDERER_DENSITY_SCALE);
+    glUniform4fv(glGetUniformLocation(renderer.density_program, "active_color"), 1, state.synapse_color.active);
+    glUniform4fv(glGetUniformLocation(renderer.density_program, "inactive_color"), 1, state.synapse_color.inactive);
+    glBindVertexArray(renderer.synapse_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // Synapses behind neurons
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.draw_buffer);
+    glUseProgram(renderer.synapse_program);
+    renderer_set_camera(renderer.synapse_program, view, state);
+    glUniform4fv(glGetUniformLocation(renderer.synapse_program, "active_color"), 1, state.synapse_color.active);
+    glUniform4fv(glGetUniformLocation(renderer.synapse_program, "inactive_color"), 1, state.synapse_color.inactive);
+    glDrawArraysIndirect(GL_LINES, (void *)offsetof(RendererDrawCommands, synapse_count));
+
+    glUseProgram(renderer.neuron_program);
+    renderer_set_camera(renderer.neuron_program, view, state);
+    glUniform1f(glGetUniformLocation(renderer.neuron_program, "point_size"), view.point_size);
+    glUniform4fv(glGetUniformLocation(renderer.neuron_program, "active_color"), 1, state.neuron_color.active);
+    glUniform4fv(glGetUniformLocation(renderer.neuron_program, "inactive_color"), 1, state.neuron_color.inactive);
+    glBindVertexArray(renderer.neuron_vao);
+    glDrawArraysIndirect(GL_POINTS, (void *)offsetof(RendererDrawCommands, neuron_count));
 
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
     glDisable(GL_BLEND);
 }
 
-void renderer_render_synapses(const Renderer &renderer, const Network &network, const State &state) {
-    // Get viewport dimensions
-    GLint viewport[4];
-    glGetIntegerv(GL_VIEWPORT, viewport);
-    float width = static_cast<float>(viewport[2]);
-    float height = static_cast<float>(viewport[3]);
+static void renderer_texture_storage(GLuint texture, GLenum format, u32 width, u32 height) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format == GL_R32UI ? GL_RED_INTEGER : GL_RGBA,
+                 format == GL_R32UI ? GL_UNSIGNED_INT : GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
 
-    glUseProgram(renderer.synapse_program);
-    GLint viewport_loc = glGetUniformLocation(renderer.synapse_program, "viewport");
-    GLint active_loc = glGetUniformLocation(renderer.synapse_program, "active_color");
-    GLint inactive_loc = glGetUniformLocation(renderer.synapse_program, "inactive_color");
+static void renderer_resize_targets(Renderer &renderer, u32 width, u32 height) {
+    if (width == renderer.splat_width && height == renderer.splat_height) return;
 
-    glUniform2f(viewport_loc, width, height);
-    glUniform4fv(active_loc, 1, state.synapse_color.active);
-    glUniform4fv(inactive_loc, 1, state.synapse_color.inactive);
+    renderer_texture_storage(renderer.splat_neuron_texture, GL_R32UI, width, height);
+    renderer_texture_storage(renderer.splat_synapse_texture, GL_R32UI, width, height);
+    renderer_texture_storage(renderer.bloom_texture, GL_RGBA16F, width, height);
+    renderer_texture_storage(renderer.bloom_ping_texture, GL_RGBA16F, width, height);
+    renderer_texture_storage(renderer.bloom_pong_texture, GL_RGBA16F, width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
 
-    glBindVertexArray(renderer.synapse_vao);
+    renderer.splat_width = width;
+    renderer.splat_height = height;
+}
 
-    // Enable blending for transparent lines
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+// Draws a full-screen pass into texture through the bloom framebuffer
+static void renderer_bloom_target(const Renderer &renderer, GLuint texture) {
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer.bloom_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+}
+
+static void renderer_blur(const Renderer &renderer, GLuint source, GLuint target, i32 x, i32 y, f32 threshold) {
+    renderer_bloom_target(renderer, target);
+    glUseProgram(renderer.blur_program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, source);
+    glUniform1i(glGetUniformLocation(renderer.blur_program, "source"), 0);
+    glUniform2i(glGetUniformLocation(renderer.blur_program, "direction"), x, y);
+    glUniform1f(glGetUniformLocation(renderer.blur_program, "threshold"), threshold);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
 
-    const usize SYNAPSE_CACHE_STRIDE = MAX_NEURONS * MAX_SYNAPSES * 6;
-    f32 synapse_data[SYNAPSE_CACHE_STRIDE];
-    usize synapse_count = 0;
+static void renderer_render_density(Renderer &renderer, const Network &network, const State &state,
+                                    const RendererView &view) {
+    u32 width = (u32)view.width, height = (u32)view.height;
+    renderer_resize_targets(renderer, width, height);
+
+    u32 zero = 0;
+    glClearTexImage(renderer.splat_neuron_texture, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glClearTexImage(renderer.splat_synapse_texture, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, network.neuron_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, network.synapse_buffer);
+    glBindImageTexture(0, renderer.splat_neuron_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    glBindImageTexture(1, renderer.splat_synapse_texture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+
+    glUseProgram(renderer.splat_program);
+    renderer_set_camera(renderer.splat_program, view, state);
+    glDispatchCompute((GLuint)((network.neuron_count + network.variant.workgroup_size - 1) /
+                               network.variant.workgroup_size),
+                      1, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    // Tone map straight to the screen, or into bloom_texture when it will be blurred
+    GLint screen;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &screen);
+    glBindVertexArray(renderer.neuron_vao);
+    if (state.bloom_enabled) {
+        const f32 clear[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+        renderer_bloom_target(renderer, renderer.bloom_texture);
+        glClearBufferfv(GL_COLOR, 0, clear);
+    }
 
-    renderer_update_synapse_buffer(renderer, network, synapse_data, synapse_count);
+    GLuint program = renderer.splat_resolve_program;
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, renderer.splat_neuron_texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, renderer.splat_synapse_texture);
+    glUniform1i(glGetUniformLocation(program, "neuron_density"), 0);
+    glUniform1i(glGetUniformLocation(program, "synapse_traffic"), 1);
+    glUniform1f(glGetUniformLocation(program, "exposure"), state.exposure);
+    glUniform4fv(glGetUniformLocation(program, "neuron_color"), 1, state.neuron_color.active);
+    glUniform4fv(glGetUniformLocation(program, "synapse_color"), 1, state.synapse_color.active);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    if (state.bloom_enabled) {
+        renderer_blur(renderer, renderer.bloom_texture, renderer.bloom_ping_texture, 1, 0, RENDERER_BLOOM_THRESHOLD);
+        renderer_blur(renderer, renderer.bloom_ping_texture, renderer.bloom_pong_texture, 0, 1, 0.0f);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, screen);
+        glUseProgram(renderer.bloom_program);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, renderer.bloom_texture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, renderer.bloom_pong_texture);
+        glUniform1i(glGetUniformLocation(renderer.bloom_program, "original"), 0);
+        glUniform1i(glGetUniformLocation(renderer.bloom_program, "bloom"), 1);
+        glUniform1f(glGetUniformLocation(renderer.bloom_program, "intensity"), RENDERER_BLOOM_INTENSITY);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
 
-    // Draw the synapses as lines
-    glDrawArrays(GL_LINES, 0, synapse_count / 3); // 3 floats per vertex
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+}
 
-    glDisable(GL_BLEND);
+bool renderer_uses_density(const Renderer &renderer, const State &state) {
+    if (state.render_mode == RenderModeAuto) return renderer.synapse_count > RENDERER_SPLAT_SYNAPSE_THRESHOLD;
+    return state.render_mode == RenderModeDensity;
 }
 
-void renderer_update_synapse_buffer(const Renderer &renderer, const Network &network, f32 *synapse_data,
-                                    usize &synapse_count) {
-    synapse_count = 0;
-
-    for (usize i = 0; i < network.neuron_count; i++) {
-        float x1 = network.neuron_data[i * 4 + 0];
-        float y1 = network.neuron_data[i * 4 + 1];
-        float activation1 = network.neuron_data[i * 4 + 2];
-
-        for (int j = 0; j < MAX_SYNAPSES; j++) {
-            int target = network.synapse_data[i * MAX_SYNAPSES + j];
-            if (target >= 0) {
-                float x2 = network.neuron_data[target * 4 + 0];
-                float y2 = network.neuron_data[target * 4 + 1];
-                float activation2 = network.neuron_data[target * 4 + 2];
-
-                // First vertex of the line
-                synapse_data[synapse_count++] = x1;
-                synapse_data[synapse_count++] = y1;
-                synapse_data[synapse_count++] = activation1;
-
-                // Second vertex of the line
-                synapse_data[synapse_count++] = x2;
-                synapse_data[synapse_count++] = y2;
-                synapse_data[synapse_count++] = activation2;
-            }
-        }
+void renderer_render(Renderer &renderer, const Network &network, const State &state) {
+    if (!renderer.cull_neuron_program || network.neuron_count > renderer.neuron_capacity) return;
+
+    RendererView view = renderer_view(state);
+    if (renderer_uses_density(renderer, state)) {
+        renderer_render_density(renderer, network, state, view);
+    } else {
+        renderer_render_lines(renderer, network, state, view);
     }
+}
 
-    // Upload synapse data
-    glBindBuffer(GL_ARRAY_BUFFER, renderer.synapse_buffer);
-    glBufferData(GL_ARRAY_BUFFER, synapse_count * sizeof(f32), synapse_data, GL_STREAM_DRAW);
+void renderer_visible_counts(const Renderer &renderer, u32 *neurons, u32 *synapse_lines) {
+    RendererDrawCommands commands = RENDERER_EMPTY_COMMANDS;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, renderer.draw_buffer);
+    glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(commands), &commands);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
 
-    // Setup synapse attributes
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(f32) * 3, (void *)0);                 // position
-    glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(f32) * 3, (void *)(sizeof(f32) * 2)); // activation
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
+    *neurons = commands.neuron_count;
+    *synapse_lines = commands.synapse_count / 2;
 }
@@ -3,6 +3,21 @@
 #include "neural_net.hpp"
 #include "state.hpp"
 
+#define RENDERER_SYNAPSE_LINE_CAPACITY (1 << 22)   // visible lines per frame, the rest fall back to density tiles
+#define RENDERER_LOD_PIXELS 2.0f                   // synapses shorter than this on screen are drawn as density
+#define RENDERER_TILE_PIXELS 4                     // density tile edge
+#define RENDERER_SPLAT_SYNAPSE_THRESHOLD (1 << 20) // RenderModeAuto splats above this many synapses
+#define RENDERER_BLOOM_THRESHOLD 0.4f              // tone mapped brightness that starts to glow
+#define RENDERER_BLOOM_INTENSITY 1.5f
+
+// Neurons and synapses are culled on the GPU every frame. Compute passes append the visible neuron indices and
+// (row, target) pairs of visible synapses to buffers and count them into an indirect draw buffer, so draw cost
+// follows what is on screen rather than the network size. Synapses that would be sub-pixel are accumulated into
+// screen tiles instead and drawn as one full-screen density pass.
+//
+// Past a few million synapses even the culled lines are fill-rate bound and read as noise. The density mode skips
+// rasterising them: one compute pass atomically adds neuron activation and synapse traffic into two fixed-point
+// images, O(neurons + synapses) with no overdraw, and a full-screen pass tone maps them, optionally through bloom.
 struct Renderer {
     // Neuron resources
     GLuint neuron_program;
@@ -11,15 +26,50 @@ struct Renderer {
     // Synapse resources
     GLuint synapse_program;
     GLuint synapse_vao;
-    GLuint synapse_buffer;
 
-    // Post processing
+    // Culling, built for a specific network by renderer_attach
+    GLuint cull_neuron_program;
+    GLuint cull_synapse_program;
+    GLuint visible_neuron_buffer;  // u32 neuron index per visible neuron
+    GLuint visible_synapse_buffer; // uvec2 (row, target) per visible synapse
+    GLuint draw_buffer;            // RendererDrawCommands
+    usize neuron_capacity;
+
+    // Synapse level of detail
+    GLuint density_program;
+    GLuint density_buffer; // count and summed activation per tile
+    u32 tiles_x, tiles_y;
+
+    // Density mode
+    GLuint splat_program;
+    GLuint splat_resolve_program;
+    GLuint splat_neuron_texture;   // r32ui, activation * 256 per pixel
+    GLuint splat_synapse_texture;  // r32ui, presynaptic activation * 256 summed along synapses
+    u32 splat_width, splat_height; // size of the splat and bloom textures
+    usize synapse_count;           // of the attached network, for RenderModeAuto
+
+    // Post processing, density mode renders into bloom_texture and blurs it through ping and pong
+    GLuint blur_program;
+    GLuint bloom_program;
     GLuint bloom_fbo;
     GLuint bloom_texture;
     GLuint bloom_ping_texture;
     GLuint bloom_pong_texture;
 };
 
+// Layout shared with the cull shaders, the two draw commands are read by glDrawArraysIndirect
+struct RendererDrawCommands {
+    u32 neuron_count, neuron_instances, neuron_first, neuron_base_instance;
+    u32 synapse_count, synapse_instances, synapse_first, synapse_base_instance;
+    u32 synapse_appended; // may exceed the line capacity, the overflow goes to density tiles
+};
+
 void renderer_init(Renderer &renderer);
+// Compiles the cull passes for the network's storage format and sizes the visible lists. Call after network_upload.
+void renderer_attach(Renderer &renderer, const Network &network);
 void renderer_deinit(Renderer &renderer);
-void renderer_render(const Renderer &renderer, const Network &network, const State &state);
+void renderer_render(Renderer &renderer, const Network &network, const State &state);
+bool renderer_uses_density(const Renderer &renderer, const State &state);
+
+// Reads back last frame's visible counts, stalls the pipeline so only use it for diagnostics
+void renderer_visible_counts(const Renderer &renderer, u32 *neurons, u32 *synapse_lines);
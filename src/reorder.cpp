@@ -0,0 +1,221 @@
+#include "reorder.hpp"
+
+#include "core/arena.h"
+#include "core/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#define REORDER_GRAIN 4096
+
+// Hilbert index of (x, y) on a 2^16 x 2^16 grid
+static u64 hilbert_index(u32 x, u32 y) {
+    u64 d = 0;
+    for (u32 s = 1u << 15; s > 0; s >>= 1) {
+        u32 rx = (x & s) > 0;
+        u32 ry = (y & s) > 0;
+        d += (u64)s * s * ((3 * rx) ^ ry);
+
+        // Rotate the quadrant so the curve stays continuous
+        if (ry == 0) {
+            if (rx == 1) {
+                x = s - 1 - x;
+                y = s - 1 - y;
+            }
+            u32 t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return d;
+}
+
+static inline u64 morton_spread(u32 v) {
+    u64 x = v & 0xffff;
+    x = (x | (x << 8)) & 0x00ff00ff;
+    x = (x | (x << 4)) & 0x0f0f0f0f;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+static void reorder_curve(const Network &net, bool hilbert, u32 *order) {
+    usize n = net.neuron_count;
+
+    f32 min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    for (usize i = 0; i < n; i++) {
+        min_x = fminf(min_x, net.neuron_data[i * 4 + 0]);
+        min_y = fminf(min_y, net.neuron_data[i * 4 + 1]);
+        max_x = fmaxf(max_x, net.neuron_data[i * 4 + 0]);
+        max_y = fmaxf(max_y, net.neuron_data[i * 4 + 1]);
+    }
+    f32 scale = 65535.0f / fmaxf(fmaxf(max_x - min_x, max_y - min_y), 1e-6f);
+
+    // Curve index in the high bits, neuron index in the low bits, so one sort gives a stable order
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u64 *keys = arena_push<u64>(scratch, n);
+    parallel_for(0, n, REORDER_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            u32 x = (u32)((net.neuron_data[i * 4 + 0] - min_x) * scale);
+            u32 y = (u32)((net.neuron_data[i * 4 + 1] - min_y) * scale);
+            u64 curve = hilbert ? hilbert_index(x, y) : (morton_spread(x) | (morton_spread(y) << 1));
+            keys[i] = (curve << 32) | (u64)i;
+        }
+    });
+
+    // 32 bits of curve index is exact for a 2^16 grid
+    std::sort(keys, keys + n);
+    for (usize i = 0; i < n; i++) {
+        order[i] = (u32)(keys[i] & 0xffffffffu);
+    }
+
+    arena_restore(scratch, mark);
+}
+
+// Cuthill-McKee needs an undirected graph, so synapses are added in both directions
+static void reorder_rcm(const Network &net, u32 *order) {
+    usize n = net.neuron_count;
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u32 *offsets = arena_push_zero<u32>(scratch, n + 1);
+    for (usize i = 0; i < n; i++) {
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            i32 target = net.synapse_data[i * MAX_SYNAPSES + j];
+            if (target < 0 || (usize)target == i) continue;
+            offsets[i + 1]++;
+            offsets[target + 1]++;
+        }
+    }
+    for (usize i = 0; i < n; i++) {
+        offsets[i + 1] += offsets[i];
+    }
+
+    u32 *adjacency = arena_push<u32>(scratch, offsets[n]);
+    u32 *cursor = arena_push<u32>(scratch, n);
+    memcpy(cursor, offsets, n * sizeof(u32));
+    for (usize i = 0; i < n; i++) {
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            i32 target = net.synapse_data[i * MAX_SYNAPSES + j];
+            if (target < 0 || (usize)target == i) continue;
+            adjacency[cursor[i]++] = (u32)target;
+            adjacency[cursor[target]++] = (u32)i;
+        }
+    }
+
+    // Components are started from their lowest-degree neuron, a cheap stand-in for a pseudo-peripheral node
+    u32 *by_degree = cursor;
+    for (usize i = 0; i < n; i++) {
+        by_degree[i] = (u32)i;
+    }
+    std::sort(by_degree, by_degree + n, [&](u32 a, u32 b) {
+        return offsets[a + 1] - offsets[a] < offsets[b + 1] - offsets[b];
+    });
+
+    bool *visited = arena_push_zero<bool>(scratch, n);
+    usize head = 0, tail = 0;
+    for (usize s = 0; s < n; s++) {
+        u32 start = by_degree[s];
+        if (visited[start]) continue;
+
+        visited[start] = true;
+        order[tail++] = start;
+        while (head < tail) {
+            u32 node = order[head++];
+            usize first = tail;
+            for (u32 e = offsets[node]; e < offsets[node + 1]; e++) {
+                u32 neighbour = adjacency[e];
+                if (visited[neighbour]) continue;
+                visited[neighbour] = true;
+                order[tail++] = neighbour;
+            }
+            std::sort(order + first, order + tail, [&](u32 a, u32 b) {
+                return offsets[a + 1] - offsets[a] < offsets[b + 1] - offsets[b];
+            });
+        }
+    }
+
+    std::reverse(order, order + n);
+
+    arena_restore(scratch, mark);
+}
+
+void reorder_compute(const Network &net, ReorderMethod method, u32 *order) {
+    switch (method) {
+    case ReorderHilbert:
+        reorder_curve(net, true, order);
+        break;
+    case ReorderMorton:
+        reorder_curve(net, false, order);
+        break;
+    case ReorderRcm:
+        reorder_rcm(net, order);
+        break;
+    }
+}
+
+void network_permute(Network &net, const u32 *order) {
+    usize n = net.neuron_count;
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u32 *inverse = arena_push<u32>(scratch, n);
+    for (usize i = 0; i < n; i++) {
+        inverse[order[i]] = (u32)i;
+    }
+
+    f32 *neuron_data = (f32 *)malloc(n * 4 * sizeof(f32));
+    i32 *synapse_data = (i32 *)malloc(n * MAX_SYNAPSES * sizeof(i32));
+    f32 *weight_data = (f32 *)malloc(n * MAX_SYNAPSES * sizeof(f32));
+    Neuron::Kind *kind_data = (Neuron::Kind *)malloc(n * sizeof(Neuron::Kind));
+    u8 *delay_data = net.delay_data ? (u8 *)malloc(n * MAX_SYNAPSES) : nullptr;
+    u32 *id_of_index = (u32 *)malloc(n * sizeof(u32));
+
+    parallel_for(0, n, REORDER_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            u32 old = order[i];
+            memcpy(&neuron_data[i * 4], &net.neuron_data[old * 4], 4 * sizeof(f32));
+            kind_data[i] = net.kind_data[old];
+            id_of_index[i] = net.id_of_index ? net.id_of_index[old] : old;
+
+            for (int j = 0; j < MAX_SYNAPSES; j++) {
+                i32 target = net.synapse_data[old * MAX_SYNAPSES + j];
+                synapse_data[i * MAX_SYNAPSES + j] = target >= 0 ? (i32)inverse[target] : -1;
+                weight_data[i * MAX_SYNAPSES + j] = net.weight_data[old * MAX_SYNAPSES + j];
+            }
+            if (delay_data) memcpy(&delay_data[i * MAX_SYNAPSES], &net.delay_data[old * MAX_SYNAPSES], MAX_SYNAPSES);
+        }
+    });
+
+    if (!net.index_of_id) net.index_of_id = (u32 *)malloc(n * sizeof(u32));
+    for (usize i = 0; i < n; i++) {
+        net.index_of_id[id_of_index[i]] = (u32)i;
+    }
+
+    free(net.neuron_data);
+    free(net.synapse_data);
+    free(net.weight_data);
+    free(net.kind_data);
+    free(net.delay_data);
+    free(net.id_of_index);
+    arena_restore(scratch, mark);
+
+    net.neuron_data = neuron_data;
+    net.synapse_data = synapse_data;
+    net.weight_data = weight_data;
+    net.kind_data = kind_data;
+    net.delay_data = delay_data;
+    net.id_of_index = id_of_index;
+}
+
+void network_reorder(Network &net, ReorderMethod method) {
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u32 *order = arena_push<u32>(scratch, net.neuron_count);
+    reorder_compute(net, method, order);
+    network_permute(net, order);
+    arena_restore(scratch, mark);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "core/types.h"
+#include "neural_net.hpp"
+
+// Neuron orderings that place connected neurons close together in memory, so the gather of presynaptic
+// activations in a tick hits cache lines that neighbouring rows already loaded.
+enum ReorderMethod {
+    ReorderHilbert, // Hilbert curve over neuron positions, best when wiring is spatially local
+    ReorderMorton,  // Z-order over neuron positions, cheaper to compute but with longer jumps
+    ReorderRcm,     // Reverse Cuthill-McKee over the synapse graph, independent of positions
+};
+
+// Computes order[new_index] = old_index for every neuron
+void reorder_compute(const Network &net, ReorderMethod method, u32 *order);
+
+// Permutes neuron_data, kind_data and the synapse rows by order, remaps synapse targets and updates the ID
+// translation table. Host data only, call before network_upload.
+void network_permute(Network &net, const u32 *order);
+void network_reorder(Network &net, ReorderMethod method);
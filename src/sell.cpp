@@ -0,0 +1,93 @@
+#include "sell.hpp"
+
+#include "core/arena.h"
+#include "core/simd.h"
+#include "neural_net.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+static u32 sell_row_length(const Network &net, usize i) {
+    u32 length = 0;
+    for (int j = 0; j < MAX_SYNAPSES; j++) length += net.synapse_data[i * MAX_SYNAPSES + j] >= 0;
+    return length;
+}
+
+void sell_init(SellSynapses &sell, const Network &net, u32 chunk, u32 sigma) {
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+
+    usize n = net.neuron_count;
+    chunk = (chunk + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    if (sigma < chunk) sigma = chunk;
+    sell.neuron_count = n;
+    sell.chunk = chunk;
+    sell.sigma = sigma;
+    sell.chunk_count = (n + chunk - 1) / chunk;
+
+    // Longest rows first within each window, ties keep their order so equal rows stay as close as they were
+    u32 *length = arena_push<u32>(scratch, n);
+    sell.rows = (u32 *)malloc(sell.chunk_count * chunk * sizeof(u32));
+    sell.synapse_count = 0;
+    for (usize i = 0; i < n; i++) {
+        length[i] = sell_row_length(net, i);
+        sell.rows[i] = (u32)i;
+        sell.synapse_count += length[i];
+    }
+    for (usize i = n; i < sell.chunk_count * chunk; i++) sell.rows[i] = SELL_NO_ROW;
+    for (usize w = 0; w < n; w += sigma) {
+        usize end = w + sigma < n ? w + sigma : n;
+        std::stable_sort(sell.rows + w, sell.rows + end, [&](u32 a, u32 b) { return length[a] > length[b]; });
+    }
+
+    sell.chunks = (u32 *)malloc(sell.chunk_count * 2 * sizeof(u32));
+    usize entries = 0;
+    for (usize c = 0; c < sell.chunk_count; c++) {
+        u32 width = 0;
+        for (u32 l = 0; l < chunk; l++) {
+            u32 row = sell.rows[c * chunk + l];
+            if (row != SELL_NO_ROW && length[row] > width) width = length[row];
+        }
+        sell.chunks[c * 2 + 0] = (u32)entries;
+        sell.chunks[c * 2 + 1] = width;
+        entries += (usize)width * chunk;
+    }
+    sell.entry_count = entries;
+
+    sell.targets = (i32 *)malloc(entries * sizeof(i32));
+    sell.weights = (f32 *)malloc(entries * sizeof(f32));
+    for (usize c = 0; c < sell.chunk_count; c++) {
+        usize offset = sell.chunks[c * 2 + 0];
+        u32 width = sell.chunks[c * 2 + 1];
+        for (u32 l = 0; l < chunk; l++) {
+            u32 row = sell.rows[c * chunk + l];
+            u32 column = 0;
+            if (row != SELL_NO_ROW) {
+                for (int j = 0; j < MAX_SYNAPSES; j++) {
+                    usize slot = row * MAX_SYNAPSES + j;
+                    if (net.synapse_data[slot] < 0) continue;
+                    sell.targets[offset + column * chunk + l] = net.synapse_data[slot];
+                    sell.weights[offset + column * chunk + l] = net.weight_data[slot];
+                    column++;
+                }
+            }
+            for (; column < width; column++) {
+                sell.targets[offset + column * chunk + l] = -1;
+                sell.weights[offset + column * chunk + l] = 0.0f;
+            }
+        }
+    }
+
+    usize padded = (n + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    sell.input = (f32 *)calloc(padded, sizeof(f32));
+
+    arena_restore(scratch, mark);
+}
+
+void sell_deinit(SellSynapses &sell) {
+    free(sell.rows);
+    free(sell.chunks);
+    free(sell.targets);
+    free(sell.weights);
+    free(sell.input);
+}
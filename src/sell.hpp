@@ -0,0 +1,39 @@
+#pragma once
+
+#include "core/types.h"
+
+#define SELL_CHUNK 32   // C: one GPU warp, four AVX2 vectors
+#define SELL_SIGMA 1024 // rows are sorted by fan-in within windows of this many
+#define SELL_NO_ROW 0xFFFFFFFFu
+
+struct Network;
+
+// Synapse rows in sliced ELLPACK with fan-in sorting (SELL-C-sigma). Within each window of sigma rows of the current
+// order, rows are sorted longest first and cut into chunks of C. A chunk is padded only to its own longest row and
+// stored column-major, so column j of all C rows is contiguous: one SIMD load per 8 rows on the CPU, a coalesced
+// load per warp on the GPU. Each row keeps its synapses in column order with the -1 holes of the padded layout
+// squeezed out. Targets and activations stay in network order, rows maps each sorted position back to its neuron.
+struct SellSynapses {
+    usize neuron_count;
+    u32 chunk; // C, a multiple of SIMD_WIDTH
+    u32 sigma;
+    usize chunk_count;
+    usize entry_count;   // stored slots including padding
+    usize synapse_count; // real synapses
+
+    u32 *rows;   // neuron of each sorted position, chunk_count * chunk, SELL_NO_ROW past the last neuron
+    u32 *chunks; // first entry and width per chunk, read as a uvec2 by the compute shader
+    i32 *targets; // padding slots hold -1 with weight 0
+    f32 *weights;
+
+    f32 *input; // synaptic input per neuron between the two passes of a CPU tick, padded for SIMD loads
+};
+
+// Copies and re-sorts the network's rows, later edits to the network are not seen
+void sell_init(SellSynapses &sell, const Network &net, u32 chunk = SELL_CHUNK, u32 sigma = SELL_SIGMA);
+void sell_deinit(SellSynapses &sell);
+
+// Stored slots per real synapse, 1 when no slot is padding
+static inline f64 sell_padding_ratio(const SellSynapses &sell) {
+    return sell.synapse_count ? (f64)sell.entry_count / sell.synapse_count : 1.0;
+}
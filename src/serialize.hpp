@@ -2,4 +2,7 @@
 
 #include "core/types.h"
 
-const usize BIN_MAGIC = 0x78697500;
+// The low byte is the image version. Version 1 has no neuron kinds and loads every neuron as Hidden, version 2 adds
+// one byte per neuron for its kind after the weights.
+const usize BIN_MAGIC_V1 = 0x78697500;
+const usize BIN_MAGIC = 0x78697501;
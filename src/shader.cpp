@@ -1,8 +1,34 @@
 #include "shader.hpp"
 
+#include "core/arena.h"
+#include "core/file.h"
 #include "core/logger.h"
+#include "core/random.h"
 
-void check_shader_compilation(GLuint shader) {
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#define SHADER_CACHE_MAGIC 0x31424853u // "SHB1"
+
+// KHR_parallel_shader_compile, not part of the generated glad loader
+typedef void(APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+static PFNGLMAXSHADERCOMPILERTHREADSKHRPROC shader_max_compiler_threads;
+
+ShaderLibrary global_shader_library;
+
+struct ShaderCacheHeader {
+    u32 magic;
+    u32 format;
+    u64 key;
+};
+
+static f64 shader_now_ms() {
+    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+    return std::chrono::duration<f64, std::milli>(now).count();
+}
+
+bool check_shader_compilation(GLuint shader) {
     GLint success;
     char infoLog[512];
     glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
@@ -10,4 +36,412 @@ void check_shader_compilation(GLuint shader) {
         glGetShaderInfoLog(shader, 512, NULL, infoLog);
         error("Shader compilation failed: %s\n", infoLog);
     }
+    return success;
+}
+
+bool check_program_link(GLuint program) {
+    GLint success;
+    char infoLog[512];
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        error("Program link failed: %s\n", infoLog);
+    }
+    return success;
+}
+
+static char *shader_read_source(const ShaderLibrary &library, const char *name) {
+    for (usize i = 0; i < library.source_count; i++) {
+        const ShaderLibrary::Source &source = library.sources[i];
+        if (strcmp(source.name, name) != 0 || !source.text) continue;
+
+        usize len = strlen(source.text);
+        char *copy = (char *)malloc(len + 1);
+        memcpy(copy, source.text, len + 1);
+        return copy;
+    }
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", SHADER_DIR, name);
+    char *source = (char *)read_file_to_string(path);
+    if (!source) error("Missing shader source %s", path);
+    return source;
+}
+
+#ifdef DEBUG
+// Replaces the prefetched copy of name with what is on disk now, so a reload and every later compile see the edit
+static void shader_refresh_source(ShaderLibrary &library, const char *name) {
+    for (usize i = 0; i < library.source_count; i++) {
+        ShaderLibrary::Source &source = library.sources[i];
+        if (strcmp(source.name, name) != 0) continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", SHADER_DIR, name);
+        free(source.text);
+        source.mtime = file_mtime(path);
+        source.text = (char *)read_file_to_string(path);
+    }
+}
+#endif
+
+static i64 shader_source_mtime(const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", SHADER_DIR, name);
+    return file_mtime(path);
+}
+
+// Modification time of the text a compile of name used, the prefetched copy's if there is one. A file edited after
+// the prefetch then still looks changed to shader_library_poll.
+static i64 shader_read_mtime(const ShaderLibrary &library, const char *name) {
+    for (usize i = 0; i < library.source_count; i++) {
+        const ShaderLibrary::Source &source = library.sources[i];
+        if (strcmp(source.name, name) == 0 && source.text) return source.mtime;
+    }
+    return shader_source_mtime(name);
+}
+
+static bool shader_read_sources(const ShaderLibrary &library, const ShaderLibrary::Entry &entry, char **sources) {
+    bool complete = true;
+    for (usize i = 0; i < entry.stage_count; i++) {
+        sources[i] = shader_read_source(library, entry.names[i]);
+        complete = complete && sources[i];
+    }
+    return complete;
+}
+
+static void shader_free_sources(const ShaderLibrary::Entry &entry, char **sources) {
+    for (usize i = 0; i < entry.stage_count; i++) {
+        free(sources[i]);
+    }
+}
+
+// Compiles every stage, returns false and leaves shaders[] empty if any fails. Without check the status is not
+// queried, which would wait for a parallel compile to finish.
+static bool shader_compile_stages(const ShaderLibrary::Entry &entry, char **sources, GLuint *shaders,
+                                  bool check = true) {
+    bool compiled = true;
+    for (usize i = 0; i < entry.stage_count; i++) {
+        const char *parts[] = {entry.preamble, sources[i]};
+        shaders[i] = glCreateShader(entry.types[i]);
+        glShaderSource(shaders[i], 2, parts, NULL);
+        glCompileShader(shaders[i]);
+        if (check) compiled = check_shader_compilation(shaders[i]) && compiled;
+    }
+
+    if (!compiled) {
+        for (usize i = 0; i < entry.stage_count; i++) {
+            glDeleteShader(shaders[i]);
+        }
+    }
+    return compiled;
+}
+
+static bool shader_link(GLuint program, const GLuint *shaders, usize count, bool check = true) {
+    for (usize i = 0; i < count; i++) {
+        glAttachShader(program, shaders[i]);
+    }
+    glLinkProgram(program);
+    if (!check) return true;
+
+    for (usize i = 0; i < count; i++) {
+        glDetachShader(program, shaders[i]);
+    }
+    return check_program_link(program);
+}
+
+static void shader_delete_stages(const GLuint *shaders, usize count) {
+    for (usize i = 0; i < count; i++) {
+        glDeleteShader(shaders[i]);
+    }
+}
+
+static u64 shader_cache_key(const ShaderLibrary &library, const ShaderLibrary::Entry &entry, char **sources) {
+    u64 key = hash_bytes(entry.preamble, strlen(entry.preamble), library.driver_hash);
+    for (usize i = 0; i < entry.stage_count; i++) {
+        key = hash_bytes(&entry.types[i], sizeof(entry.types[i]), key);
+        key = hash_bytes(sources[i], strlen(sources[i]), key);
+    }
+    return key;
+}
+
+static void shader_cache_path(u64 key, char *path, usize capacity) {
+    snprintf(path, capacity, "%s/%016llx.bin", SHADER_CACHE_DIR, (unsigned long long)key);
+}
+
+static bool shader_cache_load(GLuint program, u64 key) {
+    char path[512];
+    shader_cache_path(key, path, sizeof(path));
+
+    usize len = 0;
+    u8 *data = read_file_to_bytes(path, &len);
+    if (!data) return false;
+
+    bool loaded = false;
+    const ShaderCacheHeader *header = (const ShaderCacheHeader *)data;
+    if (len > sizeof(ShaderCacheHeader) && header->magic == SHADER_CACHE_MAGIC && header->key == key) {
+        glProgramBinary(program, header->format, data + sizeof(ShaderCacheHeader),
+                        (GLsizei)(len - sizeof(ShaderCacheHeader)));
+        GLint success;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        loaded = success;
+    }
+
+    // A binary the driver rejects is rewritten after the program compiles from source
+    if (!loaded) info("Discarding stale program binary %s", path);
+    free(data);
+    return loaded;
+}
+
+static void shader_cache_store(GLuint program, u64 key) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u8 *data = arena_push<u8>(scratch, sizeof(ShaderCacheHeader) + length);
+    ShaderCacheHeader *header = (ShaderCacheHeader *)data;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, NULL, &format, data + sizeof(ShaderCacheHeader));
+    header->magic = SHADER_CACHE_MAGIC;
+    header->format = format;
+    header->key = key;
+
+    char path[512];
+    shader_cache_path(key, path, sizeof(path));
+    if (!write_bytes_to_file(path, data, sizeof(ShaderCacheHeader) + length)) {
+        warn("Failed to write program binary %s", path);
+    }
+    arena_restore(scratch, mark);
+}
+
+void shader_library_prefetch(ShaderLibrary &library, const char *const *names, usize count) {
+    for (usize i = 0; i < count && library.source_count < SHADER_LIBRARY_CAPACITY; i++) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", SHADER_DIR, names[i]);
+
+        ShaderLibrary::Source &source = library.sources[library.source_count++];
+        snprintf(source.name, SHADER_NAME_LENGTH, "%s", names[i]);
+        source.mtime = file_mtime(path); // before the read, an edit in between is reloaded later
+        source.text = (char *)read_file_to_string(path);
+    }
+}
+
+bool shader_has_extension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
+
+void shader_library_init(ShaderLibrary &library, GLADloadproc load) {
+    library.count = 0;
+    library.last_poll = 0.0;
+    library.compiled = 0;
+    library.cached = 0;
+    library.build_ms = 0.0;
+
+    const char *strings[] = {
+        (const char *)glGetString(GL_VENDOR),
+        (const char *)glGetString(GL_RENDERER),
+        (const char *)glGetString(GL_VERSION),
+    };
+    library.driver_hash = hash_bytes(nullptr, 0);
+    for (const char *string : strings) {
+        if (string) library.driver_hash = hash_bytes(string, strlen(string), library.driver_hash);
+    }
+
+    // Let the driver pick its thread count, compiles then return immediately and finish in the background
+    library.parallel_compile = false;
+    if (shader_has_extension("GL_KHR_parallel_shader_compile")) {
+        shader_max_compiler_threads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsKHR");
+    } else if (shader_has_extension("GL_ARB_parallel_shader_compile")) {
+        shader_max_compiler_threads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)load("glMaxShaderCompilerThreadsARB");
+    }
+    if (shader_max_compiler_threads) {
+        shader_max_compiler_threads(0xFFFFFFFFu);
+        library.parallel_compile = true;
+    }
+
+    library.binary_cache = false;
+#ifndef DEBUG
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    library.binary_cache = formats > 0 && make_directory(SHADER_CACHE_DIR);
+    if (!library.binary_cache) warn("Program binary cache unavailable, shaders compile on every start");
+#endif
+}
+
+static void shader_entry_delete(ShaderLibrary::Entry &entry) {
+    if (entry.pending) shader_delete_stages(entry.shaders, entry.stage_count);
+    entry.pending = false;
+    glDeleteProgram(entry.program);
+}
+
+void shader_library_deinit(ShaderLibrary &library) {
+    for (usize i = 0; i < library.count; i++) {
+        shader_entry_delete(library.entries[i]);
+    }
+    library.count = 0;
+
+    for (usize i = 0; i < library.source_count; i++) {
+        free(library.sources[i].text);
+    }
+    library.source_count = 0;
+}
+
+static GLuint shader_library_add(ShaderLibrary &library, ShaderLibrary::Entry &entry) {
+    f64 start = shader_now_ms();
+
+    char *sources[SHADER_MAX_STAGES] = {};
+    if (!shader_read_sources(library, entry, sources)) {
+        shader_free_sources(entry, sources);
+        return 0;
+    }
+
+    entry.program = glCreateProgram();
+    entry.pending = false;
+    entry.key = library.binary_cache ? shader_cache_key(library, entry, sources) : 0;
+
+    if (library.binary_cache && shader_cache_load(entry.program, entry.key)) {
+        library.cached++;
+    } else {
+        library.compiled++;
+        if (library.binary_cache) glProgramParameteri(entry.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+        if (library.parallel_compile) {
+            // Status queries would block, shader_library_finish checks the result
+            shader_compile_stages(entry, sources, entry.shaders, false);
+            shader_link(entry.program, entry.shaders, entry.stage_count, false);
+            entry.pending = true;
+        } else if (shader_compile_stages(entry, sources, entry.shaders)) {
+            if (shader_link(entry.program, entry.shaders, entry.stage_count) && library.binary_cache) {
+                shader_cache_store(entry.program, entry.key);
+            }
+            shader_delete_stages(entry.shaders, entry.stage_count);
+        }
+    }
+    shader_free_sources(entry, sources);
+
+    for (usize i = 0; i < entry.stage_count; i++) {
+        entry.mtimes[i] = shader_read_mtime(library, entry.names[i]);
+    }
+
+    if (library.count < SHADER_LIBRARY_CAPACITY) {
+        library.entries[library.count++] = entry;
+    } else {
+        warn("Shader library full, %s will not be reloaded", entry.names[0]);
+    }
+
+    library.build_ms += shader_now_ms() - start;
+    return entry.program;
+}
+
+static void shader_entry_name(ShaderLibrary::Entry &entry, usize stage, GLenum type, const char *name) {
+    entry.types[stage] = type;
+    snprintf(entry.names[stage], SHADER_NAME_LENGTH, "%s", name);
+}
+
+GLuint shader_library_compute(ShaderLibrary &library, const char *name, const char *preamble) {
+    ShaderLibrary::Entry entry;
+    entry.stage_count = 1;
+    shader_entry_name(entry, 0, GL_COMPUTE_SHADER, name);
+    snprintf(entry.preamble, SHADER_PREAMBLE_LENGTH, "%s", preamble ? preamble : "");
+    return shader_library_add(library, entry);
+}
+
+GLuint shader_library_render(ShaderLibrary &library, const char *vertex_name, const char *fragment_name) {
+    ShaderLibrary::Entry entry;
+    entry.stage_count = 2;
+    shader_entry_name(entry, 0, GL_VERTEX_SHADER, vertex_name);
+    shader_entry_name(entry, 1, GL_FRAGMENT_SHADER, fragment_name);
+    entry.preamble[0] = '\0';
+    return shader_library_add(library, entry);
+}
+
+GLuint shader_library_find_compute(const ShaderLibrary &library, const char *name, const char *preamble) {
+    for (usize i = 0; i < library.count; i++) {
+        const ShaderLibrary::Entry &entry = library.entries[i];
+        if (entry.stage_count != 1 || entry.types[0] != GL_COMPUTE_SHADER) continue;
+        if (strncmp(entry.names[0], name, SHADER_NAME_LENGTH) != 0) continue;
+        if (strncmp(entry.preamble, preamble ? preamble : "", SHADER_PREAMBLE_LENGTH) != 0) continue;
+        return entry.program;
+    }
+    return 0;
+}
+
+void shader_library_release(ShaderLibrary &library, GLuint program) {
+    for (usize i = 0; i < library.count; i++) {
+        if (library.entries[i].program != program) continue;
+        shader_entry_delete(library.entries[i]);
+        library.entries[i] = library.entries[--library.count];
+        return;
+    }
+    glDeleteProgram(program);
+}
+
+void shader_library_finish(ShaderLibrary &library) {
+    f64 start = shader_now_ms();
+    for (usize e = 0; e < library.count; e++) {
+        ShaderLibrary::Entry &entry = library.entries[e];
+        if (!entry.pending) continue;
+
+        for (usize i = 0; i < entry.stage_count; i++) {
+            glDetachShader(entry.program, entry.shaders[i]);
+            check_shader_compilation(entry.shaders[i]);
+        }
+        if (check_program_link(entry.program) && library.binary_cache) shader_cache_store(entry.program, entry.key);
+
+        shader_delete_stages(entry.shaders, entry.stage_count);
+        entry.pending = false;
+    }
+    library.build_ms += shader_now_ms() - start;
+}
+
+usize shader_library_poll(ShaderLibrary &library) {
+#ifdef DEBUG
+    f64 now = shader_now_ms() / 1e3;
+    if (now - library.last_poll < SHADER_POLL_INTERVAL) return 0;
+    library.last_poll = now;
+
+    usize reloaded = 0;
+    for (usize e = 0; e < library.count; e++) {
+        ShaderLibrary::Entry &entry = library.entries[e];
+        if (entry.pending) continue;
+
+        bool changed = false;
+        for (usize i = 0; i < entry.stage_count; i++) {
+            i64 mtime = shader_source_mtime(entry.names[i]);
+            if (mtime == entry.mtimes[i]) continue;
+            shader_refresh_source(library, entry.names[i]);
+            changed = true;
+            entry.mtimes[i] = mtime;
+        }
+        if (!changed) continue;
+
+        char *sources[SHADER_MAX_STAGES] = {};
+        GLuint shaders[SHADER_MAX_STAGES];
+        if (shader_read_sources(library, entry, sources) && shader_compile_stages(entry, sources, shaders)) {
+            // Link a scratch program first, a failed link on the live program would leave it unusable
+            GLuint scratch = glCreateProgram();
+            bool linked = shader_link(scratch, shaders, entry.stage_count);
+            glDeleteProgram(scratch);
+
+            if (linked && shader_link(entry.program, shaders, entry.stage_count)) {
+                info("Reloaded %s", entry.names[0]);
+                reloaded++;
+            }
+            shader_delete_stages(shaders, entry.stage_count);
+        } else {
+            warn("Keeping previous %s", entry.names[0]);
+        }
+        shader_free_sources(entry, sources);
+    }
+    return reloaded;
+#else
+    return 0;
+#endif
 }
@@ -1,5 +1,96 @@
 #pragma once
 
 #include "core/logger.h"
+#include "core/types.h"
 
-void check_shader_compilation(GLuint shader);
+#define SHADER_LIBRARY_CAPACITY 64
+#define SHADER_MAX_STAGES 2
+#define SHADER_NAME_LENGTH 64
+#define SHADER_PREAMBLE_LENGTH 1024
+#define SHADER_POLL_INTERVAL 0.5 // seconds between source checks in debug builds
+
+#ifndef SHADER_DIR
+#define SHADER_DIR "shaders"
+#endif
+
+#ifndef SHADER_CACHE_DIR
+#define SHADER_CACHE_DIR "shader_cache"
+#endif
+
+bool check_shader_compilation(GLuint shader);
+bool check_program_link(GLuint program);
+
+// Programs built from the files in SHADER_DIR.
+//
+// Debug builds watch the sources and relink changed programs in place, so GLuint handles held by networks and the
+// renderer stay valid. A source that fails to compile keeps the previous program running.
+//
+// With KHR_parallel_shader_compile, programs are compiled and linked by driver threads and only checked in
+// shader_library_finish, so the caller can keep working while they build.
+//
+// Release builds keep linked binaries in SHADER_CACHE_DIR, keyed by a hash of the sources, preamble and driver
+// strings. A warm start loads them with glProgramBinary and skips compilation; a driver update or an edited
+// source changes the key and falls back to compiling.
+struct ShaderLibrary {
+    struct Entry {
+        GLuint program;
+        usize stage_count;
+        GLenum types[SHADER_MAX_STAGES];
+        char names[SHADER_MAX_STAGES][SHADER_NAME_LENGTH];
+        char preamble[SHADER_PREAMBLE_LENGTH]; // prepended to every stage, empty when the files carry #version
+        i64 mtimes[SHADER_MAX_STAGES];
+
+        // Still building on driver threads, checked and cached by shader_library_finish
+        bool pending;
+        GLuint shaders[SHADER_MAX_STAGES];
+        u64 key;
+    };
+
+    // Sources read ahead of time, possibly on another thread before the context exists
+    struct Source {
+        char name[SHADER_NAME_LENGTH];
+        char *text;
+        i64 mtime; // of the file when text was read
+    };
+
+    Entry entries[SHADER_LIBRARY_CAPACITY];
+    usize count;
+    Source sources[SHADER_LIBRARY_CAPACITY];
+    usize source_count;
+
+    bool parallel_compile;
+    bool binary_cache;
+    u64 driver_hash;
+    f64 last_poll;
+
+    // Startup accounting, programs compiled from source vs loaded from the binary cache
+    usize compiled;
+    usize cached;
+    f64 build_ms;
+};
+
+extern ShaderLibrary global_shader_library;
+
+// Reads sources into memory without touching GL. Must finish before the first program is created.
+void shader_library_prefetch(ShaderLibrary &library, const char *const *names, usize count);
+
+// Needs a current context, reads the driver strings, prepares the cache directory and enables parallel compilation.
+// load resolves extension entry points glad does not know about, e.g. glfwGetProcAddress.
+void shader_library_init(ShaderLibrary &library, GLADloadproc load);
+void shader_library_deinit(ShaderLibrary &library);
+
+// Whether the current context lists the extension
+bool shader_has_extension(const char *name);
+
+// The preamble must supply #version when given
+GLuint shader_library_compute(ShaderLibrary &library, const char *name, const char *preamble = nullptr);
+GLuint shader_library_render(ShaderLibrary &library, const char *vertex_name, const char *fragment_name);
+// The program an earlier shader_library_compute built from the same file and preamble, 0 when there is none
+GLuint shader_library_find_compute(const ShaderLibrary &library, const char *name, const char *preamble = nullptr);
+void shader_library_release(ShaderLibrary &library, GLuint program);
+
+// Blocks until every pending program is built, reports failures and writes the binary cache
+void shader_library_finish(ShaderLibrary &library);
+
+// Relinks programs whose sources changed since they were built, returns how many were reloaded. No-op in release.
+usize shader_library_poll(ShaderLibrary &library);
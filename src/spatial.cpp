@@ -0,0 +1,235 @@
+#include "spatial.hpp"
+
+#include "core/arena.h"
+#include "core/parallel.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#define SPATIAL_GRAIN 4096
+
+static inline u32 spatial_grid_cell_of(const SpatialGrid &grid, f32 x, f32 y) {
+    i32 cx = (i32)((x - grid.min_x) * grid.inv_cell_size);
+    i32 cy = (i32)((y - grid.min_y) * grid.inv_cell_size);
+    if (cx < 0) cx = 0;
+    if (cy < 0) cy = 0;
+    if (cx >= (i32)grid.width) cx = grid.width - 1;
+    if (cy >= (i32)grid.height) cy = grid.height - 1;
+    return (u32)cy * grid.width + (u32)cx;
+}
+
+void spatial_grid_build(SpatialGrid &grid, const f32 *positions, usize stride, usize count, f32 points_per_cell) {
+    grid.point_count = count;
+
+    // Bounds per chunk, merged under a lock since there is only one merge per thread
+    f32 min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    std::mutex bounds_mutex;
+    parallel_for(0, count, SPATIAL_GRAIN, [&](usize begin, usize end) {
+        f32 lo_x = INFINITY, lo_y = INFINITY, hi_x = -INFINITY, hi_y = -INFINITY;
+        for (usize i = begin; i < end; i++) {
+            f32 x = positions[i * stride + 0];
+            f32 y = positions[i * stride + 1];
+            lo_x = fminf(lo_x, x);
+            lo_y = fminf(lo_y, y);
+            hi_x = fmaxf(hi_x, x);
+            hi_y = fmaxf(hi_y, y);
+        }
+
+        std::lock_guard<std::mutex> lock(bounds_mutex);
+        min_x = fminf(min_x, lo_x);
+        min_y = fminf(min_y, lo_y);
+        max_x = fmaxf(max_x, hi_x);
+        max_y = fmaxf(max_y, hi_y);
+    });
+    if (count == 0) min_x = min_y = max_x = max_y = 0.0f;
+
+    f32 extent_x = fmaxf(max_x - min_x, 1e-6f);
+    f32 extent_y = fmaxf(max_y - min_y, 1e-6f);
+    f32 cells = fmaxf((f32)count / points_per_cell, 1.0f);
+
+    grid.min_x = min_x;
+    grid.min_y = min_y;
+    grid.cell_size = sqrtf(extent_x * extent_y / cells);
+    grid.inv_cell_size = 1.0f / grid.cell_size;
+    grid.width = (u32)(extent_x * grid.inv_cell_size) + 1;
+    grid.height = (u32)(extent_y * grid.inv_cell_size) + 1;
+
+    usize cell_count = (usize)grid.width * grid.height;
+    grid.cell_offsets = (u32 *)calloc(cell_count + 1, sizeof(u32));
+    grid.indices = (u32 *)malloc(count * sizeof(u32));
+    grid.points = (f32 *)malloc(count * 2 * sizeof(f32));
+
+    // Keys and counts are independent per point. Points are scattered with atomic cursors and each cell is then
+    // sorted by source index, so the layout does not depend on thread timing.
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    u32 *keys = arena_push<u32>(scratch, count);
+    std::atomic<u32> *cursor = arena_push_zero<std::atomic<u32>>(scratch, cell_count + 1);
+    parallel_for(0, count, SPATIAL_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            keys[i] = spatial_grid_cell_of(grid, positions[i * stride + 0], positions[i * stride + 1]);
+            cursor[keys[i] + 1].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+
+    for (usize c = 0; c < cell_count; c++) {
+        u32 offset = grid.cell_offsets[c] + cursor[c + 1].load(std::memory_order_relaxed);
+        grid.cell_offsets[c + 1] = offset;
+        cursor[c].store(grid.cell_offsets[c], std::memory_order_relaxed);
+    }
+
+    parallel_for(0, count, SPATIAL_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            grid.indices[cursor[keys[i]].fetch_add(1, std::memory_order_relaxed)] = (u32)i;
+        }
+    });
+
+    parallel_for(0, cell_count, SPATIAL_GRAIN, [&](usize begin, usize end) {
+        for (usize c = begin; c < end; c++) {
+            // Cells hold a handful of points, insertion sort is enough
+            for (u32 p = grid.cell_offsets[c] + 1; p < grid.cell_offsets[c + 1]; p++) {
+                u32 index = grid.indices[p];
+                u32 q = p;
+                while (q > grid.cell_offsets[c] && grid.indices[q - 1] > index) {
+                    grid.indices[q] = grid.indices[q - 1];
+                    q--;
+                }
+                grid.indices[q] = index;
+            }
+            for (u32 p = grid.cell_offsets[c]; p < grid.cell_offsets[c + 1]; p++) {
+                grid.points[p * 2 + 0] = positions[grid.indices[p] * stride + 0];
+                grid.points[p * 2 + 1] = positions[grid.indices[p] * stride + 1];
+            }
+        }
+    });
+
+    arena_restore(scratch, mark);
+}
+
+void spatial_grid_deinit(SpatialGrid &grid) {
+    free(grid.cell_offsets);
+    free(grid.indices);
+    free(grid.points);
+    grid.cell_offsets = nullptr;
+    grid.indices = nullptr;
+    grid.points = nullptr;
+    grid.point_count = 0;
+}
+
+usize spatial_grid_knn(const SpatialGrid &grid, f32 x, f32 y, usize k, i32 exclude, u32 *out_indices,
+                       f32 *out_dist2) {
+    if (k == 0 || grid.point_count == 0) return 0;
+
+    i32 cx = (i32)((x - grid.min_x) * grid.inv_cell_size);
+    i32 cy = (i32)((y - grid.min_y) * grid.inv_cell_size);
+    i32 max_ring = (i32)(grid.width > grid.height ? grid.width : grid.height) + abs(cx) + abs(cy);
+
+    usize found = 0;
+    for (i32 ring = 0; ring <= max_ring; ring++) {
+        for (i32 gy = cy - ring; gy <= cy + ring; gy++) {
+            if (gy < 0 || gy >= (i32)grid.height) continue;
+
+            // Interior rows of the ring only contribute their two edge cells
+            bool edge_row = gy == cy - ring || gy == cy + ring;
+            i32 step = edge_row ? 1 : 2 * ring;
+            for (i32 gx = cx - ring; gx <= cx + ring; gx += step > 0 ? step : 1) {
+                if (gx < 0 || gx >= (i32)grid.width) continue;
+
+                u32 cell = (u32)gy * grid.width + (u32)gx;
+                for (u32 p = grid.cell_offsets[cell]; p < grid.cell_offsets[cell + 1]; p++) {
+                    if ((i32)grid.indices[p] == exclude) continue;
+
+                    f32 dx = grid.points[p * 2 + 0] - x;
+                    f32 dy = grid.points[p * 2 + 1] - y;
+                    f32 d2 = dx * dx + dy * dy;
+                    if (found == k && d2 >= out_dist2[k - 1]) continue;
+
+                    // Insertion into the sorted result list, k is small
+                    usize slot = found < k ? found++ : k - 1;
+                    while (slot > 0 && out_dist2[slot - 1] > d2) {
+                        out_dist2[slot] = out_dist2[slot - 1];
+                        out_indices[slot] = out_indices[slot - 1];
+                        slot--;
+                    }
+                    out_dist2[slot] = d2;
+                    out_indices[slot] = grid.indices[p];
+                }
+            }
+        }
+
+        // Everything beyond this ring is at least ring * cell_size away
+        f32 reach = ring * grid.cell_size;
+        if (found == k && out_dist2[k - 1] <= reach * reach) break;
+    }
+
+    return found;
+}
+
+// Range of cells overlapping the square around (x, y), clamped to the grid. False when the square misses the grid,
+// or is not a number. Clamped as floats, so far-off queries never overflow the cast to i32.
+static bool spatial_grid_cell_range(const SpatialGrid &grid, f32 x, f32 y, f32 radius, i32 *lo_x, i32 *lo_y,
+                                    i32 *hi_x, i32 *hi_y) {
+    f32 lx = floorf((x - radius - grid.min_x) * grid.inv_cell_size);
+    f32 ly = floorf((y - radius - grid.min_y) * grid.inv_cell_size);
+    f32 hx = floorf((x + radius - grid.min_x) * grid.inv_cell_size);
+    f32 hy = floorf((y + radius - grid.min_y) * grid.inv_cell_size);
+    f32 last_x = (f32)(grid.width - 1), last_y = (f32)(grid.height - 1);
+    if (!(hx >= 0.0f && hy >= 0.0f && lx <= last_x && ly <= last_y && lx <= hx && ly <= hy)) return false;
+
+    *lo_x = (i32)(lx < 0.0f ? 0.0f : lx);
+    *lo_y = (i32)(ly < 0.0f ? 0.0f : ly);
+    *hi_x = (i32)(hx > last_x ? last_x : hx);
+    *hi_y = (i32)(hy > last_y ? last_y : hy);
+    return true;
+}
+
+usize spatial_grid_radius(const SpatialGrid &grid, f32 x, f32 y, f32 radius, u32 *out_indices, usize capacity) {
+    if (grid.point_count == 0) return 0;
+
+    i32 lo_x, lo_y, hi_x, hi_y;
+    if (!spatial_grid_cell_range(grid, x, y, radius, &lo_x, &lo_y, &hi_x, &hi_y)) return 0;
+
+    usize found = 0;
+    f32 radius2 = radius * radius;
+    for (i32 gy = lo_y; gy <= hi_y; gy++) {
+        u32 row_begin = grid.cell_offsets[(u32)gy * grid.width + (u32)lo_x];
+        u32 row_end = grid.cell_offsets[(u32)gy * grid.width + (u32)hi_x + 1];
+
+        // Cells of a row are contiguous, so the whole span is one linear scan
+        for (u32 p = row_begin; p < row_end; p++) {
+            f32 dx = grid.points[p * 2 + 0] - x;
+            f32 dy = grid.points[p * 2 + 1] - y;
+            if (dx * dx + dy * dy > radius2) continue;
+            if (found < capacity) out_indices[found] = grid.indices[p];
+            found++;
+        }
+    }
+    return found;
+}
+
+i32 spatial_grid_nearest(const SpatialGrid &grid, f32 x, f32 y, f32 max_distance) {
+    if (grid.point_count == 0) return -1;
+
+    i32 lo_x, lo_y, hi_x, hi_y;
+    if (!spatial_grid_cell_range(grid, x, y, max_distance, &lo_x, &lo_y, &hi_x, &hi_y)) return -1;
+
+    i32 nearest = -1;
+    f32 nearest_dist2 = max_distance * max_distance;
+    for (i32 gy = lo_y; gy <= hi_y; gy++) {
+        u32 row_begin = grid.cell_offsets[(u32)gy * grid.width + (u32)lo_x];
+        u32 row_end = grid.cell_offsets[(u32)gy * grid.width + (u32)hi_x + 1];
+        for (u32 p = row_begin; p < row_end; p++) {
+            f32 dx = grid.points[p * 2 + 0] - x;
+            f32 dy = grid.points[p * 2 + 1] - y;
+            f32 d2 = dx * dx + dy * dy;
+            if (d2 > nearest_dist2) continue;
+            if (d2 == nearest_dist2 && nearest >= 0 && grid.indices[p] > (u32)nearest) continue;
+            nearest = (i32)grid.indices[p];
+            nearest_dist2 = d2;
+        }
+    }
+    return nearest;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "core/types.h"
+
+// Uniform grid over 2D points, stored as CSR over cells. Point positions are copied in cell order so that
+// queries walk contiguous memory instead of gathering from the source array.
+struct SpatialGrid {
+    f32 min_x, min_y;
+    f32 cell_size, inv_cell_size;
+    u32 width, height;
+    usize point_count;
+
+    u32 *cell_offsets; // width * height + 1
+    u32 *indices;      // source index of each point, in cell order
+    f32 *points;       // x,y of each point, in cell order
+};
+
+// Builds the grid over count points read from positions with the given float stride (2 for packed x,y, 4 for
+// neuron_data). Cells are sized to hold roughly points_per_cell points on average. Runs in parallel and produces the
+// same layout for any thread count; call spatial_grid_deinit first when rebuilding after positions change.
+void spatial_grid_build(SpatialGrid &grid, const f32 *positions, usize stride, usize count,
+                        f32 points_per_cell = 2.0f);
+void spatial_grid_deinit(SpatialGrid &grid);
+
+// Finds up to k nearest points to (x, y), skipping the point with source index exclude (-1 for none).
+// Results are written nearest first; returns the number found.
+usize spatial_grid_knn(const SpatialGrid &grid, f32 x, f32 y, usize k, i32 exclude, u32 *out_indices,
+                       f32 *out_dist2);
+
+// Writes the source indices of all points within radius of (x, y), up to capacity of them. Returns the total number
+// within radius, which may exceed capacity.
+usize spatial_grid_radius(const SpatialGrid &grid, f32 x, f32 y, f32 radius, u32 *out_indices, usize capacity);
+
+// Source index of the nearest point within max_distance of (x, y), or -1. Ties go to the lower index.
+i32 spatial_grid_nearest(const SpatialGrid &grid, f32 x, f32 y, f32 max_distance);
@@ -6,14 +6,42 @@
 // #include <cstdlib>
 // #include <cstring>
 
+enum RenderMode {
+    RenderModeAuto,    // splat once the network has more than RENDERER_SPLAT_SYNAPSE_THRESHOLD synapses
+    RenderModeLines,   // culled points and lines
+    RenderModeDensity, // activation and synapse traffic splatted into density images
+};
+
 struct State {
     struct Color {
         f32 active[4];
         f32 inactive[4];
     };
 
+    // World point at the centre of the viewport, zoom 1 shows y in [-1, 1]
+    struct Camera {
+        f32 x, y;
+        f32 zoom;
+    };
+
     bool network_paused, renderer_paused;
+    bool plasticity_enabled;
     Color neuron_color, synapse_color;
+    Camera camera;
+
+    RenderMode render_mode;
+    bool bloom_enabled; // density mode only
+    f32 exposure;
+
+    // Picking, indices into the network's neuron arrays or -1
+    i32 hovered_neuron;
+    i32 selected_neuron;
+    bool select_requested; // set by the mouse button callback, resolved on the next frame
+
+    // Stimulus brush, drag with the right mouse button
+    bool brush_enabled;
+    bool brush_active;
+    f32 brush_radius; // world units
 };
 
 // bool save(State &state, const char *path) {
@@ -0,0 +1,158 @@
+#include "storage_format.hpp"
+
+#include "core/half.h"
+#include "core/logger.h"
+#include "core/simd.h"
+#include "neural_net.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+StorageFormat storage_format_resolve(StorageFormat format, usize neuron_count) {
+    if (format.targets == TargetFormatU16 && neuron_count > STORAGE_U16_MAX_NEURONS) {
+        warn("16-bit targets need at most %d neurons, using 32-bit targets for %zu", STORAGE_U16_MAX_NEURONS,
+             neuron_count);
+        format.targets = TargetFormatI32;
+    }
+    return format;
+}
+
+usize storage_format_bytes_per_tick(const StorageFormat &format, usize neuron_count) {
+    usize slots = neuron_count * MAX_SYNAPSES;
+    usize target_bytes = format.targets == TargetFormatU16 ? 2 : 4;
+    usize weight_bytes = format.weights == WeightFormatF32 ? 4 : format.weights == WeightFormatF16 ? 2 : 1;
+    usize activation_bytes = format.activations == ActivationFormatF16 ? 2 : 4;
+    usize scale_bytes = format.weights == WeightFormatQ8 ? neuron_count * sizeof(f32) : 0;
+
+    return slots * (target_bytes + weight_bytes + activation_bytes) + scale_bytes + neuron_count * 2 * activation_bytes;
+}
+
+// Largest magnitude maps to 127 so the row keeps its full int8 range
+static f32 compact_row_scale(const Network &net, usize row) {
+    f32 largest = 0.0f;
+    for (int j = 0; j < MAX_SYNAPSES; j++) {
+        if (net.synapse_data[row * MAX_SYNAPSES + j] < 0) continue;
+        largest = fmaxf(largest, fabsf(net.weight_data[row * MAX_SYNAPSES + j]));
+    }
+    return largest > 0.0f ? largest / 127.0f : 1.0f;
+}
+
+static void compact_encode_weights(const Network &net, WeightFormat format, void *weights, f32 *row_scale) {
+    for (usize i = 0; i < net.neuron_count; i++) {
+        f32 scale = format == WeightFormatQ8 ? compact_row_scale(net, i) : 1.0f;
+        if (row_scale) row_scale[i] = scale;
+
+        for (int j = 0; j < MAX_SYNAPSES; j++) {
+            usize slot = i * MAX_SYNAPSES + j;
+            f32 weight = net.synapse_data[slot] >= 0 ? net.weight_data[slot] : 0.0f;
+
+            switch (format) {
+            case WeightFormatF32:
+                ((f32 *)weights)[slot] = weight;
+                break;
+            case WeightFormatF16:
+                ((u16 *)weights)[slot] = f16_from_f32(weight);
+                break;
+            case WeightFormatQ8:
+                ((i8 *)weights)[slot] = (i8)lrintf(fminf(fmaxf(weight / scale, -127.0f), 127.0f));
+                break;
+            }
+        }
+    }
+}
+
+static usize compact_weight_size(WeightFormat format) {
+    return format == WeightFormatF32 ? sizeof(f32) : format == WeightFormatF16 ? sizeof(u16) : sizeof(i8);
+}
+
+void compact_init(CompactSynapses &compact, const Network &net, StorageFormat format) {
+    format = storage_format_resolve(format, net.neuron_count);
+
+    usize n = net.neuron_count;
+    usize slots = n * MAX_SYNAPSES;
+    compact.format = format;
+    compact.neuron_count = n;
+
+    compact.targets = malloc(slots * (format.targets == TargetFormatU16 ? sizeof(u16) : sizeof(i32)));
+    for (usize s = 0; s < slots; s++) {
+        i32 target = net.synapse_data[s] >= 0 ? net.synapse_data[s] : 0;
+        if (format.targets == TargetFormatU16) {
+            ((u16 *)compact.targets)[s] = (u16)target;
+        } else {
+            ((i32 *)compact.targets)[s] = target;
+        }
+    }
+
+    // 8 spare bytes so a Q8 row tail can be read as a whole 64-bit load
+    compact.weights = malloc(slots * compact_weight_size(format.weights) + 8);
+    compact.row_scale = format.weights == WeightFormatQ8 ? (f32 *)malloc(n * sizeof(f32)) : nullptr;
+    compact_encode_weights(net, format.weights, compact.weights, compact.row_scale);
+
+    compact.activation = nullptr;
+    compact.next_activation = nullptr;
+    if (format.activations == ActivationFormatF16) {
+        usize padded = (n + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH + 1;
+        compact.activation = (u16 *)calloc(padded, sizeof(u16));
+        compact.next_activation = (u16 *)calloc(padded, sizeof(u16));
+        for (usize i = 0; i < n; i++) {
+            compact.activation[i] = f16_from_f32(net.neuron_data[i * 4 + 2]);
+        }
+    }
+}
+
+void compact_deinit(CompactSynapses &compact) {
+    free(compact.targets);
+    free(compact.weights);
+    free(compact.row_scale);
+    free(compact.activation);
+    free(compact.next_activation);
+}
+
+f32 compact_weight(const CompactSynapses &compact, usize slot) {
+    switch (compact.format.weights) {
+    case WeightFormatF32:
+        return ((const f32 *)compact.weights)[slot];
+    case WeightFormatF16:
+        return f32_from_f16(((const u16 *)compact.weights)[slot]);
+    case WeightFormatQ8:
+        return ((const i8 *)compact.weights)[slot] * compact.row_scale[slot / MAX_SYNAPSES];
+    }
+    return 0.0f;
+}
+
+usize compact_pack_weights(const Network &net, WeightFormat format, Arena &arena, void **out, f32 **out_row_scale) {
+    // Rounded up to whole u32 words, the shader reads packed pairs and quads
+    usize size = (net.neuron_count * MAX_SYNAPSES * compact_weight_size(format) + 3) / 4 * 4;
+    *out = arena_alloc_zero(arena, size);
+    *out_row_scale = nullptr;
+
+    f32 *row_scale = nullptr;
+    if (format == WeightFormatQ8) row_scale = arena_push<f32>(arena, net.neuron_count);
+    compact_encode_weights(net, format, *out, row_scale);
+
+    if (row_scale) {
+        for (usize i = 0; i < net.neuron_count; i++) {
+            row_scale[i] *= 127.0f;
+        }
+        *out_row_scale = row_scale;
+    }
+    return size;
+}
+
+usize compact_pack_targets(const Network &net, TargetFormat format, Arena &arena, void **out) {
+    usize slots = net.neuron_count * MAX_SYNAPSES;
+    if (format == TargetFormatI32) {
+        *out = arena_push<i32>(arena, slots);
+        for (usize s = 0; s < slots; s++) {
+            ((i32 *)*out)[s] = net.synapse_data[s];
+        }
+        return slots * sizeof(i32);
+    }
+
+    usize size = (slots * sizeof(u16) + 3) / 4 * 4;
+    *out = arena_alloc_zero(arena, size);
+    for (usize s = 0; s < slots; s++) {
+        ((u16 *)*out)[s] = net.synapse_data[s] >= 0 ? (u16)net.synapse_data[s] : STORAGE_U16_PADDING;
+    }
+    return size;
+}
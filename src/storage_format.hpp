@@ -0,0 +1,69 @@
+#pragma once
+
+#include "core/arena.h"
+#include "core/types.h"
+
+#define STORAGE_U16_PADDING 0xFFFF // padding slot in uploaded 16-bit rows, so the largest usable index is one less
+#define STORAGE_U16_MAX_NEURONS 65535
+
+struct Network;
+
+// Reduced-precision encodings for the data a tick streams. Weights and targets are read once per synapse and
+// activations are gathered once per synapse, so narrowing them cuts the bytes per tick roughly in proportion.
+enum WeightFormat {
+    WeightFormatF32,
+    WeightFormatF16,
+    WeightFormatQ8, // int8 with one f32 scale per row
+};
+
+enum TargetFormat {
+    TargetFormatI32,
+    TargetFormatU16, // only when neuron_count <= STORAGE_U16_MAX_NEURONS
+};
+
+enum ActivationFormat {
+    ActivationFormatF32,
+    ActivationFormatF16, // host engine only, the GPU keeps activations in the vec4 neuron buffer the renderer draws
+};
+
+struct StorageFormat {
+    WeightFormat weights;
+    TargetFormat targets;
+    ActivationFormat activations;
+};
+
+static inline StorageFormat storage_format_default() {
+    return {WeightFormatF32, TargetFormatI32, ActivationFormatF32};
+}
+
+// Falls back to wider encodings the network cannot use, e.g. 16-bit targets beyond STORAGE_U16_MAX_NEURONS
+StorageFormat storage_format_resolve(StorageFormat format, usize neuron_count);
+
+// Bytes a tick reads and writes for one network in this format: targets, weights and row scales once per slot,
+// one activation gather per slot, and one activation read and write per neuron
+usize storage_format_bytes_per_tick(const StorageFormat &format, usize neuron_count);
+
+// Synapse rows re-encoded from a Network. Padding slots become target 0 with weight 0, so kernels reading this
+// layout never test for -1.
+struct CompactSynapses {
+    StorageFormat format;
+    usize neuron_count;
+
+    void *targets;  // i32 or u16, MAX_SYNAPSES per row
+    void *weights;  // f32, f16 bits or i8, MAX_SYNAPSES per row
+    f32 *row_scale; // Q8 only
+
+    // F16 only, double-buffered like CpuSim's activations and padded for SIMD gathers
+    u16 *activation;
+    u16 *next_activation;
+};
+
+void compact_init(CompactSynapses &compact, const Network &net, StorageFormat format);
+void compact_deinit(CompactSynapses &compact);
+f32 compact_weight(const CompactSynapses &compact, usize slot);
+
+// Packs weights for upload in the layout the compute shader decodes. Q8 scales are premultiplied by 127 to match
+// unpackSnorm4x8. Returns the byte size written to *out, both outputs are allocated from arena.
+usize compact_pack_weights(const Network &net, WeightFormat format, Arena &arena, void **out, f32 **out_row_scale);
+// 16-bit padding slots hold STORAGE_U16_PADDING, unlike CompactSynapses where padding is target 0 with weight 0
+usize compact_pack_targets(const Network &net, TargetFormat format, Arena &arena, void **out);
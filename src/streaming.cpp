@@ -0,0 +1,124 @@
+#include "streaming.hpp"
+
+#include "core/logger.h"
+
+#include <chrono>
+#include <cstring>
+
+#define STREAM_WAIT_TIMEOUT 1000000000 // ns, one second per attempt
+
+StreamBuffer global_stream_buffer;
+
+static f64 stream_now_ms() {
+    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+    return std::chrono::duration<f64, std::milli>(now).count();
+}
+
+void stream_buffer_init(StreamBuffer &stream) {
+    memset(&stream, 0, sizeof(stream));
+
+    GLint alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    stream.alignment = alignment > 16 ? (usize)alignment : 16;
+
+    const usize size = (usize)STREAM_REGION_SIZE * STREAM_REGION_COUNT;
+    glGenBuffers(1, &stream.buffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer);
+    if (glBufferStorage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_READ_BUFFER, size, nullptr, flags);
+        stream.mapped = (u8 *)glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, flags);
+    } else {
+        glBufferData(GL_COPY_READ_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    if (!stream.mapped) warn("Streaming buffer is not persistently mapped, uploads use glBufferSubData");
+    info("Streaming buffer: %d x %d KB regions", STREAM_REGION_COUNT, STREAM_REGION_SIZE / 1024);
+}
+
+void stream_buffer_deinit(StreamBuffer &stream) {
+    if (!stream.buffer) return;
+
+    for (usize i = 0; i < STREAM_REGION_COUNT; i++) {
+        if (stream.fences[i]) glDeleteSync(stream.fences[i]);
+    }
+    if (stream.mapped) {
+        glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &stream.buffer);
+    memset(&stream, 0, sizeof(stream));
+}
+
+bool stream_buffer_push(StreamBuffer &stream, const void *data, usize size, usize *offset) {
+    if (!stream.buffer) return false;
+
+    usize head = (stream.head + stream.alignment - 1) & ~(stream.alignment - 1);
+    if (head + size > STREAM_REGION_SIZE) {
+        stream.overflows++;
+        return false;
+    }
+
+    *offset = stream.region * STREAM_REGION_SIZE + head;
+    if (stream.mapped) {
+        memcpy(stream.mapped + *offset, data, size);
+    } else {
+        glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer);
+        glBufferSubData(GL_COPY_READ_BUFFER, *offset, size, data);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    stream.head = head + size;
+    stream.head_uploads++;
+    stream.bytes += size;
+    stream.uploads++;
+    return true;
+}
+
+void stream_buffer_upload(StreamBuffer &stream, GLuint target, usize target_offset, const void *data, usize size) {
+    usize offset;
+    if (stream_buffer_push(stream, data, size, &offset)) {
+        glBindBuffer(GL_COPY_READ_BUFFER, stream.buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, target_offset, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    } else {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, target);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, target_offset, size, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+}
+
+void stream_buffer_frame(StreamBuffer &stream) {
+    if (!stream.buffer) return;
+
+    stream.frame_bytes = stream.head;
+    stream.frame_uploads = stream.head_uploads;
+    stream.head = 0;
+    stream.head_uploads = 0;
+
+    if (stream.fences[stream.region]) glDeleteSync(stream.fences[stream.region]);
+    stream.fences[stream.region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stream.region = (stream.region + 1) % STREAM_REGION_COUNT;
+
+    // The oldest region is only reused once the GPU has finished the frame that wrote it
+    GLsync fence = stream.fences[stream.region];
+    if (!fence) return;
+
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        f64 start = stream_now_ms();
+        stream.fence_waits++;
+        do {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_WAIT_TIMEOUT);
+        } while (status == GL_TIMEOUT_EXPIRED);
+        stream.fence_wait_ms += stream_now_ms() - start;
+    }
+    if (status == GL_WAIT_FAILED) error("Streaming buffer fence wait failed");
+
+    glDeleteSync(fence);
+    stream.fences[stream.region] = nullptr;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/types.h"
+
+#include <glad/glad.h>
+
+#define STREAM_REGION_COUNT 3          // frames the CPU may run ahead of the GPU
+#define STREAM_REGION_SIZE (1 << 20)   // bytes per frame
+#define STREAM_STIMULUS_BINDING 10     // SSBO binding for index lists read straight out of the ring
+
+// Ring of per-frame upload regions in one persistently mapped buffer.
+//
+// Small dynamic uploads are copied into the current region and read by the GPU from there, either as a storage
+// buffer range or as the source of a glCopyBufferSubData, so they never orphan a buffer or stall on an implicit sync.
+// stream_buffer_frame fences the region just written and moves on to the oldest one, waiting only if the GPU is
+// still reading it.
+//
+// Without glBufferStorage (GL < 4.4 and no ARB_buffer_storage) the ring falls back to glBufferSubData into the same
+// regions, which is correct but may sync.
+struct StreamBuffer {
+    GLuint buffer;
+    u8 *mapped; // null on the fallback path
+    usize alignment;
+    usize region;
+    usize head; // bytes used in the current region
+    usize head_uploads;
+    GLsync fences[STREAM_REGION_COUNT];
+
+    // Stats, frame_* are for the last completed frame and include alignment padding
+    usize frame_bytes;
+    usize frame_uploads;
+    usize bytes;
+    usize uploads;
+    usize fence_waits; // fences not yet signalled when their region came round again
+    f64 fence_wait_ms;
+    usize overflows; // pushes that did not fit in the region, the caller uploads them itself
+};
+
+extern StreamBuffer global_stream_buffer;
+
+// Needs a current context
+void stream_buffer_init(StreamBuffer &stream);
+void stream_buffer_deinit(StreamBuffer &stream);
+
+// Copies size bytes into the current region and writes their offset in stream.buffer. Offsets are aligned for
+// glBindBufferRange on storage buffers. Returns false when the ring is not initialised or the region is full.
+bool stream_buffer_push(StreamBuffer &stream, const void *data, usize size, usize *offset);
+
+// Copies into a range of another buffer on the GPU timeline, falls back to glBufferSubData when the push fails
+void stream_buffer_upload(StreamBuffer &stream, GLuint target, usize target_offset, const void *data, usize size);
+
+// Call once per frame after the last command that reads this frame's region has been issued
+void stream_buffer_frame(StreamBuffer &stream);
@@ -0,0 +1,249 @@
+#include "topology.hpp"
+
+#include "core/arena.h"
+#include "core/logger.h"
+#include "core/parallel.h"
+#include "core/random.h"
+#include "spatial.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+#define TOPOLOGY_GRAIN 4096
+
+// Allocates a topology whose rows all have the same length, which every generator here produces except for the
+// empty rows of the first scale-free node and the input layer.
+static void topology_alloc(Topology &topo, usize neuron_count, usize synapse_count) {
+    topo.neuron_count = neuron_count;
+    topo.synapse_count = synapse_count;
+    topo.offsets = (u32 *)malloc((neuron_count + 1) * sizeof(u32));
+    topo.targets = (i32 *)malloc(synapse_count * sizeof(i32));
+    topo.weights = (f32 *)malloc(synapse_count * sizeof(f32));
+    topo.positions = (f32 *)malloc(neuron_count * 2 * sizeof(f32));
+    topo.kinds = (Neuron::Kind *)malloc(neuron_count * sizeof(Neuron::Kind));
+}
+
+// Same spiral as network_init so generated networks render the way the default one does
+static void topology_spiral_positions(Topology &topo) {
+    parallel_for(0, topo.neuron_count, TOPOLOGY_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            f32 angle = i * 0.5f;
+            f32 radius = sqrtf((f32)i / topo.neuron_count);
+            topo.positions[i * 2 + 0] = cosf(angle) * radius;
+            topo.positions[i * 2 + 1] = sinf(angle) * radius;
+            topo.kinds[i] = Neuron::Hidden;
+        }
+    });
+}
+
+static inline f32 topology_random_weight(Rng &rng) {
+    return 0.1f + rng_f32(rng) * 0.4f;
+}
+
+bool topology_generate(Topology &topo, const TopologyParams &params) {
+    if (params.neuron_count < 2 || params.degree == 0) {
+        error("Topology needs at least 2 neurons and a non-zero degree");
+        return false;
+    }
+
+    switch (params.kind) {
+    case TopologyParams::SmallWorld:
+        if (params.degree >= params.neuron_count) return false;
+        topology_small_world(topo, params.neuron_count, params.degree, params.rewire_probability, params.seed);
+        return true;
+    case TopologyParams::ScaleFree:
+        topology_scale_free(topo, params.neuron_count, params.degree, params.seed);
+        return true;
+    case TopologyParams::Spatial:
+        if (params.degree >= params.neuron_count) return false;
+        topology_spatial(topo, params.neuron_count, params.degree, params.decay_length, params.seed);
+        return true;
+    case TopologyParams::Layered:
+        if (params.layer_count < 2 || params.layer_count > params.neuron_count) return false;
+        topology_layered(topo, params.neuron_count, params.layer_count, params.degree, params.seed);
+        return true;
+    }
+
+    return false;
+}
+
+void topology_deinit(Topology &topo) {
+    free(topo.offsets);
+    free(topo.targets);
+    free(topo.weights);
+    free(topo.positions);
+    free(topo.kinds);
+    topo = {};
+}
+
+void topology_small_world(Topology &topo, usize neuron_count, usize k, f32 rewire_probability, u64 seed) {
+    topology_alloc(topo, neuron_count, neuron_count * k);
+    topology_spiral_positions(topo);
+
+    parallel_for(0, neuron_count, TOPOLOGY_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            Rng rng = rng_create(seed, i);
+            topo.offsets[i] = (u32)(i * k);
+
+            // Ring lattice: alternate between the next and previous neighbours, then rewire
+            for (usize j = 0; j < k; j++) {
+                usize distance = j / 2 + 1;
+                usize target = j % 2 == 0 ? (i + distance) % neuron_count
+                                          : (i + neuron_count - distance % neuron_count) % neuron_count;
+
+                if (rng_f32(rng) < rewire_probability) {
+                    target = rng_range(rng, (u32)(neuron_count - 1));
+                    if (target >= i) target++; // skip self
+                }
+
+                topo.targets[i * k + j] = (i32)target;
+                topo.weights[i * k + j] = topology_random_weight(rng);
+            }
+        }
+    });
+    topo.offsets[neuron_count] = (u32)(neuron_count * k);
+}
+
+// Preferential attachment is inherently sequential in its textbook form. This follows the edge-list formulation
+// (Batagelj & Brandes) where every edge endpoint is a slot in one long array and a new edge copies the value of a
+// uniformly chosen earlier slot. Because each slot's choice is a pure function of (seed, slot), any slot can be
+// resolved independently by following the chain of copies, so all rows are generated in parallel
+// (Sanders & Schulz). Two virtual slots holding neuron 0 seed the process.
+struct ScaleFreeSampler {
+    usize m;
+    u64 seed;
+
+    // Neuron that owns edge e, node 0 has no outgoing edges
+    inline usize source_of(usize e) const {
+        return 1 + e / m;
+    }
+
+    usize target_of(usize e) const {
+        usize source = source_of(e);
+        for (u64 attempt = 0; attempt < 32; attempt++) {
+            Rng rng = rng_create(seed, (u64)e * 32 + attempt);
+            usize slot = (usize)(rng_next(rng) % (u64)(2 * e + 2));
+            usize target;
+            if (slot < 2) {
+                target = 0;
+            } else if ((slot - 2) % 2 == 0) {
+                target = source_of((slot - 2) / 2);
+            } else {
+                target = target_of((slot - 2) / 2);
+            }
+            if (target != source) return target;
+        }
+
+        // Pathological run of self-loops, fall back to a uniform earlier neuron
+        Rng rng = rng_create(seed ^ 0x5ca1ab1eull, e);
+        return rng_range(rng, (u32)source);
+    }
+};
+
+void topology_scale_free(Topology &topo, usize neuron_count, usize m, u64 seed) {
+    topology_alloc(topo, neuron_count, (neuron_count - 1) * m);
+    topology_spiral_positions(topo);
+
+    ScaleFreeSampler sampler = {m, seed};
+    parallel_for(0, neuron_count, TOPOLOGY_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            topo.offsets[i] = i == 0 ? 0 : (u32)((i - 1) * m);
+            if (i == 0) continue;
+
+            Rng rng = rng_create(~seed, i);
+            for (usize j = 0; j < m; j++) {
+                usize e = (i - 1) * m + j;
+                topo.targets[e] = (i32)sampler.target_of(e);
+                topo.weights[e] = topology_random_weight(rng);
+            }
+        }
+    });
+    topo.offsets[neuron_count] = (u32)topo.synapse_count;
+}
+
+void topology_spatial(Topology &topo, usize neuron_count, usize k, f32 decay_length, u64 seed) {
+    topology_alloc(topo, neuron_count, neuron_count * k);
+    if (decay_length <= 0.0f) decay_length = 1.0f;
+
+    // Uniform over the unit disk
+    parallel_for(0, neuron_count, TOPOLOGY_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            Rng rng = rng_create(seed, i);
+            f32 radius = sqrtf(rng_f32(rng));
+            f32 angle = rng_f32(rng) * 6.2831853f;
+            topo.positions[i * 2 + 0] = cosf(angle) * radius;
+            topo.positions[i * 2 + 1] = sinf(angle) * radius;
+            topo.kinds[i] = Neuron::Hidden;
+        }
+    });
+
+    SpatialGrid grid;
+    spatial_grid_build(grid, topo.positions, 2, neuron_count);
+
+    // One slice of candidates per grain, carved here so workers never touch their own scratch. parallel_for starts
+    // every chunk on a grain boundary, so begin / TOPOLOGY_GRAIN is unique to the chunk.
+    Arena &scratch = arena_scratch();
+    usize mark = arena_mark(scratch);
+    usize slices = (neuron_count + TOPOLOGY_GRAIN - 1) / TOPOLOGY_GRAIN;
+    f32 *dist2_slices = arena_push<f32>(scratch, slices * k);
+    u32 *nearest_slices = arena_push<u32>(scratch, slices * k);
+
+    parallel_for(0, neuron_count, TOPOLOGY_GRAIN, [&](usize begin, usize end) {
+        f32 *dist2 = dist2_slices + begin / TOPOLOGY_GRAIN * k;
+        u32 *nearest = nearest_slices + begin / TOPOLOGY_GRAIN * k;
+
+        for (usize i = begin; i < end; i++) {
+            topo.offsets[i] = (u32)(i * k);
+            usize found = spatial_grid_knn(grid, topo.positions[i * 2 + 0], topo.positions[i * 2 + 1], k, (i32)i,
+                                           nearest, dist2);
+            for (usize j = 0; j < k; j++) {
+                if (j < found) {
+                    topo.targets[i * k + j] = (i32)nearest[j];
+                    topo.weights[i * k + j] = 0.5f * expf(-sqrtf(dist2[j]) / decay_length);
+                } else {
+                    topo.targets[i * k + j] = -1;
+                    topo.weights[i * k + j] = 0.0f;
+                }
+            }
+        }
+    });
+    topo.offsets[neuron_count] = (u32)topo.synapse_count;
+
+    arena_restore(scratch, mark);
+    spatial_grid_deinit(grid);
+}
+
+void topology_layered(Topology &topo, usize neuron_count, usize layer_count, usize fan_in, u64 seed) {
+    // Equal layers, the output layer takes the remainder
+    usize layer_size = neuron_count / layer_count;
+    usize input_count = layer_size;
+    topology_alloc(topo, neuron_count, (neuron_count - input_count) * fan_in);
+
+    parallel_for(0, neuron_count, TOPOLOGY_GRAIN, [&](usize begin, usize end) {
+        for (usize i = begin; i < end; i++) {
+            usize layer = i / layer_size;
+            if (layer >= layer_count) layer = layer_count - 1;
+            usize layer_begin = layer * layer_size;
+            usize layer_end = layer == layer_count - 1 ? neuron_count : layer_begin + layer_size;
+
+            topo.kinds[i] = layer == 0 ? Neuron::Input : layer == layer_count - 1 ? Neuron::Output : Neuron::Hidden;
+
+            // Layers are columns across the view, neurons spread vertically within them
+            f32 column = (f32)(i - layer_begin) / (f32)(layer_end - layer_begin);
+            topo.positions[i * 2 + 0] = -0.9f + 1.8f * (f32)layer / (f32)(layer_count - 1);
+            topo.positions[i * 2 + 1] = -0.9f + 1.8f * column;
+
+            topo.offsets[i] = i < input_count ? 0 : (u32)((i - input_count) * fan_in);
+            if (layer == 0) continue;
+
+            Rng rng = rng_create(seed, i);
+            usize previous_begin = layer_begin - layer_size;
+            for (usize j = 0; j < fan_in; j++) {
+                usize s = (i - input_count) * fan_in + j;
+                topo.targets[s] = (i32)(previous_begin + rng_range(rng, (u32)layer_size));
+                topo.weights[s] = topology_random_weight(rng);
+            }
+        }
+    });
+    topo.offsets[neuron_count] = (u32)topo.synapse_count;
+}
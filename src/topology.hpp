@@ -0,0 +1,42 @@
+#pragma once
+
+#include "core/types.h"
+#include "neural_net.hpp"
+
+// Connectivity in CSR form. Row i lists the presynaptic neurons that neuron i reads its input from, which is the
+// same orientation as the padded rows in Network::synapse_data.
+struct Topology {
+    usize neuron_count;
+    usize synapse_count;
+
+    u32 *offsets;  // neuron_count + 1
+    i32 *targets;  // synapse_count
+    f32 *weights;  // synapse_count
+    f32 *positions; // x,y per neuron
+    Neuron::Kind *kinds;
+};
+
+struct TopologyParams {
+    enum Kind {
+        SmallWorld, // Watts-Strogatz ring lattice with random rewiring
+        ScaleFree,  // Barabasi-Albert preferential attachment
+        Spatial,    // k nearest neighbours with distance-decayed weights
+        Layered,    // feed-forward Input -> Hidden... -> Output
+    };
+
+    Kind kind;
+    usize neuron_count;
+    usize degree;           // synapses per neuron: k for SmallWorld/Spatial, m for ScaleFree, fan-in for Layered
+    f32 rewire_probability; // SmallWorld
+    f32 decay_length;       // Spatial
+    usize layer_count;      // Layered, including the input and output layers
+    u64 seed;
+};
+
+bool topology_generate(Topology &topo, const TopologyParams &params);
+void topology_deinit(Topology &topo);
+
+void topology_small_world(Topology &topo, usize neuron_count, usize k, f32 rewire_probability, u64 seed);
+void topology_scale_free(Topology &topo, usize neuron_count, usize m, u64 seed);
+void topology_spatial(Topology &topo, usize neuron_count, usize k, f32 decay_length, u64 seed);
+void topology_layered(Topology &topo, usize neuron_count, usize layer_count, usize fan_in, u64 seed);
@@ -0,0 +1,392 @@
+#include "transport.hpp"
+
+#include "core/logger.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define TRANSPORT_SHM_MAGIC 0x53484d54u
+
+static f64 transport_now_ms() {
+    auto now = std::chrono::high_resolution_clock::now().time_since_epoch();
+    return std::chrono::duration<f64, std::milli>(now).count();
+}
+
+void transport_buffer_reserve(TransportBuffer &buffer, usize capacity) {
+    if (capacity <= buffer.capacity) return;
+    buffer.data = (u8 *)realloc(buffer.data, capacity);
+    buffer.capacity = capacity;
+}
+
+void transport_buffer_free(TransportBuffer &buffer) {
+    free(buffer.data);
+    buffer.data = nullptr;
+    buffer.size = buffer.capacity = 0;
+}
+
+static void transport_clear(Transport &transport, TransportKind kind, u32 rank, u32 rank_count) {
+    memset(&transport, 0, sizeof(transport));
+    transport.kind = kind;
+    transport.rank = rank;
+    transport.rank_count = rank_count;
+    for (u32 r = 0; r < TRANSPORT_MAX_RANKS; r++) {
+        transport.sockets[r] = -1;
+    }
+}
+
+#ifndef _WIN32
+
+// Shared memory layout: a header, then a mailbox per (sender, receiver) pair. A mailbox holds one chunk at a time,
+// the sender fills it and sets full, the receiver copies it out and clears full.
+struct ShmHeader {
+    std::atomic<u32> magic; // written last by rank 0, the mailboxes are ready once it is set
+    std::atomic<u32> attached;
+    u8 padding[56];
+};
+
+struct ShmMailbox {
+    std::atomic<u32> full;
+    u32 padding;
+    u64 total; // message size, repeated in every chunk
+    u64 chunk;
+    u8 padding_end[40];
+    u8 data[TRANSPORT_SHM_SLOT_SIZE];
+};
+
+static_assert(sizeof(ShmHeader) == 64 && sizeof(ShmMailbox) % 64 == 0, "mailboxes must not share cache lines");
+
+static ShmMailbox *transport_mailbox(Transport &transport, u32 from, u32 to) {
+    ShmMailbox *mailboxes = (ShmMailbox *)(transport.shm + sizeof(ShmHeader));
+    return &mailboxes[from * transport.rank_count + to];
+}
+
+bool transport_init_shm(Transport &transport, const char *name, u32 rank, u32 rank_count) {
+    transport_clear(transport, TransportShm, rank, rank_count);
+    if (rank_count > TRANSPORT_MAX_RANKS || rank >= rank_count) return false;
+
+    snprintf(transport.shm_name, sizeof(transport.shm_name), "%s", name);
+    transport.shm_size = sizeof(ShmHeader) + (usize)rank_count * rank_count * sizeof(ShmMailbox);
+
+    f64 deadline = transport_now_ms() + TRANSPORT_CONNECT_TIMEOUT * 1000.0;
+    int fd = -1;
+    if (rank == 0) {
+        shm_unlink(name);
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, (off_t)transport.shm_size) != 0) {
+            error("Failed to create shared memory segment %s", name);
+            if (fd >= 0) close(fd);
+            return false;
+        }
+    } else {
+        // Wait for rank 0 to create and size the segment
+        struct stat st;
+        while (true) {
+            fd = shm_open(name, O_RDWR, 0600);
+            if (fd >= 0 && fstat(fd, &st) == 0 && (usize)st.st_size == transport.shm_size) break;
+            if (fd >= 0) close(fd);
+            if (transport_now_ms() > deadline) {
+                error("Timed out waiting for shared memory segment %s", name);
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void *mapped = mmap(nullptr, transport.shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        error("Failed to map shared memory segment %s", name);
+        return false;
+    }
+    transport.shm = (u8 *)mapped;
+
+    // ftruncate zero fills, so every mailbox starts empty
+    ShmHeader *header = (ShmHeader *)transport.shm;
+    if (rank == 0) header->magic.store(TRANSPORT_SHM_MAGIC, std::memory_order_release);
+    while (header->magic.load(std::memory_order_acquire) != TRANSPORT_SHM_MAGIC) {
+        std::this_thread::yield();
+    }
+
+    header->attached.fetch_add(1, std::memory_order_acq_rel);
+    while (header->attached.load(std::memory_order_acquire) < rank_count) {
+        if (transport_now_ms() > deadline) {
+            error("Timed out waiting for %u ranks to attach to %s", rank_count, name);
+            transport_deinit(transport);
+            return false;
+        }
+        std::this_thread::yield();
+    }
+
+    // Everyone holds a mapping now, the name is no longer needed and is not left behind if a rank crashes
+    if (rank == 0) shm_unlink(name);
+    return true;
+}
+
+static bool transport_exchange_shm(Transport &transport, const TransportBuffer *send) {
+    usize sent[TRANSPORT_MAX_RANKS] = {};
+    usize received[TRANSPORT_MAX_RANKS] = {};
+    bool send_done[TRANSPORT_MAX_RANKS] = {};
+    bool receive_done[TRANSPORT_MAX_RANKS] = {};
+    send_done[transport.rank] = receive_done[transport.rank] = true;
+
+    usize remaining = 2 * (transport.rank_count - 1);
+    while (remaining > 0) {
+        bool progress = false;
+        for (u32 peer = 0; peer < transport.rank_count; peer++) {
+            ShmMailbox *out = transport_mailbox(transport, transport.rank, peer);
+            if (!send_done[peer] && out->full.load(std::memory_order_acquire) == 0) {
+                const TransportBuffer &message = send[peer];
+                usize chunk = message.size - sent[peer];
+                if (chunk > TRANSPORT_SHM_SLOT_SIZE) chunk = TRANSPORT_SHM_SLOT_SIZE;
+                memcpy(out->data, message.data + sent[peer], chunk);
+                out->total = message.size;
+                out->chunk = chunk;
+                out->full.store(1, std::memory_order_release);
+
+                sent[peer] += chunk;
+                // An empty message still takes one chunk so the receiver knows it arrived
+                if (sent[peer] == message.size) {
+                    send_done[peer] = true;
+                    remaining--;
+                }
+                progress = true;
+            }
+
+            ShmMailbox *in = transport_mailbox(transport, peer, transport.rank);
+            if (!receive_done[peer] && in->full.load(std::memory_order_acquire) == 1) {
+                TransportBuffer &message = transport.received[peer];
+                transport_buffer_reserve(message, in->total);
+                if (in->chunk > 0) memcpy(message.data + received[peer], in->data, in->chunk);
+                received[peer] += in->chunk;
+                message.size = in->total;
+                in->full.store(0, std::memory_order_release);
+
+                if (received[peer] == message.size) {
+                    receive_done[peer] = true;
+                    remaining--;
+                }
+                progress = true;
+            }
+        }
+        if (!progress) std::this_thread::yield();
+    }
+    return true;
+}
+
+bool transport_init_tcp(Transport &transport, const char *host, u16 base_port, u32 rank, u32 rank_count) {
+    transport_clear(transport, TransportTcp, rank, rank_count);
+    if (rank_count > TRANSPORT_MAX_RANKS || rank >= rank_count) return false;
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+        error("Invalid transport host %s", host);
+        return false;
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int yes = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    address.sin_port = htons((u16)(base_port + rank));
+    if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, (int)rank_count) != 0) {
+        error("Failed to listen on %s:%u", host, base_port + rank);
+        close(listener);
+        return false;
+    }
+
+    // Lower ranks are dialled, higher ranks dial in. connect completes from the listen backlog, so the order in
+    // which ranks reach this point does not matter.
+    f64 deadline = transport_now_ms() + TRANSPORT_CONNECT_TIMEOUT * 1000.0;
+    bool ok = true;
+    for (u32 peer = 0; peer < rank && ok; peer++) {
+        address.sin_port = htons((u16)(base_port + peer));
+        while (true) {
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (connect(fd, (sockaddr *)&address, sizeof(address)) == 0) {
+                transport.sockets[peer] = fd;
+                break;
+            }
+            close(fd);
+            if (transport_now_ms() > deadline) {
+                error("Timed out connecting to rank %u", peer);
+                ok = false;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (ok) ok = write(transport.sockets[peer], &rank, sizeof(rank)) == sizeof(rank);
+    }
+
+    for (u32 accepted = rank + 1; accepted < rank_count && ok; accepted++) {
+        int fd = accept(listener, nullptr, nullptr);
+        u32 peer = 0;
+        if (fd < 0 || recv(fd, &peer, sizeof(peer), MSG_WAITALL) != sizeof(peer) || peer <= rank ||
+            peer >= rank_count || transport.sockets[peer] >= 0) {
+            error("Bad connection on rank %u", rank);
+            if (fd >= 0) close(fd);
+            ok = false;
+            break;
+        }
+        transport.sockets[peer] = fd;
+    }
+    close(listener);
+
+    if (!ok) {
+        transport_deinit(transport);
+        return false;
+    }
+
+    for (u32 peer = 0; peer < rank_count; peer++) {
+        int fd = transport.sockets[peer];
+        if (fd < 0) continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+    return true;
+}
+
+// Messages are framed by a u64 length. Non-blocking sockets and one poll over all of them, so a rank never blocks
+// in a send while its peer blocks in a send back.
+static bool transport_exchange_tcp(Transport &transport, const TransportBuffer *send) {
+    u64 headers[TRANSPORT_MAX_RANKS];
+    u64 incoming[TRANSPORT_MAX_RANKS] = {};
+    usize sent[TRANSPORT_MAX_RANKS] = {};
+    usize received[TRANSPORT_MAX_RANKS] = {};
+    pollfd fds[TRANSPORT_MAX_RANKS];
+
+    for (u32 peer = 0; peer < transport.rank_count; peer++) {
+        headers[peer] = send[peer].size;
+    }
+
+    while (true) {
+        usize count = 0;
+        u32 peers[TRANSPORT_MAX_RANKS];
+        for (u32 peer = 0; peer < transport.rank_count; peer++) {
+            if (peer == transport.rank) continue;
+            bool sending = sent[peer] < sizeof(u64) + send[peer].size;
+            bool receiving = received[peer] < sizeof(u64) || received[peer] < sizeof(u64) + incoming[peer];
+            if (!sending && !receiving) continue;
+            fds[count].fd = transport.sockets[peer];
+            fds[count].events = (short)((sending ? POLLOUT : 0) | (receiving ? POLLIN : 0));
+            fds[count].revents = 0;
+            peers[count++] = peer;
+        }
+        if (count == 0) return true;
+
+        if (poll(fds, (nfds_t)count, -1) < 0) return false;
+
+        for (usize f = 0; f < count; f++) {
+            u32 peer = peers[f];
+            int fd = fds[f].fd;
+            if (fds[f].revents & (POLLERR | POLLNVAL)) return false;
+
+            if (fds[f].revents & POLLOUT) {
+                // Header first, then the payload
+                while (sent[peer] < sizeof(u64) + send[peer].size) {
+                    const u8 *from;
+                    usize size;
+                    if (sent[peer] < sizeof(u64)) {
+                        from = (const u8 *)&headers[peer] + sent[peer];
+                        size = sizeof(u64) - sent[peer];
+                    } else {
+                        from = send[peer].data + (sent[peer] - sizeof(u64));
+                        size = send[peer].size - (sent[peer] - sizeof(u64));
+                    }
+                    ssize_t written = ::send(fd, from, size, MSG_NOSIGNAL);
+                    if (written <= 0) break;
+                    sent[peer] += (usize)written;
+                }
+            }
+
+            if (fds[f].revents & (POLLIN | POLLHUP)) {
+                while (true) {
+                    u8 *to;
+                    usize size;
+                    if (received[peer] < sizeof(u64)) {
+                        to = (u8 *)&incoming[peer] + received[peer];
+                        size = sizeof(u64) - received[peer];
+                    } else {
+                        TransportBuffer &message = transport.received[peer];
+                        if (received[peer] == sizeof(u64)) {
+                            transport_buffer_reserve(message, incoming[peer]);
+                            message.size = incoming[peer];
+                        }
+                        if (received[peer] == sizeof(u64) + incoming[peer]) break;
+                        to = message.data + (received[peer] - sizeof(u64));
+                        size = incoming[peer] - (received[peer] - sizeof(u64));
+                    }
+                    ssize_t got = recv(fd, to, size, 0);
+                    if (got == 0) return false; // peer closed
+                    if (got < 0) break;
+                    received[peer] += (usize)got;
+                }
+            }
+        }
+    }
+}
+
+#else
+
+// Neither backend has a Windows port yet
+bool transport_init_shm(Transport &transport, const char *name, u32 rank, u32 rank_count) {
+    transport_clear(transport, TransportShm, rank, rank_count);
+    return false;
+}
+
+bool transport_init_tcp(Transport &transport, const char *host, u16 base_port, u32 rank, u32 rank_count) {
+    transport_clear(transport, TransportTcp, rank, rank_count);
+    return false;
+}
+
+static bool transport_exchange_shm(Transport &transport, const TransportBuffer *send) {
+    return false;
+}
+
+static bool transport_exchange_tcp(Transport &transport, const TransportBuffer *send) {
+    return false;
+}
+
+#endif
+
+bool transport_exchange(Transport &transport, const TransportBuffer *send) {
+    f64 start = transport_now_ms();
+    bool ok = transport.kind == TransportShm ? transport_exchange_shm(transport, send)
+                                             : transport_exchange_tcp(transport, send);
+
+    for (u32 peer = 0; peer < transport.rank_count; peer++) {
+        if (peer != transport.rank) transport.bytes_sent += send[peer].size;
+    }
+    transport.exchanges++;
+    transport.exchange_ms += transport_now_ms() - start;
+    return ok;
+}
+
+void transport_deinit(Transport &transport) {
+#ifndef _WIN32
+    if (transport.shm) munmap(transport.shm, transport.shm_size);
+    for (u32 r = 0; r < TRANSPORT_MAX_RANKS; r++) {
+        if (transport.sockets[r] >= 0) close(transport.sockets[r]);
+    }
+#endif
+    transport.shm = nullptr;
+
+    for (u32 r = 0; r < TRANSPORT_MAX_RANKS; r++) {
+        transport.sockets[r] = -1;
+        transport_buffer_free(transport.received[r]);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "core/types.h"
+
+#define TRANSPORT_MAX_RANKS 64
+#define TRANSPORT_SHM_SLOT_SIZE (256 << 10) // bytes per mailbox, larger messages go through in several chunks
+#define TRANSPORT_CONNECT_TIMEOUT 10.0     // seconds to wait for the other ranks to show up
+
+enum TransportKind {
+    TransportShm, // one POSIX shared memory segment holding a mailbox per ordered pair of ranks
+    TransportTcp, // a socket per pair of ranks, listening on base_port + rank
+};
+
+// One message in each direction between every pair of ranks per exchange, the collective the distributed engine
+// runs once a tick. Both backends progress every send and receive at once, so ranks exchanging large messages with
+// each other never wait on one another.
+struct TransportBuffer {
+    u8 *data;
+    usize size;
+    usize capacity;
+};
+
+struct Transport {
+    TransportKind kind;
+    u32 rank;
+    u32 rank_count;
+
+    // Shared memory
+    char shm_name[64];
+    u8 *shm;
+    usize shm_size;
+
+    // TCP, sockets[rank] is -1
+    int sockets[TRANSPORT_MAX_RANKS];
+
+    // Received messages, owned by the transport and valid until the next exchange
+    TransportBuffer received[TRANSPORT_MAX_RANKS];
+
+    // Stats
+    usize exchanges;
+    usize bytes_sent;
+    f64 exchange_ms;
+};
+
+// Every rank calls init with the same name and rank_count. The name must be unique to the run, rank 0 creates the
+// segment and unlinks it once everyone has attached.
+bool transport_init_shm(Transport &transport, const char *name, u32 rank, u32 rank_count);
+// host is where every rank listens, e.g. "127.0.0.1" for processes on one machine
+bool transport_init_tcp(Transport &transport, const char *host, u16 base_port, u32 rank, u32 rank_count);
+void transport_deinit(Transport &transport);
+
+// Sends send[peer] to every other rank and blocks until one message from each has arrived in received[peer].
+// send[rank] is ignored. Returns false when a peer disappeared.
+bool transport_exchange(Transport &transport, const TransportBuffer *send);
+
+void transport_buffer_reserve(TransportBuffer &buffer, usize capacity);
+void transport_buffer_free(TransportBuffer &buffer);